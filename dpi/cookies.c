@@ -1251,6 +1251,7 @@ static int Cookies_set(char *cookie_string, char *url_host,
 
 /*
  * Compare the cookie with the supplied data to see whether it matches
+ * (a NULL 'url_path' matches any path)
  */
 static bool_t Cookies_match(CookieData_t *cookie, const char *url_path,
                             bool_t host_only_val, bool_t is_tls)
@@ -1263,7 +1264,7 @@ static bool_t Cookies_match(CookieData_t *cookie, const char *url_path,
    if (cookie->secure && !is_tls)
       return FALSE;
 
-   if (!Cookies_path_matches(url_path, cookie->path))
+   if (url_path && !Cookies_path_matches(url_path, cookie->path))
       return FALSE;
 
    /* It's a match */
@@ -1316,22 +1317,16 @@ static void Cookies_add_matching_cookies(const char *domain,
 }
 
 /*
- * Return a string that contains all relevant cookies as headers.
+ * Return the list of cookies to be sent for a URL, longest paths first.
+ * With a NULL 'url_path', the cookies for any path on the host are returned.
  */
-static char *Cookies_get(char *url_host, char *url_path,
-                         char *url_scheme)
+static Dlist *Cookies_get_matching(char *url_host, char *url_path,
+                                   char *url_scheme)
 {
-   char *domain_str, *str;
-   CookieData_t *cookie;
+   char *domain_str;
    Dlist *matching_cookies;
    bool_t is_tls, is_ip_addr, host_only_val;
 
-   Dstr *cookie_dstring;
-   int i;
-
-   if (disabled)
-      return dStrdup("");
-
    matching_cookies = dList_new(8);
 
    /* Check if the protocol is secure or not */
@@ -1379,6 +1374,26 @@ static char *Cookies_get(char *url_host, char *url_path,
       }
    }
 
+   return matching_cookies;
+}
+
+/*
+ * Return a string that contains all relevant cookies as headers.
+ */
+static char *Cookies_get(char *url_host, char *url_path,
+                         char *url_scheme)
+{
+   char *str;
+   CookieData_t *cookie;
+   Dlist *matching_cookies;
+   Dstr *cookie_dstring;
+   int i;
+
+   if (disabled)
+      return dStrdup("");
+
+   matching_cookies = Cookies_get_matching(url_host, url_path, url_scheme);
+
    /* Found the cookies, now make the string */
    cookie_dstring = dStr_new("");
    if (dList_length(matching_cookies) > 0) {
@@ -1403,6 +1418,43 @@ static char *Cookies_get(char *url_host, char *url_path,
    return str;
 }
 
+/*
+ * Return all the cookies that may be sent to a host, whatever the path,
+ * for the browser's cookie cache: one line per cookie, in the order in
+ * which they are to be sent, as
+ *
+ *   <expiration time> <path length> <path> <name>=<value>
+ *
+ * with the expiration time in seconds since the epoch. The path goes with
+ * its length because it may contain spaces.
+ */
+static char *Cookies_get_jar(char *url_host, char *url_scheme)
+{
+   char *str;
+   CookieData_t *cookie;
+   Dlist *matching_cookies;
+   Dstr *jar_dstring;
+   int i;
+
+   if (disabled)
+      return dStrdup("");
+
+   matching_cookies = Cookies_get_matching(url_host, NULL, url_scheme);
+
+   jar_dstring = dStr_new("");
+   for (i = 0; (cookie = dList_nth_data(matching_cookies, i)); ++i)
+      dStr_sprintfa(jar_dstring, "%ld %d %s %s=%s\n",
+                    (long) cookie->expires_at, (int) strlen(cookie->path),
+                    cookie->path, cookie->name, cookie->value);
+   dList_free(matching_cookies);
+
+   str = jar_dstring->str;
+   dStr_free(jar_dstring, FALSE);
+   if (*str)
+      cookies_use_counter++;
+   return str;
+}
+
 /* -------------------------------------------------------------
  *                    Access control routines
  * ------------------------------------------------------------- */
@@ -1606,6 +1658,26 @@ static int srv_parse_tok(Dsh *sh, ClientInfo *client, char *Buf)
           ret = 2;
       }
       dFree(cookie);
+
+   } else if (strcmp(cmd, "get_cookie_jar") == 0) {
+      char *scheme = a_Dpip_get_attr_l(Buf, BufSize, "scheme");
+
+      host = a_Dpip_get_attr_l(Buf, BufSize, "host");
+
+      cookie = Cookies_get_jar(host, scheme);
+      dFree(scheme);
+      dFree(host);
+
+      dFree(cmd);
+      cmd = a_Dpip_build_cmd("cmd=%s jar=%s", "get_cookie_jar_answer",
+                             cookie);
+
+      if (a_Dpip_dsh_write_str(sh, 1, cmd)) {
+          ret = 1;
+      } else {
+          ret = 2;
+      }
+      dFree(cookie);
    }
    dFree(cmd);
 
@@ -327,7 +327,7 @@ DLItem::DLItem(const char *full_filename, const char *url, const char *user_agen
    
    if(dStrnAsciiCasecmp(esc_url, "gemini:/", 8) == 0) {
       /* Use internal Gemini downloader */
-      dl_argv[i++] = (char*)DILLO_LIBDIR "/dpi/gemini/gemini.filter.dpi";
+      dl_argv[i++] = (char*)DILLO_LIBDIR "/dpi/gemini/gemini.dpi";
       dl_argv[i++] = esc_url;
       dl_argv[i++] = fullname;
       /* ToDo: add the other options */
@@ -10,8 +10,9 @@
  */
 
 /*
- * Directory scanning is no longer streamed, but it gets sorted instead!
- * Directory entries on top, files next.
+ * Directory listings are streamed: rows are sent in batches while the
+ * directory is read. By default they're sorted (directory entries on top,
+ * files next), with big directories sorted in runs that are merged.
  * With new HTML layout.
  */
 
@@ -32,6 +33,11 @@
 #include <signal.h>
 #include <netinet/in.h>
 
+#ifdef __linux__
+#include <sys/sendfile.h>
+#define HAVE_SENDFILE 1
+#endif
+
 #include "../dpip/dpip.h"
 #include "dpiutil.h"
 #include "d_size.h"
@@ -47,6 +53,12 @@
 
 #define HIDE_DOTFILES TRUE
 
+/* Directory rows are read (and stat'ed) and sent in batches of this size */
+#define DIR_BATCH     256
+/* Sorted listings hold at most this many names in memory; bigger
+ * directories are sorted in runs kept in temporary files, then merged */
+#define DIR_RUN_SIZE  8192
+
 /*
  * Communication flags
  */
@@ -55,6 +67,7 @@
 #define FILE_WRITE       4     /* Sending data */
 #define FILE_DONE        8     /* Operation done */
 #define FILE_ERR        16     /* Operation error */
+#define FILE_NO_SENDFILE 32    /* sendfile() doesn't work for this file */
 
 typedef enum {
    st_start = 10,
@@ -65,13 +78,43 @@ typedef enum {
    st_err
 } FileState;
 
+/*
+ * A name read from a directory.
+ */
+typedef struct {
+   char *name;
+   int is_dir;
+} DirName;
+
+/*
+ * A sorted run of names, spilled to a temporary file.
+ */
+typedef struct {
+   FILE *fp;
+   DirName *head;          /* next name of this run (NULL at its end) */
+} DirRun;
+
+/*
+ * A directory listing in progress.
+ */
+typedef struct {
+   char *dirname;          /* with a trailing slash */
+   DIR *dir;
+   int eof;                /* readdir() is done */
+   int sorted;
+   Dlist *names;           /* DirName, read and not yet sent (or spilled) */
+   int pos;                /* next of 'names' to send */
+   Dlist *runs;            /* DirRun, to be merged */
+   int n;                  /* rows sent */
+} FileDir;
+
 typedef struct {
    Dsh *sh;
    char *orig_url;
    char *filename;
    int file_fd;
    off_t file_sz;
-   DilloDir *d_dir;
+   FileDir *d_dir;
    FileState state;
    int err_code;
    int flags;
@@ -88,6 +131,7 @@ static const char *File_content_type(const char *filename);
  */
 static int DPIBYE = 0;
 static int OLD_STYLE = 0;
+static int SORT_DIRS = 1;
 /* A list for the clients we are serving */
 static Dlist *Clients;
 /* Set of filedescriptors we're working on */
@@ -103,23 +147,99 @@ static void File_close(int fd)
 }
 
 /*
- * Allocate a DilloDir structure, set safe values in it and sort the entries.
+ * Directory listings ------------------------------------------------------
  */
-static DilloDir *File_dillodir_fs_new(char *dirname)
+
+static DirName *File_dirname_new(const char *name, int is_dir)
 {
-   struct stat sb;
-   struct dirent *de;
+   DirName *dn = dNew(DirName, 1);
+
+   dn->name = dStrdup(name);
+   dn->is_dir = is_dir;
+   return dn;
+}
+
+static void File_dirname_free(DirName *dn)
+{
+   if (dn) {
+      dFree(dn->name);
+      dFree(dn);
+   }
+}
+
+/*
+ * Directories first, then by name (as FileUtil_comp() does).
+ */
+static int File_dirname_cmp(const void *v1, const void *v2)
+{
+   const DirName *d1 = v1, *d2 = v2;
+
+   if (d1->is_dir != d2->is_dir)
+      return d1->is_dir ? -1 : 1;
+   return strcmp(d1->name, d2->name);
+}
+
+/*
+ * Open a directory for a streamed listing.
+ */
+static FileDir *File_dir_open(const char *dirname, int sorted)
+{
+   FileDir *fdir;
    DIR *dir;
-   DilloDir *Ddir;
-   char *full_path;
 
    if (!(dir = opendir(dirname)))
       return NULL;
 
-   Ddir = FileUtil_dillodir_new(dirname);
+   fdir = dNew(FileDir, 1);
+   fdir->dirname = dStrdup(dirname);
+   fdir->dir = dir;
+   fdir->eof = 0;
+   fdir->sorted = sorted;
+   fdir->names = dList_new(sorted ? DIR_RUN_SIZE : DIR_BATCH);
+   fdir->pos = 0;
+   fdir->runs = dList_new(8);
+   fdir->n = 0;
+   return fdir;
+}
+
+static void File_dir_free(FileDir *fdir)
+{
+   DirRun *run;
+   int i;
+
+   dReturn_if (fdir == NULL);
+
+   for (i = fdir->pos; i < dList_length(fdir->names); ++i)
+      File_dirname_free(dList_nth_data(fdir->names, i));
+   dList_free(fdir->names);
+   for (i = 0; (run = dList_nth_data(fdir->runs, i)); ++i) {
+      File_dirname_free(run->head);
+      fclose(run->fp);
+      dFree(run);
+   }
+   dList_free(fdir->runs);
+   if (fdir->dir)
+      closedir(fdir->dir);
+   dFree(fdir->dirname);
+   dFree(fdir);
+}
+
+/*
+ * Read up to 'max' more names into fdir->names.
+ * Only sorting needs to know which ones are directories; d_type tells
+ * that without a stat call, unless it's a symlink or not supported.
+ */
+static void File_dir_read(FileDir *fdir, int max)
+{
+   struct dirent *de;
+   struct stat sb;
+   int is_dir;
 
-   /* Scan every name and sort them */
-   while ((de = readdir(dir)) != 0) {
+   while (max > 0 && !fdir->eof) {
+      if (!(de = readdir(fdir->dir))) {
+         fdir->eof = 1;
+         break;
+      }
       if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
          continue;              /* skip "." and ".." */
 
@@ -132,21 +252,125 @@ static DilloDir *File_dillodir_fs_new(char *dirname)
             continue;
       }
 
-      full_path = dStrconcat(Ddir->dirname, de->d_name, NULL);
-      if (stat(full_path, &sb) == -1) {
-         dFree(full_path);
-         continue;              /* ignore files we can't stat */
+      is_dir = 0;
+      if (fdir->sorted) {
+#ifdef DT_DIR
+         if (de->d_type == DT_DIR)
+            is_dir = 1;
+         else if (de->d_type == DT_LNK || de->d_type == DT_UNKNOWN)
+#endif
+            is_dir = (fstatat(dirfd(fdir->dir), de->d_name, &sb, 0) == 0 &&
+                      S_ISDIR(sb.st_mode));
       }
-      
-      FileUtil_dillodir_add(Ddir, full_path, sb);
+      dList_append(fdir->names, File_dirname_new(de->d_name, is_dir));
+      --max;
    }
+}
 
-   closedir(dir);
+/*
+ * Read a name from a spilled run into its head.
+ */
+static void File_dirrun_advance(DirRun *run)
+{
+   Dstr *ds;
+   int c, is_dir;
+
+   run->head = NULL;
+   if ((is_dir = getc(run->fp)) == EOF)
+      return;
+   ds = dStr_sized_new(64);
+   while ((c = getc(run->fp)) != EOF && c != '\0')
+      dStr_append_c(ds, c);
+   run->head = File_dirname_new(ds->str, is_dir == 'd');
+   dStr_free(ds, 1);
+}
 
-   /* sort the entries */
-   dList_sort(Ddir->flist, (dCompareFunc)FileUtil_comp);
+/*
+ * Sort the names in memory and move them to a temporary file, as a run
+ * to be merged later.
+ * Return: 0 on success, -1 on error.
+ */
+static int File_dir_spill(FileDir *fdir)
+{
+   DirName *dn;
+   DirRun *run;
+   FILE *fp;
+   int i;
+
+   if (!(fp = tmpfile()))
+      return -1;
+   dList_sort(fdir->names, File_dirname_cmp);
+   for (i = 0; (dn = dList_nth_data(fdir->names, i)); ++i) {
+      fputc(dn->is_dir ? 'd' : '-', fp);
+      fputs(dn->name, fp);
+      fputc('\0', fp);
+      File_dirname_free(dn);
+   }
+   dList_free(fdir->names);
+   fdir->names = dList_new(DIR_RUN_SIZE);
+   if (fflush(fp) != 0 || fseek(fp, 0, SEEK_SET) != 0) {
+      fclose(fp);
+      return -1;
+   }
+   run = dNew(DirRun, 1);
+   run->fp = fp;
+   File_dirrun_advance(run);
+   dList_append(fdir->runs, run);
+   return 0;
+}
+
+/*
+ * Read the whole directory for a sorted listing, a run at a time (this is
+ * called until fdir->eof). Once read, it's either sorted in memory, or
+ * all the runs are spilled and ready to be merged.
+ * Return: 0 on success, -1 on error.
+ */
+static int File_dir_read_sorted(FileDir *fdir)
+{
+   File_dir_read(fdir, DIR_RUN_SIZE - dList_length(fdir->names));
+   if (!fdir->eof || dList_length(fdir->runs)) {
+      if (dList_length(fdir->names) && File_dir_spill(fdir) != 0)
+         return -1;
+   } else {
+      dList_sort(fdir->names, File_dirname_cmp);
+   }
+   return 0;
+}
+
+/*
+ * Get the next name to list, or NULL when done.
+ * The caller owns the returned name.
+ */
+static DirName *File_dir_next(FileDir *fdir)
+{
+   DirName *dn = NULL;
+   DirRun *run, *min = NULL;
+   int i;
+
+   if (dList_length(fdir->runs)) {
+      /* merge the runs; there are few, a linear search is fine */
+      for (i = 0; (run = dList_nth_data(fdir->runs, i)); ++i) {
+         if (run->head &&
+             (!min || File_dirname_cmp(run->head, min->head) < 0))
+            min = run;
+      }
+      if (min) {
+         dn = min->head;
+         File_dirrun_advance(min);
+      }
+      return dn;
+   }
 
-   return Ddir;
+   if (fdir->pos == dList_length(fdir->names) && !fdir->eof) {
+      /* unsorted: read the next batch */
+      dList_free(fdir->names);
+      fdir->names = dList_new(DIR_BATCH);
+      fdir->pos = 0;
+      File_dir_read(fdir, DIR_BATCH);
+   }
+   if (fdir->pos < dList_length(fdir->names))
+      dn = dList_nth_data(fdir->names, fdir->pos++);
+   return dn;
 }
 
 /*
@@ -180,14 +404,18 @@ static const char *File_content_type(const char *filename)
 
 /*
  * Send the HTML directory page in HTTP.
+ * Rows are sent DIR_BATCH at a time, each batch once the previous one has
+ * been written out, so the page shows up as the directory is read.
  */
 static void File_send_dir(ClientInfo *client)
 {
-   int n;
+   int i, st;
    char *d_cmd;
    const char *filecont;
-   FileInfo *finfo;
-   DilloDir *Ddir = client->d_dir;
+   struct stat sb;
+   FileInfo finfo;
+   DirName *dn;
+   FileDir *fdir = client->d_dir;
 
    if (client->state == st_start) {
       /* Send DPI command */
@@ -201,34 +429,69 @@ static void File_send_dir(ClientInfo *client)
       /* send HTTP header and HTML top part */
 
       /* Send page title */
-      FileUtil_print_page_header(client->sh, "file", Ddir->dirname, client->old_style);
+      FileUtil_print_page_header(client->sh, "file", fdir->dirname, client->old_style);
 
       /* Output the parent directory */
-      FileUtil_print_parent_dir(client->sh, "file", Ddir->dirname);
+      FileUtil_print_parent_dir(client->sh, "file", fdir->dirname);
 
-      /* HTML style toggle */
-      a_Dpip_dsh_write_str(client->sh, 0,
-         "&nbsp;&nbsp;<a href='dpi:/file/toggle'>%</a>\n");
-	 
-      /* Output the file listing table */
-      FileUtil_print_table_header(client->sh, dList_length(Ddir->flist), client->old_style);
+      /* HTML style and sorting toggles */
+      a_Dpip_dsh_printf(client->sh, 1,
+         "&nbsp;&nbsp;<a href='dpi:/file/toggle'>%%</a>"
+         "&nbsp;&nbsp;<a href='dpi:/file/sort'>%s</a>\n",
+         fdir->sorted ? "unsorted" : "sorted");
 
       client->state = st_http;
 
    } else if (client->state == st_http) {
-      /* send directories as HTML contents */
-      for (n = 0; n < dList_length(Ddir->flist); ++n) {
-         finfo = dList_nth_data(Ddir->flist,n);
-         filecont = File_content_type(finfo->full_path);
-         FileUtil_print_info(client->sh, finfo, n+1, filecont, client->old_style);
+      if ((st = a_Dpip_dsh_tryflush(client->sh)) != 0) {
+         /* wait until the last batch is out */
+         client->flags |= (st == -3) ? FILE_ERR : 0;
+         return;
+      }
+      if (fdir->sorted && !fdir->eof) {
+         /* still reading the names */
+         if (File_dir_read_sorted(fdir) != 0) {
+            MSG("\nERROR while sorting directory '%s': %s\n\n",
+                fdir->dirname, dStrerror(errno));
+            client->flags |= FILE_ERR;
+         }
+         return;
       }
-      
-      FileUtil_print_table_footer(client->sh, dList_length(Ddir->flist), client->old_style);
 
-      FileUtil_print_page_footer(client->sh, client->old_style);
+      /* send a batch of rows */
+      for (i = 0; i < DIR_BATCH; ) {
+         if (!(dn = File_dir_next(fdir)))
+            break;
+         if (fstatat(dirfd(fdir->dir), dn->name, &sb, 0) == 0) {
+            /* ignore files we can't stat */
+            finfo.full_path = dStrconcat(fdir->dirname, dn->name, NULL);
+            finfo.filename = finfo.full_path + strlen(fdir->dirname);
+            finfo.size = sb.st_size;
+            finfo.mode = sb.st_mode;
+            finfo.mtime = sb.st_mtime;
+            if (fdir->n++ == 0)
+               FileUtil_print_table_header(client->sh, 1, client->old_style);
+            filecont = File_content_type(finfo.full_path);
+            FileUtil_print_info(client->sh, &finfo, fdir->n, filecont,
+                                client->old_style);
+            dFree(finfo.full_path);
+            ++i;
+         }
+         File_dirname_free(dn);
+      }
+
+      if (i == DIR_BATCH) {
+         a_Dpip_dsh_tryflush(client->sh);
+      } else {
+         if (fdir->n == 0)
+            FileUtil_print_table_header(client->sh, 0, client->old_style);
+         FileUtil_print_table_footer(client->sh, fdir->n, client->old_style);
+
+         FileUtil_print_page_footer(client->sh, client->old_style);
 
-      client->state = st_content;
-      client->flags |= FILE_DONE;
+         client->state = st_content;
+         client->flags |= FILE_DONE;
+      }
    }
 }
 
@@ -285,13 +548,13 @@ static void File_send_error_page(ClientInfo *client)
 }
 
 /*
- * Scan the directory, sort and prepare to send it enclosed in HTTP.
+ * Open the directory and prepare to send it enclosed in HTTP.
  */
 static int File_prepare_send_dir(ClientInfo *client,
                                  const char *DirName, const char *orig_url)
 {
    Dstr *ds_dirname;
-   DilloDir *Ddir;
+   FileDir *fdir;
 
    /* Let's make sure this directory url has a trailing slash */
    ds_dirname = dStr_new(DirName);
@@ -299,12 +562,12 @@ static int File_prepare_send_dir(ClientInfo *client,
       dStr_append(ds_dirname, "/");
 
    /* Let's get a structure ready for transfer */
-   Ddir = File_dillodir_fs_new(ds_dirname->str);
+   fdir = File_dir_open(ds_dirname->str, SORT_DIRS);
    dStr_free(ds_dirname, TRUE);
-   if (Ddir) {
+   if (fdir) {
       /* looks ok, set things accordingly */
       client->orig_url = dStrdup(orig_url);
-      client->d_dir = Ddir;
+      client->d_dir = fdir;
       client->state = st_start;
       client->flags &= ~FILE_READ;
       client->flags |= FILE_WRITE;
@@ -368,6 +631,43 @@ static void File_get(ClientInfo *client, const char *filename,
    }
 }
 
+#ifdef HAVE_SENDFILE
+/*
+ * Send the next chunk of the file straight from the kernel's page cache
+ * to the socket, without copying it through a user space buffer.
+ * Return: 1 chunk sent (or EAGAIN), 0 on EOF, -1 if sendfile() can't be
+ *         used here (fall back to read/write), -3 on error.
+ */
+static int File_sendfile(ClientInfo *client)
+{
+   const size_t chunk = 1024*1024; /* let other clients in between */
+   int fd_out = client->sh->fd_out, old_flags;
+   ssize_t st;
+
+   /* non-blocking, as Dsh does for its own writes */
+   old_flags = fcntl(fd_out, F_GETFL);
+   if (!(old_flags & O_NONBLOCK))
+      fcntl(fd_out, F_SETFL, old_flags | O_NONBLOCK);
+   do {
+      st = sendfile(fd_out, client->file_fd, NULL, chunk);
+   } while (st < 0 && errno == EINTR);
+   if (!(old_flags & O_NONBLOCK))
+      fcntl(fd_out, F_SETFL, old_flags);
+
+   if (st > 0)
+      return 1;
+   else if (st == 0)
+      return 0;
+   else if (errno == EAGAIN)
+      return 1;
+   else if (errno == EINVAL || errno == ENOSYS)
+      return -1;
+   MSG("\nERROR while sending file '%s': %s\n\n",
+       client->filename, dStrerror(errno));
+   return -3;
+}
+#endif /* HAVE_SENDFILE */
+
 /*
  * Send HTTP headers and then the file itself.
  */
@@ -429,7 +729,22 @@ static int File_send_file(ClientInfo *client)
       /* Send body -- raw file contents */
       if ((st = a_Dpip_dsh_tryflush(client->sh)) < 0) {
          client->flags |= (st == -3) ? FILE_ERR : 0;
+#ifdef HAVE_SENDFILE
+      } else if (st == 0 && !(client->flags & FILE_NO_SENDFILE) &&
+                 (st = File_sendfile(client)) != -1) {
+         /* headers flushed, the kernel sends the body */
+         if (st == 0) {
+            client->state = st_content;
+            client->flags |= FILE_DONE;
+         } else if (st == -3) {
+            client->flags |= FILE_ERR;
+         }
+#endif
       } else {
+#ifdef HAVE_SENDFILE
+         if (st == -1)
+            client->flags |= FILE_NO_SENDFILE;
+#endif
          /* no pending data, let's send new data */
          do {
             st2 = read(client->file_fd, buf, LBUF);
@@ -452,6 +767,19 @@ static int File_send_file(ClientInfo *client)
    return 0;
 }
 
+/*
+ * Toggle directory sorting and ask for a reload.
+ */
+static void File_toggle_sort(ClientInfo *client)
+{
+   char *d_cmd;
+
+   SORT_DIRS = !SORT_DIRS;
+   d_cmd = a_Dpip_build_cmd("cmd=%s", "reload_request");
+   a_Dpip_dsh_write_str(client->sh, 1, d_cmd);
+   dFree(d_cmd);
+}
+
 /*
  * Set the style flag and ask for a reload, so it shows immediately.
  */
@@ -513,7 +841,7 @@ static void File_remove_client(ClientInfo *client)
    File_close(client->file_fd);
    dFree(client->orig_url);
    dFree(client->filename);
-   FileUtil_dillodir_free(client->d_dir);
+   File_dir_free(client->d_dir);
 
    dFree(client);
 }
@@ -558,6 +886,9 @@ static void File_serve_client(void *data, int f_write)
                } else if (url && dStrnAsciiCasecmp(url, "dpi:", 4) == 0 &&
                           strcmp(url+4, "/file/toggle") == 0) {
                   File_toggle_html_style(client);
+               } else if (url && dStrnAsciiCasecmp(url, "dpi:", 4) == 0 &&
+                          strcmp(url+4, "/file/sort") == 0) {
+                  File_toggle_sort(client);
                } else if (path) {
                   File_get(client, path, url);
                } else {
@@ -32,12 +32,19 @@
  */
 
 /*
+ * This is a server dpi: it stays running, so that the SSL context is set up
+ * once, and the address and last TLS session of every host are remembered
+ * (a Gemini connection is closed after each response, but resuming the
+ * session saves most of the handshake). Every connection is served by a
+ * child process, so that a slow server or an unanswered certificate dialog
+ * doesn't hold up the other requests; the child reports what it learned
+ * about the hosts (their address and TLS session) back over a pipe.
+ *
  * TODO: a lot of things, this is just a bare bones example.
  *
  * For instance:
  * - Certificate authentication (asking the user in case it can't be verified)
  * - Certificate management.
- * - Session caching ...
  *
  */
 
@@ -45,6 +52,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/select.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <sys/un.h>
@@ -56,6 +64,8 @@
 #include <errno.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
 
 #include "../dpip/dpip.h"
 #include "dpiutil.h"
@@ -77,24 +87,87 @@
 #include <openssl/rand.h>
 #include <openssl/ssl.h>
 
-static int get_network_connection(char * url);
+/* Max. number of hosts to remember, and for how long (in seconds) their
+ * address is good */
+#define GEMINI_MAX_HOSTS 64
+#define GEMINI_DNS_TTL  300
+/* Seconds to wait for a TCP connection */
+#define GEMINI_CONNECT_TIMEOUT  30
+
+typedef struct {
+   char *name;
+   int port;
+   struct sockaddr_storage addr;
+   socklen_t addr_len;         /* 0 if not resolved */
+   time_t resolved;
+   SSL_SESSION *session;       /* the last one, to resume it */
+   int session_checked;        /* its certificate was checked */
+} GeminiHost;
+
+/* What a child reports about a host: followed by the host name and the
+ * DER encoded session */
+typedef struct {
+   int port;
+   int name_len;
+   struct sockaddr_storage addr;
+   socklen_t addr_len;
+   time_t resolved;
+   int session_len;
+   int session_checked;
+} GeminiHostReport;
+
+static int get_network_connection(GeminiHost *host);
 static int handle_certificate_problem(SSL * ssl_connection);
 static int save_certificate_home(X509 * cert);
 
 #endif
 
-char servername[1024];
-
 /*---------------------------------------------------------------------------*/
 /*
  * Global variables
  */
-static char *root_url = NULL;  /*Holds the URL we are connecting to*/
 static Dsh *sh;
+static int DPIBYE = 0;
+
+/* The pipes to read the reports of the children from */
+typedef struct {
+   int fd;
+   Dstr *data;
+} Reporter;
+
+static Dlist *Reporters = NULL;
+
+/* In a child, the pipe to report to the server */
+static int report_fd = -1;
+
+/*
+ * Write data to the server, in a child.
+ */
+static void Gemini_report(const void *data, size_t len)
+{
+   const char *p = data;
+   ssize_t st;
+
+   while (report_fd != -1 && len > 0) {
+      if ((st = write(report_fd, p, len)) < 0) {
+         if (errno == EINTR)
+            continue;
+         MSG("can't report to the server: %s\n", dStrerror(errno));
+         return;
+      }
+      p += st;
+      len -= st;
+   }
+}
 
 
 #ifdef ENABLE_SSL
 
+static SSL_CTX *ssl_context = NULL;
+
+/* The hosts we've connected to, most recently used first */
+static Dlist *Hosts = NULL;
+
 static const char *const ca_files[] = {
    "/etc/ssl/certs/ca-certificates.crt",
    "/etc/pki/tls/certs/ca-bundle.crt",
@@ -243,6 +316,174 @@ SSL_CTX *init_ssl(void)
    return exit_error ? NULL : ssl_context;
 }
 
+/*
+ * Get the host name and port out of a URL.
+ */
+static void Gemini_parse_host(const char *url, char **name, int *port)
+{
+   const char *p;
+   uint_t len;
+
+   *port = 1965;
+
+   /*Determine how much of url we chop off as unneeded*/
+   if (dStrnAsciiCasecmp(url, "gemini://", 9) == 0)
+      url += 9;
+
+   /*Find end of URL*/
+   if ((p = strpbrk(url, ":/")) != NULL) {
+      len = p - url;
+      /*Check for port number*/
+      if (*p == ':')
+         *port = strtol(p + 1, NULL, 10);
+   } else {
+      len = strlen(url);
+   }
+   *name = dStrndup(url, len);
+}
+
+static void Gemini_host_free(GeminiHost *host)
+{
+   if (host->session)
+      SSL_SESSION_free(host->session);
+   dFree(host->name);
+   dFree(host);
+}
+
+/*
+ * Find the entry for a host, or make a new one.
+ */
+static GeminiHost *Gemini_host_find(const char *name, int port)
+{
+   GeminiHost *host;
+   int i;
+
+   if (!Hosts)
+      Hosts = dList_new(GEMINI_MAX_HOSTS + 1);
+
+   for (i = 0; (host = dList_nth_data(Hosts, i)); ++i) {
+      if (host->port == port && !dStrAsciiCasecmp(host->name, name)) {
+         dList_remove(Hosts, host);
+         dList_prepend(Hosts, host);
+         return host;
+      }
+   }
+
+   host = dNew0(GeminiHost, 1);
+   host->name = dStrdup(name);
+   host->port = port;
+   dList_prepend(Hosts, host);
+   if (dList_length(Hosts) > GEMINI_MAX_HOSTS) {
+      GeminiHost *lru = dList_nth_data(Hosts, GEMINI_MAX_HOSTS);
+      dList_remove(Hosts, lru);
+      Gemini_host_free(lru);
+   }
+   return host;
+}
+
+/*
+ * Find the entry for the host of a URL, or make a new one.
+ */
+static GeminiHost *Gemini_host_get(const char *url)
+{
+   GeminiHost *host;
+   char *name;
+   int port;
+
+   Gemini_parse_host(url, &name, &port);
+   host = Gemini_host_find(name, port);
+   dFree(name);
+   return host;
+}
+
+/*
+ * Tell the server, from a child, the address and session of a host.
+ */
+static void Gemini_host_report(GeminiHost *host)
+{
+   GeminiHostReport rep;
+   unsigned char *der = NULL, *p;
+   int der_len = 0;
+
+   if (host->session && (der_len = i2d_SSL_SESSION(host->session, NULL)) > 0){
+      der = p = dNew(unsigned char, der_len);
+      der_len = i2d_SSL_SESSION(host->session, &p);
+   }
+   memset(&rep, 0, sizeof(rep));
+   rep.port = host->port;
+   rep.name_len = strlen(host->name);
+   memcpy(&rep.addr, &host->addr, sizeof(rep.addr));
+   rep.addr_len = host->addr_len;
+   rep.resolved = host->resolved;
+   rep.session_len = MAX(der_len, 0);
+   rep.session_checked = host->session_checked;
+
+   Gemini_report("H", 1);
+   Gemini_report(&rep, sizeof(rep));
+   Gemini_report(host->name, rep.name_len);
+   Gemini_report(der, rep.session_len);
+   dFree(der);
+}
+
+/*
+ * Take in the report of a child about a host.
+ * Return: the length of the report, or 0 if it's incomplete.
+ */
+static size_t Gemini_host_take_report(const char *data, size_t len)
+{
+   GeminiHostReport rep;
+   GeminiHost *host;
+   const unsigned char *der;
+   char *name;
+
+   if (len < sizeof(rep))
+      return 0;
+   memcpy(&rep, data, sizeof(rep));
+   if (len < sizeof(rep) + rep.name_len + rep.session_len)
+      return 0;
+
+   name = dStrndup(data + sizeof(rep), rep.name_len);
+   host = Gemini_host_find(name, rep.port);
+   dFree(name);
+   memcpy(&host->addr, &rep.addr, sizeof(host->addr));
+   host->addr_len = rep.addr_len;
+   host->resolved = rep.resolved;
+   if (host->session) {
+      SSL_SESSION_free(host->session);
+      host->session = NULL;
+   }
+   if (rep.session_len > 0) {
+      der = (const unsigned char *)data + sizeof(rep) + rep.name_len;
+      host->session = d2i_SSL_SESSION(NULL, &der, rep.session_len);
+   }
+   host->session_checked = rep.session_checked;
+   _MSG("Took the report about %s\n", host->name);
+   return sizeof(rep) + rep.name_len + rep.session_len;
+}
+
+/*
+ * Remember the session of a connection, to resume it the next time.
+ * 'checked' tells whether the server certificate was checked.
+ */
+static void Gemini_host_save_session(GeminiHost *host, SSL *ssl_connection,
+                                     int checked)
+{
+   SSL_SESSION *session = SSL_get1_session(ssl_connection);
+
+   if (session == NULL)
+      return;
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+   if (!SSL_SESSION_is_resumable(session)) {
+      SSL_SESSION_free(session);
+      return;
+   }
+#endif
+   if (host->session)
+      SSL_SESSION_free(host->session);
+   host->session = session;
+   host->session_checked = checked;
+}
+
 /*
  * This function initializes an SSL connection
  */
@@ -273,8 +514,8 @@ static SSL *init_ssl_connection(SSL_CTX *ssl_context)
 /*
  * This function opens a socket to an URL for the SSL connection
  */
-static int open_ssl_connection(SSL *ssl_connection, char *url,
-                               char *proxy_url, char *proxy_connect,
+static int open_ssl_connection(SSL *ssl_connection, GeminiHost *host,
+                               GeminiHost *proxy, char *proxy_connect,
                                int check_cert)
 {
    /* The following variable will be set to 1 in the event of
@@ -283,7 +524,7 @@ static int open_ssl_connection(SSL *ssl_connection, char *url,
    int exit_error = 0;
    int network_socket = -1;
 
-   network_socket = get_network_connection(proxy_url ? proxy_url : url);
+   network_socket = get_network_connection(proxy ? proxy : host);
    if (network_socket<0){
       MSG("Network socket create error\n");
       exit_error = 1;
@@ -353,12 +594,17 @@ static int open_ssl_connection(SSL *ssl_connection, char *url,
 
    if (exit_error == 0){
       /* Configure SSL to use the servername */
-      if(SSL_set_tlsext_host_name(ssl_connection, servername) == 0) {
+      if(SSL_set_tlsext_host_name(ssl_connection, host->name) == 0) {
          MSG("Error setting servername to SSL\n");
          exit_error = 1;
      }
    }
-   
+
+   if (exit_error == 0 && host->session){
+      /* Try to resume the last session with this host */
+      SSL_set_session(ssl_connection, host->session);
+   }
+
    if (exit_error == 0){
       /*Actually do SSL connection handshake*/
       if (SSL_connect(ssl_connection) != 1){
@@ -370,7 +616,11 @@ static int open_ssl_connection(SSL *ssl_connection, char *url,
 
    /*Use handle error function to decide what to do*/
    if (exit_error == 0){
-      if (check_cert && handle_certificate_problem(ssl_connection) < 0){
+      /* A resumed session was checked when it was made */
+      if (SSL_session_reused(ssl_connection) && host->session_checked){
+         _MSG("Resumed session with %s\n", host->name);
+      } else if (check_cert &&
+                 handle_certificate_problem(ssl_connection) < 0){
          MSG("Certificate verification error\n");
          exit_error = 1;
       }
@@ -415,40 +665,43 @@ int gemini_send_request(SSL *ssl_connection, char *query,
    return gemini_code;
 }
 
+/*
+ *  Send the response body to dillo, as it arrives.
+ */
+static void gemini_send_body(SSL *ssl_connection)
+{
+   char buf[16*1024];
+   int ret;
+
+   while ((ret = SSL_read(ssl_connection, buf, sizeof(buf))) > 0)
+      a_Dpip_dsh_write(sh, 1, buf, (size_t)ret);
+}
+
 /*
  *  This function does all of the work with SSL
  */
-static void yes_ssl_support(void)
+static void yes_ssl_support(SSL_CTX *ssl_context)
 {
    /* The following variable will be set to 1 in the event of
     * an error and skip any further processing
     */
    int exit_error = 0;
-   SSL_CTX * ssl_context = NULL;
    SSL * ssl_connection = NULL;
+   GeminiHost *host = NULL, *proxy = NULL;
 
    char *dpip_tag = NULL, *cmd = NULL, *url = NULL, *gemini_query = NULL,
         *proxy_url = NULL, *proxy_connect = NULL, *check_cert = NULL;
    char buf[4096], outbuf[4096*4];
-   int ret = 0;
    int network_socket = -1;
 
    int gemini_code = -1;
 
-   MSG("{In gemini.filter.dpi}\n");
-
-   /* Create context and SSL object */
-   if ((ssl_context = init_ssl()) == NULL){
-      MSG("Error creating SSL context\n");
-      exit_error = 1;
-   }
+   MSG("{In gemini.dpi}\n");
 
    /* Init an SSL connection */
-   if (exit_error == 0){
-      if ((ssl_connection = init_ssl_connection(ssl_context)) == NULL){
-         MSG("Error creating SSL connection\n");
-         exit_error = 1;
-      }
+   if ((ssl_connection = init_ssl_connection(ssl_context)) == NULL){
+      MSG("Error creating SSL connection\n");
+      exit_error = 1;
    }
 
    /* Parse connection data */
@@ -459,11 +712,27 @@ static void yes_ssl_support(void)
       MSG("dpip_tag = %s\n", dpip_tag);
 	       
       cmd = a_Dpip_get_attr(dpip_tag, "cmd");
+      if (cmd && strcmp(cmd, "DpiBye") == 0) {
+         DPIBYE = 1;
+         MSG("(pid %d): Got DpiBye.\n", (int)getpid());
+         exit_error = 1;
+      }
+   }
+
+   if (exit_error == 0){
       proxy_url = a_Dpip_get_attr(dpip_tag, "proxy_url");
       proxy_connect =
                   a_Dpip_get_attr(dpip_tag, "proxy_connect");
       url = a_Dpip_get_attr(dpip_tag, "url");
 
+      if (!url) {
+	MSG("***Value of url is NULL"
+                    " - cannot continue\n");
+         exit_error = 1;
+      }
+   }
+
+   if (exit_error == 0){
       gemini_query = malloc(strlen(url) + 10);
 
       if(!strchr(url+strlen("gemini://"), '/')) {
@@ -488,17 +757,15 @@ static void yes_ssl_support(void)
          check_cert = dStrdup("true");
       }
 
-      if (!url) {
-	MSG("***Value of url is NULL"
-                    " - cannot continue\n");
-         exit_error = 1;
-      }
+      host = Gemini_host_get(url);
+      if (proxy_url)
+         proxy = Gemini_host_get(proxy_url);
    }
 
    /* Open the SSL connection to a server */
    if (exit_error == 0){
-      network_socket = open_ssl_connection(ssl_connection, url,
-                                           proxy_url, proxy_connect,
+      network_socket = open_ssl_connection(ssl_connection, host,
+                                           proxy, proxy_connect,
                                            strcmp(check_cert, "true") == 0);
       if (network_socket<0){
          MSG("Network socket create error\n");
@@ -513,11 +780,26 @@ static void yes_ssl_support(void)
       if(gemini_code < 0) {
          MSG("Error parsing server reponse\n");
          exit_error = 1;
+      } else {
+         /* By now, any session ticket for it has been read */
+         Gemini_host_save_session(host, ssl_connection,
+                                  strcmp(check_cert, "true") == 0 ||
+                                  (SSL_session_reused(ssl_connection) &&
+                                   host->session_checked));
       }
 
       fprintf(stderr, "HEADER LINE = %s\n", buf);
    }
 
+   /* Let the server know about the hosts before the body comes */
+   if (host && report_fd != -1) {
+      Gemini_host_report(host);
+      if (proxy)
+         Gemini_host_report(proxy);
+      dClose(report_fd);
+      report_fd = -1;
+   }
+
    /* Read the Gemini response */
    if (exit_error == 0) {
       char *d_cmd;
@@ -578,14 +860,6 @@ static void yes_ssl_support(void)
                      "HTTP/1.1 200 OK\r\n"
                      "Content-Type: text/gemini; charset=UTF-8\r\n\r\n");
 
-            a_Dpip_dsh_write(sh, 1, outbuf, strlen(outbuf));
-
-            /*Send remaining data*/
-
-            while ((ret = SSL_read_line(ssl_connection, buf, 4096)) > 0 ){
-               a_Dpip_dsh_write(sh, 1, buf, (size_t)ret);
-            }
-
          } else {
 
             /*Send HTTP OK header*/
@@ -593,15 +867,12 @@ static void yes_ssl_support(void)
                      "HTTP/1.1 200 OK\r\n"
                      "Content-Type: %s\r\n\r\n", buf + 3);
 
-            a_Dpip_dsh_write(sh, 1, outbuf, strlen(outbuf));
+         }
 
-            /*Send remaining data*/
-      
-            while ((ret = SSL_read(ssl_connection, buf, 4096)) > 0 ){
-               a_Dpip_dsh_write(sh, 1, buf, (size_t)ret);
-            }
+         a_Dpip_dsh_write(sh, 1, outbuf, strlen(outbuf));
 
-         }
+         /*Send remaining data*/
+         gemini_send_body(ssl_connection);
 
          break;
 
@@ -623,81 +894,98 @@ static void yes_ssl_support(void)
       network_socket = -1;
    }
    if (ssl_connection != NULL){
+      /* Don't wait for a close_notify from the server, and keep the
+       * session resumable */
+      SSL_set_shutdown(ssl_connection,
+                       SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
       SSL_free(ssl_connection);
       ssl_connection = NULL;
    }
-   if (ssl_context != NULL){
-      SSL_CTX_free(ssl_context);
-      ssl_context = NULL;
+}
+
+/*
+ * Connect a socket to an address, giving up after GEMINI_CONNECT_TIMEOUT.
+ * Return: the socket, or -1 on error.
+ */
+static int Gemini_connect_addr(const struct sockaddr *addr, socklen_t len)
+{
+   int s, st, err = 0, flags;
+   socklen_t err_len = sizeof(err);
+   fd_set wset;
+   struct timeval timeout;
+
+   if ((s = socket(addr->sa_family, SOCK_STREAM, 0)) < 0)
+      return -1;
+   flags = fcntl(s, F_GETFL);
+   fcntl(s, F_SETFL, flags | O_NONBLOCK);
+   if (connect(s, addr, len) != 0) {
+      if (errno != EINPROGRESS) {
+         err = errno;
+      } else {
+         timeout.tv_sec = GEMINI_CONNECT_TIMEOUT;
+         timeout.tv_usec = 0;
+         do {
+            FD_ZERO(&wset);
+            FD_SET(s, &wset);
+            st = select(s + 1, NULL, &wset, NULL, &timeout);
+         } while (st < 0 && errno == EINTR);
+         if (st <= 0)
+            err = st ? errno : ETIMEDOUT;
+         else if (getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0)
+            err = errno;
+      }
    }
+   if (err) {
+      MSG("connect: %s\n", dStrerror(err));
+      dClose(s);
+      return -1;
+   }
+   fcntl(s, F_SETFL, flags);
+   return s;
 }
 
 /*
  * The following function attempts to open up a connection to the
  * remote server and return the file descriptor number of the
  * socket.  Returns -1 in the event of an error
+ *
+ * The address is looked up again when it's older than GEMINI_DNS_TTL,
+ * or when it can't be connected to.
  */
-static int get_network_connection(char * url)
+static int get_network_connection(GeminiHost *host)
 {
-   struct sockaddr_in address;
-   struct hostent *hp;
-
-   int s;
-   int url_offset = 0;
-   int portnum = 1965;
-   uint_t url_look_up_length = 0;
-   char * url_look_up = NULL;
+   struct addrinfo hints, *res, *ai;
+   char port[16];
+   int s = -1, err;
 
    MSG("{get_network_connection}\n");
 
-   /*Determine how much of url we chop off as unneeded*/
-   if (dStrnAsciiCasecmp(url, "gemini://", 9) == 0){
-      url_offset = 9;
-   }
-
-   /*Find end of URL*/
-
-   if (strpbrk(url+url_offset, ":/") != NULL){
-      url_look_up_length = strpbrk(url+url_offset, ":/") - (url+url_offset);
-      url_look_up = dStrndup(url+url_offset, url_look_up_length);
-
-      /*Check for port number*/
-      if (strchr(url+url_offset, ':') ==
-          (url + url_offset + url_look_up_length)){
-         portnum = strtol(url + url_offset + url_look_up_length + 1, NULL, 10);
-      }
-   } else {
-      url_look_up = url + url_offset;
+   if (host->addr_len &&
+       time(NULL) - host->resolved < GEMINI_DNS_TTL) {
+      if ((s = Gemini_connect_addr((struct sockaddr *)&host->addr,
+                                   host->addr_len)) >= 0)
+         return s;
+      host->addr_len = 0;
    }
 
-   root_url = dStrdup(url_look_up);
-
-   memset(servername, 0, sizeof(servername));
-   strncpy(servername, root_url, sizeof(servername) - 1);
-   
-   hp=gethostbyname(url_look_up);
-
-   /*url_look_uip no longer needed, so free if necessary*/
-   if (url_look_up_length != 0){
-      dFree(url_look_up);
-   }
-
-   if (hp == NULL){
-      MSG("gethostbyname() failed\n");
+   memset(&hints, 0, sizeof(hints));
+   hints.ai_family = AF_UNSPEC;
+   hints.ai_socktype = SOCK_STREAM;
+   snprintf(port, sizeof(port), "%d", host->port);
+   if ((err = getaddrinfo(host->name, port, &hints, &res)) != 0){
+      MSG("getaddrinfo() failed: %s\n", gai_strerror(err));
       return -1;
    }
 
-   memset(&address,0,sizeof(address));
-   memcpy((char *)&address.sin_addr, hp->h_addr, (size_t)hp->h_length);
-   address.sin_family=hp->h_addrtype;
-   address.sin_port= htons((u_short)portnum);
-
-   s = socket(hp->h_addrtype, SOCK_STREAM, 0);
-   if (connect(s, (struct sockaddr *)&address, sizeof(address)) != 0){
-      dClose(s);
-      s = -1;
-      MSG("errno: %i\n", errno);
+   for (ai = res; ai != NULL; ai = ai->ai_next) {
+      if ((s = Gemini_connect_addr(ai->ai_addr, ai->ai_addrlen)) >= 0) {
+         memcpy(&host->addr, ai->ai_addr, ai->ai_addrlen);
+         host->addr_len = ai->ai_addrlen;
+         host->resolved = time(NULL);
+         break;
+      }
    }
+   freeaddrinfo(res);
    return s;
 }
 
@@ -1048,16 +1336,26 @@ static void no_ssl_support(void)
    char *dpip_tag = NULL, *cmd = NULL, *url = NULL, *http_query = NULL;
    char *d_cmd;
 
-   /* Read the dpi command from STDIN */
+   /* Read the dpi command */
    dpip_tag = a_Dpip_dsh_read_token(sh, 1);
 
-   MSG("{In gemini.filter.dpi}\n");
+   MSG("{In gemini.dpi}\n");
    MSG("no_ssl_support version\n");
 
    cmd = a_Dpip_get_attr(dpip_tag, "cmd");
    url = a_Dpip_get_attr(dpip_tag, "url");
    http_query = a_Dpip_get_attr(dpip_tag, "query");
 
+   if (cmd && strcmp(cmd, "DpiBye") == 0) {
+      DPIBYE = 1;
+      MSG("(pid %d): Got DpiBye.\n", (int)getpid());
+      dFree(cmd);
+      dFree(url);
+      dFree(http_query);
+      dFree(dpip_tag);
+      return;
+   }
+
    MSG("{ cmd: %s}\n", cmd);
    MSG("{ url: %s}\n", url);
    MSG("{ http_query:\n%s}\n", http_query);
@@ -1112,6 +1410,104 @@ static void no_ssl_support(void)
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Perform any necessary cleanups upon abnormal termination
+ */
+static void termination_handler(int signum)
+{
+  MSG("\nexit(signum), signum=%d\n\n", signum);
+  exit(signum);
+}
+
+static void sigchld_handler(int signum)
+{
+   int saved_errno = errno;
+
+   while (waitpid(-1, NULL, WNOHANG) > 0) ;
+   errno = saved_errno;
+}
+
+/*
+ * Read from the pipe of a child. Once the child is done with it, take its
+ * reports in and forget the pipe.
+ * Return: 1 if the pipe was forgotten, 0 otherwise.
+ */
+static int Gemini_reporter_read(Reporter *r)
+{
+   char buf[4096];
+   ssize_t st;
+   size_t pos = 0, n;
+
+   do {
+      st = read(r->fd, buf, sizeof(buf));
+   } while (st < 0 && errno == EINTR);
+   if (st > 0) {
+      dStr_append_l(r->data, buf, st);
+      return 0;
+   }
+
+   while (pos < (size_t)r->data->len) {
+      n = 0;
+      switch (r->data->str[pos]) {
+      case 'B':
+         MSG("Got DpiBye.\n");
+         DPIBYE = 1;
+         n = 1;
+         break;
+#ifdef ENABLE_SSL
+      case 'H':
+         if ((n = Gemini_host_take_report(r->data->str + pos + 1,
+                                          r->data->len - pos - 1)) > 0)
+            n++;
+         break;
+#endif
+      }
+      if (n == 0) {
+         MSG("Incomplete report from a child\n");
+         break;
+      }
+      pos += n;
+   }
+
+   dList_remove(Reporters, r);
+   dClose(r->fd);
+   dStr_free(r->data, 1);
+   dFree(r);
+   return 1;
+}
+
+/*
+ * Serve a connection from dillo.
+ */
+static void Gemini_serve(int sock_fd)
+{
+   char *dpip_tag;
+
+   fcntl(sock_fd, F_SETFL, fcntl(sock_fd, F_GETFL) & ~O_NONBLOCK);
+
+   /* Initialize the SockHandler for this connection */
+   sh = a_Dpip_dsh_new(sock_fd, sock_fd, 8*1024);
+
+   /* Authenticate our client... */
+   if (!(dpip_tag = a_Dpip_dsh_read_token(sh, 1)) ||
+       a_Dpip_check_auth(dpip_tag) < 0) {
+      MSG("can't authenticate request: %s\n", dStrerror(errno));
+   } else {
+#ifdef ENABLE_SSL
+      yes_ssl_support(ssl_context);
+#else
+      no_ssl_support();
+#endif
+   }
+   dFree(dpip_tag);
+   if (DPIBYE)
+      Gemini_report("B", 1);
+
+   /* Finish the SockHandler */
+   a_Dpip_dsh_close(sh);
+   a_Dpip_dsh_free(sh);
+}
+
 int download(char *url, char *output_filename,
              char *proxy_url, char *proxy_connect, int check_cert) {
    /* The following variable will be set to 1 in the event of
@@ -1152,9 +1548,11 @@ int download(char *url, char *output_filename,
 
    /* Open the SSL connection to a server */
    if (exit_error == 0){
-      network_socket = open_ssl_connection(ssl_connection, url,
-                                           proxy_url, proxy_connect,
-                                           check_cert);
+      network_socket = open_ssl_connection(ssl_connection,
+                                           Gemini_host_get(url),
+                                           proxy_url ?
+                                           Gemini_host_get(proxy_url) : NULL,
+                                           proxy_connect, check_cert);
       if (network_socket<0){
          MSG("Network socket create error\n");
          exit_error = 1;
@@ -1235,7 +1633,6 @@ int download(char *url, char *output_filename,
 
 int main(int argc, char *argv[])
 {
-   char *dpip_tag;
    int i;
    
    if(argc > 1) {
@@ -1262,31 +1659,93 @@ int main(int argc, char *argv[])
       }
       
    } else {
-      /* Standard DPI behaviour */
-
-      /* Initialize the SockHandler for this filter dpi */
-      sh = a_Dpip_dsh_new(STDIN_FILENO, STDOUT_FILENO, 8*1024);
+      /* Standard DPI behaviour: serve connections until DpiBye */
+      int sock_fd, report_pipe[2];
+      pid_t pid;
+      fd_set read_set;
+      Reporter *r;
 
-      /* Authenticate our client... */
-      if (!(dpip_tag = a_Dpip_dsh_read_token(sh, 1)) ||
-          a_Dpip_check_auth(dpip_tag) < 0) {
-         MSG("can't authenticate request: %s\n", dStrerror(errno));
-         a_Dpip_dsh_close(sh);
+#ifdef ENABLE_SSL
+      /* Create context and SSL object */
+      if ((ssl_context = init_ssl()) == NULL){
+         MSG("Error creating SSL context\n");
          return 1;
       }
-      dFree(dpip_tag);
-
-#ifdef ENABLE_SSL
-      yes_ssl_support();
-#else
-      no_ssl_support();
 #endif
 
-      /* Finish the SockHandler */
-      a_Dpip_dsh_close(sh);
-      a_Dpip_dsh_free(sh);
+      /* Arrange the cleanup function for abnormal terminations */
+      if (signal (SIGINT, termination_handler) == SIG_IGN)
+        signal (SIGINT, SIG_IGN);
+      if (signal (SIGHUP, termination_handler) == SIG_IGN)
+        signal (SIGHUP, SIG_IGN);
+      if (signal (SIGTERM, termination_handler) == SIG_IGN)
+        signal (SIGTERM, SIG_IGN);
+      /* Reap the children serving connections */
+      signal (SIGCHLD, sigchld_handler);
+
+      /* Set STDIN socket nonblocking (to ensure accept() never blocks) */
+      fcntl(STDIN_FILENO, F_SETFL, O_NONBLOCK | fcntl(STDIN_FILENO, F_GETFL));
+
+      Reporters = dList_new(8);
+
+      while (!DPIBYE) {
+         /* wait for a connection, or for a child to report */
+         FD_ZERO(&read_set);
+         FD_SET(STDIN_FILENO, &read_set);
+         for (i = 0; (r = dList_nth_data(Reporters, i)); ++i)
+            FD_SET(r->fd, &read_set);
+         if (select(FD_SETSIZE, &read_set, NULL, NULL, NULL) < 0) {
+            if (errno == EINTR)
+               continue;
+            MSG(" select() %s\n", dStrerror(errno));
+            break;
+         }
+
+         for (i = 0; (r = dList_nth_data(Reporters, i)); ++i)
+            if (FD_ISSET(r->fd, &read_set) && Gemini_reporter_read(r))
+               --i;
+         if (DPIBYE || !FD_ISSET(STDIN_FILENO, &read_set))
+            continue;
+
+         do {
+            sock_fd = accept(STDIN_FILENO, NULL, NULL);
+         } while (sock_fd < 0 && errno == EINTR);
+         if (sock_fd == -1) {
+            if (errno == EAGAIN)
+               continue;
+            MSG(" accept() %s\n", dStrerror(errno));
+            break;
+         }
 
-      dFree(root_url);
+         /* Serve it from a child, which reports back over a pipe */
+         if (pipe(report_pipe) < 0) {
+            MSG("pipe: %s\n", dStrerror(errno));
+            pid = -1;
+         } else if ((pid = fork()) == 0) {
+            dClose(STDIN_FILENO);
+            dClose(report_pipe[0]);
+            for (i = 0; (r = dList_nth_data(Reporters, i)); ++i)
+               dClose(r->fd);
+            report_fd = report_pipe[1];
+            Gemini_serve(sock_fd);
+            _exit(0);
+         } else {
+            dClose(report_pipe[1]);
+            if (pid < 0) {
+               MSG("fork: %s\n", dStrerror(errno));
+               dClose(report_pipe[0]);
+            } else {
+               r = dNew(Reporter, 1);
+               r->fd = report_pipe[0];
+               r->data = dStr_new("");
+               dList_append(Reporters, r);
+            }
+         }
+         if (pid < 0)
+            Gemini_serve(sock_fd);
+         else
+            dClose(sock_fd);
+      }
 
       MSG("{ exiting gemini.dpi}\n");
 
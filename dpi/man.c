@@ -10,9 +10,9 @@
  */
 
 /*
- * Directory scanning is no longer streamed, but it gets sorted instead!
- * Directory entries on top, files next.
- * With new HTML layout.
+ * Converted pages are kept in ~/.dillo-plus/man_cache/, so that viewing a
+ * page again doesn't run the man toolchain; the pages referenced in the
+ * SEE ALSO section are converted in the background, a few at a time.
  */
 
 #include <ctype.h>           /* for isspace */
@@ -26,6 +26,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/un.h>
+#include <sys/wait.h>
 #include <dirent.h>
 #include <fcntl.h>
 #include <time.h>
@@ -47,6 +48,10 @@
 
 #define HIDE_DOTFILES TRUE
 
+/* Max. number of SEE ALSO pages being converted at once, and waiting */
+#define MAN_MAX_PREFETCH        2
+#define MAN_MAX_PREFETCH_QUEUE 32
+
 /*
  * Communication flags
  */
@@ -86,6 +91,10 @@ typedef struct {
    FormatState fstate;
    int err_code;
    int flags;
+   char *cache_key;        /* NULL if the page can't be cached */
+   char *cache_file;
+   Dstr *html;             /* the converted page (cached or to cache) */
+   int cached;             /* 'html' comes from the cache */
 } ClientInfo;
 
 /*
@@ -94,6 +103,9 @@ typedef struct {
 static int DPIBYE = 0;
 /* A list for the clients we are serving */
 static Dlist *Clients;
+/* Pages to convert in the background, and pids of the ones being done */
+static Dlist *PrefetchQueue;
+static Dlist *PrefetchPids;
 /* Set of filedescriptors we're working on */
 fd_set read_set, write_set;
 
@@ -306,6 +318,322 @@ static void Man_close(FILE *fp)
    if (fp != NULL) fclose(fp);
 }
 
+/*
+ * Split "name(section)" in place. 'arg' is set to the section, or "--".
+ */
+static void Man_split_arg(char *manpage, char **arg)
+{
+   unsigned i, len = strlen(manpage);
+
+   *arg = "--";
+   for(i=0; manpage[i] != '(' && i < len; i++) ;
+   if(manpage[i] == '(') {
+      manpage[i] = '\0';
+      i++;
+      *arg = manpage + i;
+      for(; manpage[i] != ')' && i < len; i++) ;
+      if(manpage[i] == ')') manpage[i] = '\0';
+   }
+}
+
+/*
+ * Ask man where the source of a page is ("man -w").
+ * Return: the path (to be freed), or NULL.
+ */
+static char *Man_locate(const char *arg, const char *manpage)
+{
+   int pipe_fd[2], pid, status;
+   char buf[1024], *path = NULL, *nl;
+   FILE *fp;
+
+   if (pipe(pipe_fd) < 0)
+      return NULL;
+   if ((pid = fork()) == -1) {
+      close(pipe_fd[0]);
+      close(pipe_fd[1]);
+      return NULL;
+   }
+   if (pid == 0) {
+      // child
+      close(pipe_fd[0]);
+      if (pipe_fd[1] != STDOUT_FILENO) {
+         dup2(pipe_fd[1], STDOUT_FILENO);
+         close(pipe_fd[1]);
+      }
+      const char* argp[] = {"man", "-w", arg, manpage, NULL};
+      execvp("man", (char**) argp);
+      _exit(127);
+   }
+
+   close(pipe_fd[1]);
+   if ((fp = fdopen(pipe_fd[0], "r"))) {
+      if (fgets(buf, sizeof(buf), fp) && buf[0] == '/') {
+         if ((nl = strchr(buf, '\n')))
+            *nl = '\0';
+         path = dStrdup(buf);
+      }
+      fclose(fp);
+   } else {
+      close(pipe_fd[0]);
+   }
+   while (waitpid(pid, &status, 0) < 0 && errno == EINTR) ;
+   return path;
+}
+
+/* Cache ------------------------------------------------------------------*/
+
+/*
+ * Find where a converted page is cached, and the key it's stored with.
+ * 'section' is the man section, "--" for any, or NULL for a file path.
+ * The file name depends on the section and page path only, so a newer
+ * version of the page replaces the old one; the key adds the page's mtime.
+ * Return: 0 on success, -1 if it can't be cached.
+ */
+static int Man_cache_lookup(const char *section, const char *manpage,
+                            char **key, char **file)
+{
+   struct stat sb;
+   char *path, hex[16];
+   const char *p;
+   uint_t hash = 2166136261U;
+   Dstr *ds;
+
+   path = section ? Man_locate(section, manpage) : dStrdup(manpage);
+   if (!path || stat(path, &sb) != 0) {
+      dFree(path);
+      return -1;
+   }
+   ds = dStr_new("");
+   dStr_sprintf(ds, "%ld %s %s", (long)sb.st_mtime,
+                section ? section : "file", path);
+   *key = ds->str;
+   dStr_free(ds, 0);
+   /* FNV-1a, skipping the mtime */
+   for (p = strchr(*key, ' ') + 1; *p; ++p)
+      hash = (hash ^ (uchar_t)*p) * 16777619U;
+   snprintf(hex, sizeof(hex), "%08x", hash);
+   *file = dStrconcat(dGethomedir(), "/." BINNAME "/man_cache/", hex,
+                      ".html", NULL);
+   dFree(path);
+   return 0;
+}
+
+/*
+ * Read a converted page from the cache, if it's there and up to date.
+ * The first line of the file is its key.
+ */
+static Dstr *Man_cache_load(const char *key, const char *file)
+{
+   FILE *fp;
+   Dstr *ds = NULL;
+   char buf[4096];
+   size_t n, key_len = strlen(key);
+
+   if (!(fp = fopen(file, "r")))
+      return NULL;
+   if (fgets(buf, sizeof(buf), fp) && strlen(buf) == key_len + 1 &&
+       !strncmp(buf, key, key_len)) {
+      ds = dStr_sized_new(16*1024);
+      while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+         dStr_append_l(ds, buf, n);
+      if (ferror(fp)) {
+         dStr_free(ds, 1);
+         ds = NULL;
+      }
+   }
+   fclose(fp);
+   return ds;
+}
+
+/*
+ * Store a converted page, atomically.
+ */
+static void Man_cache_save(const char *key, const char *file, Dstr *html)
+{
+   char *dir, *tmp, pid[16];
+   FILE *fp;
+   int ok;
+
+   dir = dStrconcat(dGethomedir(), "/." BINNAME "/man_cache", NULL);
+   mkdir(dir, 0700);
+   dFree(dir);
+
+   snprintf(pid, sizeof(pid), ".%d", (int)getpid());
+   tmp = dStrconcat(file, pid, NULL);
+   if ((fp = fopen(tmp, "w"))) {
+      ok = (fprintf(fp, "%s\n", key) > 0 &&
+            fwrite(html->str, 1, html->len, fp) == (size_t)html->len);
+      if (fclose(fp) == 0 && ok && rename(tmp, file) == 0) {
+         _MSG("cached %s\n", key);
+      } else {
+         unlink(tmp);
+      }
+   }
+   dFree(tmp);
+}
+
+/* Conversion -------------------------------------------------------------*/
+
+/*
+ * Convert a line of man's output to HTML, with links to the pages in
+ * the SEE ALSO section.
+ */
+static void Man_format_line(FormatState *fstate, const char *buf, Dstr *ds)
+{
+   int st2 = strlen(buf), lstart, i;
+
+   /* preprocessing line */
+   if(isupper(buf[0]) && isupper(buf[1])) {
+      dStr_append(ds, "<strong>");
+   }
+   if(buf[0] != ' ' && *fstate == fs_in_see_also) {
+      *fstate = fs_start;
+   }
+
+   /* write line content */
+   if(*fstate == fs_in_see_also) {
+
+      /* skip initial spaces */
+      for(i = 0; buf[i] == ' ' && i < st2; i++) ;
+
+      dStr_append_l(ds, buf, i);
+
+      lstart = i;
+
+      while(buf[lstart] != '\n' && lstart < st2) {
+
+         dStr_append(ds, "<a href=\"man:");
+
+         for(i = lstart; buf[i] != ',' && buf[i] != '\n' && i < st2; i++) ;
+
+         dStr_append_l(ds, buf + lstart, i - lstart);
+         dStr_append(ds, "\">");
+         dStr_append_l(ds, buf + lstart, i - lstart);
+         dStr_append(ds, "</a>");
+
+         lstart = i;
+
+         for(i = lstart; (buf[i] == ',' || buf[i] == ' ') && i < st2; i++) ;
+         dStr_append_l(ds, buf + lstart, i - lstart);
+
+         lstart = i;
+      }
+
+      dStr_append(ds, "\n");
+
+   } else {
+      dStr_append_l(ds, buf, st2);
+   }
+
+   /* post processing line */
+   if(isupper(buf[0]) && isupper(buf[1])) {
+      dStr_append(ds, "</strong>");
+   }
+   if(!strncmp(buf, "SEE ALSO", 8)) {
+      *fstate = fs_in_see_also;
+   }
+}
+
+/*
+ * The beginning of a converted page.
+ */
+static void Man_format_head(const char *title, Dstr *ds)
+{
+   dStr_sprintfa(ds, "<title>Man %s</title>\n<pre>", title);
+}
+
+/* Prefetching ------------------------------------------------------------*/
+
+/*
+ * Queue the pages linked from a converted page for conversion.
+ */
+static void Man_prefetch_add_links(Dstr *html)
+{
+   const char *p = html->str, *end;
+   char *ref;
+
+   while ((p = strstr(p, "<a href=\"man:"))) {
+      p += 13;
+      if (!(end = strchr(p, '"')))
+         break;
+      ref = dStrndup(p, end - p);
+      if (dList_length(PrefetchQueue) < MAN_MAX_PREFETCH_QUEUE &&
+          !dList_find_custom(PrefetchQueue, ref, (dCompareFunc)strcmp)) {
+         dList_append(PrefetchQueue, ref);
+      } else {
+         dFree(ref);
+      }
+      p = end;
+   }
+}
+
+/*
+ * Convert a page into the cache, unless it's already there.
+ * (Runs in a child process).
+ */
+static void Man_prefetch_page(char *manpage)
+{
+   char *arg, *key, *file, *title, buf[16*1024];
+   FormatState fstate = fs_start;
+   Dstr *ds;
+   FILE *man;
+
+   title = dStrdup(manpage);
+   Man_split_arg(manpage, &arg);
+   if (Man_cache_lookup(arg, manpage, &key, &file) != 0)
+      return;
+   if ((ds = Man_cache_load(key, file))) {
+      /* already there */
+   } else if ((man = Man_open(arg, manpage))) {
+      ds = dStr_sized_new(16*1024);
+      Man_format_head(title, ds);
+      while (fgets(buf, sizeof(buf), man))
+         Man_format_line(&fstate, buf, ds);
+      if (!ferror(man)) {
+         dStr_append(ds, "</pre>");
+         Man_cache_save(key, file, ds);
+      }
+      Man_close(man);
+   }
+   dStr_free(ds, 1);
+   dFree(title);
+   dFree(key);
+   dFree(file);
+}
+
+/*
+ * Reap the finished children, and start converting queued pages while
+ * there's room.
+ * Return: whether there's prefetching work left.
+ */
+static int Man_prefetch_run(void)
+{
+   ClientInfo *client;
+   char *ref;
+   int i, pid, status;
+
+   /* this also reaps the man toolchain processes */
+   while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+      dList_remove(PrefetchPids, INT2VOIDP(pid));
+
+   while (dList_length(PrefetchPids) < MAN_MAX_PREFETCH &&
+          (ref = dList_nth_data(PrefetchQueue, 0))) {
+      dList_remove(PrefetchQueue, ref);
+      if ((pid = fork()) == 0) {
+         /* Don't keep the client connections open */
+         close(STDIN_FILENO);
+         for (i = 0; (client = dList_nth_data(Clients, i)); ++i)
+            close(client->sh->fd_in);
+         Man_prefetch_page(ref);
+         _exit(0);
+      }
+      if (pid > 0)
+         dList_append(PrefetchPids, INT2VOIDP(pid));
+      dFree(ref);
+   }
+   return dList_length(PrefetchPids) || dList_length(PrefetchQueue);
+}
+
 /*
  * Send an error page
  */
@@ -366,28 +694,30 @@ static int Man_prepare_send_file(ClientInfo *client,
                                  const char *orig_url,
                                  ManpageType type)
 {
-   FILE *man;
+   FILE *man = NULL;
    int res = -1;
    char *arg = "--";
-   unsigned i, len = strlen(manpage);
 
    if(type == man_arg) {
-      for(i=0; manpage[i] != '(' && i < len; i++) ;
-      if(manpage[i] == '(') {
-         manpage[i] = '\0';
-         i++;
-         arg = manpage + i;
-         for(; manpage[i] != ')' && i < len; i++) ;
-         if(manpage[i] == ')') manpage[i] = '\0';
-      }
+      Man_split_arg(manpage, &arg);
    }
 
-   if (!(man = Man_open(arg, manpage))) {
+   if (Man_cache_lookup(type == man_arg ? arg : NULL, manpage,
+                        &client->cache_key, &client->cache_file) == 0 &&
+       (client->html = Man_cache_load(client->cache_key,
+                                      client->cache_file))) {
+      _MSG("cache hit: %s\n", client->cache_key);
+      client->cached = 1;
+   }
+
+   if (!client->cached && !(man = Man_open(arg, manpage))) {
       /* prepare an error message */
       res = errno;
    } else {
       /* looks ok, set things accordingly */
       client->man = man;
+      if (!client->cached && client->cache_key)
+         client->html = dStr_sized_new(16*1024);
       client->state = st_start;
       client->fstate = fs_start;
       client->orig_url = dStrdup(orig_url);
@@ -471,6 +801,20 @@ static void Man_get(ClientInfo *client, char *filename,
    }
 }
 
+/*
+ * Send a piece of the converted page, and keep it for the cache.
+ * 'ds' is freed.
+ */
+static void Man_send_html(ClientInfo *client, Dstr *ds)
+{
+   a_Dpip_dsh_write(client->sh, 0, ds->str, ds->len);
+   if (a_Dpip_dsh_tryflush(client->sh) == -3)
+      client->flags |= MAN_ERR;
+   if (client->html)
+      dStr_append_l(client->html, ds->str, ds->len);
+   dStr_free(ds, 1);
+}
+
 /*
  * Send HTTP headers and then the file itself.
  */
@@ -481,10 +825,9 @@ static int Man_send_file(ClientInfo *client)
 
    const char *ct = "text/html";
    char buf[LBUF], *d_cmd;
-   int st, st2;
+   int st;
    char *lr;
-
-   int lstart, i;
+   Dstr *ds;
 
    if (client->state == st_start) {
       /* Send DPI command */
@@ -508,9 +851,17 @@ static int Man_send_file(ClientInfo *client)
       a_Dpip_dsh_printf(client->sh, 1, "\r\n");
       client->state = st_http;
 
+   } else if (client->state == st_http && client->cached) {
+      /* the whole converted page, from the cache */
+      a_Dpip_dsh_write(client->sh, 1, client->html->str, client->html->len);
+      Man_prefetch_add_links(client->html);
+      client->state = st_post_content;
+      client->flags |= MAN_DONE;
+
    } else if (client->state == st_http) {
-      a_Dpip_dsh_printf(client->sh, 1, "<title>Man %s</title>\n", client->manpage);
-      a_Dpip_dsh_printf(client->sh, 1, "<pre>");
+      ds = dStr_new("");
+      Man_format_head(client->manpage, ds);
+      Man_send_html(client, ds);
       client->state = st_pre_content;
    } else if (client->state == st_pre_content) {
       /* Send body -- raw file contents */
@@ -527,70 +878,18 @@ static int Man_send_file(ClientInfo *client)
             client->state = st_content;
          } else {
             /* ok to write */
-            st2 = strlen(buf);
-
-            /* preprocessing line */
-            if(isupper(buf[0]) && isupper(buf[1])) {
-               a_Dpip_dsh_printf(client->sh, 1, "<strong>");
-            }
-            if(buf[0] != ' ' && client->fstate == fs_in_see_also) {
-               client->fstate = fs_start;
-            }
-
-            /* write line content */
-            if(client->fstate == fs_in_see_also) {
-
-               /* skip initial spaces */
-               for(i = 0; buf[i] == ' ' && i < st2; i++) ;
-
-               st = a_Dpip_dsh_trywrite(client->sh, buf, i);
-               client->flags |= (st == -3) ? MAN_ERR : 0;
-
-               lstart = i;
-
-               while(buf[lstart] != '\n' && lstart < st2) {
-
-                  a_Dpip_dsh_printf(client->sh, 1, "<a href=\"man:");
-
-                  for(i = lstart; buf[i] != ',' && buf[i] != '\n' && i < st2; i++) ;
-
-                  st = a_Dpip_dsh_trywrite(client->sh, buf + lstart, i - lstart);
-                  client->flags |= (st == -3) ? MAN_ERR : 0;
-
-                  a_Dpip_dsh_printf(client->sh, 1, "\">");
-
-                  st = a_Dpip_dsh_trywrite(client->sh, buf + lstart, i - lstart);
-                  client->flags |= (st == -3) ? MAN_ERR : 0;
-
-                  a_Dpip_dsh_printf(client->sh, 1, "</a>");
-
-                  lstart = i;
-
-                  for(i = lstart; (buf[i] == ',' || buf[i] == ' ') && i < st2; i++) ;
-                  st = a_Dpip_dsh_trywrite(client->sh, buf + lstart, i - lstart);
-
-                  lstart = i;
-               }
-
-               a_Dpip_dsh_printf(client->sh, 1, "\n");
-
-            } else {
-               st = a_Dpip_dsh_trywrite(client->sh, buf, st2);
-               client->flags |= (st == -3) ? MAN_ERR : 0;
-            }
-
-            /* post processing line */
-            if(isupper(buf[0]) && isupper(buf[1])) {
-               a_Dpip_dsh_printf(client->sh, 1, "</strong>");
-            }
-            if(!strncmp(buf, "SEE ALSO", 8)) {
-               client->fstate = fs_in_see_also;
-            }
-
+            ds = dStr_new("");
+            Man_format_line(&client->fstate, buf, ds);
+            Man_send_html(client, ds);
          }
       }
    } else if (client->state == st_content) {
-      a_Dpip_dsh_printf(client->sh, 1, "</pre>");
+      ds = dStr_new("</pre>");
+      Man_send_html(client, ds);
+      if (client->html && !(client->flags & MAN_ERR)) {
+         Man_cache_save(client->cache_key, client->cache_file, client->html);
+         Man_prefetch_add_links(client->html);
+      }
       client->state = st_post_content;
       client->flags |= MAN_DONE;
    }
@@ -625,6 +924,10 @@ static ClientInfo *Man_add_client(int sock_fd)
    new_client->state = 0;
    new_client->err_code = 0;
    new_client->flags = MAN_READ;
+   new_client->cache_key = NULL;
+   new_client->cache_file = NULL;
+   new_client->html = NULL;
+   new_client->cached = 0;
 
    dList_append(Clients, new_client);
    return new_client;
@@ -643,6 +946,9 @@ static void Man_remove_client(ClientInfo *client)
    Man_close(client->man);
    dFree(client->orig_url);
    if (client->manpage) dFree(client->manpage);
+   dFree(client->cache_key);
+   dFree(client->cache_file);
+   dStr_free(client->html, 1);
 
    dFree(client);
 }
@@ -810,6 +1116,8 @@ int main(void)
 
    /* initialize Clients list */
    Clients = dList_new(512);
+   PrefetchQueue = dList_new(MAN_MAX_PREFETCH_QUEUE);
+   PrefetchPids = dList_new(MAN_MAX_PREFETCH);
 
    /* some OSes may need this... */
    sin_sz = sizeof(sin);
@@ -818,7 +1126,8 @@ int main(void)
    while (!DPIBYE) {
       /* wait for activity */
       do {
-         c_st = Man_check_fds(10);
+         /* check on the background work every second while there's some */
+         c_st = Man_check_fds(Man_prefetch_run() ? 1 : 10);
       } while (c_st == 0 && !DPIBYE);
       if (c_st < 0) {
          MSG(" select() %s\n", dStrerror(errno));
@@ -10,8 +10,11 @@
  */
 
 /*
- * Directory scanning is no longer streamed, but it gets sorted instead!
- * Directory entries on top, files next.
+ * ZIP archives are read in-process: the central directory is parsed once
+ * into an index (kept for the last few archives), and members are sent
+ * straight from the archive, inflating them if needed.
+ * Anything the native reader can't handle (other archive formats, other
+ * compression methods, encryption) goes to the external unzip (or 7z).
  * With new HTML layout.
  */
 
@@ -30,6 +33,13 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <netinet/in.h>
+#include <stdint.h>
+#include <zlib.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#define HAVE_SENDFILE 1
+#endif
 
 #define __USE_XOPEN
 #include <time.h>
@@ -49,6 +59,11 @@
 
 #define HIDE_DOTFILES TRUE
 
+/* Number of archive indexes kept in memory */
+#define ZIP_MAX_ARCHIVES 8
+/* Size of the input and output buffers for a member */
+#define ZIP_BUF_SIZE 16*1024
+
 /*
  * Communication flags
  */
@@ -67,12 +82,54 @@ typedef enum {
    st_err
 } FileState;
 
+/*
+ * A member of a ZIP archive, from the central directory.
+ */
+typedef struct {
+   char *name;
+   int method;             /* 0: stored, 8: deflated */
+   int encrypted;
+   off_t csize;            /* compressed size */
+   off_t usize;            /* uncompressed size */
+   off_t hdr_offset;       /* offset of the local header */
+   time_t mtime;
+} ZipEntry;
+
+/*
+ * The index of an archive (entries sorted by name).
+ */
+typedef struct {
+   char *filename;
+   int fd;
+   dev_t dev;
+   ino_t ino;
+   off_t size;
+   time_t mtime;
+   ZipEntry *entries;
+   int num_entries;
+} ZipArchive;
+
+/*
+ * A member being sent by the native reader.
+ */
+typedef struct {
+   int fd;                 /* the archive */
+   int method;
+   off_t in_offset;        /* next compressed byte to read */
+   off_t in_left;          /* compressed bytes left to read */
+   off_t size;             /* uncompressed size */
+   z_stream zs;
+   int zs_init;
+   char *in_buf;
+} ZipStream;
+
 typedef struct {
    Dsh *sh;
    char *orig_url;
    char *archive_filename;
    char *inner_filename;
    FILE *zip;
+   ZipStream *zstream;
    DilloDir *d_dir;
    FileState state;
    int err_code;
@@ -99,11 +156,445 @@ static const char *Zip_content_type(const char *archive_filename, const char *in
  */
 static int DPIBYE = 0;
 static int OLD_STYLE = 0;
+/* Indexes of the recently used archives, most recent first */
+static Dlist *Archives;
 /* A list for the clients we are serving */
 static Dlist *Clients;
 /* Set of filedescriptors we're working on */
 fd_set read_set, write_set;
 
+/* Native ZIP reader --------------------------------------------------------*/
+
+/*
+ * Little-endian field accessors.
+ */
+static uint_t Zip_get16(const uchar_t *p)
+{
+   return p[0] | (p[1] << 8);
+}
+
+static uint32_t Zip_get32(const uchar_t *p)
+{
+   return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+          ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t Zip_get64(const uchar_t *p)
+{
+   return (uint64_t)Zip_get32(p) | ((uint64_t)Zip_get32(p + 4) << 32);
+}
+
+/*
+ * Read exactly 'len' bytes at 'offset'.
+ * Return: 0 on success, -1 on error or short read.
+ */
+static int Zip_pread(int fd, void *buf, size_t len, off_t offset)
+{
+   ssize_t st;
+   size_t done = 0;
+
+   while (done < len) {
+      st = pread(fd, (char *)buf + done, len - done, offset + done);
+      if (st < 0 && errno == EINTR)
+         continue;
+      if (st <= 0)
+         return -1;
+      done += st;
+   }
+   return 0;
+}
+
+/*
+ * Convert an MS-DOS date and time (local time) to time_t.
+ */
+static time_t Zip_dos_time(uint_t dos_date, uint_t dos_time)
+{
+   struct tm tm;
+
+   memset(&tm, 0, sizeof(tm));
+   tm.tm_year = ((dos_date >> 9) & 0x7f) + 80;
+   tm.tm_mon = ((dos_date >> 5) & 0x0f) - 1;
+   tm.tm_mday = dos_date & 0x1f;
+   tm.tm_hour = (dos_time >> 11) & 0x1f;
+   tm.tm_min = (dos_time >> 5) & 0x3f;
+   tm.tm_sec = (dos_time & 0x1f) * 2;
+   tm.tm_isdst = -1;
+   return mktime(&tm);
+}
+
+static int Zip_entry_cmp(const void *v1, const void *v2)
+{
+   return strcmp(((const ZipEntry *)v1)->name, ((const ZipEntry *)v2)->name);
+}
+
+static void Zip_archive_free(ZipArchive *za)
+{
+   int i;
+
+   dReturn_if (za == NULL);
+
+   for (i = 0; i < za->num_entries; ++i)
+      dFree(za->entries[i].name);
+   dFree(za->entries);
+   if (za->fd >= 0)
+      close(za->fd);
+   dFree(za->filename);
+   dFree(za);
+}
+
+/*
+ * Find the end of central directory record and get the central directory
+ * position and number of entries from it (or from its Zip64 version).
+ * Return: 0 on success, -1 if this isn't a (supported) ZIP file.
+ */
+static int Zip_find_central_dir(int fd, off_t file_size, off_t *cd_offset,
+                                off_t *cd_size, long *num_entries)
+{
+   uchar_t *buf, *p, loc[20], eocd64[56];
+   size_t len;
+   off_t start, eocd_offset;
+   int ret = -1;
+
+   /* the record is 22 bytes, plus a comment of up to 64KiB */
+   len = MIN(file_size, 22 + 65535);
+   start = file_size - len;
+   if (len < 22)
+      return -1;
+   buf = dNew(uchar_t, len);
+   if (Zip_pread(fd, buf, len, start) == 0) {
+      for (p = buf + len - 22; p >= buf; --p) {
+         if (Zip_get32(p) == 0x06054b50 &&
+             p + 22 + Zip_get16(p + 20) <= buf + len)
+            break;
+      }
+      if (p >= buf) {
+         eocd_offset = start + (p - buf);
+         *num_entries = Zip_get16(p + 10);
+         *cd_size = Zip_get32(p + 12);
+         *cd_offset = Zip_get32(p + 16);
+         ret = 0;
+         if ((*num_entries == 0xffff || *cd_size == 0xffffffff ||
+              *cd_offset == 0xffffffff) && eocd_offset >= 20 &&
+             Zip_pread(fd, loc, 20, eocd_offset - 20) == 0 &&
+             Zip_get32(loc) == 0x07064b50) {
+            /* Zip64 */
+            if (Zip_pread(fd, eocd64, 56, Zip_get64(loc + 8)) == 0 &&
+                Zip_get32(eocd64) == 0x06064b50) {
+               *num_entries = Zip_get64(eocd64 + 32);
+               *cd_size = Zip_get64(eocd64 + 40);
+               *cd_offset = Zip_get64(eocd64 + 48);
+            } else {
+               ret = -1;
+            }
+         }
+      }
+   }
+   dFree(buf);
+   if (ret == 0 && (*cd_offset < 0 || *cd_size < 0 || *num_entries < 0 ||
+                    *cd_offset + *cd_size > file_size))
+      ret = -1;
+   return ret;
+}
+
+/*
+ * Get the sizes and offset from a Zip64 extra field, for the ones that
+ * are saturated in the central directory header.
+ */
+static void Zip_parse_zip64_extra(const uchar_t *extra, uint_t extra_len,
+                                  ZipEntry *ze)
+{
+   const uchar_t *p = extra, *end = extra + extra_len, *f;
+   uint_t id, len;
+
+   while (p + 4 <= end) {
+      id = Zip_get16(p);
+      len = Zip_get16(p + 2);
+      if (p + 4 + len > end)
+         break;
+      if (id == 0x0001) {
+         f = p + 4;
+         if (ze->usize == 0xffffffff && f + 8 <= p + 4 + len) {
+            ze->usize = Zip_get64(f);
+            f += 8;
+         }
+         if (ze->csize == 0xffffffff && f + 8 <= p + 4 + len) {
+            ze->csize = Zip_get64(f);
+            f += 8;
+         }
+         if (ze->hdr_offset == 0xffffffff && f + 8 <= p + 4 + len)
+            ze->hdr_offset = Zip_get64(f);
+         break;
+      }
+      p += 4 + len;
+   }
+}
+
+/*
+ * Open an archive and read its central directory into an index.
+ * Return: the index, or NULL if it isn't a ZIP file we can read.
+ */
+static ZipArchive *Zip_archive_open(const char *filename)
+{
+   struct stat sb;
+   ZipArchive *za;
+   ZipEntry *ze;
+   uchar_t *cd, *p, *end;
+   off_t cd_offset, cd_size;
+   long i, num_entries;
+   uint_t name_len, extra_len, comment_len;
+   int fd;
+
+   if ((fd = open(filename, O_RDONLY)) < 0)
+      return NULL;
+   if (fstat(fd, &sb) < 0 || !S_ISREG(sb.st_mode) ||
+       Zip_find_central_dir(fd, sb.st_size, &cd_offset, &cd_size,
+                            &num_entries) != 0 ||
+       num_entries > cd_size / 46) {
+      close(fd);
+      return NULL;
+   }
+
+   za = dNew0(ZipArchive, 1);
+   za->filename = dStrdup(filename);
+   za->fd = fd;
+   za->dev = sb.st_dev;
+   za->ino = sb.st_ino;
+   za->size = sb.st_size;
+   za->mtime = sb.st_mtime;
+   za->entries = dNew0(ZipEntry, MAX(num_entries, 1));
+
+   cd = dNew(uchar_t, MAX(cd_size, 1));
+   if (Zip_pread(fd, cd, cd_size, cd_offset) != 0) {
+      dFree(cd);
+      Zip_archive_free(za);
+      return NULL;
+   }
+   end = cd + cd_size;
+   for (p = cd, i = 0; i < num_entries; ++i) {
+      if (p + 46 > end || Zip_get32(p) != 0x02014b50)
+         break;
+      name_len = Zip_get16(p + 28);
+      extra_len = Zip_get16(p + 30);
+      comment_len = Zip_get16(p + 32);
+      if (p + 46 + name_len + extra_len + comment_len > end)
+         break;
+
+      ze = &za->entries[za->num_entries++];
+      ze->encrypted = Zip_get16(p + 8) & 1;
+      ze->method = Zip_get16(p + 10);
+      ze->mtime = Zip_dos_time(Zip_get16(p + 14), Zip_get16(p + 12));
+      ze->csize = Zip_get32(p + 20);
+      ze->usize = Zip_get32(p + 24);
+      ze->hdr_offset = Zip_get32(p + 42);
+      ze->name = dStrndup((char *)p + 46, name_len);
+      Zip_parse_zip64_extra(p + 46 + name_len, extra_len, ze);
+
+      p += 46 + name_len + extra_len + comment_len;
+   }
+   dFree(cd);
+
+   if (i < num_entries) {
+      MSG("error: %s: damaged central directory\n", filename);
+      Zip_archive_free(za);
+      return NULL;
+   }
+   qsort(za->entries, za->num_entries, sizeof(ZipEntry), Zip_entry_cmp);
+   return za;
+}
+
+/*
+ * Get the index of an archive, from the cache if it hasn't changed.
+ * Return: the index (owned by the cache), or NULL.
+ */
+static ZipArchive *Zip_archive_get(const char *filename)
+{
+   struct stat sb;
+   ZipArchive *za;
+   int i;
+
+   if (stat(filename, &sb) < 0)
+      return NULL;
+
+   for (i = 0; (za = dList_nth_data(Archives, i)); ++i) {
+      if (!strcmp(za->filename, filename)) {
+         dList_remove(Archives, za);
+         if (za->dev == sb.st_dev && za->ino == sb.st_ino &&
+             za->size == sb.st_size && za->mtime == sb.st_mtime) {
+            dList_prepend(Archives, za);
+            return za;
+         }
+         /* the archive changed */
+         Zip_archive_free(za);
+         break;
+      }
+   }
+
+   if ((za = Zip_archive_open(filename))) {
+      dList_prepend(Archives, za);
+      while (dList_length(Archives) > ZIP_MAX_ARCHIVES) {
+         ZipArchive *old = dList_nth_data(Archives, ZIP_MAX_ARCHIVES);
+         dList_remove(Archives, old);
+         Zip_archive_free(old);
+      }
+   }
+   return za;
+}
+
+/*
+ * Find a member by name.
+ */
+static ZipEntry *Zip_archive_find(ZipArchive *za, const char *name)
+{
+   ZipEntry key;
+
+   if (name[0] == '/')
+      name++;
+   key.name = (char *)name;
+   return bsearch(&key, za->entries, za->num_entries, sizeof(ZipEntry),
+                  Zip_entry_cmp);
+}
+
+/*
+ * Whether the native reader can extract this member.
+ */
+static int Zip_entry_supported(const ZipEntry *ze)
+{
+   return !ze->encrypted && (ze->method == 0 || ze->method == 8);
+}
+
+/*
+ * Start reading a member: skip its local header and set up inflate.
+ * Return: a new stream, or NULL on error.
+ */
+static ZipStream *Zip_stream_new(ZipArchive *za, const ZipEntry *ze)
+{
+   ZipStream *zst;
+   uchar_t hdr[30];
+
+   if (Zip_pread(za->fd, hdr, 30, ze->hdr_offset) != 0 ||
+       Zip_get32(hdr) != 0x04034b50)
+      return NULL;
+
+   zst = dNew0(ZipStream, 1);
+   zst->fd = dup(za->fd);
+   zst->method = ze->method;
+   zst->in_offset = ze->hdr_offset + 30 + Zip_get16(hdr + 26) +
+                    Zip_get16(hdr + 28);
+   zst->in_left = ze->csize;
+   zst->size = ze->usize;
+   if (zst->method == 8) {
+      zst->in_buf = dNew(char, ZIP_BUF_SIZE);
+      /* raw deflate data, no zlib header */
+      zst->zs_init = (inflateInit2(&zst->zs, -MAX_WBITS) == Z_OK);
+   }
+   if (zst->fd < 0 || (zst->method == 8 && !zst->zs_init)) {
+      if (zst->fd >= 0)
+         close(zst->fd);
+      dFree(zst->in_buf);
+      dFree(zst);
+      return NULL;
+   }
+   return zst;
+}
+
+static void Zip_stream_free(ZipStream *zst)
+{
+   dReturn_if (zst == NULL);
+
+   if (zst->zs_init)
+      inflateEnd(&zst->zs);
+   close(zst->fd);
+   dFree(zst->in_buf);
+   dFree(zst);
+}
+
+/*
+ * Get up to 'len' more bytes of the member.
+ * Return: number of bytes, 0 at its end, -1 on error.
+ */
+static int Zip_stream_read(ZipStream *zst, char *buf, int len)
+{
+   ssize_t st;
+   int zst_st;
+
+   if (zst->method == 0) {
+      len = MIN(len, zst->in_left);
+      if (len == 0)
+         return 0;
+      do {
+         st = pread(zst->fd, buf, len, zst->in_offset);
+      } while (st < 0 && errno == EINTR);
+      if (st <= 0)
+         return -1;
+      zst->in_offset += st;
+      zst->in_left -= st;
+      return st;
+   }
+
+   zst->zs.next_out = (Bytef *)buf;
+   zst->zs.avail_out = len;
+   while (zst->zs.avail_out == (uInt)len) {
+      if (zst->zs.avail_in == 0 && zst->in_left > 0) {
+         do {
+            st = pread(zst->fd, zst->in_buf, MIN(ZIP_BUF_SIZE, zst->in_left),
+                       zst->in_offset);
+         } while (st < 0 && errno == EINTR);
+         if (st <= 0)
+            return -1;
+         zst->in_offset += st;
+         zst->in_left -= st;
+         zst->zs.next_in = (Bytef *)zst->in_buf;
+         zst->zs.avail_in = st;
+      }
+      zst_st = inflate(&zst->zs, Z_NO_FLUSH);
+      if (zst_st == Z_STREAM_END)
+         break;
+      if (zst_st != Z_OK ||
+          (zst->zs.avail_in == 0 && zst->in_left == 0 &&
+           zst->zs.avail_out == (uInt)len))
+         return -1;
+   }
+   return len - zst->zs.avail_out;
+}
+
+#ifdef HAVE_SENDFILE
+/*
+ * Send the next chunk of a stored member straight from the archive.
+ * Return: 1 chunk sent (or EAGAIN), 0 at its end, -1 if sendfile() can't
+ *         be used, -3 on error.
+ */
+static int Zip_stream_sendfile(ZipStream *zst, int fd_out)
+{
+   int old_flags;
+   ssize_t st;
+
+   if (zst->in_left == 0)
+      return 0;
+   /* non-blocking, as Dsh does for its own writes */
+   old_flags = fcntl(fd_out, F_GETFL);
+   if (!(old_flags & O_NONBLOCK))
+      fcntl(fd_out, F_SETFL, old_flags | O_NONBLOCK);
+   do {
+      st = sendfile(fd_out, zst->fd, &zst->in_offset,
+                    MIN(zst->in_left, 1024*1024));
+   } while (st < 0 && errno == EINTR);
+   if (!(old_flags & O_NONBLOCK))
+      fcntl(fd_out, F_SETFL, old_flags);
+
+   if (st > 0) {
+      zst->in_left -= st;
+      return 1;
+   } else if (st < 0 && errno == EAGAIN) {
+      return 1;
+   } else if (st < 0 && (errno == EINVAL || errno == ENOSYS)) {
+      return -1;
+   }
+   return -3;
+}
+#endif /* HAVE_SENDFILE */
+
+/* External unzip -----------------------------------------------------------*/
+
 /*
  * Open a pipe to an unzip process with the specified cmdline arguments
  */
@@ -272,12 +763,27 @@ static DilloDir *Zip_dillodir_fs_new(const char *archive_filename)
    struct stat sb;
    struct tm tm;
    FILE *zip;
+   ZipArchive *za;
    DilloDir *Ddir;
    char *full_path, *timestamp;
    ZipFileInfo zfi;
-   int in_file_listing;
+   int i, in_file_listing;
    char line[1024];
 
+   if ((za = Zip_archive_get(archive_filename))) {
+      /* from the index, already in name order */
+      Ddir = FileUtil_dillodir_new(archive_filename);
+      for (i = 0; i < za->num_entries; ++i) {
+         full_path = dStrconcat(archive_filename, "/", za->entries[i].name,
+                                NULL);
+         sb.st_size = za->entries[i].usize;
+         sb.st_mode = S_IFREG;
+         sb.st_mtime = za->entries[i].mtime;
+         FileUtil_dillodir_add(Ddir, full_path, sb);
+      }
+      return Ddir;
+   }
+
    if (!(zip = Zip_open_listing(archive_filename)))
       return NULL;
 
@@ -330,14 +836,29 @@ static DilloDir *Zip_dillodir_fs_new(const char *archive_filename)
 static const char *Zip_content_type(const char *archive_filename, const char *inner_filename)
 {
    FILE *zip;
+   ZipArchive *za;
+   ZipEntry *ze;
+   ZipStream *zst;
    const char *ct;
    char buf[256];
-   ssize_t buf_size;
+   ssize_t buf_size, st;
 
    if (!(ct = FileUtil_ext(inner_filename))) {
       /* everything failed, let's analyze the data... */
-      zip = Zip_open_extract(archive_filename, inner_filename);
-      if (zip) {
+      if ((za = Zip_archive_get(archive_filename)) &&
+          (ze = Zip_archive_find(za, inner_filename)) &&
+          Zip_entry_supported(ze)) {
+         if ((zst = Zip_stream_new(za, ze))) {
+            for (buf_size = 0; buf_size < 256; buf_size += st)
+               if ((st = Zip_stream_read(zst, buf + buf_size,
+                                         256 - buf_size)) <= 0)
+                  break;
+            if (buf_size > 0)
+               ct = FileUtil_get_content_type_from_data(buf,
+                                                        (size_t)buf_size);
+            Zip_stream_free(zst);
+         }
+      } else if ((zip = Zip_open_extract(archive_filename, inner_filename))) {
          if ((buf_size = fread(buf, 1, 256, zip)) > 0) {
             ct = FileUtil_get_content_type_from_data(buf, (size_t)buf_size);
          }
@@ -492,8 +1013,30 @@ static int Zip_prepare_send_file(ClientInfo *client,
                                   const char *orig_url)
 {
    FILE *zip;
+   ZipArchive *za;
+   ZipEntry *ze;
    int res = -1;
 
+   if ((za = Zip_archive_get(archive_filename))) {
+      if (!(ze = Zip_archive_find(za, inner_filename))) {
+         res = ENOENT;
+      } else if (Zip_entry_supported(ze)) {
+         if (!(client->zstream = Zip_stream_new(za, ze))) {
+            res = EIO;
+         } else {
+            client->d_dir = NULL;
+            client->state = st_start;
+            client->orig_url = dStrdup(orig_url);
+            client->flags &= ~ZIP_READ;
+            client->flags |= ZIP_WRITE;
+            res = 0;
+         }
+      }
+      if (res != -1)
+         return res;
+      /* else let unzip deal with it */
+   }
+
    if (!(zip = Zip_open_extract(archive_filename, inner_filename))) {
       /* prepare an error message */
       res = errno;
@@ -638,14 +1181,45 @@ static int Zip_send_file(ClientInfo *client)
       } else {
          /* If we don't know type for gzipped data, let dillo figure it out. */
       }
-      /* Todo: determine content length */
-      /*
-      a_Dpip_dsh_printf(client->sh, 1,
-                        "Content-Length: %ld\r\n"
-                        client->file_sz); */
+      if (client->zstream) {
+         a_Dpip_dsh_printf(client->sh, 0, "Content-Length: %ld\r\n",
+                           (long)client->zstream->size);
+      }
       a_Dpip_dsh_printf(client->sh, 1, "\r\n");
       client->state = st_http;
 
+   } else if (client->state == st_http && client->zstream) {
+      /* Send body -- from the archive */
+      if ((st = a_Dpip_dsh_tryflush(client->sh)) < 0) {
+         client->flags |= (st == -3) ? ZIP_ERR : 0;
+#ifdef HAVE_SENDFILE
+      } else if (st == 0 && client->zstream->method == 0 &&
+                 (st = Zip_stream_sendfile(client->zstream,
+                                           client->sh->fd_out)) != -1) {
+         /* stored member, headers flushed: let the kernel send it */
+         if (st == 0) {
+            client->state = st_content;
+            client->flags |= ZIP_DONE;
+         } else if (st == -3) {
+            client->flags |= ZIP_ERR;
+         }
+#endif
+      } else {
+         st2 = Zip_stream_read(client->zstream, buf, LBUF);
+         if (st2 < 0) {
+            MSG("\nERROR while extracting '%s' from '%s'\n\n",
+                client->inner_filename, client->archive_filename);
+            client->flags |= ZIP_ERR;
+         } else if (st2 == 0) {
+            client->state = st_content;
+            client->flags |= ZIP_DONE;
+         } else {
+            /* ok to write */
+            st = a_Dpip_dsh_trywrite(client->sh, buf, st2);
+            client->flags |= (st == -3) ? ZIP_ERR : 0;
+         }
+      }
+
    } else if (client->state == st_http) {
       /* Send body -- raw file contents */
       if ((st = a_Dpip_dsh_tryflush(client->sh)) < 0) {
@@ -711,6 +1285,7 @@ static ClientInfo *Zip_add_client(int sock_fd)
    new_client->archive_filename = NULL;
    new_client->inner_filename = NULL;
    new_client->zip = NULL;
+   new_client->zstream = NULL;
    new_client->d_dir = NULL;
    new_client->state = 0;
    new_client->err_code = 0;
@@ -732,6 +1307,7 @@ static void Zip_remove_client(ClientInfo *client)
    a_Dpip_dsh_close(client->sh);
    a_Dpip_dsh_free(client->sh);
    Zip_close(client->zip);
+   Zip_stream_free(client->zstream);
    dFree(client->orig_url);
    if (client->archive_filename) dFree(client->archive_filename);
    if (client->inner_filename) dFree(client->inner_filename);
@@ -905,6 +1481,7 @@ int main(void)
 
    /* initialize Clients list */
    Clients = dList_new(512);
+   Archives = dList_new(ZIP_MAX_ARCHIVES + 1);
 
    /* some OSes may need this... */
    sin_sz = sizeof(sin);
@@ -31,8 +31,10 @@ enum {
    AUTH_CMD, /* authentication */
    BYE_CMD,  /* "DpiBye" */
    CHECK_SERVER_CMD, /* "check_server" */
+   CONNECT_SERVER_CMD, /* "connect_server" */
    REGISTER_ALL_CMD, /* "register_all" */
-   REGISTER_SERVICE_CMD /* "register_service" */
+   REGISTER_SERVICE_CMD, /* "register_service" */
+   PRESPAWN_CMD /* "prespawn" */
 };
 
 
@@ -41,7 +41,18 @@
 volatile sig_atomic_t caught_sigchld = 0;
 char *SharedKey = NULL;
 
-/*! Remove dpid_comm_keys file.
+/*! Remove the Unix-domain sockets of the dpis in dpi_attr_list.
+ */
+void rm_dpi_sockets(struct dp *dpi_attr_list, int numdpis)
+{
+   int i;
+
+   for (i = 0; i < numdpis; i++)
+      if (dpi_attr_list[i].sock_path)
+         unlink(dpi_attr_list[i].sock_path);
+}
+
+/*! Remove dpid_comm_keys file and the Unix-domain sockets.
  * This avoids that dillo instances connect to a stale port after dpid
  * has exited (e.g. after a reboot).
  */
@@ -51,6 +62,13 @@ void cleanup()
    fname = dStrconcat(dGethomedir(), "/", dotDILLO_DPID_COMM_KEYS, NULL);
    unlink(fname);
    dFree(fname);
+
+   if (sockdir) {
+      fname = dStrconcat(sockdir, "/", SRS_NAME, NULL);
+      unlink(fname);
+      dFree(fname);
+   }
+   rm_dpi_sockets(dpi_attr_list, numdpis);
 }
 
 /*! Free memory used to describe
@@ -66,6 +84,23 @@ void free_dpi_attr(struct dp *dpi_attr)
       dFree(dpi_attr->path);
       dpi_attr->path = NULL;
    }
+   if (dpi_attr->sock_path != NULL) {
+      dFree(dpi_attr->sock_path);
+      dpi_attr->sock_path = NULL;
+   }
+   close_warm_filter(dpi_attr);
+}
+
+/*! Forget the warm filter of a dpi, if any.
+ * It exits when it finds its socket closed.
+ */
+void close_warm_filter(struct dp *dpi_attr)
+{
+   if (dpi_attr->warm_fd != -1) {
+      dClose(dpi_attr->warm_fd);
+      dpi_attr->warm_fd = -1;
+   }
+   dpi_attr->warm_pid = 0;
 }
 
 /*! Free memory used by the plugin list
@@ -206,6 +241,21 @@ char *get_dpi_dir(char *dpidrc)
    return (value);
 }
 
+/*! Fill dpi_attr for the dpi program at path (both strings are copied)
+ */
+static void set_dpi_attr(struct dp *dpi_attr, const char *path,
+                         const char *service)
+{
+   dpi_attr->path = dStrdup(path);
+   dpi_attr->id = dStrdup(service);
+   dpi_attr->sock_path = NULL;
+   dpi_attr->pid = 1;
+   dpi_attr->filter = (strstr(dpi_attr->path, ".filter") != NULL);
+   dpi_attr->prespawn = 0;
+   dpi_attr->warm_fd = -1;
+   dpi_attr->warm_pid = 0;
+}
+
 /*! Scans a service directory in dpi_dir and fills dpi_attr
  * \Note
  * Caller must allocate memory for dpi_attr.
@@ -242,17 +292,14 @@ int get_dpi_attr(char *dpi_dir, char *service, struct dp *dpi_attr)
          ftype = get_file_type(dir_entry->d_name);
          switch (ftype) {
             case DPI_FILE:
-               dpi_attr->path =
+               {
+               char *path =
                   dStrconcat(service_dir, "/", dir_entry->d_name, NULL);
-               dpi_attr->id = dStrdup(service);
-               dpi_attr->port = 0;
-               dpi_attr->pid = 1;
-               if (strstr(dpi_attr->path, ".filter") != NULL)
-                  dpi_attr->filter = 1;
-               else
-                  dpi_attr->filter = 0;
+               set_dpi_attr(dpi_attr, path, service);
+               dFree(path);
                ret = 0;
                break;
+               }
             default:
                break;
          }
@@ -323,33 +370,155 @@ int register_service(struct dp *dpi_attr, char *service)
    return ret;
 }
 
+/*! Append a dpi to the list (the list is grown one by one)
+ */
+static void add_dpi_attr(struct dp **attlist, int snum, const char *path,
+                         const char *service)
+{
+   *attlist = (struct dp *) dRealloc(*attlist, (snum + 1) * sizeof(struct dp));
+   set_dpi_attr(&(*attlist)[snum], path, service);
+}
+
+/*! Note a scanned directory and its mtime in the scan cache
+ */
+static void scan_cache_add_dir(Dstr *cache, const char *dir)
+{
+   struct stat sb;
+
+   if (stat(dir, &sb) == 0)
+      dStr_sprintfa(cache, "dir\t%ld\t%s\n", (long)sb.st_mtime, dir);
+}
+
+/*! Scan a dpi directory, appending its dpis to attlist.
+ * The directories looked at are noted in cache.
+ * \Return
+ * the new number of dpis in attlist
+ */
+static int scan_dpi_dir(const char *dpidir, struct dp **attlist, int snum,
+                        Dstr *cache)
+{
+   DIR *dir_stream;
+   struct dirent *dirent;
+   struct dp dpi_attr;
+   char *service_dir;
+
+   if ((dir_stream = opendir(dpidir)) == NULL)
+      return snum;
+
+   scan_cache_add_dir(cache, dpidir);
+   while ((dirent = readdir(dir_stream)) != NULL) {
+      if (dirent->d_name[0] == '.')
+         continue;
+      service_dir = dStrconcat(dpidir, "/", dirent->d_name, NULL);
+      scan_cache_add_dir(cache, service_dir);
+      dFree(service_dir);
+      if (get_dpi_attr((char *)dpidir, dirent->d_name, &dpi_attr) == 0) {
+         add_dpi_attr(attlist, snum++, dpi_attr.path, dpi_attr.id);
+         dStr_sprintfa(cache, "dpi\t%s\t%s\n", dpi_attr.id, dpi_attr.path);
+         free_dpi_attr(&dpi_attr);
+      }
+   }
+   closedir(dir_stream);
+   return snum;
+}
+
+/*! Load the plugin list saved by the last scan, if none of the scanned
+ * directories changed since (adding or removing a dpi changes the mtime
+ * of its directory), and the dpi directories that were missing are still
+ * missing.
+ * \Return
+ * \li number of plugins on success
+ * \li -1 if there's no valid scan cache
+ */
+static int load_scan_cache(const char *fname, const char *dirs,
+                           struct dp **attlist)
+{
+   FILE *fp;
+   char *line, *f1, *f2;
+   struct stat sb;
+   int snum = 0, ok = 1;
+
+   if ((fp = fopen(fname, "r")) == NULL)
+      return -1;
+
+   /* the first line tells the dpi directories it was made for */
+   line = dGetline(fp);
+   if (!line || strncmp(line, dirs, strlen(dirs)) ||
+       line[strlen(dirs)] != '\n')
+      ok = 0;
+   dFree(line);
+
+   while (ok && (line = dGetline(fp)) != NULL) {
+      line[strcspn(line, "\n")] = 0;
+      if (!(f1 = strchr(line, '\t')) || !(f2 = strchr(++f1, '\t'))) {
+         ok = 0;
+      } else {
+         *f2++ = 0;
+         if (strncmp(line, "dir\t", 4) == 0) {
+            ok = (stat(f2, &sb) == 0 && (long)sb.st_mtime == atol(f1));
+         } else if (strncmp(line, "nodir\t", 6) == 0) {
+            ok = (access(f2, F_OK) == -1);
+         } else if (strncmp(line, "dpi\t", 4) == 0) {
+            add_dpi_attr(attlist, snum++, f2, f1);
+         } else {
+            ok = 0;
+         }
+      }
+      dFree(line);
+   }
+   fclose(fp);
+
+   if (!ok) {
+      free_plugin_list(attlist, snum);
+      return -1;
+   }
+   return snum;
+}
+
+/*! Save the scan cache, atomically
+ */
+static void save_scan_cache(const char *fname, const char *dirs, Dstr *cache)
+{
+   char *tmp = dStrconcat(fname, ".tmp", NULL);
+   FILE *fp;
+   int ok;
+
+   if ((fp = fopen(tmp, "w")) != NULL) {
+      ok = (fprintf(fp, "%s\n%s", dirs, cache->str) >= 0);
+      if (fclose(fp) == 0 && ok && rename(tmp, fname) == 0) {
+         tmp[0] = 0;
+      }
+   }
+   if (tmp[0])
+      unlink(tmp);
+   dFree(tmp);
+}
+
 /*!
  * Create dpi directory for available
  * plugins and create plugin list.
+ * The result is cached in dotDILLO_DPID_SCAN, so that dpid doesn't have to
+ * open every service directory when it starts.
  * \Return
  * \li Returns number of available plugins on success
  * \li -1 on failure
  */
 int register_all(struct dp **attlist)
 {
-   DIR *user_dir_stream, *sys_dir_stream;
    char *user_dpidir = NULL, *sys_dpidir = NULL, *dpidrc = NULL;
-   struct dirent *user_dirent, *sys_dirent;
-   int st;
+   char *scan_file, *dirs, *user_dpidir_path;
+   Dstr *cache;
    int snum;
-   size_t dp_sz = sizeof(struct dp);
 
    if (*attlist != NULL) {
       ERRMSG("register_all", "attlist parameter should be NULL", 0);
       return -1;
    }
 
-   user_dpidir = dStrconcat(dGethomedir(), "/", dotDILLO_DPI, NULL);
-   if (access(user_dpidir, F_OK) == -1) {
-      /* no dpis in user's space */
-      dFree(user_dpidir);
-      user_dpidir = NULL;
-   }
+   user_dpidir_path = dStrconcat(dGethomedir(), "/", dotDILLO_DPI, NULL);
+   if (access(user_dpidir_path, F_OK) == 0)
+      user_dpidir = dStrdup(user_dpidir_path);
+   /* else no dpis in user's space */
    dpidrc = dStrconcat(dGethomedir(), "/", dotDILLO_DPIDRC, NULL);
    if (access(dpidrc, F_OK) == -1) {
       dFree(dpidrc);
@@ -369,34 +538,30 @@ int register_all(struct dp **attlist)
       exit(1);
    }
 
-   /* Get list of services in user's .dillo/dpi directory */
-   snum = 0;
-   if (user_dpidir && (user_dir_stream = opendir(user_dpidir)) != NULL) {
-      while ((user_dirent = readdir(user_dir_stream)) != NULL) {
-         if (user_dirent->d_name[0] == '.')
-            continue;
-         *attlist = (struct dp *) dRealloc(*attlist, (snum + 1) * dp_sz);
-         st=get_dpi_attr(user_dpidir, user_dirent->d_name, &(*attlist)[snum]);
-         if (st == 0)
-            snum++;
-      }
-      closedir(user_dir_stream);
-   }
-   if (sys_dpidir && (sys_dir_stream = opendir(sys_dpidir)) != NULL) {
-      /* if system service is not in user list then add it */
-      while ((sys_dirent = readdir(sys_dir_stream)) != NULL) {
-         if (sys_dirent->d_name[0] == '.')
-           continue;
-         *attlist = (struct dp *) dRealloc(*attlist, (snum + 1) * dp_sz);
-         st=get_dpi_attr(sys_dpidir, sys_dirent->d_name, &(*attlist)[snum]);
-         if (st == 0)
-            snum++;
-      }
-      closedir(sys_dir_stream);
+   scan_file = dStrconcat(dGethomedir(), "/", dotDILLO_DPID_SCAN, NULL);
+   dirs = dStrconcat("dpidirs\t", user_dpidir_path, "\t",
+                     sys_dpidir ? sys_dpidir : "", NULL);
+
+   if ((snum = load_scan_cache(scan_file, dirs, attlist)) == -1) {
+      /* Get list of services in user's .dillo/dpi directory,
+       * and then the system ones */
+      cache = dStr_new("");
+      snum = 0;
+      if (user_dpidir)
+         snum = scan_dpi_dir(user_dpidir, attlist, snum, cache);
+      else  /* a personal dpi installed later must be found */
+         dStr_sprintfa(cache, "nodir\t0\t%s\n", user_dpidir_path);
+      if (sys_dpidir)
+         snum = scan_dpi_dir(sys_dpidir, attlist, snum, cache);
+      save_scan_cache(scan_file, dirs, cache);
+      dStr_free(cache, 1);
    }
 
+   dFree(dirs);
+   dFree(scan_file);
    dFree(sys_dpidir);
    dFree(user_dpidir);
+   dFree(user_dpidir_path);
 
    /* TODO: do we consider snum == 0 an error?
     *       (if so, we should return -1 )       */
@@ -484,6 +649,18 @@ int fill_services_list(struct dp *attlist, int numdpis, Dlist **services_list)
       if (strcmp(service, "dpi_dir") == 0)
          continue;
 
+      /* servers to start as soon as dillo is up */
+      if (strcmp(service, "dpi_prespawn") == 0) {
+         char *name, *list = dStrdup(path), *p = list;
+
+         while ((name = dStrsep(&p, " ,")) != NULL)
+            for (i = 0; *name && i < numdpis; i++)
+               if (!attlist[i].filter && strcmp(attlist[i].id, name) == 0)
+                  attlist[i].prespawn = 1;
+         dFree(list);
+         continue;
+      }
+
       s = dNew(struct service, 1);
       /* init services list entry */
       s->name = dStrdup(service);
@@ -577,6 +754,78 @@ int bind_socket_fd(int base_port, int *p_port)
    return ok ? sock_fd : -1;
 }
 
+/*! Bind a Unix-domain socket at path, replacing a stale one if any.
+ * \Return
+ * \li listening socket file descriptor on success
+ * \li -1 on failure
+ */
+int bind_unix_socket_fd(const char *path)
+{
+   int sock_fd;
+   struct sockaddr_un sun;
+
+   if (strlen(path) >= sizeof(sun.sun_path)) {
+      MSG_ERR("bind_unix_socket_fd: path too long: %s\n", path);
+      return (-1);
+   }
+   if ((sock_fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+      ERRMSG("bind_unix_socket_fd", "socket", errno);
+      return (-1);
+   }
+   /* Set the socket FD to close on exec */
+   fcntl(sock_fd, F_SETFD, FD_CLOEXEC | fcntl(sock_fd, F_GETFD));
+
+   memset(&sun, 0, sizeof(sun));
+   sun.sun_family = AF_UNIX;
+   strcpy(sun.sun_path, path);
+
+   /* The directory is ours, a socket file left there is from a dead dpid */
+   unlink(path);
+   if (bind(sock_fd, (struct sockaddr *)&sun, sizeof(sun)) == -1) {
+      ERRMSG("bind_unix_socket_fd", "bind", errno);
+      MSG_ERR(" - %s\n", path);
+   } else if (listen(sock_fd, QUEUE) == -1) {
+      ERRMSG("bind_unix_socket_fd", "listen", errno);
+   } else {
+      return sock_fd;
+   }
+   dClose(sock_fd);
+   return (-1);
+}
+
+/*! Connect a new socket to a dpi.
+ * When the dpi is not running, the connection waits in the listen queue
+ * until dpid starts it.
+ * \Return
+ * \li connected socket file descriptor on success
+ * \li -1 on failure
+ */
+int connect_dpi_socket(struct dp *dpi_attr)
+{
+   int sock_fd, flags;
+   struct sockaddr_un sun;
+
+   if ((sock_fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+      ERRMSG("connect_dpi_socket", "socket", errno);
+      return (-1);
+   }
+   memset(&sun, 0, sizeof(sun));
+   sun.sun_family = AF_UNIX;
+   strncpy(sun.sun_path, dpi_attr->sock_path, sizeof(sun.sun_path) - 1);
+
+   /* Don't block on a full queue: dpid itself has to start the dpi. */
+   flags = fcntl(sock_fd, F_GETFL);
+   fcntl(sock_fd, F_SETFL, flags | O_NONBLOCK);
+   if (ckd_connect(sock_fd, (struct sockaddr *)&sun, sizeof(sun)) == -1) {
+      MSG_ERR(" - %s\n", dpi_attr->sock_path);
+      dClose(sock_fd);
+      return (-1);
+   }
+   fcntl(sock_fd, F_SETFL, flags);
+
+   return sock_fd;
+}
+
 /*! Save the current port and a shared secret in a file so dillo can find it.
  * \Return:
  * \li -1 on failure
@@ -601,14 +850,17 @@ int save_comm_keys(int srs_port)
    return ret;
 }
 
-/*! Initialise the service request socket (IDS)
+/*! Initialise the service request sockets (IDS).
+ * The TCP one is found through dpid_comm_keys, the Unix-domain one
+ * in the socket directory; only the latter can hand connections over.
  * \Return:
- * \li Number of sockets (1 == success)
+ * \li Number of sockets (2 == success)
  * \li -1 on failure
  */
 int init_ids_srs_socket()
 {
    int srs_port, ret = -1;
+   char *srs_path;
 
    FD_ZERO(&sock_set);
 
@@ -622,6 +874,17 @@ int init_ids_srs_socket()
       }
    }
 
+   if (ret == 1) {
+      srs_path = dStrconcat(sockdir, "/", SRS_NAME, NULL);
+      if ((srs_un_fd = bind_unix_socket_fd(srs_path)) != -1) {
+         FD_SET(srs_un_fd, &sock_set);
+         ret = 2;
+      } else {
+         ret = -1;
+      }
+      dFree(srs_path);
+   }
+
    return ret;
 }
 
@@ -632,11 +895,12 @@ int init_ids_srs_socket()
  */
 int init_dpi_socket(struct dp *dpi_attr)
 {
-   int s_fd, port, ret = -1;
+   int s_fd, ret = -1;
 
-   if ((s_fd = bind_socket_fd(DPID_BASE_PORT, &port)) != -1) {
+   dFree(dpi_attr->sock_path);
+   dpi_attr->sock_path = dStrconcat(sockdir, "/", dpi_attr->id, NULL);
+   if ((s_fd = bind_unix_socket_fd(dpi_attr->sock_path)) != -1) {
       dpi_attr->sock_fd = s_fd;
-      dpi_attr->port = port;
       FD_SET(s_fd, &sock_set);
       ret = 1;
    }
@@ -692,6 +956,10 @@ void handle_sigchld(void)
          FD_SET(dpi_attr_list[i].sock_fd, &sock_set);
          numsocks++;
       }
+      /* a warm filter that exits before getting a connection is useless */
+      if (dpi_attr_list[i].warm_pid > 0 &&
+          waitpid(dpi_attr_list[i].warm_pid, &status, WNOHANG) > 0)
+         close_warm_filter(dpi_attr_list + i);
    }
 
    /* Wait for any old dpis that have exited */
@@ -735,30 +1003,21 @@ void stop_active_dpis(struct dp *dpi_attr_list, int numdpis)
 {
    char *bye_cmd, *auth_cmd;
    int i, sock_fd;
-   struct sockaddr_in sin;
 
    bye_cmd = a_Dpip_build_cmd("cmd=%s", "DpiBye");
    auth_cmd = a_Dpip_build_cmd("cmd=%s msg=%s", "auth", SharedKey);
 
-   memset(&sin, 0, sizeof(sin));
-   sin.sin_family = AF_INET;
-   sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-
    for (i = 0; i < numdpis; i++) {
       /* Skip inactive dpis and filters */
       if (dpi_attr_list[i].pid == 1 || dpi_attr_list[i].filter)
          continue;
 
-      if ((sock_fd = make_socket_fd()) == -1) {
-         ERRMSG("stop_active_dpis", "socket", errno);
-         continue;
-      }
-
-      sin.sin_port = htons(dpi_attr_list[i].port);
-      if (ckd_connect(sock_fd, (struct sockaddr *)&sin, sizeof(sin)) == -1) {
+      if ((sock_fd = connect_dpi_socket(dpi_attr_list + i)) == -1) {
          ERRMSG("stop_active_dpis", "connect", errno);
          MSG_ERR("%s\n", dpi_attr_list[i].path);
-      } else if (CKD_WRITE(sock_fd, auth_cmd) == -1) {
+         continue;
+      }
+      if (CKD_WRITE(sock_fd, auth_cmd) == -1) {
          ERRMSG("stop_active_dpis", "write", errno);
       } else if (CKD_WRITE(sock_fd, bye_cmd) == -1) {
          ERRMSG("stop_active_dpis", "write", errno);
@@ -784,26 +1043,36 @@ void ignore_dpi_sockets(struct dp *dpi_attr_list, int numdpis)
    for (i = 0; i < numdpis; i++) {
       FD_CLR(dpi_attr_list[i].sock_fd, &sock_set);
       dClose(dpi_attr_list[i].sock_fd);
+      close_warm_filter(dpi_attr_list + i);
    }
 }
 
 /*! Registers available dpis and stops active non-filter dpis.
  * Called when dpid receives
  * cmd='register' service='all'
- * command
+ * command (the dpi directories are scanned again)
  * \Return
  * Number of available dpis
  */
 int register_all_cmd()
 {
+   char *scan_file;
+
+   scan_file = dStrconcat(dGethomedir(), "/", dotDILLO_DPID_SCAN, NULL);
+   unlink(scan_file);
+   dFree(scan_file);
+
    stop_active_dpis(dpi_attr_list, numdpis);
+   ignore_dpi_sockets(dpi_attr_list, numdpis);
+   rm_dpi_sockets(dpi_attr_list, numdpis);
    free_plugin_list(&dpi_attr_list, numdpis);
    free_services_list(services_list);
    services_list = NULL;
    numdpis = 0;
-   numsocks = 1;                /* the srs socket */
+   numsocks = 2;                /* the srs sockets */
    FD_ZERO(&sock_set);
    FD_SET(srs_fd, &sock_set);
+   FD_SET(srs_un_fd, &sock_set);
    numdpis = register_all(&dpi_attr_list);
    fill_services_list(dpi_attr_list, numdpis, &services_list);
    numsocks = init_all_dpi_sockets(dpi_attr_list);
@@ -849,15 +1118,18 @@ int service_match(const struct service *A, const char *B)
 }
 
 /*!
- * Send socket port that matches dpi_id to client
+ * Find the dpi that serves the dpi_id in dpi_tag (answers the client
+ * with a DpiError when there isn't such a dpi)
+ * \Return
+ * index in dpi_attr_list on success, -1 on failure
  */
-void send_sockport(int sock_fd, char *dpi_tag, struct dp *dpi_attr_list)
+static int find_dpi(int sock_fd, char *dpi_tag, struct dp *dpi_attr_list)
 {
    int i;
-   char *dpi_id, *d_cmd, port_str[16];
+   char *dpi_id, *d_cmd;
    struct service *serv;
 
-   dReturn_if_fail((dpi_id = get_message(sock_fd, dpi_tag)) != NULL);
+   dReturn_val_if_fail((dpi_id = get_message(sock_fd, dpi_tag)) != NULL, -1);
 
    serv = dList_find_custom(services_list,dpi_id,(dCompareFunc)service_match);
 
@@ -867,13 +1139,95 @@ void send_sockport(int sock_fd, char *dpi_tag, struct dp *dpi_attr_list)
                       dpi_attr_list[i].id - strchr(dpi_attr_list[i].id, '.')))
             break;
 
-   if (i < numdpis) {
-      /* found */
-      snprintf(port_str, 8, "%d", dpi_attr_list[i].port);
-      d_cmd = a_Dpip_build_cmd("cmd=%s msg=%s", "send_data", port_str);
+   if (i >= numdpis) {
+      /* answer anyway, the connection may be kept open */
+      d_cmd = a_Dpip_build_cmd("cmd=%s msg=%s", "DpiError", "No such server");
       (void) CKD_WRITE(sock_fd, d_cmd);
       dFree(d_cmd);
+      i = -1;
    }
 
    dFree(dpi_id);
+   return i;
+}
+
+/*!
+ * Send the socket path of the dpi that matches dpi_id to client
+ */
+void send_sockport(int sock_fd, char *dpi_tag, struct dp *dpi_attr_list)
+{
+   int i;
+   char *d_cmd;
+
+   if ((i = find_dpi(sock_fd, dpi_tag, dpi_attr_list)) != -1) {
+      d_cmd = a_Dpip_build_cmd("cmd=%s msg=%s", "send_data",
+                               dpi_attr_list[i].sock_path);
+      (void) CKD_WRITE(sock_fd, d_cmd);
+      dFree(d_cmd);
+   }
+}
+
+/*!
+ * Connect to the dpi that matches dpi_id, and pass the connected socket
+ * to the client (along with the socket path, so it can connect by itself
+ * next time). Only works over the Unix-domain service request socket.
+ */
+void send_sockconn(int sock_fd, char *dpi_tag, struct dp *dpi_attr_list)
+{
+   int i, conn_fd;
+   char *d_cmd;
+   struct msghdr mh;
+   struct iovec iov;
+   union {
+      struct cmsghdr cm;
+      char buf[CMSG_SPACE(sizeof(int))];
+   } ctl;
+   struct cmsghdr *cmsg;
+   ssize_t st;
+
+   struct sockaddr_storage ss;
+   socklen_t ss_len = sizeof(ss);
+
+   if (getsockname(sock_fd, (struct sockaddr *)&ss, &ss_len) == -1 ||
+       ss.ss_family != AF_UNIX) {
+      d_cmd = a_Dpip_build_cmd("cmd=%s msg=%s",
+                               "DpiError", "Not a Unix-domain connection");
+      (void) CKD_WRITE(sock_fd, d_cmd);
+      dFree(d_cmd);
+      return;
+   }
+   if ((i = find_dpi(sock_fd, dpi_tag, dpi_attr_list)) == -1)
+      return;
+
+   if ((conn_fd = connect_dpi_socket(dpi_attr_list + i)) == -1) {
+      d_cmd = a_Dpip_build_cmd("cmd=%s msg=%s", "DpiError", "Can't connect");
+      (void) CKD_WRITE(sock_fd, d_cmd);
+      dFree(d_cmd);
+      return;
+   }
+
+   d_cmd = a_Dpip_build_cmd("cmd=%s msg=%s", "send_fd",
+                            dpi_attr_list[i].sock_path);
+   iov.iov_base = d_cmd;
+   iov.iov_len = strlen(d_cmd);
+   memset(&mh, 0, sizeof(mh));
+   mh.msg_iov = &iov;
+   mh.msg_iovlen = 1;
+   mh.msg_control = ctl.buf;
+   mh.msg_controllen = sizeof(ctl.buf);
+   cmsg = CMSG_FIRSTHDR(&mh);
+   cmsg->cmsg_level = SOL_SOCKET;
+   cmsg->cmsg_type = SCM_RIGHTS;
+   cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+   memcpy(CMSG_DATA(cmsg), &conn_fd, sizeof(int));
+
+   do {
+      st = sendmsg(sock_fd, &mh, 0);
+   } while (st == -1 && errno == EINTR);
+   if (st == -1)
+      ERRMSG("send_sockconn", "sendmsg", errno);
+
+   /* the client has its own copy now */
+   dClose(conn_fd);
+   dFree(d_cmd);
 }
@@ -30,15 +30,24 @@
 /*! dpid's service request socket file descriptor */
 extern int srs_fd;
 
+/*! dpid's Unix-domain service request socket file descriptor */
+extern int srs_un_fd;
+
+/*! Per user directory for the Unix-domain sockets */
+extern char *sockdir;
+
 /*! plugin state information
  */
 struct dp {
    char *id;
    char *path;
    int sock_fd;
-   int port;
+   char *sock_path;  /* Unix-domain socket the dpi listens on */
    pid_t pid;
    int filter;
+   int prespawn;     /* server to start when dillo asks for it */
+   int warm_fd;      /* socket to pass a connection to the warm filter */
+   pid_t warm_pid;   /* filter started ahead of time, waiting on warm_fd */
 };
 
 /*! bind dpi with service
@@ -76,6 +85,8 @@ void free_plugin_list(struct dp **dpi_attr_list_ptr, int numdpis);
 
 void free_services_list(Dlist *s_list);
 
+void close_warm_filter(struct dp *dpi_attr);
+
 enum file_type get_file_type(char *file_name);
 
 int get_dpi_attr(char *dpi_dir, char *service, struct dp *dpi_attr);
@@ -86,6 +97,10 @@ int register_all(struct dp **attlist);
 
 int fill_services_list(struct dp *attlist, int numdpis, Dlist **services_list);
 
+int bind_unix_socket_fd(const char *path);
+
+int connect_dpi_socket(struct dp *dpi_attr);
+
 int init_ids_srs_socket();
 
 int init_dpi_socket(struct dp *dpi_attr);
@@ -100,6 +115,8 @@ void est_dpi_sigchld(void);
 
 void est_dpi_terminator(void);
 
+int ckd_connect(int sock_fd, struct sockaddr *addr, socklen_t len);
+
 void stop_active_dpis(struct dp *dpi_attr_list, int numdpis);
 
 void ignore_dpi_sockets(struct dp *dpi_attr_list, int numdpis);
@@ -112,4 +129,6 @@ int service_match(const struct service *A, const char *B);
 
 void send_sockport(int sock_fd, char * dpi_tag, struct dp *dpi_attr_list);
 
+void send_sockconn(int sock_fd, char *dpi_tag, struct dp *dpi_attr_list);
+
 #endif
@@ -23,6 +23,7 @@
 #define dotDILLO_DPI "." BINNAME "/dpi"
 #define dotDILLO_DPIDRC "." BINNAME "/dpidrc"
 #define dotDILLO_DPID_COMM_KEYS "." BINNAME "/dpid_comm_keys"
+#define dotDILLO_DPID_SCAN "." BINNAME "/dpid_scan"
 
 #define ERRMSG(CALLER, CALLED, ERR)\
  errmsg(CALLER, CALLED, ERR, __FILE__, __LINE__)
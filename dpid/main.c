@@ -20,6 +20,8 @@
 #include <stdlib.h>      /* for exit */
 #include <assert.h>      /* for assert */
 #include <sys/stat.h>    /* for umask */
+#include <fcntl.h>       /* for F_SETFD, F_GETFD, FD_CLOEXEC */
+#include <sys/socket.h>  /* for socketpair, sendmsg */
 
 #include "dpid_common.h"
 #include "dpid-plus.h"
@@ -31,6 +33,7 @@
 #include "../dpip/dpip.h"
 
 sigset_t mask_sigchld;
+static sigset_t mask_none;
 enum dpi_errno_t dpi_errno;
 struct dp *dpi_attr_list;
 Dlist *services_list;
@@ -38,62 +41,162 @@ int numdpis;
 int numsocks;
 fd_set sock_set;
 int srs_fd;
+int srs_un_fd = -1;
+char *sockdir = NULL;
+
+/* Control connections (Dsh), kept open after their first request, so that
+ * a client can send several requests without reconnecting. They're all
+ * closed when the plugin set changes, to let the clients know that the
+ * socket paths they may have cached are stale. */
+static Dlist *ctrl_conns;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* Start a filter plugin ahead of time, so that the next connection to it
+ * doesn't wait for the exec. The plugin blocks in a_Dpip_dsh_new() until
+ * it gets its connection through its stdin (see pass_to_warm_filter).
+ */
+static void start_warm_filter(struct dp *dpi_attr)
+{
+   int sv[2];
+   pid_t pid;
+
+   if (dpi_attr->warm_fd != -1)
+      return;
+
+   if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+      ERRMSG("start_warm_filter", "socketpair", errno);
+      return;
+   }
+   if ((pid = fork()) == -1) {
+      ERRMSG("start_warm_filter", "fork", errno);
+      dClose(sv[0]);
+      dClose(sv[1]);
+      return;
+   }
+   if (pid == 0) {
+      /* Child, start plugin */
+      (void) sigprocmask(SIG_SETMASK, &mask_none, NULL);
+      dClose(sv[0]);
+      if (dup2(sv[1], STDIN_FILENO) == -1 ||
+          dup2(sv[1], STDOUT_FILENO) == -1) {
+         ERRMSG("start_warm_filter", "dup2", errno);
+         _exit(1);
+      }
+      if (sv[1] > STDOUT_FILENO)
+         dClose(sv[1]);
+      setenv("DPIP_WARM", "1", 1);
+      execl(dpi_attr->path, dpi_attr->path, (char*)NULL);
+      ERRMSG("start_warm_filter", "execl", errno);
+      MSG_ERR("ERROR in child proc for %s\n", dpi_attr->path);
+      _exit(1);
+   }
+
+   dClose(sv[1]);
+   /* the other plugins must not keep it open */
+   fcntl(sv[0], F_SETFD, FD_CLOEXEC | fcntl(sv[0], F_GETFD));
+   dpi_attr->warm_fd = sv[0];
+   dpi_attr->warm_pid = pid;
+}
+
+/* Pass a connection to the warm filter of a dpi, which is then on its own.
+ * \Return
+ * \li The filter's process ID on success
+ * \li 0 if there's no warm filter (or it has died)
+ */
+static int pass_to_warm_filter(struct dp *dpi_attr, int conn_fd)
+{
+   struct msghdr mh;
+   struct iovec iov;
+   union {
+      struct cmsghdr cm;
+      char buf[CMSG_SPACE(sizeof(int))];
+   } ctl;
+   struct cmsghdr *cmsg;
+   ssize_t st;
+   pid_t pid = dpi_attr->warm_pid;
+
+   if (dpi_attr->warm_fd == -1)
+      return 0;
+
+   iov.iov_base = "c";
+   iov.iov_len = 1;
+   memset(&mh, 0, sizeof(mh));
+   mh.msg_iov = &iov;
+   mh.msg_iovlen = 1;
+   mh.msg_control = ctl.buf;
+   mh.msg_controllen = sizeof(ctl.buf);
+   cmsg = CMSG_FIRSTHDR(&mh);
+   cmsg->cmsg_level = SOL_SOCKET;
+   cmsg->cmsg_type = SCM_RIGHTS;
+   cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+   memcpy(CMSG_DATA(cmsg), &conn_fd, sizeof(int));
+
+   do {
+      st = sendmsg(dpi_attr->warm_fd, &mh, MSG_NOSIGNAL);
+   } while (st == -1 && errno == EINTR);
+
+   /* either way, this one is not waiting anymore */
+   close_warm_filter(dpi_attr);
+   if (st == -1) {
+      ERRMSG("pass_to_warm_filter", "sendmsg", errno);
+      return 0;
+   }
+   return pid;
+}
 
 
 /* Start a dpi filter plugin after accepting the pending connection
+ * (or give the connection to its warm filter)
  * \Return
  * \li Child process ID on success
  * \li 0 on failure
  */
-static int start_filter_plugin(struct dp dpi_attr)
+static int start_filter_plugin(struct dp *dpi_attr)
 {
-   int newsock, old_stdout=-1, old_stdin=-1;
+   int newsock;
    socklen_t csz;
    struct sockaddr_un clnt_addr;
    pid_t pid;
 
    csz = (socklen_t) sizeof(clnt_addr);
 
-   newsock = accept(dpi_attr.sock_fd, (struct sockaddr *) &clnt_addr, &csz);
-   if (newsock == -1)
+   newsock = accept(dpi_attr->sock_fd, (struct sockaddr *) &clnt_addr, &csz);
+   if (newsock == -1) {
       ERRMSG("start_plugin", "accept", errno);
-
-   dup2(STDIN_FILENO, old_stdin);
-   if (dup2(newsock, STDIN_FILENO) == -1) {
-      ERRMSG("start_plugin", "dup2", errno);
-      MSG_ERR("ERROR in child proc for %s\n", dpi_attr.path);
-      exit(1);
+      return 0;
    }
-
-   dup2(STDOUT_FILENO, old_stdout);
-   if (dup2(newsock, STDOUT_FILENO) == -1) {
-      ERRMSG("start_plugin", "dup2", errno);
-      MSG_ERR("ERROR in child proc for %s\n", dpi_attr.path);
-      exit(1);
+   if ((pid = pass_to_warm_filter(dpi_attr, newsock)) != 0) {
+      dClose(newsock);
+      return pid;
    }
+
    if ((pid = fork()) == -1) {
       ERRMSG("main", "fork", errno);
+      dClose(newsock);
       return 0;
    }
    if (pid == 0) {
-      /* Child, start plugin */
-      if (execl(dpi_attr.path, dpi_attr.path, (char*)NULL) == -1) {
+      /* Child, start plugin with the connection as its stdin/stdout */
+      if (dup2(newsock, STDIN_FILENO) == -1 ||
+          dup2(newsock, STDOUT_FILENO) == -1) {
+         ERRMSG("start_plugin", "dup2", errno);
+         MSG_ERR("ERROR in child proc for %s\n", dpi_attr->path);
+         _exit(1);
+      }
+      if (newsock > STDOUT_FILENO)
+         dClose(newsock);
+      if (execl(dpi_attr->path, dpi_attr->path, (char*)NULL) == -1) {
          ERRMSG("start_plugin", "execl", errno);
-         MSG_ERR("ERROR in child proc for %s\n", dpi_attr.path);
-         exit(1);
+         MSG_ERR("ERROR in child proc for %s\n", dpi_attr->path);
+         _exit(1);
       }
    }
 
-   /* Parent, Close sockets fix stdio and return pid */
-   if (dClose(newsock) == -1) {
-      ERRMSG("start_plugin", "close", errno);
-      MSG_ERR("ERROR in child proc for %s\n", dpi_attr.path);
-      exit(1);
-   }
-   dClose(STDIN_FILENO);
-   dClose(STDOUT_FILENO);
-   dup2(old_stdin, STDIN_FILENO);
-   dup2(old_stdout, STDOUT_FILENO);
+   /* Parent, the child has its own copy */
+   dClose(newsock);
    return pid;
 }
 
@@ -116,6 +219,42 @@ static void start_server_plugin(struct dp dpi_attr)
    }
 }
 
+/* Start a dpi server plugin (unless it's running) but don't wait for new
+ * connections on its socket
+ */
+static void start_server(struct dp *dpi_attr)
+{
+   if (dpi_attr->pid > 1)
+      return;
+
+   numsocks--;
+   assert(numsocks >= 0);
+   FD_CLR(dpi_attr->sock_fd, &sock_set);
+   if ((dpi_attr->pid = fork()) == -1) {
+      ERRMSG("main", "fork", errno);
+      dpi_attr->pid = 1;
+      FD_SET(dpi_attr->sock_fd, &sock_set);
+      numsocks++;
+   } else if (dpi_attr->pid == 0) {
+      /* child */
+      (void) sigprocmask(SIG_SETMASK, &mask_none, NULL);
+      start_server_plugin(*dpi_attr);
+   }
+}
+
+/* Start the server plugins listed in dpi_prespawn (in dpidrc).
+ * dillo asks for it once its first page is up, so that they don't compete
+ * with it, and are ready for the first file: or bookmarks request.
+ */
+static void prespawn_servers(void)
+{
+   int i;
+
+   for (i = 0; i < numdpis; i++)
+      if (dpi_attr_list[i].prespawn && !dpi_attr_list[i].filter)
+         start_server(dpi_attr_list + i);
+}
+
 /*!
  * Read service request from sock
  * \Return
@@ -163,10 +302,14 @@ static int get_command(Dsh *sh, char *dpi_tag)
       COMMAND = BYE_CMD;
    } else if (strcmp("check_server", cmd) == 0) {
       COMMAND = CHECK_SERVER_CMD;
+   } else if (strcmp("connect_server", cmd) == 0) {
+      COMMAND = CONNECT_SERVER_CMD;
    } else if (strcmp("register_all", cmd) == 0) {
       COMMAND = REGISTER_ALL_CMD;
    } else if (strcmp("register_service", cmd) == 0) {
       COMMAND = REGISTER_SERVICE_CMD;
+   } else if (strcmp("prespawn", cmd) == 0) {
+      COMMAND = PRESPAWN_CMD;
    } else {                     /* Error unknown command */
       COMMAND = UNKNOWN_CMD;
    }
@@ -207,6 +350,111 @@ static int get_open_max(void)
 #endif
 }
 
+/*
+ * Serve one request on a control connection.
+ * \Return
+ * \li 1 to keep the connection open
+ * \li 0 to close it
+ * \li 2 to close it and all the other control connections
+ */
+static int serve_request(Dsh *sh)
+{
+   int command, ret = 1;
+   char *req;
+
+read_next:
+   req = get_request(sh);
+   if (req == NULL)
+      /* EOF: the client closed the connection */
+      return 0;
+   command = get_command(sh, req);
+   switch (command) {
+   case AUTH_CMD:
+      if (a_Dpip_check_auth(req) != -1) {
+         dFree(req);
+         goto read_next;
+      }
+      ret = 0;
+      break;
+   case BYE_CMD:
+      stop_active_dpis(dpi_attr_list, numdpis);
+      //cleanup();
+      exit(0);
+      break;
+   case CHECK_SERVER_CMD:
+      send_sockport(sh->fd_out, req, dpi_attr_list);
+      break;
+   case CONNECT_SERVER_CMD:
+      send_sockconn(sh->fd_out, req, dpi_attr_list);
+      break;
+   case REGISTER_ALL_CMD:
+      register_all_cmd();
+      ret = 2;
+      break;
+   case PRESPAWN_CMD:
+      /* no answer, the client doesn't wait for one */
+      prespawn_servers();
+      break;
+   case UNKNOWN_CMD:
+      {
+      char *d_cmd = a_Dpip_build_cmd("cmd=%s msg=%s",
+                                     "DpiError", "Unknown command");
+      (void) CKD_WRITE(sh->fd_out, d_cmd);
+      dFree(d_cmd);
+      ERRMSG("main", "Unknown command", 0);
+      MSG_ERR(" for request: %s\n", req);
+      break;
+      }
+   case -1:
+      _ERRMSG("main", "get_command failed", 0);
+      ret = 0;
+      break;
+   }
+   free(req);
+   return ret;
+}
+
+/*
+ * Close a control connection.
+ */
+static void close_ctrl_conn(Dsh *sh)
+{
+   FD_CLR(sh->fd_in, &sock_set);
+   dList_remove(ctrl_conns, sh);
+   a_Dpip_dsh_close(sh);
+   a_Dpip_dsh_free(sh);
+}
+
+/*
+ * Accept a control connection on a service request socket, and mark it
+ * as selected, so that its request gets served.
+ * \Return 1 on success, 0 on failure
+ */
+static int accept_ctrl_conn(int listen_fd, fd_set *selected_set)
+{
+   int sock_fd;
+   socklen_t sa_sz;
+   struct sockaddr_storage sa;
+   Dsh *sh;
+
+   sa_sz = (socklen_t) sizeof(sa);
+   sock_fd = accept(listen_fd, (struct sockaddr *)&sa, &sa_sz);
+   if (sock_fd == -1) {
+      ERRMSG("main", "accept", errno);
+      MSG_ERR("accept on srs socket failed\n");
+      MSG_ERR("service pending connections, and continue\n");
+      return 0;
+   }
+
+   /* plugins must not keep it open when we close it */
+   fcntl(sock_fd, F_SETFD, FD_CLOEXEC | fcntl(sock_fd, F_GETFD));
+   sh = a_Dpip_dsh_new(sock_fd, sock_fd, 1024);
+   dList_append(ctrl_conns, sh);
+   FD_SET(sock_fd, &sock_set);
+   FD_SET(sock_fd, selected_set);
+   return 1;
+}
+
 /*! \todo
  * \li Add a dpid_idle_timeout variable to dpidrc
  * \bug Infinite loop if plugin crashes before it accepts a connection
@@ -214,13 +462,14 @@ static int get_open_max(void)
 int main(void)
 {
    int i, n = 0, open_max;
+   char *dirname;
    int dpid_idle_timeout = 60 * 60; /* default, in seconds */
    struct timeval select_timeout;
-   sigset_t mask_none;
    fd_set selected_set;
 
    dpi_attr_list = NULL;
    services_list = NULL;
+   ctrl_conns = dList_new(4);
    //daemon(0,0); /* Use 0,1 for feedback */
    /* TODO: call setsid() ?? */
 
@@ -243,7 +492,6 @@ int main(void)
    /* Get list of available dpis */
    numdpis = register_all(&dpi_attr_list);
 
-#if 0
    /* Get name of socket directory */
    dirname = a_Dpi_sockdir_file();
    if ((sockdir = init_sockdir(dirname)) == NULL) {
@@ -251,7 +499,7 @@ int main(void)
       MSG_ERR("Failed to create socket directory\n");
       exit(1);
    }
-#endif
+   dFree(dirname);
 
    /* Init and get services list */
    fill_services_list(dpi_attr_list, numdpis, &services_list);
@@ -314,65 +562,38 @@ int main(void)
          ERRMSG("main", "select", errno);
          exit(1);
       }
-      /* If the service req socket is selected then service the req. */
+      /* If a service req socket is selected then accept the connection,
+       * its request is served below, as the other control connections. */
       if (FD_ISSET(srs_fd, &selected_set)) {
-         int sock_fd;
-         socklen_t sin_sz;
-         struct sockaddr_in sin;
-         char *req = NULL;
-
          --n;
          assert(n >= 0);
-         sin_sz = (socklen_t) sizeof(sin);
-         sock_fd = accept(srs_fd, (struct sockaddr *)&sin, &sin_sz);
-         if (sock_fd == -1) {
-            ERRMSG("main", "accept", errno);
-            MSG_ERR("accept on srs socket failed\n");
-            MSG_ERR("service pending connections, and continue\n");
-         } else {
-            int command;
-            Dsh *sh;
-
-            sh = a_Dpip_dsh_new(sock_fd, sock_fd, 1024);
-read_next:
-            req = get_request(sh);
-            command = get_command(sh, req);
-            switch (command) {
-            case AUTH_CMD:
-               if (a_Dpip_check_auth(req) != -1) {
-                  dFree(req);
-                  goto read_next;
-               }
-               break;
-            case BYE_CMD:
-               stop_active_dpis(dpi_attr_list, numdpis);
-               //cleanup();
-               exit(0);
-               break;
-            case CHECK_SERVER_CMD:
-               send_sockport(sock_fd, req, dpi_attr_list);
-               break;
-            case REGISTER_ALL_CMD:
-               register_all_cmd();
-               break;
-            case UNKNOWN_CMD:
-               {
-               char *d_cmd = a_Dpip_build_cmd("cmd=%s msg=%s",
-                                              "DpiError", "Unknown command");
-               (void) CKD_WRITE(sock_fd, d_cmd);
-               dFree(d_cmd);
-               ERRMSG("main", "Unknown command", 0);
-               MSG_ERR(" for request: %s\n", req);
-               break;
-               }
-            case -1:
-               _ERRMSG("main", "get_command failed", 0);
-               break;
+         n += accept_ctrl_conn(srs_fd, &selected_set);
+      }
+      if (FD_ISSET(srs_un_fd, &selected_set)) {
+         --n;
+         assert(n >= 0);
+         n += accept_ctrl_conn(srs_un_fd, &selected_set);
+      }
+
+      /* Serve the requests on the control connections */
+      for (i = 0; n > 0 && i < dList_length(ctrl_conns); i++) {
+         Dsh *sh = dList_nth_data(ctrl_conns, i);
+
+         if (FD_ISSET(sh->fd_in, &selected_set)) {
+            int st;
+
+            --n;
+            assert(n >= 0);
+            FD_CLR(sh->fd_in, &selected_set);
+            if ((st = serve_request(sh)) == 2) {
+               /* register_all_cmd() has rebuilt sock_set */
+               while ((sh = dList_nth_data(ctrl_conns, 0)))
+                  close_ctrl_conn(sh);
+               n = 0;
+            } else if (st == 0) {
+               close_ctrl_conn(sh);
+               --i;
             }
-            if (req)
-               free(req);
-            a_Dpip_dsh_close(sh);
-            a_Dpip_dsh_free(sh);
          }
       }
 
@@ -387,21 +608,11 @@ read_next:
                /* start a dpi filter plugin and continue watching its socket
                 * for new connections */
                (void) sigprocmask(SIG_SETMASK, &mask_none, NULL);
-               start_filter_plugin(dpi_attr_list[i]);
+               start_filter_plugin(dpi_attr_list + i);
+               /* have the next one ready */
+               start_warm_filter(dpi_attr_list + i);
             } else {
-               /* start a dpi server plugin but don't wait for new connections
-                * on its socket */
-               numsocks--;
-               assert(numsocks >= 0);
-               FD_CLR(dpi_attr_list[i].sock_fd, &sock_set);
-               if ((dpi_attr_list[i].pid = fork()) == -1) {
-                  ERRMSG("main", "fork", errno);
-                  /* exit(1); */
-               } else if (dpi_attr_list[i].pid == 0) {
-                  /* child */
-                  (void) sigprocmask(SIG_SETMASK, &mask_none, NULL);
-                  start_server_plugin(dpi_attr_list[i]);
-               }
+               start_server(dpi_attr_list + i);
             }
          }
       }
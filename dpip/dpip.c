@@ -18,6 +18,7 @@
 #include <ctype.h>
 #include <unistd.h>   /* for close */
 #include <fcntl.h>    /* for fcntl */
+#include <sys/socket.h>   /* for recvmsg */
 
 #include "dpip.h"
 #include "d_size.h"
@@ -27,6 +28,7 @@
 
 #define DPIP_TAG_END            " '>"
 #define DPIP_MODE_SWITCH_TAG    "cmd='start_send_page' "
+#define DPIP_AUTH_TAG           "<cmd='auth' "
 #define MSG_ERR(...)            fprintf(stderr, "[dpip]: " __VA_ARGS__)
 
 /*
@@ -232,16 +234,198 @@ int a_Dpip_check_auth(const char *auth_tag)
    return ret;
 }
 
+/* --------------------------------------------------------------------------
+ * Framed tags --------------------------------------------------------------
+ *
+ * A tag frame carries the attributes of a tag already parsed and unstuffed,
+ * after a header with its length, so that the reader neither has to look
+ * for the end of the tag nor rescan it for every attribute:
+ *
+ *   DPIP_FRAME_MARK <4 byte length> *(<name> "\0" <value> "\0")
+ *
+ * e.g. <cmd='chat' msg='ain''t' '> becomes:
+ *
+ *   "\1\0\0\0\023" "cmd\0chat\0msg\0ain't\0"
+ */
+
+/*
+ * Return the payload length from a frame header (DPIP_FRAME_HDR_SZ bytes),
+ * or -1 if it's over DPIP_FRAME_MAX (the stream is not a valid one, e.g.
+ * a text-mode peer sent a stray DPIP_FRAME_MARK byte).
+ */
+int a_Dpip_frame_len(const char *hdr)
+{
+   const uchar_t *p = (const uchar_t *)hdr + 1;
+   uint_t len = ((uint_t)p[0] << 24) | ((uint_t)p[1] << 16) |
+                ((uint_t)p[2] << 8) | (uint_t)p[3];
+
+   return (len > DPIP_FRAME_MAX) ? -1 : (int)len;
+}
+
+/*
+ * Append the frame for a complete tag to 'ds'.
+ * Return value: 0 on success, -1 if the tag is malformed (nothing appended).
+ */
+static int Dpip_append_frame(Dstr *ds, const char *tag, size_t tagsize)
+{
+   size_t i, start, hdr = (size_t)ds->len;
+   uint_t len;
+
+   dStr_append_l(ds, "\1\0\0\0\0", DPIP_FRAME_HDR_SZ);
+   for (i = 1; i < tagsize; ) {
+      if (tag[i] == ' ') {
+         ++i;
+      } else if (tag[i] == Quote) {
+         break;
+      } else {
+         /* name (a leading "<dpi " is skipped) */
+         for (start = i; i < tagsize && tag[i] != '='; ++i)
+            if (tag[i] == ' ')
+               start = i + 1;
+         if (i + 1 >= tagsize || tag[i + 1] != Quote)
+            break;
+         dStr_append_l(ds, tag + start, (int)(i - start));
+         dStr_append_c(ds, 0);
+         /* value */
+         for (i += 2; i < tagsize; ++i) {
+            if (tag[i] == Quote) {
+               if (i + 1 < tagsize && tag[i + 1] == Quote)
+                  ++i;
+               else
+                  break;
+            }
+            dStr_append_c(ds, tag[i]);
+         }
+         dStr_append_c(ds, 0);
+         ++i;
+      }
+   }
+
+   len = (uint_t)ds->len - hdr - DPIP_FRAME_HDR_SZ;
+   if (i + 2 != tagsize || tag[i] != Quote || tag[i + 1] != '>' ||
+       len > DPIP_FRAME_MAX) {
+      dStr_truncate(ds, (int)hdr);
+      return -1;
+   }
+   ds->str[hdr + 1] = (char)(len >> 24);
+   ds->str[hdr + 2] = (char)(len >> 16);
+   ds->str[hdr + 3] = (char)(len >> 8);
+   ds->str[hdr + 4] = (char)len;
+   return 0;
+}
+
+/*
+ * Task: given a frame's payload, its size and an attribute name, return
+ * the attribute value.
+ * Return value: the attribute value, or NULL if not present or malformed.
+ */
+char *a_Dpip_frame_get_attr(const char *frame, size_t framesize,
+                            const char *attrname)
+{
+   const char *p = frame, *end = frame + framesize, *q, *v;
+
+   if (!frame || !attrname)
+      return NULL;
+
+   while (p < end &&
+          (q = memchr(p, 0, end - p)) && (v = memchr(q + 1, 0, end - q - 1))) {
+      if (strcmp(p, attrname) == 0)
+         return dStrndup(q + 1, (uint_t)(v - q - 1));
+      p = v + 1;
+   }
+   return NULL;
+}
+
+/*
+ * Return the frame's payload as a (newly allocated) text tag, for the
+ * code that wants to see the tag itself.
+ */
+char *a_Dpip_frame_to_tag(const char *frame, size_t framesize)
+{
+   const char *p = frame, *end = frame + framesize, *q, *v;
+   Dstr *tag = dStr_sized_new(framesize + 16);
+   char *ret;
+
+   dStr_append_c(tag, '<');
+   while (p < end &&
+          (q = memchr(p, 0, end - p)) && (v = memchr(q + 1, 0, end - q - 1))) {
+      if (tag->len > 1)
+         dStr_append_c(tag, ' ');
+      dStr_append_l(tag, p, (int)(q - p));
+      dStr_append_c(tag, '=');
+      dStr_append_c(tag, Quote);
+      for (++q; q < v; ++q) {
+         dStr_append_c(tag, *q);
+         if (*q == Quote)
+            dStr_append_c(tag, *q);
+      }
+      dStr_append_c(tag, Quote);
+      p = v + 1;
+   }
+   dStr_append(tag, " '>");
+
+   ret = tag->str;
+   dStr_free(tag, FALSE);
+   return ret;
+}
+
 /* --------------------------------------------------------------------------
  * Dpip socket API ----------------------------------------------------------
  */
 
+/*
+ * A filter dpi started ahead of time by dpid (a "warm" one) gets its
+ * connection later, passed through its stdin; put it in place of
+ * stdin and stdout. If dpid closes the socket instead, there's nothing
+ * to do: exit.
+ */
+static void Dpip_warm_wait(void)
+{
+   int fd = -1;
+   char c;
+   struct msghdr mh;
+   struct iovec iov;
+   union {
+      struct cmsghdr cm;
+      char buf[CMSG_SPACE(sizeof(int))];
+   } ctl;
+   struct cmsghdr *cmsg;
+   ssize_t st;
+
+   unsetenv("DPIP_WARM");
+
+   iov.iov_base = &c;
+   iov.iov_len = 1;
+   memset(&mh, 0, sizeof(mh));
+   mh.msg_iov = &iov;
+   mh.msg_iovlen = 1;
+   mh.msg_control = ctl.buf;
+   mh.msg_controllen = sizeof(ctl.buf);
+   while ((st = recvmsg(STDIN_FILENO, &mh, 0)) == -1 && errno == EINTR) ;
+   if (st > 0) {
+      for (cmsg = CMSG_FIRSTHDR(&mh); cmsg; cmsg = CMSG_NXTHDR(&mh, cmsg)) {
+         if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+      }
+   }
+   if (fd == -1 ||
+       dup2(fd, STDIN_FILENO) == -1 || dup2(fd, STDOUT_FILENO) == -1)
+      _exit(0);
+   if (fd > STDOUT_FILENO)
+      close(fd);
+}
+
 /*
  * Create and initialize a dpip socket handler
  */
 Dsh *a_Dpip_dsh_new(int fd_in, int fd_out, int flush_sz)
 {
-   Dsh *dsh = dNew(Dsh, 1);
+   Dsh *dsh;
+
+   if (fd_in == STDIN_FILENO && getenv("DPIP_WARM"))
+      Dpip_warm_wait();
+
+   dsh = dNew(Dsh, 1);
 
    /* init descriptors and streams */
    dsh->fd_in  = fd_in;
@@ -305,6 +489,34 @@ static int Dpip_dsh_write(Dsh *dsh, int nb, const char *Data, int DataSize)
    return ret;
 }
 
+/*
+ * Append tags to the write buffer as frames. Whatever follows the tag
+ * that starts sending a page is raw data. Anything else that isn't a
+ * complete tag (e.g. a tag written in pieces) makes this connection fall
+ * back to text tags, which the client can parse as well.
+ */
+static void Dpip_dsh_append_frames(Dsh *dsh, const char *Data, int DataSize)
+{
+   int i, start = 0;
+   size_t sw_len = strlen(DPIP_MODE_SWITCH_TAG);
+
+   for (i = 2; i < DataSize && !(dsh->mode & DPIP_WR_RAW); ++i) {
+      /* end of tag (EOT=" '>") */
+      if (Data[i] == '>' && Data[i-1] == Quote && Data[i-2] == ' ') {
+         if (Data[start] != '<' ||
+             Dpip_append_frame(dsh->wrbuf, Data + start, i + 1 - start))
+            break;
+         if ((size_t)(i - start) > sw_len &&
+             !strncmp(Data + start + 1, DPIP_MODE_SWITCH_TAG, sw_len))
+            dsh->mode |= DPIP_WR_RAW;
+         start = i + 1;
+      }
+   }
+   if (start < DataSize && !(dsh->mode & DPIP_WR_RAW))
+      dsh->mode &= ~DPIP_FRAMES;
+   dStr_append_l(dsh->wrbuf, Data + start, DataSize - start);
+}
+
 /*
  * Streamed write to socket
  * Return: 0 on success, 1 on error.
@@ -314,7 +526,10 @@ int a_Dpip_dsh_write(Dsh *dsh, int flush, const char *Data, int DataSize)
    int ret = 1;
 
    /* append to buf */
-   dStr_append_l(dsh->wrbuf, Data, DataSize);
+   if ((dsh->mode & (DPIP_FRAMES | DPIP_WR_RAW)) == DPIP_FRAMES)
+      Dpip_dsh_append_frames(dsh, Data, DataSize);
+   else
+      dStr_append_l(dsh->wrbuf, Data, DataSize);
 
    if (!flush || dsh->wrbuf->len == 0)
       return 0;
@@ -355,6 +570,11 @@ int a_Dpip_dsh_trywrite(Dsh *dsh, const char *Data, int DataSize)
 {
    int st;
 
+   if ((dsh->mode & (DPIP_FRAMES | DPIP_WR_RAW)) == DPIP_FRAMES) {
+      /* tags go through the buffer, to be framed */
+      a_Dpip_dsh_write(dsh, 0, Data, DataSize);
+      return (a_Dpip_dsh_tryflush(dsh) == -3) ? -3 : DataSize;
+   }
    if ((st = Dpip_dsh_write(dsh, 1, Data, DataSize)) > 0) {
       /* update internal buffer */
       if (st < DataSize)
@@ -425,6 +645,19 @@ static void Dpip_dsh_read(Dsh *dsh, int blocking)
       Dpip_dsh_read(dsh, 0);
 }
 
+/*
+ * The client offers to read framed tags in its auth tag (frames='1');
+ * old clients don't, and keep getting text tags.
+ */
+static void Dpip_dsh_check_frames(Dsh *dsh, const char *tag, int tagsize)
+{
+   char *val = a_Dpip_get_attr_l(tag, (size_t)tagsize, "frames");
+
+   if (val && strcmp(val, "1") == 0)
+      dsh->mode |= DPIP_FRAMES;
+   dFree(val);
+}
+
 /*
  * Return a newlly allocated string with the next dpip token in the socket.
  * Return value: token string and length on success, NULL otherwise.
@@ -440,7 +673,7 @@ char *a_Dpip_dsh_read_token2(Dsh *dsh, int blocking, int *DataSize)
 
    /* switch mode upon request */
    if (dsh->mode & DPIP_LAST_TAG)
-      dsh->mode = DPIP_RAW;
+      dsh->mode = DPIP_RAW | (dsh->mode & (DPIP_FRAMES | DPIP_WR_RAW));
 
    if (blocking) {
       if (dsh->mode & DPIP_TAG) {
@@ -468,6 +701,8 @@ char *a_Dpip_dsh_read_token2(Dsh *dsh, int blocking, int *DataSize)
          dStr_erase(dsh->rdbuf, 0, p - dsh->rdbuf->str + 3);
          if (strstr(ret, DPIP_MODE_SWITCH_TAG))
             dsh->mode |= DPIP_LAST_TAG;
+         else if (!strncmp(ret, DPIP_AUTH_TAG, strlen(DPIP_AUTH_TAG)))
+            Dpip_dsh_check_frames(dsh, ret, *DataSize);
       }
    } else {
       /* raw mode, return what we have "as is" */
@@ -18,6 +18,17 @@ extern "C" {
 #define   DPIP_LAST_TAG   2   /* Dpip mode-switching tag */
 #define   DPIP_RAW        4   /* Raw data in the socket  */
 #define   DPIP_NONBLOCK   8   /* Nonblocking IO          */
+#define   DPIP_FRAMES    16   /* Write tags as frames    */
+#define   DPIP_WR_RAW    32   /* Raw data is written now */
+
+/*
+ * Framed tags: a DPIP_FRAME_MARK byte, the payload length (4 bytes, most
+ * significant first) and the attributes as "name\0value\0" pairs.
+ * They're sent only to clients that offer frames='1' in their auth tag.
+ */
+#define   DPIP_FRAME_MARK     '\x01'
+#define   DPIP_FRAME_HDR_SZ   5
+#define   DPIP_FRAME_MAX      (1024*1024)  /* max payload length */
 
 typedef enum {
    DPIP_EAGAIN,
@@ -38,7 +49,8 @@ typedef struct {
    Dstr *rdbuf;    /* read buffer */
    int flush_sz;   /* max size before flush */
 
-   int mode;       /* mode flags: DPIP_TAG | DPIP_LAST_TAG | DPIP_RAW */
+   int mode;       /* mode flags: DPIP_TAG | DPIP_LAST_TAG | DPIP_RAW
+                    *             | DPIP_FRAMES | DPIP_WR_RAW */
    int status;     /* status code: DPIP_EAGAIN | DPIP_ERROR | DPIP_EOF */
 } Dsh;
 
@@ -61,6 +73,14 @@ char *a_Dpip_get_attr_l(const char *tag, size_t tagsize, const char *attrname);
 
 int a_Dpip_check_auth(const char *auth);
 
+/*
+ * Framed tags
+ */
+int a_Dpip_frame_len(const char *hdr);
+char *a_Dpip_frame_get_attr(const char *frame, size_t framesize,
+                            const char *attrname);
+char *a_Dpip_frame_to_tag(const char *frame, size_t framesize);
+
 /*
  * Dpip socket API
  */
@@ -26,28 +26,41 @@
 namespace dw {
 namespace core {
 
+using namespace lout::misc;
+using namespace lout::container::typed;
+
 FindtextState::FindtextState ()
 {
    DBG_OBJ_CREATE ("dw::core::FindtextState");
 
    key = NULL;
-   nexttab = NULL;
    widget = NULL;
    iterator = NULL;
    hlIterator = NULL;
+
+   text = new SimpleVector<char> (1);
+   foldedText = new SimpleVector<char> (1);
+   checkpoints = new Vector<CharIterator> (1, true);
+   matches = new SimpleVector<int> (1);
+   indexValid = false;
+   indexAllocationSerial = indexContentSerial = 0;
+   currentMatch = -1;
 }
 
 FindtextState::~FindtextState ()
 {
    if (key)
       free(key);
-   if (nexttab)
-      delete[] nexttab;
    if (iterator)
       delete iterator;
    if (hlIterator)
       delete hlIterator;
 
+   delete text;
+   delete foldedText;
+   delete checkpoints;
+   delete matches;
+
    DBG_OBJ_DELETE ();
 }
 
@@ -59,9 +72,6 @@ void FindtextState::setWidget (Widget *widget)
    if (key)
       free(key);
    key = NULL;
-   if (nexttab)
-      delete[] nexttab;
-   nexttab = NULL;
 
    if (iterator)
       delete iterator;
@@ -69,6 +79,8 @@ void FindtextState::setWidget (Widget *widget)
    if (hlIterator)
       delete hlIterator;
    hlIterator = NULL;
+
+   clearIndex ();
 }
 
 FindtextState::Result FindtextState::search (const char *key, bool caseSens,
@@ -77,71 +89,74 @@ FindtextState::Result FindtextState::search (const char *key, bool caseSens,
    if (!widget || *key == 0) // empty keys are not found
       return NOT_FOUND;
 
-   bool wasHighlighted = unhighlight ();
-   bool newKey;
+   unhighlight ();
+
+   // The position of the last occurrence, from which the search is
+   // continued.
+   int lastPos =
+      currentMatch >= 0 && currentMatch < matches->size () ?
+      matches->get (currentMatch) : -1;
+   bool newMatches = false;
 
    // If the key (or the widget) changes (including case sensitivity),
    // the search is started from the beginning.
    if (this->key == NULL || this->caseSens != caseSens ||
        strcmp (this->key, key) != 0) {
-      newKey = true;
       if (this->key)
          free(this->key);
       this->key = strdup (key);
       this->caseSens = caseSens;
+      lastPos = -1;
+      newMatches = true;
+   }
+
+   if (!isIndexUpToDate ()) {
+      buildIndex ();
+      newMatches = true;
+   }
 
-      if (nexttab)
-         delete[] nexttab;
-      nexttab = createNexttab (key, caseSens, backwards);
+   if (newMatches)
+      findMatches ();
 
-      if (iterator)
-         delete iterator;
-      iterator = new CharIterator (widget, true);
+   int numMatches = matches->size ();
+   if (numMatches == 0) {
+      currentMatch = -1;
+      return NOT_FOUND;
+   }
 
-      if (backwards) {
-         /* Go to end */
-         while (iterator->next () ) ;
-         iterator->prev (); //We don't want to be at CharIterator::END.
-      } else {
-         iterator->next ();
-      }
-   } else
-      newKey = false;
-
-   bool firstTrial = !wasHighlighted || newKey;
-
-   if (search0 (backwards, firstTrial)) {
-      // Highlighting is done with a clone.
-      hlIterator = iterator->cloneCharIterator ();
-      for (int i = 0; key[i]; i++)
-         hlIterator->next ();
-      CharIterator::highlight (iterator, hlIterator, HIGHLIGHT_FINDTEXT);
-      CharIterator::scrollTo (iterator, hlIterator,
-                              HPOS_INTO_VIEW, VPOS_CENTER);
-
-      // The search will continue from the word after the found position.
-      iterator->next ();
-      return SUCCESS;
+   // Search the first occurrence after (or before) lastPos.
+   int low = 0, high = numMatches;
+   while (low < high) {
+      int mid = (low + high) / 2;
+      if (backwards ? matches->get (mid) < lastPos :
+          matches->get (mid) <= lastPos)
+         low = mid + 1;
+      else
+         high = mid;
+   }
+
+   Result result;
+   if (lastPos == -1) {
+      currentMatch = backwards ? numMatches - 1 : 0;
+      result = SUCCESS;
+   } else if (backwards ? low > 0 : low < numMatches) {
+      currentMatch = backwards ? low - 1 : low;
+      result = SUCCESS;
    } else {
-      if (firstTrial) {
-         return NOT_FOUND;
-      } else {
-         // Nothing found anymore, reset the state for the next trial.
-         delete iterator;
-         iterator = new CharIterator (widget, true);
-         if (backwards) {
-            /* Go to end */
-            while (iterator->next ()) ;
-            iterator->prev (); //We don't want to be at CharIterator::END.
-         } else {
-            iterator->next ();
-         }
-         // We expect a success.
-         Result result2 = search (key, caseSens, backwards);
-         assert (result2 == SUCCESS);
-         return RESTART;
-      }
+      // Nothing found anymore, restart from the other end.
+      currentMatch = backwards ? numMatches - 1 : 0;
+      result = RESTART;
    }
+
+   int pos = matches->get (currentMatch);
+   iterator = iteratorAt (pos);
+   hlIterator = iterator->cloneCharIterator ();
+   for (int i = 0; key[i]; i++)
+      hlIterator->next ();
+   CharIterator::highlight (iterator, hlIterator, HIGHLIGHT_FINDTEXT);
+   CharIterator::scrollTo (iterator, hlIterator, HPOS_INTO_VIEW, VPOS_CENTER);
+
+   return result;
 }
 
 /**
@@ -154,143 +169,153 @@ void FindtextState::resetSearch ()
    if (key)
       free(key);
    key = NULL;
+   currentMatch = -1;
 }
 
-/*
- * Return a new string: with the reverse of the original.
+/**
+ * \brief Returns whether the position of the search refers to \em widget
+ *    or one of its children (see dw::core::DeepIterator::refersTo).
  */
-const char* FindtextState::rev(const char *str)
+bool FindtextState::refersTo (Widget *widget)
 {
-   if (!str)
-      return NULL;
+   if ((iterator && iterator->refersTo (widget)) ||
+       (hlIterator && hlIterator->refersTo (widget)))
+      return true;
 
-   int len = strlen(str);
-   char *nstr = new char[len+1];
-   for (int i = 0; i < len; ++i)
-      nstr[i] = str[len-1 -i];
-   nstr[len] = 0;
+   // The checkpoints of an outdated index are never used again (only
+   // deleted), so they may refer to deleted widgets.
+   if (isIndexUpToDate ()) {
+      for (int i = 0; i < checkpoints->size (); i++)
+         if (checkpoints->get(i)->refersTo (widget))
+            return true;
+   }
 
-   return nstr;
+   return false;
 }
 
-int *FindtextState::createNexttab (const char *needle, bool caseSens,
-                                   bool backwards)
+void FindtextState::clearIndex ()
 {
-   const char* key;
-
-   key = (backwards) ? rev(needle) : needle;
-   int i = 0;
-   int j = -1;
-   int l = strlen (key);
-   int *nexttab = new int[l + 1]; // + 1 is necessary for l == 1 case
-   nexttab[0] = -1;
-
-   do {
-      if (j == -1 || charsEqual (key[i], key[j], caseSens)) {
-         i++;
-         j++;
-         nexttab[i] = j;
-         //_MSG ("nexttab[%d] = %d\n", i, j);
-      } else
-         j = nexttab[j];
-   } while (i < l - 1);
-
-   if (backwards)
-      delete [] key;
-
-   return nexttab;
+   text->setSize (0);
+   foldedText->setSize (0);
+   checkpoints->clear ();
+   matches->setSize (0);
+   indexValid = false;
+   currentMatch = -1;
 }
 
 /**
- * \brief Unhighlight, and return whether a region was highlighted.
+ * \brief Whether the index still reflects the text of the widget tree.
+ *
+ * The text may have changed since the index was built, when any
+ * allocation or any content has changed.
  */
-bool FindtextState::unhighlight ()
+bool FindtextState::isIndexUpToDate ()
 {
-   if (hlIterator) {
-      CharIterator *start = hlIterator->cloneCharIterator ();
-      for (int i = 0; key[i]; i++)
-         start->prev ();
+   Layout *layout = widget ? widget->getLayout () : NULL;
+   return indexValid &&
+      (layout == NULL ||
+       (indexAllocationSerial == layout->getAllocationSerial () &&
+        indexContentSerial == layout->getContentSerial ()));
+}
 
-      CharIterator::unhighlight (start, hlIterator, HIGHLIGHT_FINDTEXT);
-      delete start;
-      delete hlIterator;
-      hlIterator = NULL;
+/**
+ * \brief Collect the text of the whole widget tree.
+ *
+ * This walks once over all characters, so that all further searches
+ * only deal with a flat buffer, until the text changes.
+ */
+void FindtextState::buildIndex ()
+{
+   clearIndex ();
+
+   CharIterator *it = new CharIterator (widget, true);
+   for (int n = 0; it->next (); n++) {
+      if (n % CHECKPOINT_DIST == 0)
+         checkpoints->put (it->cloneCharIterator ());
+      text->increase ();
+      text->set (n, it->getChar ());
+   }
+   delete it;
 
-      return true;
-   } else
-      return false;
+   Layout *layout = widget->getLayout ();
+   indexAllocationSerial = layout ? layout->getAllocationSerial () : 0;
+   indexContentSerial = layout ? layout->getContentSerial () : 0;
+   indexValid = true;
 }
 
-bool FindtextState::search0 (bool backwards, bool firstTrial)
+/**
+ * \brief Fill "matches" with all (possibly overlapping) occurrences of
+ *    "key" in the index.
+ *
+ * In the case insensitive case, both text and key are folded with
+ * foldChar, so that the search itself is a plain byte comparison,
+ * where candidates are found by memchr.
+ */
+void FindtextState::findMatches ()
 {
-   if (iterator->getChar () == CharIterator::END)
-      return false;
-
-   bool ret = false;
-   const char* searchKey = (backwards) ? rev(key) : key;
-   int j = 0;
-   bool nextit = true;
-   int l = strlen (key);
-
-   if (backwards && !firstTrial) {
-      _MSG("Having to do.");
-      /* Position correctly */
-      /* In order to achieve good results (i.e: find a word that ends within
-       * the previously searched word's limit) we have to position the
-       * iterator in the semilast character of the previously searched word.
-       *
-       * Since we know that if a word was found before it was exactly the
-       * same word as the one we are searching for now, we can apply the
-       * following expression:
-       *
-       * Where l=length of the key and n=num of positions to move:
-       *
-       * n = l - 3
-       *
-       * If n is negative, we have to move backwards, but if it is
-       * positive, we have to move forward. So, when l>=4, we start moving
-       * the iterator forward. */
-
-      if (l==1) {
-         iterator->prev();
-         iterator->prev();
-      } else if (l==2) {
-         iterator->prev();
-      } else if (l>=4) {
-         for (int i=0; i<l-3; i++) {
-            iterator->next();
-         }
+   int n = text->size (), l = strlen (key);
+   const char *haystack;
+   char *needle = strdup (key);
+
+   matches->setSize (0);
+
+   if (caseSens)
+      haystack = n > 0 ? text->getArray () : NULL;
+   else {
+      if (foldedText->size () != n) {
+         foldedText->setSize (n);
+         for (int i = 0; i < n; i++)
+            foldedText->set (i, foldChar (text->get (i)));
       }
-
-   } else if (backwards && l==1) {
-      /* Particular case where we can't find the last character */
-      iterator->next();
+      haystack = n > 0 ? foldedText->getArray () : NULL;
+      for (int i = 0; i < l; i++)
+         needle[i] = foldChar (needle[i]);
    }
 
-   do {
-      if (j == -1 || charsEqual (iterator->getChar(),searchKey[j],caseSens)) {
-         j++;
-         nextit = backwards ? iterator->prev () : iterator->next ();
-      } else
-         j = nexttab[j];
-   } while (nextit && j < l);
-
-   if (j >= l) {
-      if (backwards) {
-         //This is the location of the key
-         iterator->next();
-      } else {
-         // Go back to where the key was found.
-         for (int i = 0; i < l; i++)
-            iterator->prev ();
+   for (int p = 0; p + l <= n; ) {
+      const char *found =
+         (const char*) memchr (haystack + p, needle[0], n - l + 1 - p);
+      if (found == NULL)
+         break;
+
+      p = found - haystack;
+      if (memcmp (found + 1, needle + 1, l - 1) == 0) {
+         matches->increase ();
+         matches->set (matches->size () - 1, p);
       }
-      ret = true;
+      p++;
    }
 
-   if (backwards)
-      delete [] searchKey;
+   free (needle);
+}
 
-   return ret;
+/**
+ * \brief Return a new iterator at the given position of the index.
+ */
+CharIterator *FindtextState::iteratorAt (int pos)
+{
+   CharIterator *it =
+      checkpoints->get(pos / CHECKPOINT_DIST)->cloneCharIterator ();
+   for (int i = pos % CHECKPOINT_DIST; i > 0; i--)
+      it->next ();
+   return it;
+}
+
+/**
+ * \brief Unhighlight, and return whether a region was highlighted.
+ */
+bool FindtextState::unhighlight ()
+{
+   if (hlIterator) {
+      CharIterator::unhighlight (iterator, hlIterator, HIGHLIGHT_FINDTEXT);
+      delete iterator;
+      iterator = NULL;
+      delete hlIterator;
+      hlIterator = NULL;
+
+      return true;
+   } else
+      return false;
 }
 
 } // namespace core
@@ -39,9 +39,6 @@ private:
    /** \brief Whether the last search was case sensitive. */
    bool caseSens;
 
-   /** \brief The table used for KMP search. */
-   int *nexttab;
-
    /** \brief The top of the widget tree, in which the search is done.
     *
     * From this, the iterator will be constructed. Set by
@@ -49,25 +46,59 @@ private:
     */
    Widget *widget;
 
-   /** \brief The position from where the next search will start. */
+   /**
+    * \brief The start of the highlighted occurrence.
+    *
+    * NULL, when no text is highlighted.
+    */
    CharIterator *iterator;
 
    /**
-    * \brief The position from where the characters are highlighted.
+    * \brief The end of the highlighted occurrence.
     *
     * NULL, when no text is highlighted.
     */
    CharIterator *hlIterator;
 
-   static const char* rev(const char* _str); /* reverse a C string */
+   /**
+    * \brief All characters returned by a dw::core::CharIterator for
+    *    "widget", as one buffer.
+    */
+   lout::misc::SimpleVector<char> *text;
 
-   static int *createNexttab (const char *needle,bool caseSens,bool backwards);
-   bool unhighlight ();
-   bool search0 (bool backwards, bool firstTrial);
+   /** \brief Like "text", but folded for case insensitive search. */
+   lout::misc::SimpleVector<char> *foldedText;
 
-   inline static bool charsEqual (char c1, char c2, bool caseSens)
-   { return caseSens ? c1 == c2 : tolower (c1) == tolower (c2) ||
-      (isspace (c1) && isspace (c2)); }
+   /**
+    * \brief Copies of a dw::core::CharIterator, at every
+    *    CHECKPOINT_DIST'th character of "text", starting at 0.
+    */
+   lout::container::typed::Vector<CharIterator> *checkpoints;
+
+   /**
+    * \brief Layout::getAllocationSerial and Layout::getContentSerial when
+    *    the index was built.
+    */
+   int indexAllocationSerial, indexContentSerial;
+   bool indexValid;
+
+   /** \brief Positions of all occurrences of "key" in "text". */
+   lout::misc::SimpleVector<int> *matches;
+
+   /** \brief Index within "matches" of the highlighted occurrence, or -1. */
+   int currentMatch;
+
+   enum { CHECKPOINT_DIST = 4096 };
+
+   inline static char foldChar (char c)
+   { return isspace ((unsigned char)c) ? ' ' : tolower ((unsigned char)c); }
+
+   void clearIndex ();
+   bool isIndexUpToDate ();
+   void buildIndex ();
+   void findMatches ();
+   CharIterator *iteratorAt (int pos);
+   bool unhighlight ();
 
 public:
    FindtextState ();
@@ -76,6 +107,16 @@ public:
    void setWidget (Widget *widget);
    Result search (const char *key, bool caseSens, bool backwards);
    void resetSearch ();
+   bool refersTo (Widget *widget);
+
+   /** \brief Number of occurrences of the key of the last search. */
+   inline int getNumMatches () { return key ? matches->size () : 0; }
+
+   /**
+    * \brief Number (starting with 1) of the highlighted occurrence, or
+    *    0.
+    */
+   inline int getCurrentMatch () { return key ? currentMatch + 1 : 0; }
 };
 
 } // namespace core
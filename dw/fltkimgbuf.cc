@@ -23,6 +23,15 @@
 
 #include <FL/fl_draw.H>
 #include <math.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#elif defined(__SSE2__)
+#   include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#   include <arm_neon.h>
+#endif
 
 #define IMAGE_MAX_AREA (6000 * 6000)
 
@@ -40,6 +49,9 @@ const enum ScaleMode { SIMPLE, BEAUTIFUL, BEAUTIFUL_GAMMA }
 Vector <FltkImgbuf::GammaCorrectionTable> *FltkImgbuf::gammaCorrectionTables
    = new Vector <FltkImgbuf::GammaCorrectionTable> (true, 2);
 
+int FltkImgbuf::numRootBufs = 0, FltkImgbuf::numScaledBufs = 0;
+size_t FltkImgbuf::rootBufsSize = 0, FltkImgbuf::scaledBufsSize = 0;
+
 uchar *FltkImgbuf::findGammaCorrectionTable (double gamma)
 {
    // Since the number of possible keys is low, a linear search is
@@ -76,6 +88,19 @@ void FltkImgbuf::freeall ()
    gammaCorrectionTables = NULL;
 }
 
+/**
+ * \brief Return the number of image buffers currently allocated, and the
+ *    memory taken by their pixels, separately for root and scaled buffers.
+ */
+void FltkImgbuf::getMemoryUsage (int *numRoot, size_t *rootSize,
+                                 int *numScaled, size_t *scaledSize)
+{
+   *numRoot = numRootBufs;
+   *rootSize = rootBufsSize;
+   *numScaled = numScaledBufs;
+   *scaledSize = scaledBufsSize;
+}
+
 FltkImgbuf::FltkImgbuf (Type type, int width, int height, double gamma)
 {
    DBG_OBJ_CREATE ("dw::fltk::FltkImgbuf");
@@ -141,6 +166,14 @@ void FltkImgbuf::init (Type type, int width, int height, double gamma,
       // Set light-gray as interim background color.
       memset(rawdata, 222, width*height*bpp);
 
+      if (isRoot()) {
+         numRootBufs++;
+         rootBufsSize += (size_t)bpp * width * height;
+      } else {
+         numScaledBufs++;
+         scaledBufsSize += (size_t)bpp * width * height;
+      }
+
       refCount = 1;
       deleteOnUnref = true;
       copiedRows = new lout::misc::BitSet (height);
@@ -171,8 +204,14 @@ FltkImgbuf::~FltkImgbuf ()
 {
    _MSG ("FltkImgbuf::~FltkImgbuf\n");
 
-   if (!isRoot())
+   if (isRoot()) {
+      numRootBufs--;
+      rootBufsSize -= (size_t)bpp * width * height;
+   } else {
+      numScaledBufs--;
+      scaledBufsSize -= (size_t)bpp * width * height;
       root->detachScaledBuf (this);
+   }
 
    delete[] rawdata;
    delete copiedRows;
@@ -233,12 +272,16 @@ inline void FltkImgbuf::scaleRowSimple (int row, const core::byte *data)
       }
 
       if (sr == sr1) {
+         // px2 = (px+1) * width / root->width, without dividing per pixel.
+         int px1 = 0, rest = 0;
          for (int px = 0; px < root->width; px++) {
-            int px1 = px * width / root->width;
-            int px2 = (px+1) * width / root->width;
+            int px2 = px1;
+            for (rest += width; rest >= root->width; rest -= root->width)
+               px2++;
             for (int sp = px1; sp < px2; sp++) {
                memcpy(rawdata + (sr*width + sp)*bpp, data + px*bpp, bpp);
             }
+            px1 = px2;
          }
       } else {
          memcpy(rawdata + sr*width*bpp, rawdata + sr1*width*bpp, width*bpp);
@@ -292,6 +335,75 @@ inline void FltkImgbuf::scaleRowBeautiful (int row, const core::byte *data)
    }
 }
 
+/*
+ * Add a row of bytes to a row of sums. This is where downscaling
+ * spends its time, so there are SIMD versions of it.
+ */
+static void accumulateRow (uint32_t *acc, const core::byte *row, int n)
+{
+   int i = 0;
+
+#if defined(__AVX2__)
+   for (; i + 16 <= n; i += 16) {
+      __m128i b = _mm_loadu_si128 ((const __m128i*)(row + i));
+      __m256i lo = _mm256_cvtepu8_epi32 (b);
+      __m256i hi = _mm256_cvtepu8_epi32 (_mm_srli_si128 (b, 8));
+      __m256i *a = (__m256i*)(acc + i);
+      _mm256_storeu_si256 (a, _mm256_add_epi32 (_mm256_loadu_si256 (a), lo));
+      _mm256_storeu_si256 (a + 1,
+                           _mm256_add_epi32 (_mm256_loadu_si256 (a + 1), hi));
+   }
+#elif defined(__SSE2__)
+   const __m128i zero = _mm_setzero_si128 ();
+   for (; i + 16 <= n; i += 16) {
+      __m128i b = _mm_loadu_si128 ((const __m128i*)(row + i));
+      __m128i w0 = _mm_unpacklo_epi8 (b, zero), w1 = _mm_unpackhi_epi8 (b, zero);
+      __m128i d[4] = { _mm_unpacklo_epi16 (w0, zero),
+                       _mm_unpackhi_epi16 (w0, zero),
+                       _mm_unpacklo_epi16 (w1, zero),
+                       _mm_unpackhi_epi16 (w1, zero) };
+      __m128i *a = (__m128i*)(acc + i);
+      for (int j = 0; j < 4; j++)
+         _mm_storeu_si128 (a + j, _mm_add_epi32 (_mm_loadu_si128 (a + j), d[j]));
+   }
+#elif defined(__ARM_NEON)
+   for (; i + 16 <= n; i += 16) {
+      uint8x16_t b = vld1q_u8 (row + i);
+      uint16x8_t w0 = vmovl_u8 (vget_low_u8 (b));
+      uint16x8_t w1 = vmovl_u8 (vget_high_u8 (b));
+      uint32_t *a = acc + i;
+      vst1q_u32 (a,      vaddw_u16 (vld1q_u32 (a),      vget_low_u16 (w0)));
+      vst1q_u32 (a + 4,  vaddw_u16 (vld1q_u32 (a + 4),  vget_high_u16 (w0)));
+      vst1q_u32 (a + 8,  vaddw_u16 (vld1q_u32 (a + 8),  vget_low_u16 (w1)));
+      vst1q_u32 (a + 12, vaddw_u16 (vld1q_u32 (a + 12), vget_high_u16 (w1)));
+   }
+#endif
+
+   for (; i < n; i++)
+      acc[i] += row[i];
+}
+
+/*
+ * Map a row of bytes through a gamma correction table. (Table lookups
+ * don't vectorize on SSE2/NEON, so this is unrolled instead.)
+ */
+static void mapRow (core::byte *dest, const core::byte *src, int n,
+                    const uchar *map)
+{
+   int i = 0;
+
+   for (; i + 4 <= n; i += 4) {
+      core::byte b0 = map[src[i]], b1 = map[src[i + 1]];
+      core::byte b2 = map[src[i + 2]], b3 = map[src[i + 3]];
+      dest[i] = b0;
+      dest[i + 1] = b1;
+      dest[i + 2] = b2;
+      dest[i + 3] = b3;
+   }
+   for (; i < n; i++)
+      dest[i] = map[src[i]];
+}
+
 /**
  * General method to scale an image buffer. Used to scale single lines
  * in scaleRowBeautiful.
@@ -303,52 +415,90 @@ inline void FltkImgbuf::scaleRowBeautiful (int row, const core::byte *data)
  * average of all pixel values. This is pretty fast and leads to
  * rather good results.
  *
- * Nothing special (like interpolation) is done when scaling up.
+ * The rectangle is summed in two passes: the source rows are first
+ * added column-wise (accumulateRow, vectorized), then the column sums
+ * are added for each destination pixel. The column ranges and the
+ * divisors are computed once per call, not per sample.
+ *
+ * Nothing special (like interpolation) is done when scaling up; rows
+ * which come from the same source rows are just copied.
  *
  * If scaleMode is set to BEAUTIFUL_GAMMA, gamma correction is
  * considered, see <http://www.4p8.com/eric.brasseur/gamma.html>.
- *
- * TODO Could be optimized as in scaleRowSimple: when the destination
- * image is larger, calculate only one row/column, and copy it to the
- * other rows/columns.
  */
 inline void FltkImgbuf::scaleBuffer (const core::byte *src, int srcWidth,
                                      int srcHeight, core::byte *dest,
                                      int destWidth, int destHeight, int bpp,
                                      double gamma)
 {
-   uchar *gammaMap1, *gammaMap2;
+   uchar *gammaMap1 = NULL, *gammaMap2 = NULL;
 
    if (scaleMode == BEAUTIFUL_GAMMA) {
       gammaMap1 = findGammaCorrectionTable (gamma);
       gammaMap2 = findGammaCorrectionTable (1 / gamma);
    }
 
-   for(int x = 0; x < destWidth; x++)
-      for(int y = 0; y < destHeight; y++) {
-         int xo1 = x * srcWidth / destWidth;
-         int xo2 = lout::misc::max ((x + 1) * srcWidth / destWidth, xo1 + 1);
-         int yo1 = y * srcHeight / destHeight;
-         int yo2 = lout::misc::max ((y + 1) * srcHeight / destHeight, yo1 + 1);
-         int n = (xo2 - xo1) * (yo2 - yo1);
-
-         int v[bpp];
-         for(int i = 0; i < bpp; i++)
-            v[i] = 0;
-
-         for(int xo = xo1; xo < xo2; xo++)
-            for(int yo = yo1; yo < yo2; yo++) {
-               const core::byte *ps = src + bpp * (yo * srcWidth + xo);
-               for(int i = 0; i < bpp; i++)
-                  v[i] +=
-                     (scaleMode == BEAUTIFUL_GAMMA ? gammaMap2[ps[i]] : ps[i]);
-            }
+   int srcRowSize = srcWidth * bpp, destRowSize = destWidth * bpp;
+   uint32_t *acc = new uint32_t[srcRowSize];
+   core::byte *mapped = gammaMap2 ? new core::byte[srcRowSize] : NULL;
+   int *xo1 = new int[destWidth], *xo2 = new int[destWidth];
+
+   for (int x = 0; x < destWidth; x++) {
+      xo1[x] = x * srcWidth / destWidth;
+      xo2[x] = lout::misc::max ((x + 1) * srcWidth / destWidth, xo1[x] + 1);
+   }
+
+   int lastYo1 = -1, lastYo2 = -1;
+   for (int y = 0; y < destHeight; y++) {
+      int yo1 = y * srcHeight / destHeight;
+      int yo2 = lout::misc::max ((y + 1) * srcHeight / destHeight, yo1 + 1);
+      core::byte *pd = dest + y * destRowSize;
 
-         core::byte *pd = dest + bpp * (y * destWidth + x);
-         for(int i = 0; i < bpp; i++)
-            pd[i] =
-               scaleMode == BEAUTIFUL_GAMMA ? gammaMap1[v[i] / n] : v[i] / n;
+      if (yo1 == lastYo1 && yo2 == lastYo2) {
+         memcpy (pd, pd - destRowSize, destRowSize);
+         continue;
       }
+      lastYo1 = yo1;
+      lastYo2 = yo2;
+
+      memset (acc, 0, srcRowSize * sizeof (uint32_t));
+      for (int yo = yo1; yo < yo2; yo++) {
+         const core::byte *ps = src + yo * srcRowSize;
+         if (mapped) {
+            mapRow (mapped, ps, srcRowSize, gammaMap2);
+            ps = mapped;
+         }
+         accumulateRow (acc, ps, srcRowSize);
+      }
+
+      for (int x = 0; x < destWidth; x++, pd += bpp) {
+         uint32_t n = (xo2[x] - xo1[x]) * (yo2 - yo1);
+         uint32_t v[4] = { 0, 0, 0, 0 };
+
+         for (int xo = xo1[x]; xo < xo2[x]; xo++)
+            for (int i = 0; i < bpp; i++)
+               v[i] += acc[xo * bpp + i];
+
+         // floor (v / n) == (v * ceil (2^32 / n)) >> 32, as long as
+         // v <= 255 * n and n < 4104.
+         if (n < 4096) {
+            uint64_t r = ((1ULL << 32) + n - 1) / n;
+            for (int i = 0; i < bpp; i++)
+               v[i] = (uint32_t)((v[i] * r) >> 32);
+         } else {
+            for (int i = 0; i < bpp; i++)
+               v[i] /= n;
+         }
+
+         for (int i = 0; i < bpp; i++)
+            pd[i] = gammaMap1 ? gammaMap1[v[i]] : v[i];
+      }
+   }
+
+   delete[] acc;
+   delete[] mapped;
+   delete[] xo1;
+   delete[] xo2;
 }
 
 void FltkImgbuf::copyRow (int row, const core::byte *data)
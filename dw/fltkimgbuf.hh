@@ -39,6 +39,10 @@ private:
    static lout::container::typed::Vector <GammaCorrectionTable>
       *gammaCorrectionTables;
 
+   // Memory accounting, see getMemoryUsage().
+   static int numRootBufs, numScaledBufs;
+   static size_t rootBufsSize, scaledBufsSize;
+
    static uchar *findGammaCorrectionTable (double gamma);
    static bool excessiveImageDimensions (int width, int height);
 
@@ -57,6 +61,8 @@ public:
    FltkImgbuf (Type type, int width, int height, double gamma);
 
    static void freeall ();
+   static void getMemoryUsage (int *numRoot, size_t *rootSize,
+                               int *numScaled, size_t *scaledSize);
 
    void setCMap (int *colors, int num_colors);
    inline void scaleRow (int row, const core::byte *data);
@@ -58,6 +58,102 @@ void FltkViewBase::BackBuffer::setSize (int w, int h)
    }
 }
 
+FltkViewBase::TileCache::TileCache (int numTiles)
+{
+   this->numTiles = numTiles;
+   tiles = new Tile[numTiles];
+   useCounter = 0;
+   for (int i = 0; i < numTiles; i++) {
+      tiles[i].used = false;
+      tiles[i].created = false;
+      tiles[i].lastUse = 0;
+   }
+}
+
+FltkViewBase::TileCache::~TileCache ()
+{
+   clear ();
+   delete[] tiles;
+}
+
+/*
+ * Return the tile at the given canvas position (a multiple of
+ * TILE_SIZE). If it is not cached, the least recently used tile is
+ * reused, and marked as dirty completely.
+ */
+FltkViewBase::TileCache::Tile *FltkViewBase::TileCache::get (int x, int y)
+{
+   Tile *tile = NULL, *lru = NULL;
+
+   for (int i = 0; tile == NULL && i < numTiles; i++) {
+      if (tiles[i].used && tiles[i].x == x && tiles[i].y == y)
+         tile = &tiles[i];
+      else if (lru == NULL || !tiles[i].used ||
+               (lru->used && tiles[i].lastUse < lru->lastUse))
+         lru = &tiles[i];
+   }
+
+   if (tile == NULL) {
+      tile = lru;
+      if (!tile->created) {
+         tile->offscreen = fl_create_offscreen (TILE_SIZE, TILE_SIZE);
+         tile->created = true;
+      }
+      tile->x = x;
+      tile->y = y;
+      tile->used = true;
+      tile->dirty = core::Rectangle (x, y, TILE_SIZE, TILE_SIZE);
+   }
+
+   tile->lastUse = ++useCounter;
+   return tile;
+}
+
+/*
+ * Mark the given canvas area as dirty in all tiles it touches. The
+ * dirty area of a tile is the bounding box of all invalidated areas.
+ */
+void FltkViewBase::TileCache::invalidate (const core::Rectangle *area)
+{
+   for (int i = 0; i < numTiles; i++) {
+      Tile *tile = &tiles[i];
+      core::Rectangle tileArea (tile->x, tile->y, TILE_SIZE, TILE_SIZE), r;
+
+      if (tile->used &&
+          tileArea.intersectsWith ((core::Rectangle*)area, &r)) {
+         if (tile->dirty.isEmpty ())
+            tile->dirty = r;
+         else {
+            int x1 = lout::misc::min (tile->dirty.x, r.x),
+               y1 = lout::misc::min (tile->dirty.y, r.y),
+               x2 = lout::misc::max (tile->dirty.x + tile->dirty.width,
+                                     r.x + r.width),
+               y2 = lout::misc::max (tile->dirty.y + tile->dirty.height,
+                                     r.y + r.height);
+            tile->dirty = core::Rectangle (x1, y1, x2 - x1, y2 - y1);
+         }
+      }
+   }
+}
+
+void FltkViewBase::TileCache::invalidateAll ()
+{
+   for (int i = 0; i < numTiles; i++)
+      tiles[i].used = false;
+}
+
+/*
+ * Like invalidateAll, but also free the offscreens.
+ */
+void FltkViewBase::TileCache::clear ()
+{
+   for (int i = 0; i < numTiles; i++) {
+      if (tiles[i].created)
+         fl_delete_offscreen (tiles[i].offscreen);
+      tiles[i].created = tiles[i].used = false;
+   }
+}
+
 FltkViewBase::BackBuffer *FltkViewBase::backBuffer;
 bool FltkViewBase::backBufferInUse;
 
@@ -71,6 +167,9 @@ FltkViewBase::FltkViewBase (int x, int y, int w, int h, const char *label):
    mouse_x = mouse_y = 0;
    focused_child = NULL;
    exposeArea = NULL;
+   tileCache = NULL;
+   drawingTile = false;
+   tileX = tileY = 0;
    if (backBuffer == NULL) {
       backBuffer = new BackBuffer ();
    }
@@ -81,6 +180,7 @@ FltkViewBase::FltkViewBase (int x, int y, int w, int h, const char *label):
 FltkViewBase::~FltkViewBase ()
 {
    cancelQueueDraw ();
+   delete tileCache;
 }
 
 void FltkViewBase::setBufferedDrawing (bool b) {
@@ -92,6 +192,18 @@ void FltkViewBase::setBufferedDrawing (bool b) {
    }
 }
 
+/*
+ * Keep up to numTiles tiles of TileCache::TILE_SIZE squared pixels of
+ * this view in offscreens. 0 disables the cache.
+ */
+void FltkViewBase::setTileCache (int numTiles)
+{
+   if (tileCache == NULL || tileCache->getNumTiles () != numTiles) {
+      delete tileCache;
+      tileCache = numTiles > 0 ? new TileCache (numTiles) : NULL;
+   }
+}
+
 void FltkViewBase::draw ()
 {
    int d = damage ();
@@ -153,7 +265,13 @@ void FltkViewBase::draw (const core::Rectangle *rect,
 
    exposeArea = &r;
 
-   if (type == DRAW_BUFFERED && backBuffer && !backBufferInUse) {
+   if (tileCache && !theLayout->hasViewportFixedContent ()) {
+      // Drawing from the tiles needs no clipping, as only the
+      // respective rectangles are copied. The tiles are keyed by canvas
+      // position, so content fixed to the viewport would be shown at a
+      // stale place after scrolling; such pages are drawn directly.
+      drawTiled (&r, X, Y);
+   } else if (type == DRAW_BUFFERED && backBuffer && !backBufferInUse) {
       backBufferInUse = true;
       backBuffer->setSize (X + W, Y + H); // would be nicer to use (W, H)...
       fl_begin_offscreen (backBuffer->offscreen);
@@ -185,6 +303,70 @@ void FltkViewBase::draw (const core::Rectangle *rect,
    exposeArea = NULL;
 }
 
+/*
+ * Draw the canvas area "rect", which is shown at X, Y in the window, by
+ * copying from the tile cache; dirty parts of the tiles are drawn
+ * before.
+ */
+void FltkViewBase::drawTiled (const core::Rectangle *rect, int X, int Y)
+{
+   const int size = TileCache::TILE_SIZE;
+   // Round down, also for negative values.
+   int x1 = rect->x >= 0 ? rect->x / size * size :
+      - ((- rect->x + size - 1) / size * size);
+   int y1 = rect->y >= 0 ? rect->y / size * size :
+      - ((- rect->y + size - 1) / size * size);
+
+   for (int ty = y1; ty < rect->y + rect->height; ty += size) {
+      for (int tx = x1; tx < rect->x + rect->width; tx += size) {
+         TileCache::Tile *tile = tileCache->get (tx, ty);
+         core::Rectangle tileArea (tx, ty, size, size), r;
+
+         if (!tile->dirty.isEmpty ())
+            drawTile (tile);
+
+         if (tileArea.intersectsWith ((core::Rectangle*)rect, &r))
+            fl_copy_offscreen (X + r.x - rect->x, Y + r.y - rect->y,
+                               r.width, r.height, tile->offscreen,
+                               r.x - tx, r.y - ty);
+      }
+   }
+
+   // Embedded FLTK widgets are not part of the tiles, see drawFltkWidget.
+   fl_push_clip (X, Y, rect->width, rect->height);
+   for (int i = 0; i < children (); i++)
+      draw_child (*child (i));
+   fl_pop_clip ();
+}
+
+/*
+ * Draw the dirty area of a tile into its offscreen.
+ */
+void FltkViewBase::drawTile (TileCache::Tile *tile)
+{
+   core::Rectangle *oldExposeArea = exposeArea;
+   core::Rectangle area = tile->dirty;
+
+   drawingTile = true;
+   tileX = tile->x;
+   tileY = tile->y;
+   exposeArea = &area;
+
+   fl_begin_offscreen (tile->offscreen);
+   fl_push_matrix ();
+   fl_push_clip (area.x - tileX, area.y - tileY, area.width, area.height);
+   fl_color (bgColor);
+   fl_rectf (area.x - tileX, area.y - tileY, area.width, area.height);
+   theLayout->expose (this, &area);
+   fl_pop_clip ();
+   fl_pop_matrix ();
+   fl_end_offscreen ();
+
+   tile->dirty = core::Rectangle (0, 0, 0, 0);
+   exposeArea = oldExposeArea;
+   drawingTile = false;
+}
+
 void FltkViewBase::drawChildWidgets () {
    for (int i = children () - 1; i >= 0; i--) {
       Fl_Widget& w = *child(i);
@@ -350,8 +532,12 @@ int FltkViewBase::handle (int event)
                               getDwButtonState ());
       break;
    case FL_HIDE:
+      /* Hidden views (e.g. in other tabs) should not hold the tiles. */
+      if (tileCache)
+         tileCache->clear ();
       /* WORKAROUND: strangely, the tooltip window is not automatically hidden
        * with its parent. Here we fake a LEAVE to achieve it. */
+      /* fall through */
    case FL_LEAVE:
       theLayout->leaveNotify (this, getDwButtonState ());
       break;
@@ -389,6 +575,10 @@ void FltkViewBase::setLayout (core::Layout *layout)
 
 void FltkViewBase::setCanvasSize (int width, int ascent, int descent)
 {
+   // A new width means a new line breaking; most of the canvas is
+   // drawn again anyway.
+   if (tileCache && width != canvasWidth)
+      tileCache->invalidateAll ();
    canvasWidth = width;
    canvasHeight = ascent + descent;
 }
@@ -421,6 +611,8 @@ void FltkViewBase::setBgColor (core::style::Color *color)
    bgColor = color ?
       ((FltkColor*)color)->colors[dw::core::style::Color::SHADING_NORMAL] :
       FL_WHITE;
+   if (tileCache)
+      tileCache->invalidateAll ();
 }
 
 void FltkViewBase::startDrawing (core::Rectangle *area)
@@ -433,12 +625,16 @@ void FltkViewBase::finishDrawing (core::Rectangle *area)
 
 void FltkViewBase::queueDraw (core::Rectangle *area)
 {
+   if (tileCache)
+      tileCache->invalidate (area);
    drawRegion.addRectangle (area);
    damage (FL_DAMAGE_USER1);  // USER1 for buffered draw
 }
 
 void FltkViewBase::queueDrawTotal ()
 {
+   if (tileCache)
+      tileCache->invalidateAll ();
    damage (FL_DAMAGE_EXPOSE);
 }
 
@@ -462,10 +658,10 @@ void FltkViewBase::drawLine (core::style::Color *color,
    // However it's still better than no clipping at all.
    clipPoint (&x1, &y1, 5000);
    clipPoint (&x2, &y2, 5000);
-   fl_line (translateCanvasXToViewX (x1),
-            translateCanvasYToViewY (y1),
-            translateCanvasXToViewX (x2),
-            translateCanvasYToViewY (y2));
+   fl_line (translateCanvasXToDrawX (x1),
+            translateCanvasYToDrawY (y1),
+            translateCanvasXToDrawX (x2),
+            translateCanvasYToDrawY (y2));
 }
 
 void FltkViewBase::drawTypedLine (core::style::Color *color,
@@ -527,10 +723,10 @@ void FltkViewBase::drawRectangle (core::style::Color *color,
    clipPoint (&x1, &y1, 1);
    clipPoint (&x2, &y2, 1);
 
-   x1 = translateCanvasXToViewX (x1);
-   y1 = translateCanvasYToViewY (y1);
-   x2 = translateCanvasXToViewX (x2);
-   y2 = translateCanvasYToViewY (y2);
+   x1 = translateCanvasXToDrawX (x1);
+   y1 = translateCanvasYToDrawY (y1);
+   x2 = translateCanvasXToDrawX (x2);
+   y2 = translateCanvasYToDrawY (y2);
 
    if (filled)
       fl_rectf (x1, y1, x2 - x1, y2 - y1);
@@ -544,8 +740,8 @@ void FltkViewBase::drawArc (core::style::Color *color,
                             int angle1, int angle2)
 {
    fl_color(((FltkColor*)color)->colors[shading]);
-   int x = translateCanvasXToViewX (centerX) - width / 2;
-   int y = translateCanvasYToViewY (centerY) - height / 2;
+   int x = translateCanvasXToDrawX (centerX) - width / 2;
+   int y = translateCanvasYToDrawY (centerY) - height / 2;
 
    fl_arc(x, y, width, height, angle1, angle2);
    if (filled) {
@@ -572,8 +768,8 @@ void FltkViewBase::drawPolygon (core::style::Color *color,
          fl_begin_loop();
 
       for (int i = 0; i < npoints; i++) {
-         fl_vertex(translateCanvasXToViewX(points[i].x),
-                   translateCanvasYToViewY(points[i].y));
+         fl_vertex(translateCanvasXToDrawX(points[i].x),
+                   translateCanvasYToDrawY(points[i].y));
       }
       if (filled) {
          if (convex)
@@ -587,7 +783,7 @@ void FltkViewBase::drawPolygon (core::style::Color *color,
 
 core::View *FltkViewBase::getClippingView (int x, int y, int width, int height)
 {
-   fl_push_clip (translateCanvasXToViewX (x), translateCanvasYToViewY (y),
+   fl_push_clip (translateCanvasXToDrawX (x), translateCanvasYToDrawY (y),
                  width, height);
    return this;
 }
@@ -625,11 +821,11 @@ void FltkWidgetView::drawText (core::style::Font *font,
 
    if (!font->letterSpacing && !font->fontVariant) {
       fl_draw(text, len,
-              translateCanvasXToViewX (X), translateCanvasYToViewY (Y));
+              translateCanvasXToDrawX (X), translateCanvasYToDrawY (Y));
    } else {
       /* Nonzero letter spacing adjustment, draw each glyph individually */
-      int viewX = translateCanvasXToViewX (X),
-          viewY = translateCanvasYToViewY (Y);
+      int viewX = translateCanvasXToDrawX (X),
+          viewY = translateCanvasYToDrawY (Y);
       int curr = 0, next = 0, nb;
       char chbuf[4];
       int c, cu, width;
@@ -686,7 +882,7 @@ void FltkWidgetView::drawSimpleWrappedText (core::style::Font *font,
    fl_font(ff->font, ff->size);
    fl_color(((FltkColor*)color)->colors[shading]);
    fl_draw(text,
-           translateCanvasXToViewX (X), translateCanvasYToViewY (Y),
+           translateCanvasXToDrawX (X), translateCanvasYToDrawY (Y),
            W, H, FL_ALIGN_TOP|FL_ALIGN_LEFT|FL_ALIGN_WRAP, NULL, 0);
 }
 
@@ -694,8 +890,8 @@ void FltkWidgetView::drawImage (core::Imgbuf *imgbuf, int xRoot, int yRoot,
                               int X, int Y, int width, int height)
 {
    ((FltkImgbuf*)imgbuf)->draw (this,
-                                translateCanvasXToViewX (xRoot),
-                                translateCanvasYToViewY (yRoot),
+                                translateCanvasXToDrawX (xRoot),
+                                translateCanvasYToDrawY (yRoot),
                                 X, Y, width, height);
 }
 
@@ -728,6 +924,10 @@ void FltkWidgetView::allocateFltkWidget (Fl_Widget *widget,
 void FltkWidgetView::drawFltkWidget (Fl_Widget *widget,
                                    core::Rectangle *area)
 {
+   // Drawn over the tiles by drawTiled.
+   if (drawingTile)
+      return;
+
    draw_child (*widget);
    draw_outside_label(*widget);
 }
@@ -29,6 +29,40 @@ private:
          void setSize(int w, int h);
    };
 
+   /*
+    * Offscreen copies of parts of the canvas, so that exposes and
+    * scrolling can be handled by copying, instead of drawing the
+    * layout again.
+    */
+   class TileCache {
+      public:
+         enum { TILE_SIZE = 256 };
+
+         struct Tile {
+            int x, y;              // canvas position of the upper left corner
+            bool used;             // x and y are valid
+            core::Rectangle dirty; // canvas area to be redrawn; maybe empty
+            unsigned int lastUse;
+            bool created;
+            Fl_Offscreen offscreen;
+         };
+
+      private:
+         Tile *tiles;
+         int numTiles;
+         unsigned int useCounter;
+
+      public:
+         TileCache (int numTiles);
+         ~TileCache ();
+
+         inline int getNumTiles () { return numTiles; }
+         Tile *get (int x, int y);
+         void invalidate (const core::Rectangle *area);
+         void invalidateAll ();
+         void clear ();
+   };
+
    typedef enum { DRAW_PLAIN, DRAW_CLIPPED, DRAW_BUFFERED } DrawType;
 
    int bgColor;
@@ -36,8 +70,12 @@ private:
    core::Rectangle *exposeArea;
    static BackBuffer *backBuffer;
    static bool backBufferInUse;
+   TileCache *tileCache;
+   int tileX, tileY;
 
    void draw (const core::Rectangle *rect, DrawType type);
+   void drawTiled (const core::Rectangle *rect, int X, int Y);
+   void drawTile (TileCache::Tile *tile);
    void drawChildWidgets ();
    int manageTabToFocus();
    inline void clipPoint (int *x, int *y, int border) {
@@ -55,6 +93,7 @@ private:
 protected:
    core::Layout *theLayout;
    int canvasWidth, canvasHeight;
+   bool drawingTile;
    int mouse_x, mouse_y;
    Fl_Widget *focused_child;
 
@@ -63,6 +102,17 @@ protected:
    virtual int translateCanvasXToViewX (int x) = 0;
    virtual int translateCanvasYToViewY (int y) = 0;
 
+   /*
+    * Like translateCanvas{X|Y}ToView{X|Y}, but for the current drawing
+    * target, which is either the window, or a tile of the cache.
+    */
+   inline int translateCanvasXToDrawX (int x) {
+      return drawingTile ? x - tileX : translateCanvasXToViewX (x);
+   }
+   inline int translateCanvasYToDrawY (int y) {
+      return drawingTile ? y - tileY : translateCanvasYToViewY (y);
+   }
+
 public:
    FltkViewBase (int x, int y, int w, int h, const char *label = 0);
    ~FltkViewBase ();
@@ -105,6 +155,7 @@ public:
    core::View *getClippingView (int x, int y, int width, int height);
    void mergeClippingView (core::View *clippingView);
    void setBufferedDrawing (bool b);
+   void setTileCache (int numTiles);
 };
 
 
@@ -663,6 +663,26 @@ bool DeepIterator::isEmpty () {
    return !hasContents;
 }
 
+/**
+ * \brief Returns whether this iterator points to \em widget, or into it.
+ *
+ * Used to find out whether a widget may be destroyed without
+ * invalidating this iterator.
+ */
+bool DeepIterator::refersTo (Widget *widget)
+{
+   for (int i = 0; i < stack.size (); i++) {
+      Iterator *it = stack.get (i);
+      if (it->getWidget () == widget ||
+          ((it->getContent()->type &
+            (Content::WIDGET_IN_FLOW | Content::WIDGET_OOF_CONT)) &&
+           it->getContent()->widget == widget))
+         return true;
+   }
+
+   return false;
+}
+
 /**
  * \brief Move iterator forward and store content it.
  *
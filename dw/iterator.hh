@@ -190,6 +190,7 @@ public:
    inline Content *getContent () { return &content; }
 
    bool isEmpty ();
+   bool refersTo (Widget *widget);
 
    bool next ();
    bool prev ();
@@ -251,6 +252,7 @@ public:
    bool prev ();
    inline int getChar() { return ch; }
    inline CharIterator *cloneCharIterator() { return (CharIterator*)clone(); }
+   inline bool refersTo (Widget *widget) { return it->refersTo (widget); }
 
    static void highlight (CharIterator *it1, CharIterator *it2,
                           HighlightLayer layer);
@@ -24,6 +24,7 @@
 #include "../lout/msg.h"
 #include "../lout/debug.hh"
 #include "../lout/misc.hh"
+#include "../lout/trace.h"
 
 using namespace lout;
 using namespace lout::container;
@@ -261,6 +262,8 @@ Layout::Layout (Platform *platform)
    widgetAtPoint = NULL;
 
    queueResizeList = new typed::Vector<Widget> (4, false);
+   viewportWidgets = new typed::Vector<Widget> (1, false);
+   viewportFixedContent = false;
 
    DBG_OBJ_CREATE ("dw::core::Layout");
 
@@ -306,6 +309,8 @@ Layout::Layout (Platform *platform)
 
    resizeIdleCounter = queueResizeCounter = sizeAllocateCounter
       = sizeRequestCounter = getExtremesCounter = 0;
+   allocationSerial = 0;
+   contentSerial = 0;
 }
 
 Layout::~Layout ()
@@ -334,6 +339,7 @@ Layout::~Layout ()
    }
 
    delete queueResizeList;
+   delete viewportWidgets;
    delete platform;
    delete view;
    delete anchorsTable;
@@ -386,6 +392,7 @@ void Layout::addWidget (Widget *widget)
    DBG_OBJ_SET_PTR_O (widget, "container", widget->container);
 
    queueResizeList->clear ();
+   widget->checkViewportFixed ();
    widget->notifySetAsTopLevel ();
 
    findtextState.setWidget (widget);
@@ -407,6 +414,8 @@ void Layout::removeWidget ()
     */
    topLevel = NULL;
    queueResizeList->clear ();
+   viewportWidgets->clear ();
+   viewportFixedContent = false;
    widgetAtPoint = NULL;
    canvasWidth = canvasAscent = canvasDescent = 0;
    scrollX = scrollY = 0;
@@ -443,6 +452,94 @@ void Layout::setWidget (Widget *widget)
    updateCursor ();
 }
 
+/**
+ * \brief Destroy the widget tree, leaving the layout empty.
+ *
+ * Used to free the memory of pages which are not shown, but may be
+ * rendered again later (see dw::core::Layout::setWidget).
+ */
+void Layout::clearWidget ()
+{
+   widgetAtPoint = NULL;
+   if (topLevel) {
+      Widget *w = topLevel;
+      // The destructor calls removeWidget(), which resets the layout.
+      delete w;
+   }
+   textZone->zoneFree ();
+}
+
+/**
+ * \brief Returns whether the layout holds references to \em widget or
+ *    one of its descendants, beside the widget tree itself.
+ *
+ * Widgets which are destroyed while the rest of the tree remains
+ * (e. g. virtual rows in dw::Table) should be tested with this first.
+ */
+bool Layout::isWidgetInUse (Widget *widget)
+{
+   for (Widget *w = widgetAtPoint; w; w = w->getParent ())
+      if (w == widget)
+         return true;
+
+   return selectionState.refersTo (widget) || findtextState.refersTo (widget);
+}
+
+/**
+ * \brief Let \em widget know when the visible part of the canvas changes;
+ *    see dw::core::Widget::viewportChanged.
+ *
+ * The widget must call removeViewportWidget() when it is destroyed (and
+ * dw::core::Widget::layout is still set).
+ */
+void Layout::addViewportWidget (Widget *widget)
+{
+   for (int i = 0; i < viewportWidgets->size (); i++)
+      if (viewportWidgets->get (i) == widget)
+         return;
+   viewportWidgets->put (widget);
+}
+
+void Layout::removeViewportWidget (Widget *widget)
+{
+   for (int i = 0; i < viewportWidgets->size (); i++)
+      if (viewportWidgets->get (i) == widget) {
+         viewportWidgets->remove (i);
+         return;
+      }
+}
+
+/**
+ * \brief Whether some content is placed relative to the viewport, not to
+ *    the canvas.
+ *
+ * This is the case for widgets with "position: fixed" (registered via
+ * addViewportFixedContent(), see dw::core::Widget::setStyle and
+ * dw::core::Widget::setParent), and for a fixed background image.
+ * Such content moves on the canvas while scrolling, so views must not
+ * reuse pixels drawn at a former scroll position.
+ */
+bool Layout::hasViewportFixedContent ()
+{
+   return viewportFixedContent ||
+      (bgImage && bgAttachment == style::BACKGROUND_ATTACHMENT_FIXED);
+}
+
+/**
+ * \brief Call dw::core::Widget::viewportChanged for the widgets registered
+ *    by addViewportWidget().
+ *
+ * Only called outside of drawing and of the resize passes, so the widgets
+ * may change the widget tree.
+ */
+void Layout::notifyViewportWidgets ()
+{
+   // The vector is not changed by the widgets here; still, do not rely on
+   // an iterator.
+   for (int i = 0; i < viewportWidgets->size (); i++)
+      viewportWidgets->get(i)->viewportChanged ();
+}
+
 /**
  * \brief Attach a view to the layout.
  *
@@ -618,6 +715,9 @@ void Layout::scrollIdle ()
    }
 
    scrollIdleId = -1;
+
+   if (xChanged || yChanged)
+      notifyViewportWidgets ();
 }
 
 void Layout::adjustScrollPos ()
@@ -662,6 +762,7 @@ void Layout::draw (View *view, Rectangle *area)
 {
    DBG_OBJ_ENTER ("draw", 0, "draw", "%d, %d, %d * %d",
                   area->x, area->y, area->width, area->height);
+   TRACE_SCOPE ("draw", "draw");
 
    Rectangle widgetArea, intersection, widgetDrawArea;
 
@@ -861,6 +962,7 @@ void Layout::setBgImage (style::StyleImage *bgImage,
 void Layout::resizeIdle ()
 {
    DBG_OBJ_ENTER0 ("resize", 0, "resizeIdle");
+   TRACE_SCOPE ("layout", "resizeIdle");
 
    enterResizeIdle ();
 
@@ -964,6 +1066,11 @@ void Layout::resizeIdle ()
    DBG_OBJ_LEAVE ();
 
    leaveResizeIdle ();
+
+   // Allocations have changed, so the visible part of a widget may have,
+   // too. (Outside of the resize pass, so that widgets may queue another
+   // one.)
+   notifyViewportWidgets ();
 }
 
 void Layout::queueDraw (int x, int y, int width, int height)
@@ -1290,6 +1397,7 @@ void Layout::scrollPosChanged (View *view, int x, int y)
 
       setAnchor (NULL);
       updateAnchor ();
+      notifyViewportWidgets ();
    }
 }
 
@@ -1308,6 +1416,7 @@ void Layout::viewportSizeChanged (View *view, int width, int height)
       viewportWidth = width;
       viewportHeight = height;
       containerSizeChanged ();
+      notifyViewportWidgets ();
 
       DBG_OBJ_SET_SYM ("canvasHeightGreater",
                        canvasHeightGreater ? "true" : "false");
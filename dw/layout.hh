@@ -156,6 +156,10 @@ private:
    View *view;
    Widget *topLevel, *widgetAtPoint;
    lout::container::typed::Vector<Widget> *queueResizeList;
+   /* See addViewportWidget. */
+   lout::container::typed::Vector<Widget> *viewportWidgets;
+   /* See addViewportFixedContent. */
+   bool viewportFixedContent;
 
    /* The state, which must be projected into the view. */
    style::Color *bgColor;
@@ -226,6 +230,7 @@ private:
    int currVScrollbarThickness();
 
    void updateAnchor ();
+   void notifyViewportWidgets ();
 
    /* Widget */
 
@@ -251,6 +256,13 @@ private:
    void enterResizeIdle () { resizeIdleCounter++; }
    void leaveResizeIdle () { resizeIdleCounter--; }
 
+   /* Incremented by Widget::sizeAllocate whenever an allocation
+      changes; see getAllocationSerial. */
+   int allocationSerial;
+
+   /* See getContentSerial. */
+   int contentSerial;
+
 public:
    Layout (Platform *platform);
    ~Layout ();
@@ -277,6 +289,13 @@ public:
 
    void addWidget (Widget *widget);
    void setWidget (Widget *widget);
+   void clearWidget ();
+   inline Widget *getWidget () { return topLevel; }
+   bool isWidgetInUse (Widget *widget);
+   void addViewportWidget (Widget *widget);
+   void removeViewportWidget (Widget *widget);
+   inline void addViewportFixedContent () { viewportFixedContent = true; }
+   bool hasViewportFixedContent ();
 
    void attachView (View *view);
    void detachView (View *view);
@@ -287,6 +306,27 @@ public:
    inline int getScrollPosX ()  { return scrollX; }
    inline int getScrollPosY ()  { return scrollY; }
 
+   /**
+    * \brief Changes whenever the allocation of any widget has changed.
+    *
+    * Used to detect when data derived from allocations of widgets
+    * not managed by the caller (e.g. a dw::core::SpatialIndex) must
+    * be rebuilt.
+    */
+   inline int getAllocationSerial () { return allocationSerial; }
+
+   /**
+    * \brief Changes whenever the content of any widget may have changed.
+    *
+    * Incremented by dw::core::Widget::queueResize, and by widgets which
+    * change their content before queueing a resize (see
+    * dw::Textblock::addWord). Used to detect when data derived from the
+    * content (e.g. the text index of dw::core::FindtextState) is outdated,
+    * also when no allocation changes.
+    */
+   inline int getContentSerial () { return contentSerial; }
+   inline void contentChanged () { contentSerial++; }
+
    /* public */
 
    void scrollTo (HPosition hpos, VPosition vpos,
@@ -433,6 +473,13 @@ public:
    /** \brief See dw::core::FindtextState::resetSearch. */
    inline void resetSearch () { findtextState.resetSearch (); }
 
+   /** \brief See dw::core::FindtextState::getNumMatches. */
+   inline int getNumSearchMatches () { return findtextState.getNumMatches (); }
+
+   /** \brief See dw::core::FindtextState::getCurrentMatch. */
+   inline int getCurrentSearchMatch ()
+   { return findtextState.getCurrentMatch (); }
+
    void setBgColor (style::Color *color);
    void setBgImage (style::StyleImage *bgImage,
                     style::BackgroundRepeat bgRepeat,
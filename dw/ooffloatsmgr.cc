@@ -287,6 +287,42 @@ void OOFFloatsMgr::SortedFloatsVector::put (Float *vloat)
 {
    lout::container::typed::Vector<Float>::put (vloat);
    vloat->index = size() - 1;
+   // Not yet allocated; the index is rebuilt in sizeAllocateFloats.
+   index->clear ();
+}
+
+void OOFFloatsMgr::SortedFloatsVector::buildIndex ()
+{
+   index->clear ();
+   for (int i = 0; i < size (); i++) {
+      Widget *widget = get(i)->getWidget ();
+      if (widget->wasAllocated ())
+         index->add (i, widget->getAllocation()->y,
+                     widget->getAllocation()->ascent
+                     + widget->getAllocation()->descent);
+   }
+   index->build ();
+}
+
+/**
+ * \brief Append the indices of all floats which may touch the vertical
+ *    range from y to y + height (canvas coordinates) to "result", in
+ *    ascending order.
+ *
+ * Before the first allocation after a float has been added, all floats
+ * are returned.
+ */
+void OOFFloatsMgr::SortedFloatsVector::findInArea (int y, int height,
+                                                   SimpleVector<int> *result)
+{
+   if (index->isBuilt ())
+      index->find (y, height, result);
+   else {
+      for (int i = 0; i < size (); i++) {
+         result->increase ();
+         result->set (result->size () - 1, i);
+      }
+   }
 }
 
 int OOFFloatsMgr::TBInfo::ComparePosition::compare (Object *o1, Object *o2)
@@ -421,6 +457,8 @@ void OOFFloatsMgr::sizeAllocateFloats (Side side)
       vloat->getWidget()->sizeAllocate (&childAllocation);
    }
 
+   list->buildIndex ();
+
    DBG_OBJ_LEAVE ();
 }
 
@@ -507,12 +545,13 @@ void OOFFloatsMgr::draw (View *view, Rectangle *area, DrawingContext *context)
 void OOFFloatsMgr::drawFloats (SortedFloatsVector *list, View *view,
                                Rectangle *area, DrawingContext *context)
 {
-   // This could be improved, since the list is sorted: search the
-   // first float fitting into the area, and iterate until one is
-   // found below the area.
+   // "area" is relative to the container.
+   SimpleVector<int> found (4);
+   list->findInArea (container->getAllocation()->y + area->y, area->height,
+                     &found);
 
-   for (int i = 0; i < list->size(); i++) {
-      Float *vloat = list->get(i);
+   for (int i = 0; i < found.size (); i++) {
+      Float *vloat = list->get (found.get (i));
       Widget *childWidget = vloat->getWidget ();
      
       Rectangle childArea;
@@ -734,11 +773,12 @@ Widget *OOFFloatsMgr::getFloatWidgetAtPoint (SortedFloatsVector *list, int x,
                                              GettingWidgetAtPointContext
                                              *context)
 {
-   // Could use binary search to be faster (similar to drawing).
    Widget *widgetAtPoint = NULL;
+   SimpleVector<int> found (4);
+   list->findInArea (y, 0, &found);
    
-   for (int i = list->size() - 1; widgetAtPoint == NULL && i >= 0; i--) {
-      Widget *childWidget = list->get(i)->getWidget ();
+   for (int i = found.size() - 1; widgetAtPoint == NULL && i >= 0; i--) {
+      Widget *childWidget = list->get(found.get (i))->getWidget ();
       if (!context->hasWidgetBeenProcessedAsInterruption (childWidget) &&
           !StackingContextMgr::handledByStackingContextMgr (childWidget))
          widgetAtPoint = childWidget->getWidgetAtPoint (x, y, context);
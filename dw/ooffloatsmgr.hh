@@ -100,12 +100,17 @@ private:
    private:
       OOFFloatsMgr *oofm;
       Side side;
+      // Built from the allocations in sizeAllocateFloats; see
+      // findInArea.
+      core::SpatialIndex *index;
 
    public:
       inline SortedFloatsVector (OOFFloatsMgr *oofm, Side side,
                                  bool ownerOfObjects) :
          lout::container::typed::Vector<Float> (1, ownerOfObjects)
-      { this->oofm = oofm; this->side = side; }
+      { this->oofm = oofm; this->side = side;
+         index = new core::SpatialIndex (); }
+      inline ~SortedFloatsVector () { delete index; }
 
       int findFloatIndex (OOFAwareWidget *lastGB, int lastExtIndex);
       int find (int y, int start, int end);
@@ -113,6 +118,9 @@ private:
                      int *lastReturn);
       int findLastBeforeSideSpanningIndex (int sideSpanningIndex);
       void put (Float *vloat);
+      void buildIndex ();
+      void findInArea (int y, int height,
+                       lout::misc::SimpleVector<int> *result);
 
       inline lout::container::typed::Iterator<Float> iterator()
       { return lout::container::typed::Vector<Float>::iterator (); }
@@ -121,7 +129,7 @@ private:
       inline Float *get (int pos)
       { return lout::container::typed::Vector<Float>::get (pos); }
       inline void clear ()
-      { lout::container::typed::Vector<Float>::clear (); }
+      { lout::container::typed::Vector<Float>::clear (); index->clear (); }
    };
 
    class TBInfo: public WidgetInfo
@@ -70,6 +70,16 @@ void SelectionState::reset ()
    resetLink ();
 }
 
+/**
+ * \brief Returns whether the selection or the link refers to \em widget
+ *    or one of its children (see dw::core::DeepIterator::refersTo).
+ */
+bool SelectionState::refersTo (Widget *widget)
+{
+   return (from && from->refersTo (widget)) || (to && to->refersTo (widget)) ||
+      (link && link->refersTo (widget));
+}
+
 void SelectionState::resetSelection ()
 {
    if (from)
@@ -224,6 +224,7 @@ public:
 
    inline void setLayout (Layout *layout) { this->layout = layout; }
    void reset ();
+   bool refersTo (Widget *widget);
    bool buttonPress (Iterator *it, int charPos, int linkNo,
                      EventButton *event);
    bool buttonRelease (Iterator *it, int charPos, int linkNo,
@@ -0,0 +1,155 @@
+/*
+ * Dillo Widget
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <limits.h>
+
+#include "core.hh"
+
+using namespace lout::misc;
+
+namespace dw {
+namespace core {
+
+SpatialIndex::SpatialIndex ()
+{
+   entries = new SimpleVector<Entry> (4);
+   maxY2 = new SimpleVector<int> (4);
+   built = false;
+}
+
+SpatialIndex::~SpatialIndex ()
+{
+   delete entries;
+   delete maxY2;
+}
+
+void SpatialIndex::clear ()
+{
+   entries->setSize (0);
+   maxY2->setSize (0);
+   built = false;
+}
+
+void SpatialIndex::add (int index, int y, int height)
+{
+   entries->increase ();
+   Entry *entry = entries->getLastRef ();
+   entry->y1 = y;
+   entry->y2 = y + max (height, 0);
+   entry->index = index;
+   built = false;
+}
+
+int SpatialIndex::compareEntries (const void *e1, const void *e2)
+{
+   const Entry *entry1 = (const Entry*)e1, *entry2 = (const Entry*)e2;
+   if (entry1->y1 != entry2->y1)
+      return entry1->y1 < entry2->y1 ? -1 : 1;
+   else
+      return entry1->index - entry2->index;
+}
+
+int SpatialIndex::compareIndices (const void *i1, const void *i2)
+{
+   return *(const int*)i1 - *(const int*)i2;
+}
+
+/**
+ * \brief Sort the entries by their upper edge and calculate the
+ *    maximal lower edge for each subtree.
+ *
+ * Must be called after the last call of add(), and before find().
+ */
+void SpatialIndex::build ()
+{
+   if (entries->size () > 1)
+      qsort (entries->getArray (), entries->size (), sizeof (Entry),
+             compareEntries);
+
+   maxY2->setSize (entries->size ());
+   buildTree (0, entries->size ());
+   built = true;
+}
+
+/**
+ * Returns the maximal "y2" in [start, end), which is stored at the
+ * middle element.
+ */
+int SpatialIndex::buildTree (int start, int end)
+{
+   if (start >= end)
+      return INT_MIN;
+   else {
+      int mid = (start + end) / 2;
+      int m = max (entries->getRef(mid)->y2,
+                   max (buildTree (start, mid), buildTree (mid + 1, end)));
+      maxY2->set (mid, m);
+      return m;
+   }
+}
+
+void SpatialIndex::findInTree (int start, int end, int y1, int y2,
+                               SimpleVector<int> *result)
+{
+   while (start < end) {
+      int mid = (start + end) / 2;
+
+      // No entry in this subtree reaches down to y1.
+      if (maxY2->get (mid) < y1)
+         return;
+
+      findInTree (start, mid, y1, y2, result);
+
+      Entry *entry = entries->getRef (mid);
+      // Entries are sorted by y1, so this and all following entries
+      // start below y2.
+      if (entry->y1 > y2)
+         return;
+
+      if (entry->y2 >= y1) {
+         result->increase ();
+         result->set (result->size () - 1, entry->index);
+      }
+
+      // Tail recursion for the right subtree.
+      start = mid + 1;
+   }
+}
+
+/**
+ * \brief Append the indices of all entries touching the vertical range
+ *    from y to y + height (both inclusive) to "result", in ascending
+ *    order.
+ *
+ * A height of 0 searches for a point. "result" is not cleared before.
+ */
+void SpatialIndex::find (int y, int height, SimpleVector<int> *result)
+{
+   assert (built);
+
+   int oldSize = result->size ();
+   findInTree (0, entries->size (), y, y + max (height, 0), result);
+
+   if (result->size () - oldSize > 1)
+      qsort (result->getRef (oldSize), result->size () - oldSize,
+             sizeof (int), compareIndices);
+}
+
+} // namespace core
+} // namespace dw
@@ -0,0 +1,68 @@
+#ifndef __DW_SPATIALINDEX_HH__
+#define __DW_SPATIALINDEX_HH__
+
+#ifndef __INCLUDED_FROM_DW_CORE_HH__
+#   error Do not include this file directly, use "core.hh" instead.
+#endif
+
+#include "../lout/misc.hh"
+
+namespace dw {
+namespace core {
+
+/**
+ * \brief Finds the children of a container whose vertical extent
+ *    touches a given area or point.
+ *
+ * This is a static interval tree: the owner adds one entry per child
+ * (usually, from the allocations calculated in sizeAllocate), calls
+ * build(), and may then call find() as often as needed, until the
+ * index is cleared and rebuilt. Entries are referred to by an index
+ * chosen by the owner, typically the position in the owner's list of
+ * children.
+ *
+ * Intervals are closed, so find() returns a superset of the children
+ * actually intersecting the area; callers still have to test
+ * (e.g. with dw::core::Widget::intersects or
+ * dw::core::Widget::inAllocation), but only O(log n + k) candidates
+ * instead of all children. The result is sorted by index, so that the
+ * drawing order of the owner is preserved.
+ */
+class SpatialIndex
+{
+private:
+   struct Entry
+   {
+      int y1, y2, index;
+   };
+
+   lout::misc::SimpleVector<Entry> *entries;
+   // For each node of the implicit tree (the middle element of a
+   // range of "entries"), the maximal "y2" within this range.
+   lout::misc::SimpleVector<int> *maxY2;
+   bool built;
+
+   static int compareEntries (const void *e1, const void *e2);
+   static int compareIndices (const void *i1, const void *i2);
+
+   int buildTree (int start, int end);
+   void findInTree (int start, int end, int y1, int y2,
+                    lout::misc::SimpleVector<int> *result);
+
+public:
+   SpatialIndex ();
+   ~SpatialIndex ();
+
+   void clear ();
+   void add (int index, int y, int height);
+   void build ();
+   void find (int y, int height, lout::misc::SimpleVector<int> *result);
+
+   inline bool isBuilt () { return built; }
+   inline int size () { return entries->size (); }
+};
+
+} // namespace core
+} // namespace dw
+
+#endif // __DW_SPATIALINDEX_HH__
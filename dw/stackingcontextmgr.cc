@@ -40,11 +40,15 @@ StackingContextMgr::StackingContextMgr (Widget *widget)
    numZIndices = 0;
    zIndices = NULL;
    DBG_OBJ_SET_NUM ("numZIndices", numZIndices);
+
+   childSCIndex = new SpatialIndex ();
+   childSCIndexSerial = 0;
 }
 
 StackingContextMgr::~StackingContextMgr ()
 {
    delete childSCWidgets;
+   delete childSCIndex;
    if (zIndices)
       free (zIndices);
    DBG_OBJ_DELETE ();
@@ -77,6 +81,7 @@ void StackingContextMgr::addChildSCWidget (Widget *widget)
    }      
 
    childSCWidgets->put (widget);
+   childSCIndex->clear ();
    DBG_OBJ_SET_NUM ("childSCWidgets.size", childSCWidgets->size());
    DBG_OBJ_ARRSET_PTR ("childSCWidgets", childSCWidgets->size() - 1, widget);
 
@@ -120,6 +125,35 @@ int StackingContextMgr::findZIndex (int zIndex, bool mustExist)
    return result;
 }
 
+/**
+ * \brief Put the indices (within "childSCWidgets") of all children which
+ *    may touch the vertical range from y to y + height (canvas
+ *    coordinates) into "candidates", in ascending order.
+ */
+void StackingContextMgr::findCandidates (int y, int height,
+                                         SimpleVector<int> *candidates)
+{
+   Layout *layout = widget->getLayout ();
+   int serial = layout ? layout->getAllocationSerial () : 0;
+
+   if (!childSCIndex->isBuilt () || childSCIndexSerial != serial) {
+      childSCIndex->clear ();
+      for (int i = 0; i < childSCWidgets->size (); i++) {
+         Widget *child = childSCWidgets->get (i);
+         // Children not allocated are neither drawn nor found at any
+         // point.
+         if (child->wasAllocated ())
+            childSCIndex->add (i, child->getAllocation()->y,
+                               child->getAllocation()->ascent
+                               + child->getAllocation()->descent);
+      }
+      childSCIndex->build ();
+      childSCIndexSerial = serial;
+   }
+
+   childSCIndex->find (y, height, candidates);
+}
+
 void StackingContextMgr::draw (View *view, Rectangle *area, int startZIndex,
                                int endZIndex, DrawingContext *context)
 {
@@ -127,6 +161,11 @@ void StackingContextMgr::draw (View *view, Rectangle *area, int startZIndex,
                   area->x, area->y, area->width, area->height, startZIndex,
                   endZIndex);
 
+   // "area" is relative to the widget establishing the stacking context.
+   SimpleVector<int> candidates (4);
+   findCandidates (widget->getAllocation()->y + area->y, area->height,
+                   &candidates);
+
    for (int zIndexIndex = 0; zIndexIndex < numZIndices; zIndexIndex++) {
       // Wrong region of z-indices (top or bottom) is simply ignored
       // (as well as non-defined zIndices).
@@ -135,8 +174,8 @@ void StackingContextMgr::draw (View *view, Rectangle *area, int startZIndex,
          DBG_OBJ_MSGF ("draw", 1, "drawing zIndex = %d", zIndices[zIndexIndex]);
          DBG_OBJ_MSG_START ();
 
-         for (int i = 0; i < childSCWidgets->size (); i++) {
-            Widget *child = childSCWidgets->get (i);
+         for (int i = 0; i < candidates.size (); i++) {
+            Widget *child = childSCWidgets->get (candidates.get (i));
             DBG_OBJ_MSGF ("draw", 2, "widget %p has zIndex = %d",
                           child, child->getStyle()->zIndex);
 
@@ -162,6 +201,9 @@ Widget *StackingContextMgr::getWidgetAtPoint (int x, int y,
 
    Widget *widgetAtPoint = NULL;
 
+   SimpleVector<int> candidates (4);
+   findCandidates (y, 0, &candidates);
+
    for (int zIndexIndex = numZIndices - 1;
         widgetAtPoint == NULL && zIndexIndex >= 0; zIndexIndex--) {
       // Wrong region of z-indices (top or bottom) is simply ignored
@@ -172,9 +214,9 @@ Widget *StackingContextMgr::getWidgetAtPoint (int x, int y,
                        zIndices[zIndexIndex]);
          DBG_OBJ_MSG_START ();
 
-         for (int i = childSCWidgets->size () - 1;
+         for (int i = candidates.size () - 1;
               widgetAtPoint == NULL && i >= 0; i--) {
-            Widget *child = childSCWidgets->get (i);
+            Widget *child = childSCWidgets->get (candidates.get (i));
             DBG_OBJ_MSGF ("events", 2, "widget %p has zIndex = %d",
                           child, child->getStyle()->zIndex);
             if (child->getStyle()->zIndex == zIndices[zIndexIndex])
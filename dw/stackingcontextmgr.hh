@@ -23,7 +23,14 @@ private:
    lout::container::typed::Vector<Widget> *childSCWidgets;
    int *zIndices, numZIndices;
 
+   // Child stacking context widgets may be allocated by any widget, so
+   // the index is rebuilt lazily whenever any allocation has changed.
+   SpatialIndex *childSCIndex;
+   int childSCIndexSerial;
+
    int findZIndex (int zIndex, bool mustExist);
+   void findCandidates (int y, int height,
+                        lout::misc::SimpleVector<int> *candidates);
    void draw (View *view, Rectangle *area, int startZIndex, int endZIndex,
               DrawingContext *context);
    Widget *getWidgetAtPoint (int x, int y,
@@ -84,6 +84,7 @@ void StyleAttrs::initValues ()
    borderWidth.setVal (0);
    padding.setVal (0);
    borderCollapse = BORDER_MODEL_SEPARATE;
+   tableLayout = TABLE_LAYOUT_AUTO;
    setBorderColor (NULL);
    setBorderStyle (BORDER_NONE);
    hBorderSpacing = 0;
@@ -125,6 +126,7 @@ void StyleAttrs::resetValues ()
    margin.setVal (0);
    borderWidth.setVal (0);
    padding.setVal (0);
+   tableLayout = TABLE_LAYOUT_AUTO;
    setBorderColor (NULL);
    setBorderStyle (BORDER_NONE);
    hBorderSpacing = 0;
@@ -191,6 +193,7 @@ bool StyleAttrs::equals (object::Object *other) {
        borderWidth.equals (&otherAttrs->borderWidth) &&
        padding.equals (&otherAttrs->padding) &&
        borderCollapse == otherAttrs->borderCollapse &&
+       tableLayout == otherAttrs->tableLayout &&
        borderColor.top == otherAttrs->borderColor.top &&
        borderColor.right == otherAttrs->borderColor.right &&
        borderColor.bottom == otherAttrs->borderColor.bottom &&
@@ -249,6 +252,7 @@ int StyleAttrs::hashValue () {
       borderWidth.hashValue () +
       padding.hashValue () +
       borderCollapse +
+      tableLayout +
       (intptr_t) borderColor.top +
       (intptr_t) borderColor.right +
       (intptr_t) borderColor.bottom +
@@ -377,6 +381,7 @@ void Style::copyAttrs (StyleAttrs *attrs)
    borderWidth = attrs->borderWidth;
    padding = attrs->padding;
    borderCollapse = attrs->borderCollapse;
+   tableLayout = attrs->tableLayout;
    borderColor = attrs->borderColor;
    borderStyle = attrs->borderStyle;
    display = attrs->display;
@@ -418,9 +423,12 @@ int FontAttrs::hashValue()
    return h;
 }
 
+int Font::totalRef = 0;
+
 Font::~Font ()
 {
    free ((char*)name);
+   totalRef--;
    DBG_OBJ_DELETE ();
 }
 
@@ -220,6 +220,11 @@ enum BorderCollapse {
    BORDER_MODEL_COLLAPSE
 };
 
+enum TableLayout {
+   TABLE_LAYOUT_AUTO,
+   TABLE_LAYOUT_FIXED
+};
+
 enum BorderStyle {
    BORDER_NONE,
    BORDER_HIDDEN,
@@ -559,6 +564,7 @@ public:
 
    Box margin, borderWidth, padding;
    BorderCollapse borderCollapse;
+   TableLayout tableLayout;
    struct { Color *top, *right, *bottom, *left; } borderColor;
    struct { BorderStyle top, right, bottom, left; } borderStyle;
 
@@ -640,6 +646,9 @@ public:
 
    inline void ref () { refCount++; }
    inline void unref () { if (--refCount == 0) delete this; }
+
+   /** \brief Number of distinct styles currently allocated. */
+   inline static int getNumStyles () { return totalRef; }
 };
 
 
@@ -700,6 +709,7 @@ class Font: public FontAttrs
 {
 private:
    int refCount;
+   static int totalRef;
 
    static Font *create0 (Layout *layout, FontAttrs *attrs, bool tryEverything);
 
@@ -707,6 +717,7 @@ protected:
    inline Font () {
       DBG_OBJ_CREATE ("dw::core::style::Font");
       refCount = 0;
+      totalRef++;
    }
    virtual ~Font ();
 
@@ -722,6 +733,9 @@ public:
 
    inline void ref () { refCount++; }
    inline void unref () { if (--refCount == 0) delete this; }
+
+   /** \brief Number of fonts currently allocated. */
+   inline static int getNumFonts () { return totalRef; }
 };
 
 
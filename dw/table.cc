@@ -20,15 +20,20 @@
 //#define DBG
 
 #include "table.hh"
+#include "simpletablecell.hh"
 #include "../lout/msg.h"
 #include "../lout/misc.hh"
 #include "../lout/debug.hh"
 
+#include <limits.h>
+#include <string.h>
+
 using namespace lout;
 
 namespace dw {
 
 bool Table::adjustTableMinWidth = true;
+int Table::minVirtualRows = 0;
 int Table::CLASS_ID = -1;
 
 Table::Table(bool limitTextWidth)
@@ -53,11 +58,19 @@ Table::Table(bool limitTextWidth)
    colExtremes = new misc::SimpleVector<core::Extremes> (8);
    colWidthSpecified = new misc::SimpleVector<bool> (8);
    colWidthPercentage = new misc::SimpleVector<bool> (8);
+   baseColExtremes = new misc::SimpleVector<core::Extremes> (8);
+   baseColWidthSpecified = new misc::SimpleVector<bool> (8);
+   baseColWidthPercentage = new misc::SimpleVector<bool> (8);
+   extremesDirtyCells = new misc::SimpleVector <int> (8);
+   colSpanCells = new misc::SimpleVector <int> (8);
+   definedColWidths = new misc::SimpleVector <core::style::Length> (8);
    colWidths = new misc::SimpleVector <int> (8);
    cumHeight = new misc::SimpleVector <int> (8);
    rowSpanCells = new misc::SimpleVector <int> (8);
    baseline = new misc::SimpleVector <int> (8);
    rowStyle = new misc::SimpleVector <core::style::Style*> (8);
+   rowState = new misc::SimpleVector <RowState> (8);
+   builtRows = new misc::SimpleVector <int> (8);
 
    colWidthsUpToDateWidthColExtremes = true;
    DBG_OBJ_SET_BOOL ("colWidthsUpToDateWidthColExtremes",
@@ -65,6 +78,13 @@ Table::Table(bool limitTextWidth)
 
    numColWidthSpecified = 0;
    numColWidthPercentage = 0;
+   baseColExtremesValid = false;
+   numDefinedCols = 0;
+   heightsRefRow = allocRefRow = 0;
+   virtRefRow = 0;
+   numVirtualRows = 0;
+   virtScrollY = INT_MIN;
+   virtRetry = false;
 
    redrawX = 0;
    redrawY = 0;
@@ -72,11 +92,16 @@ Table::Table(bool limitTextWidth)
 
 Table::~Table()
 {
+   if (layout)
+      layout->removeViewportWidget (this);
+
    for (int i = 0; i < children->size (); i++) {
       if (children->get(i)) {
          switch (children->get(i)->type) {
          case Child::CELL:
             delete children->get(i)->cell.widget;
+            if (children->get(i)->cell.virt)
+               freeVirtualCell (children->get(i)->cell.virt);
             break;
          case Child::SPAN_SPACE:
             break;
@@ -94,11 +119,19 @@ Table::~Table()
    delete colExtremes;
    delete colWidthSpecified;
    delete colWidthPercentage;
+   delete baseColExtremes;
+   delete baseColWidthSpecified;
+   delete baseColWidthPercentage;
+   delete extremesDirtyCells;
+   delete colSpanCells;
+   delete definedColWidths;
    delete colWidths;
    delete cumHeight;
    delete rowSpanCells;
    delete baseline;
    delete rowStyle;
+   delete rowState;
+   delete builtRows;
 
    DBG_OBJ_DELETE ();
 }
@@ -138,7 +171,15 @@ void Table::getExtremesSimpl (core::Extremes *extremes)
       extremes->minWidth = extremes->minWidthIntrinsic = extremes->maxWidth =
          extremes->maxWidthIntrinsic = extremes->adjustmentWidth =
          boxDiffWidth ();
-   else {
+   else if (isFixedLayout ()) {
+      // Only absolute column widths are regarded, not the cells.
+      int width = (numCols + 1) * getStyle()->hBorderSpacing + boxDiffWidth ();
+      for (int col = 0; col < numCols; col++)
+         width += misc::max (calcFixedColWidth (col, -1), 0);
+
+      extremes->minWidth = extremes->minWidthIntrinsic = extremes->maxWidth =
+         extremes->maxWidthIntrinsic = extremes->adjustmentWidth = width;
+   } else {
       forceCalcColumnExtremes ();
 
       extremes->minWidth = extremes->minWidthIntrinsic = extremes->maxWidth =
@@ -173,6 +214,18 @@ void Table::sizeAllocateImpl (core::Allocation *allocation)
 
    calcCellSizes (true);
 
+   // When the table has not moved, only the rows changed since the last
+   // call (see allocRefRow) have to be allocated.
+   int firstRow;
+   if (wasAllocated () && allocation->x == this->allocation.x &&
+       allocation->y == this->allocation.y &&
+       allocation->width == this->allocation.width)
+      firstRow = misc::min (allocRefRow, numRows);
+   else
+      firstRow = 0;
+
+   DBG_OBJ_MSGF ("resize", 1, "allocating from row %d on", firstRow);
+
    /**
     * \bug Baselines are not regarded here.
     */
@@ -181,7 +234,7 @@ void Table::sizeAllocateImpl (core::Allocation *allocation)
    int x = allocation->x + boxOffsetX () + getStyle()->hBorderSpacing;
 
    for (int col = 0; col < numCols; col++) {
-      for (int row = 0; row < numRows; row++) {
+      for (int row = firstRow; row < numRows; row++) {
          int n = row * numCols + col;
          if (childDefined (n)) {
             int width = (children->get(n)->cell.colspanEff - 1)
@@ -209,6 +262,8 @@ void Table::sizeAllocateImpl (core::Allocation *allocation)
       x += colWidths->get (col) + getStyle()->hBorderSpacing;
    }
 
+   allocRefRow = numRows;
+
    sizeAllocateEnd ();
 
    DBG_OBJ_LEAVE ();
@@ -327,6 +382,35 @@ int Table::applyPerHeight (int containerHeight, core::style::Length perHeight)
    return core::style::multiplyWithPerLength (containerHeight, perHeight);
 }
 
+void Table::markSizeChange (int ref)
+{
+   DBG_OBJ_ENTER ("resize", 1, "markSizeChange", "%d", ref);
+
+   // The table itself uses ref = 0 (e. g. for style changes), which
+   // correctly means "from the first row on".
+   if (ref != -1 && !isParentRefOOF (ref)) {
+      int row = numCols > 0 ? getParentRefInFlowSubRef (ref) / numCols : 0;
+      heightsRefRow = misc::min (heightsRefRow, row);
+      allocRefRow = misc::min (allocRefRow, row);
+   }
+
+   DBG_OBJ_SET_NUM ("heightsRefRow", heightsRefRow);
+   DBG_OBJ_SET_NUM ("allocRefRow", allocRefRow);
+   DBG_OBJ_LEAVE ();
+}
+
+void Table::markExtremesChange (int ref)
+{
+   DBG_OBJ_ENTER ("resize", 1, "markExtremesChange", "%d", ref);
+
+   // Only cells contribute to the column extremes; see
+   // forceCalcColumnExtremes().
+   if (ref != -1 && !isParentRefOOF (ref))
+      markCellExtremesDirty (getParentRefInFlowSubRef (ref));
+
+   DBG_OBJ_LEAVE ();
+}
+
 void Table::containerSizeChangedForChildren ()
 {
    DBG_OBJ_ENTER0 ("resize", 0, "containerSizeChangedForChildren");
@@ -334,8 +418,10 @@ void Table::containerSizeChangedForChildren ()
    for (int col = 0; col < numCols; col++) {
       for (int row = 0; row < numRows; row++) {
          int n = row * numCols + col;
-         if (childDefined (n))
+         if (childDefined (n)) {
+            markCellExtremesDirty (n);
             children->get(n)->cell.widget->containerSizeChanged ();
+         }
       }
    }
 
@@ -403,13 +489,37 @@ void Table::drawLevel (core::View *view, core::Rectangle *area, int level,
 
    switch (level) {
    case SL_IN_FLOW:
-      for (int i = 0; i < children->size (); i++) {
-         if (childDefined (i)) {
-            Widget *child = children->get(i)->cell.widget;
-            core::Rectangle childArea;
-            if (!core::StackingContextMgr::handledByStackingContextMgr (child)
-                && child->intersects (this, area, &childArea))
-               child->draw (view, &childArea, context);
+      if (numRows > 0) {
+         // Only the rows intersecting with the area are drawn, plus the
+         // cells spanning into the first of them from above.
+         int firstRow = findRowAtY (area->y - getRowsOffsetY ());
+         int lastRow =
+            findRowAtY (area->y + area->height - getRowsOffsetY ());
+
+         for (int col = 0; col < numCols; col++) {
+            Child *child = children->get (firstRow * numCols + col);
+            if (child && child->type == Child::SPAN_SPACE &&
+                child->spanSpace.startRow < firstRow &&
+                child->spanSpace.startCol == col) {
+               int n = child->spanSpace.startRow * numCols + col;
+               if (childDefined (n)) {
+                  Widget *cell = children->get(n)->cell.widget;
+                  core::Rectangle childArea;
+                  if (!core::StackingContextMgr::handledByStackingContextMgr
+                      (cell) && cell->intersects (this, area, &childArea))
+                     cell->draw (view, &childArea, context);
+               }
+            }
+         }
+
+         for (int i = firstRow * numCols; i < (lastRow + 1) * numCols; i++) {
+            if (childDefined (i)) {
+               Widget *child = children->get(i)->cell.widget;
+               core::Rectangle childArea;
+               if (!core::StackingContextMgr::handledByStackingContextMgr
+                   (child) && child->intersects (this, area, &childArea))
+                  child->draw (view, &childArea, context);
+            }
          }
       }
       break;
@@ -433,12 +543,28 @@ core::Widget *Table::getWidgetAtPointLevel (int x, int y, int level,
 
    switch (level) {
    case SL_IN_FLOW:
-      for (int i = children->size () - 1; widgetAtPoint == NULL && i >= 0;
-           i--) {
-         if (childDefined (i)) {
-            Widget *child = children->get(i)->cell.widget;
-            if (!core::StackingContextMgr::handledByStackingContextMgr (child))
-               widgetAtPoint = child->getWidgetAtPoint (x, y, context);
+      if (numRows > 0) {
+         // Only the cells of the row at this position are regarded, and
+         // those spanning into it from above. (The cells of a row do not
+         // exceed it.)
+         int row = findRowAtY (y - allocation.y - getRowsOffsetY ());
+
+         for (int i = (row + 1) * numCols - 1;
+              widgetAtPoint == NULL && i >= row * numCols; i--) {
+            int n = i;
+            Child *child = children->get (i);
+            if (child && child->type == Child::SPAN_SPACE &&
+                child->spanSpace.startRow < row &&
+                child->spanSpace.startCol == i - row * numCols)
+               n = child->spanSpace.startRow * numCols +
+                  child->spanSpace.startCol;
+
+            if (childDefined (n)) {
+               Widget *cell = children->get(n)->cell.widget;
+               if (!core::StackingContextMgr::handledByStackingContextMgr
+                   (cell))
+                  widgetAtPoint = cell->getWidgetAtPoint (x, y, context);
+            }
          }
       }
       break;
@@ -543,10 +669,14 @@ void Table::addCell (Widget *widget, int colspan, int rowspan)
    child->cell.colspanOrig = colspan;
    child->cell.colspanEff = colspanEff;
    child->cell.rowspan = rowspan;
+   child->cell.extremesKnown = false;
+   child->cell.extremesDirty = false;
+   child->cell.virt = NULL;
    children->set (curRow * numCols + curCol, child);
 
-   // The position in the children array is (indirectly) assigned to parentRef,
-   // although incremental resizing is not implemented. Useful, e. g., in
+   // The position in the children array is (indirectly) assigned to
+   // parentRef. Used in markSizeChange() and markExtremesChange() to
+   // find the cell, and also useful, e. g., in
    // calcAvailWidthForDescendant(). See also reallocChildren().
    widget->parentRef = makeParentRefInFlow (curRow * numCols + curCol);
    DBG_OBJ_SET_NUM_O (widget, "parentRef", widget->parentRef);
@@ -556,7 +686,8 @@ void Table::addCell (Widget *widget, int colspan, int rowspan)
    widget->setParent (this);
    if (rowStyle->get (curRow))
       widget->setBgColor (rowStyle->get(curRow)->backgroundColor);
-   queueResize (0, true);
+   // Only this cell (and the rows from here on) is affected.
+   queueResize (widget->parentRef, true);
 
 #if 0
    // show table structure in stdout
@@ -599,6 +730,39 @@ void Table::addRow (core::style::Style *style)
    rowClosed = false;
 }
 
+/**
+ * \brief Defines the width of the next \em span columns, as HTML \<col\>
+ *    does.
+ *
+ * This is only regarded when 'table-layout' is 'fixed'; see "Fixed
+ * Layout" in dw::Table.
+ */
+void Table::addColumn (core::style::Length width, int span)
+{
+   DBG_OBJ_ENTER ("resize", 0, "addColumn", "%d, %d", width, span);
+
+   const int maxspan = 100;
+
+   // See addCell().
+   if (span > maxspan || span <= 0) {
+      MSG_WARN("span = %d is set to %d.\n", span, maxspan);
+      span = maxspan;
+   }
+
+   int firstCol = numDefinedCols;
+
+   if (firstCol + span > numCols)
+      reallocChildren (firstCol + span, numRows);
+
+   for (int col = firstCol; col < firstCol + span; col++)
+      definedColWidths->set (col, width);
+   numDefinedCols = firstCol + span;
+
+   queueResize (0, true);
+
+   DBG_OBJ_LEAVE ();
+}
+
 AlignedTableCell *Table::getCellRef ()
 {
    core::Widget *child;
@@ -783,15 +947,22 @@ void Table::reallocChildren (int newNumCols, int newNumRows)
    rowStyle->setSize (newNumRows);
    for (int row = numRows; row < newNumRows; row++)
       rowStyle->set (row, NULL);
+   rowState->setSize (newNumRows, ROW_NORMAL);
    // Rest is increased, when needed.
 
    if (newNumCols > numCols) {
+      // The cells are moved in the children array, and colspanEff may
+      // have changed, so all column extremes have to be calculated again.
+      baseColExtremesValid = false;
+      extremesDirtyCells->setSize (0);
+
       // Re-calculate parentRef. See addCell().
       for (int row = 1; row < newNumRows; row++)
          for (int col = 0; col < newNumCols; col++) {
             int n = row * newNumCols + col;
             Child *child = children->get (n);
-            if (child != NULL && child->type == Child::CELL) {
+            if (child != NULL && child->type == Child::CELL &&
+                child->cell.widget != NULL) {
                child->cell.widget->parentRef = makeParentRefInFlow (n);
                DBG_OBJ_SET_NUM_O (child->cell.widget, "parentRef",
                                   child->cell.widget->parentRef);
@@ -807,6 +978,7 @@ void Table::reallocChildren (int newNumCols, int newNumRows)
    // widths are actually calculated.
 
    colWidths->setSize (numCols, 100);
+   definedColWidths->setSize (numCols, core::style::LENGTH_AUTO);
 
    DBG_IF_RTFL {
       DBG_OBJ_SET_NUM ("colWidths.size", colWidths->size ());
@@ -865,6 +1037,7 @@ void Table::forceCalcCellSizes (bool calcHeights)
                switch (child->type) {
                case Child::CELL:
                   cell = child->cell.widget;
+                  markCellExtremesDirty (n);
                   break;
 
                case Child::SPAN_SPACE:
@@ -879,8 +1052,10 @@ void Table::forceCalcCellSizes (bool calcHeights)
                   for (col2 = col - 1; col2 >= 0 && cell == NULL; col2--) {
                      int n2 = row * numCols + col2;
                      Child *child2 = children->get(n2);
-                     if (child2 != NULL && child2->type == Child::CELL)
+                     if (child2 != NULL && child2->type == Child::CELL) {
                         cell = child2->cell.widget;
+                        markCellExtremesDirty (n2);
+                     }
                   }
                   break;
 
@@ -925,7 +1100,6 @@ void Table::actuallyCalcCellSizes (bool calcHeights)
 
    assert (colWidths->size () == numCols); // This is set in addCell.
    cumHeight->setSize (numRows + 1, 0);
-   rowSpanCells->setSize (0);
    baseline->setSize (numRows);
 
    misc::SimpleVector<int> *oldColWidths = colWidths;
@@ -957,7 +1131,10 @@ void Table::actuallyCalcCellSizes (bool calcHeights)
                  minWidth, minWidthIntrinsic, maxWidth, totalWidth,
                  totalWidthSpecified ? "specified" : "not specified");
 
-   if (minWidth > totalWidth) {
+   if (isFixedLayout ()) {
+      DBG_OBJ_MSG ("resize", 1, "case 0: fixed layout");
+      calcFixedColWidths (totalWidth);
+   } else if (minWidth > totalWidth) {
       DBG_OBJ_MSG ("resize", 1, "case 1: minWidth > totalWidth");
 
       // The sum of all column minima is larger than the available
@@ -1153,9 +1330,18 @@ void Table::actuallyCalcCellSizes (bool calcHeights)
    // TODO: Adapted from old inline function "setColWidth". But (i) is
    // this anyway correct (col width is is not x)? And does the
    // performance gain actually play a role?
-   for (int col = 0; col < colExtremes->size(); col++) {
-      if (colWidths->get (col) != oldColWidths->get (col))
+   bool colWidthsChanged = oldColWidths->size () != numCols;
+   for (int col = 0; col < numCols; col++) {
+      if (col >= oldColWidths->size () ||
+          colWidths->get (col) != oldColWidths->get (col)) {
          redrawX = lout::misc::min (redrawX, colWidths->get (col));
+         colWidthsChanged = true;
+      }
+   }
+
+   if (colWidthsChanged) {
+      // All cells get a new width, so all rows are affected.
+      heightsRefRow = allocRefRow = 0;
    }
 
    DBG_IF_RTFL {
@@ -1176,8 +1362,10 @@ void Table::actuallyCalcCellSizes (bool calcHeights)
             int n = row * numCols + col;
             // TODO: Columns spanning several rows are only regarded
             // when the first column is affected.
-            if (childDefined (n))
+            if (childDefined (n)) {
+               markCellExtremesDirty (n);
                children->get(n)->cell.widget->containerSizeChanged ();
+            }
          }
       }
    }
@@ -1185,8 +1373,17 @@ void Table::actuallyCalcCellSizes (bool calcHeights)
    delete oldColWidths;
 
    if (calcHeights) {
+      // Rows before heightsRefRow are still valid, unless cells spanning
+      // multiple rows have modified them; see apportionRowSpan().
+      int firstRow =
+         rowSpanCells->size () > 0 ? 0 : misc::min (heightsRefRow, numRows);
+      rowSpanCells->setSize (0);
+
+      DBG_OBJ_MSGF ("resize", 1, "calculating heights from row %d on",
+                    firstRow);
+
       setCumHeight (0, 0);
-      for (int row = 0; row < numRows; row++) {
+      for (int row = firstRow; row < numRows; row++) {
          /**
           * \bug dw::Table::baseline is not filled.
           */
@@ -1210,7 +1407,10 @@ void Table::actuallyCalcCellSizes (bool calcHeights)
                   rowSpanCells->increase();
                   rowSpanCells->set(rowSpanCells->size()-1, n);
                }
-            }
+            } else if (childVirtual (n))
+               // Only rows with rowspan = 1 are made virtual.
+               rowHeight = misc::max (rowHeight,
+                                      children->get(n)->cell.virt->height);
          } // for col
 
          setCumHeight (row + 1,
@@ -1218,6 +1418,7 @@ void Table::actuallyCalcCellSizes (bool calcHeights)
       } // for row
 
       apportionRowSpan ();
+      heightsRefRow = numRows;
    }
 
    DBG_OBJ_LEAVE ();
@@ -1285,90 +1486,508 @@ void Table::apportionRowSpan ()
 }
 
 
+/**
+ * \brief Returns the width of a column for fixed layout, or -1, when it
+ *    is not defined.
+ *
+ * See "Fixed Layout" in dw::Table. Percentages are only regarded when
+ * \em totalWidth is not negative.
+ */
+int Table::calcFixedColWidth (int col, int totalWidth)
+{
+   core::style::Length width = definedColWidths->get (col);
+   int cs = 1, boxDiff = 0;
+
+   if (width == core::style::LENGTH_AUTO) {
+      // Search the cell in the first row covering this column.
+      int n = col;
+      while (n >= 0 && n < children->size () && children->get(n) &&
+             children->get(n)->type == Child::SPAN_SPACE)
+         n--;
+
+      if (n >= 0 && childDefined (n) &&
+          n + children->get(n)->cell.colspanEff > col) {
+         core::style::Style *style = children->get(n)->cell.widget->getStyle();
+         width = style->width;
+         cs = children->get(n)->cell.colspanEff;
+         boxDiff = style->boxDiffWidth ();
+      }
+   }
+
+   int colWidth;
+   if (core::style::isAbsLength (width))
+      colWidth = core::style::absLengthVal (width) + boxDiff;
+   else if (core::style::isPerLength (width) && totalWidth >= 0)
+      colWidth = core::style::multiplyWithPerLength (totalWidth, width);
+   else
+      return -1;
+
+   // A cell spanning multiple columns divides its width equally.
+   return misc::max ((colWidth - (cs - 1) * getStyle()->hBorderSpacing) / cs,
+                     0);
+}
+
+/**
+ * \brief Fills dw::Table::colWidths for fixed layout.
+ */
+void Table::calcFixedColWidths (int totalWidth)
+{
+   DBG_OBJ_ENTER ("resize", 0, "calcFixedColWidths", "%d", totalWidth);
+
+   int numAuto = 0, sumWidth = 0;
+   for (int col = 0; col < numCols; col++) {
+      int width = calcFixedColWidth (col, totalWidth);
+      colWidths->set (col, width);
+      if (width == -1)
+         numAuto++;
+      else
+         sumWidth += width;
+   }
+
+   // The rest is divided between the columns without width, or, when
+   // all are defined, between all columns.
+   int rest = misc::max (totalWidth - sumWidth, 0);
+   int numRest = numAuto > 0 ? numAuto : numCols;
+
+   DBG_OBJ_MSGF ("resize", 1, "sumWidth = %d, rest = %d, numAuto = %d",
+                 sumWidth, rest, numAuto);
+
+   for (int col = 0, i = 0; col < numCols; col++)
+      if (numAuto == 0 || colWidths->get (col) == -1) {
+         int part = rest / numRest + (i < rest % numRest ? 1 : 0);
+         colWidths->set (col, misc::max (colWidths->get (col), 0) + part);
+         i++;
+      }
+
+   DBG_OBJ_LEAVE ();
+}
+
+/**
+ * \brief Returns the row at the vertical position \em y (relative to the
+ *    first row), limited to the rows already laid out.
+ */
+int Table::findRowAtY (int y)
+{
+   int low = 0, high = misc::min (numRows, cumHeight->size () - 1) - 1;
+
+   while (low < high) {
+      int mid = (low + high + 1) / 2;
+      if (cumHeight->get (mid) <= y)
+         low = mid;
+      else
+         high = mid - 1;
+   }
+
+   return low;
+}
+
+/**
+ * \brief Returns the position of the first row, relative to the
+ *    allocation of the table.
+ */
+int Table::getRowsOffsetY ()
+{
+   return boxOffsetY () + getStyle()->vBorderSpacing;
+}
+
+/**
+ * \brief Returns the allocation the cell at \em n (as index in children)
+ *    would get; also defined for virtual cells.
+ */
+void Table::getCellAllocation (int n, core::Allocation *allocation)
+{
+   int row = n / numCols, col = n % numCols;
+   Child *child = children->get (n);
+
+   allocation->x =
+      this->allocation.x + boxOffsetX () + getStyle()->hBorderSpacing;
+   for (int i = 0; i < col; i++)
+      allocation->x += colWidths->get (i) + getStyle()->hBorderSpacing;
+
+   allocation->width =
+      (child->cell.colspanEff - 1) * getStyle()->hBorderSpacing;
+   for (int i = 0; i < child->cell.colspanEff; i++)
+      allocation->width += colWidths->get (col + i);
+
+   allocation->y = this->allocation.y + getRowsOffsetY ();
+   allocation->ascent = allocation->descent = 0;
+   if (row + child->cell.rowspan < cumHeight->size ()) {
+      allocation->y += cumHeight->get (row);
+      allocation->ascent =
+         misc::max (cumHeight->get (row + child->cell.rowspan)
+                    - cumHeight->get (row) - getStyle()->vBorderSpacing, 0);
+   }
+}
+
+bool Table::isVirtualizing ()
+{
+   return minVirtualRows > 0 && numRows >= minVirtualRows &&
+      isFixedLayout () && wasAllocated () && layout != NULL &&
+      layout->getHeightViewport () > 0;
+}
+
+void Table::notifySetAsTopLevel ()
+{
+   OOFAwareWidget::notifySetAsTopLevel ();
+   if (minVirtualRows > 0)
+      layout->addViewportWidget (this);
+}
+
+void Table::notifySetParent ()
+{
+   OOFAwareWidget::notifySetParent ();
+   if (minVirtualRows > 0 && layout)
+      layout->addViewportWidget (this);
+}
+
+/**
+ * \brief Calls updateVirtualRows() when the visible area has moved far
+ *    enough, or when there are new rows, and queues a resize when rows
+ *    have been changed.
+ */
+void Table::viewportChanged ()
+{
+   if (isVirtualizing ()) {
+      int y = layout->getScrollPosY () - allocation.y - getRowsOffsetY ();
+      if (!virtRetry && virtScrollY != INT_MIN && virtRefRow == curRow &&
+          misc::max (y - virtScrollY, virtScrollY - y)
+          < layout->getHeightViewport () / 2)
+         return;
+   } else if (numVirtualRows == 0)
+      return;
+
+   if (updateVirtualRows ())
+      queueResize (-1, false);
+}
+
+/**
+ * \brief Makes the rows far away from the visible area virtual, and
+ *    builds the virtual rows near it again; see "Virtual Rows" above.
+ *
+ * Returns whether any row has been changed.
+ */
+bool Table::updateVirtualRows ()
+{
+   DBG_OBJ_ENTER0 ("resize", 0, "updateVirtualRows");
+
+   int oldNumVirtualRows = numVirtualRows;
+   bool changed = false;
+
+   virtRetry = false;
+
+   if (!isVirtualizing ()) {
+      if (numVirtualRows > 0)
+         buildAllRows ();
+      virtScrollY = INT_MIN;
+      changed = numVirtualRows != oldNumVirtualRows;
+   } else {
+      // Relative to the first row. The allocation is still the one of
+      // the last resize, which is also what is currently visible.
+      int viewportHeight = layout->getHeightViewport ();
+      int y = layout->getScrollPosY () - allocation.y - getRowsOffsetY ();
+      int keepFirst = findRowAtY (y - 2 * viewportHeight);
+      int keepLast = findRowAtY (y + 3 * viewportHeight);
+      int buildFirst = findRowAtY (y - viewportHeight);
+      int buildLast = findRowAtY (y + 2 * viewportHeight);
+      virtScrollY = y;
+
+      DBG_OBJ_MSGF ("resize", 1, "keeping rows %d to %d, building %d to %d",
+                    keepFirst, keepLast, buildFirst, buildLast);
+
+      // Rows which have been completed since the last call.
+      for (int row = virtRefRow; row < curRow; row++)
+         if (isVirtualizableRow (row)) {
+            rowState->set (row, ROW_BUILT);
+            builtRows->increase ();
+            builtRows->setLast (row);
+         }
+      virtRefRow = misc::max (virtRefRow, curRow);
+
+      // Rows with widgets far away from the visible area.
+      int j = 0;
+      for (int i = 0; i < builtRows->size (); i++) {
+         int row = builtRows->get (i);
+         if (row < keepFirst || row > keepLast) {
+            rowState->set (row, virtualizeRow (row));
+            if (rowState->get (row) == ROW_VIRTUAL)
+               changed = true;
+         }
+         if (rowState->get (row) == ROW_BUILT)
+            builtRows->set (j++, row);
+      }
+      builtRows->setSize (j);
+
+      for (int row = buildFirst; row <= buildLast; row++)
+         if (rowState->get (row) == ROW_VIRTUAL) {
+            buildRow (row);
+            changed = true;
+         }
+   }
+
+   DBG_OBJ_SET_NUM ("numVirtualRows", numVirtualRows);
+   DBG_OBJ_LEAVE_VAL ("%s", changed ? "true" : "false");
+   return changed;
+}
+
+/**
+ * \brief Returns whether the structure of the cells in \em row allows
+ *    to make it virtual. The contents are examined by virtualizeRow().
+ */
+bool Table::isVirtualizableRow (int row)
+{
+   // The first row defines the column widths (see calcFixedColWidth()),
+   // and the current row may still get contents.
+   if (row == 0 || row >= curRow)
+      return false;
+
+   for (int col = 0; col < numCols; col++) {
+      Child *child = children->get (row * numCols + col);
+      if (child == NULL)
+         continue;
+
+      if (child->type == Child::SPAN_SPACE) {
+         if (child->spanSpace.startRow != row)
+            return false;
+      } else if (child->cell.widget != NULL) {
+         Widget *cell = child->cell.widget;
+         if (child->cell.rowspan != 1 ||
+             cell->getClassId () != SimpleTableCell::CLASS_ID ||
+             cell->getStyle()->position != core::style::POSITION_STATIC)
+            return false;
+      }
+   }
+
+   return true;
+}
+
+/**
+ * \brief Tries to make \em row virtual, and returns the new state of the
+ *    row.
+ */
+Table::RowState Table::virtualizeRow (int row)
+{
+   DBG_OBJ_ENTER ("resize", 0, "virtualizeRow", "%d", row);
+
+   RowState state = ROW_VIRTUAL;
+
+   // A row is either virtual as a whole, or not at all, so all cells
+   // are examined first.
+   for (int col = 0; state == ROW_VIRTUAL && col < numCols; col++) {
+      int n = row * numCols + col;
+      if (childDefined (n)) {
+         Widget *cell = children->get(n)->cell.widget;
+         if (cell->needsResize () || cell->resizeQueued () ||
+             cell->extremesChanged () || cell->extremesQueued () ||
+             cell->needsAllocate () || cell->allocateQueued () ||
+             !cell->wasAllocated ()) {
+            // Not yet laid out; tried again after the next resize.
+            state = ROW_BUILT;
+            virtRetry = true;
+         } else if (layout->isWidgetInUse (cell))
+            state = ROW_BUILT;
+      }
+   }
+
+   VirtualCell **virt = new VirtualCell*[numCols];
+
+   for (int col = 0; col < numCols; col++) {
+      int n = row * numCols + col;
+      virt[col] = NULL;
+
+      if (state == ROW_VIRTUAL && childDefined (n)) {
+         Textblock *cell = (Textblock*)children->get(n)->cell.widget;
+         misc::StringBuffer text;
+         core::style::Style *wordStyle;
+
+         if (cell->getSimpleText (&text, &wordStyle)) {
+            core::Requisition childRequisition;
+            cell->sizeRequest (&childRequisition);
+
+            virt[col] = new VirtualCell ();
+            virt[col]->style = cell->getStyle ();
+            virt[col]->style->ref ();
+            virt[col]->wordStyle = wordStyle;
+            if (wordStyle)
+               wordStyle->ref ();
+            virt[col]->text = strdup (text.getChars ());
+            virt[col]->height =
+               childRequisition.ascent + childRequisition.descent;
+
+            // The text of a virtual cell is returned by iterators, so
+            // it must not be freed while iterators may refer to it.
+            VirtualCell *old = children->get(n)->cell.virt;
+            if (old &&
+                (old->style != virt[col]->style ||
+                 old->wordStyle != virt[col]->wordStyle ||
+                 strcmp (old->text, virt[col]->text) != 0) &&
+                layout->isWidgetInUse (this))
+               state = ROW_BUILT;
+         } else
+            state = ROW_NORMAL;
+      }
+   }
+
+   for (int col = 0; col < numCols; col++) {
+      if (virt[col]) {
+         Child *child = children->get (row * numCols + col);
+
+         if (state == ROW_VIRTUAL) {
+            VirtualCell *old = child->cell.virt;
+            if (old && old->style == virt[col]->style &&
+                old->wordStyle == virt[col]->wordStyle &&
+                strcmp (old->text, virt[col]->text) == 0) {
+               old->height = virt[col]->height;
+               freeVirtualCell (virt[col]);
+            } else {
+               if (old)
+                  freeVirtualCell (old);
+               child->cell.virt = virt[col];
+            }
+
+            Widget *cell = child->cell.widget;
+            child->cell.widget = NULL;
+            delete cell;
+         } else
+            freeVirtualCell (virt[col]);
+      }
+   }
+
+   delete[] virt;
+
+   if (state == ROW_VIRTUAL)
+      numVirtualRows++;
+
+   DBG_OBJ_LEAVE_VAL ("%d", state);
+   return state;
+}
+
+/**
+ * \brief Creates the cells of the virtual row \em row again.
+ */
+void Table::buildRow (int row)
+{
+   DBG_OBJ_ENTER ("resize", 0, "buildRow", "%d", row);
+
+   for (int col = 0; col < numCols; col++) {
+      int n = row * numCols + col;
+      if (childVirtual (n)) {
+         VirtualCell *virt = children->get(n)->cell.virt;
+         SimpleTableCell *cell = new SimpleTableCell (limitTextWidth);
+
+         // Like the HTML parser and addCell().
+         cell->setStyle (virt->style);
+         children->get(n)->cell.widget = cell;
+         cell->parentRef = makeParentRefInFlow (n);
+         DBG_OBJ_SET_NUM_O (cell, "parentRef", cell->parentRef);
+         cell->setParent (this);
+         if (rowStyle->get (row))
+            cell->setBgColor (rowStyle->get(row)->backgroundColor);
+
+         for (const char *s = virt->text; *s; ) {
+            const char *space = strchr (s, ' ');
+            cell->addText (s, space ? space - s : strlen (s),
+                           virt->wordStyle);
+            if (space == NULL)
+               break;
+            cell->addSpace (virt->wordStyle);
+            s = space + 1;
+         }
+         cell->flush ();
+
+         queueResize (cell->parentRef, true);
+      }
+   }
+
+   rowState->set (row, ROW_BUILT);
+   builtRows->increase ();
+   builtRows->setLast (row);
+   numVirtualRows--;
+
+   DBG_OBJ_LEAVE ();
+}
+
+void Table::buildAllRows ()
+{
+   for (int row = 0; row < numRows && numVirtualRows > 0; row++)
+      if (rowState->get (row) == ROW_VIRTUAL)
+         buildRow (row);
+}
+
+void Table::freeVirtualCell (VirtualCell *virt)
+{
+   virt->style->unref ();
+   if (virt->wordStyle)
+      virt->wordStyle->unref ();
+   free (virt->text);
+   delete virt;
+}
+
 /**
  * \brief Fills dw::Table::colExtremes in all cases.
+ *
+ * The extremes of cells with colspan = 1 are only regarded when they
+ * have changed (see markExtremesChange()); the cells with colspan > 1
+ * are then applied to the resulting base values.
  */
 void Table::forceCalcColumnExtremes ()
 {
    DBG_OBJ_ENTER0 ("resize", 0, "forceCalcColumnExtremes");
 
    if (numCols > 0) {
-      lout::misc::SimpleVector<int> colSpanCells (8);
       colExtremes->setSize (numCols);
       colWidthSpecified->setSize (numCols);
       colWidthPercentage->setSize (numCols);
 
       // 1. cells with colspan = 1
-      for (int col = 0; col < numCols; col++) {
-         DBG_OBJ_MSGF ("resize", 1, "column %d", col);
-         DBG_OBJ_MSG_START ();
+      if (!baseColExtremesValid || baseColExtremes->size () != numCols) {
+         DBG_OBJ_MSG ("resize", 1, "regarding all cells");
 
-         colWidthSpecified->set (col, false);
-         colWidthPercentage->set (col, false);
+         baseColExtremes->setSize (numCols);
+         baseColWidthSpecified->setSize (numCols);
+         baseColWidthPercentage->setSize (numCols);
+         colSpanCells->setSize (0);
+         extremesDirtyCells->setSize (0);
 
-         colExtremes->getRef(col)->minWidth = 0;
-         colExtremes->getRef(col)->minWidthIntrinsic = 0;
-         colExtremes->getRef(col)->maxWidth = 0;
-         colExtremes->getRef(col)->maxWidthIntrinsic = 0;
-         colExtremes->getRef(col)->adjustmentWidth = 0;
+         for (int col = 0; col < numCols; col++)
+            calcBaseColExtremes (col, true);
 
-         for (int row = 0; row < numRows; row++) {
-            DBG_OBJ_MSGF ("resize", 1, "row %d", row);
-            DBG_OBJ_MSG_START ();
+         baseColExtremesValid = true;
+      } else {
+         DBG_OBJ_MSGF ("resize", 1, "regarding %d changed cells",
+                       extremesDirtyCells->size ());
 
-            int n = row * numCols + col;
+         misc::SimpleVector<bool> recalcCol (8);
+         recalcCol.setSize (numCols, false);
 
+         for (int i = 0; i < extremesDirtyCells->size (); i++) {
+            int n = extremesDirtyCells->get (i);
             if (childDefined (n)) {
-               if (children->get(n)->cell.colspanEff == 1) {
-                  core::Extremes cellExtremes;
-                  children->get(n)->cell.widget->getExtremes (&cellExtremes);
-
-                  DBG_OBJ_MSGF ("resize", 1, "child: %d / %d",
-                                cellExtremes.minWidth, cellExtremes.maxWidth);
-
-                  colExtremes->getRef(col)->minWidthIntrinsic =
-                     misc::max (colExtremes->getRef(col)->minWidthIntrinsic,
-                                cellExtremes.minWidthIntrinsic);
-                  colExtremes->getRef(col)->maxWidthIntrinsic =
-                     misc::max (colExtremes->getRef(col)->minWidthIntrinsic,
-                                colExtremes->getRef(col)->maxWidthIntrinsic,
-                                cellExtremes.maxWidthIntrinsic);
-
-                  colExtremes->getRef(col)->minWidth =
-                     misc::max (colExtremes->getRef(col)->minWidth,
-                                cellExtremes.minWidth);
-                  colExtremes->getRef(col)->maxWidth =
-                     misc::max (colExtremes->getRef(col)->minWidth,
-                                colExtremes->getRef(col)->maxWidth,
-                                cellExtremes.maxWidth);
-
-                  colExtremes->getRef(col)->adjustmentWidth =
-                     misc::max (colExtremes->getRef(col)->adjustmentWidth,
-                                cellExtremes.adjustmentWidth);
-
-                  core::style::Length childWidth =
-                     children->get(n)->cell.widget->getStyle()->width;
-                  if (childWidth != core::style::LENGTH_AUTO) {
-                     colWidthSpecified->set (col, true);
-                     if (core::style::isPerLength (childWidth))
-                        colWidthPercentage->set (col, true);
-                  }
-
-                  DBG_OBJ_MSGF ("resize", 1, "column: %d / %d (%d / %d)",
-                                colExtremes->getRef(col)->minWidth,
-                                colExtremes->getRef(col)->maxWidth,
-                                colExtremes->getRef(col)->minWidthIntrinsic,
-                                colExtremes->getRef(col)->maxWidthIntrinsic);
-               } else {
-                  colSpanCells.increase ();
-                  colSpanCells.setLast (n);
+               Child *child = children->get(n);
+               child->cell.extremesDirty = false;
+
+               if (child->cell.colspanEff == 1) {
+                  int col = n % numCols;
+                  if (!recalcCol.get (col) && !addToBaseColExtremes (col, child))
+                     recalcCol.set (col, true);
+               } else if (!child->cell.extremesKnown) {
+                  addColSpanCell (n);
+                  child->cell.extremesKnown = true;
                }
             }
-
-            DBG_OBJ_MSG_END ();
          }
 
-         DBG_OBJ_MSG_END ();
+         extremesDirtyCells->setSize (0);
+
+         // A cell has become narrower: the maximum has to be searched again.
+         for (int col = 0; col < numCols; col++)
+            if (recalcCol.get (col))
+               calcBaseColExtremes (col, false);
+      }
+
+      for (int col = 0; col < numCols; col++) {
+         *colExtremes->getRef(col) = *baseColExtremes->getRef(col);
+         colWidthSpecified->set (col, baseColWidthSpecified->get (col));
+         colWidthPercentage->set (col, baseColWidthPercentage->get (col));
       }
 
       // 2. cells with colspan > 1
@@ -1376,8 +1995,8 @@ void Table::forceCalcColumnExtremes ()
       // TODO: Is this old comment still relevant? "If needed, here we
       // set proportionally apportioned col maximums."
 
-      for (int i = 0; i < colSpanCells.size(); i++) {
-         int n = colSpanCells.get (i);
+      for (int i = 0; i < colSpanCells->size(); i++) {
+         int n = colSpanCells->get (i);
          int col = n % numCols;
          int cs = children->get(n)->cell.colspanEff;
 
@@ -1402,7 +2021,7 @@ void Table::forceCalcColumnExtremes ()
    }
 
    numColWidthSpecified = 0;
-   numColWidthSpecified = 0;
+   numColWidthPercentage = 0;
    for (int i = 0; i < colExtremes->size (); i++) {
       if (colWidthSpecified->get (i))
          numColWidthSpecified++;
@@ -1443,6 +2062,155 @@ void Table::forceCalcColumnExtremes ()
    DBG_OBJ_LEAVE ();
 }
 
+/**
+ * \brief Calculates the base extremes (see dw::Table::baseColExtremes) of
+ *    one column from all its cells with colspan = 1.
+ *
+ * When \em collectColSpanCells is true, the cells with colspan > 1
+ * starting in this column are appended to dw::Table::colSpanCells.
+ */
+void Table::calcBaseColExtremes (int col, bool collectColSpanCells)
+{
+   DBG_OBJ_ENTER ("resize", 0, "calcBaseColExtremes", "%d, %s",
+                  col, collectColSpanCells ? "true" : "false");
+
+   baseColWidthSpecified->set (col, false);
+   baseColWidthPercentage->set (col, false);
+
+   core::Extremes *base = baseColExtremes->getRef(col);
+   base->minWidth = base->minWidthIntrinsic = base->maxWidth =
+      base->maxWidthIntrinsic = base->adjustmentWidth = 0;
+
+   for (int row = 0; row < numRows; row++) {
+      int n = row * numCols + col;
+      if (childDefined (n)) {
+         Child *child = children->get(n);
+         child->cell.extremesDirty = false;
+
+         if (child->cell.colspanEff == 1) {
+            // All values are collected again, so they cannot shrink.
+            child->cell.extremesKnown = false;
+            addToBaseColExtremes (col, child);
+         } else if (collectColSpanCells) {
+            colSpanCells->increase ();
+            colSpanCells->setLast (n);
+            child->cell.extremesKnown = true;
+         }
+      }
+   }
+
+   DBG_OBJ_MSGF ("resize", 1, "column: %d / %d (%d / %d)",
+                 base->minWidth, base->maxWidth, base->minWidthIntrinsic,
+                 base->maxWidthIntrinsic);
+
+   DBG_OBJ_LEAVE ();
+}
+
+/**
+ * \brief Regards the extremes of a cell with colspan = 1 in the base
+ *    extremes of its column.
+ *
+ * Returns false (and changes nothing) when the cell has become narrower
+ * than before, in a way which may affect the column; in this case,
+ * calcBaseColExtremes() has to be called for the column.
+ */
+bool Table::addToBaseColExtremes (int col, Child *child)
+{
+   core::Extremes cellExtremes;
+   child->cell.widget->getExtremes (&cellExtremes);
+
+   DBG_OBJ_MSGF ("resize", 1, "child: %d / %d",
+                 cellExtremes.minWidth, cellExtremes.maxWidth);
+
+   core::style::Length childWidth = child->cell.widget->getStyle()->width;
+   bool widthSpecified = childWidth != core::style::LENGTH_AUTO;
+   bool widthPercentage =
+      widthSpecified && core::style::isPerLength (childWidth);
+
+   core::Extremes *base = baseColExtremes->getRef(col);
+
+   if (child->cell.extremesKnown) {
+      core::Extremes *old = &child->cell.extremes;
+
+      // A value which has become smaller only matters, when the old one
+      // has defined the column value. (Note that the maxima are also
+      // affected by the minima.)
+      if ((cellExtremes.minWidth < old->minWidth &&
+           old->minWidth >= misc::min (base->minWidth, base->maxWidth)) ||
+          (cellExtremes.minWidthIntrinsic < old->minWidthIntrinsic &&
+           old->minWidthIntrinsic >= misc::min (base->minWidthIntrinsic,
+                                                base->maxWidthIntrinsic)) ||
+          (cellExtremes.maxWidth < old->maxWidth &&
+           old->maxWidth >= base->maxWidth) ||
+          (cellExtremes.maxWidthIntrinsic < old->maxWidthIntrinsic &&
+           old->maxWidthIntrinsic >= base->maxWidthIntrinsic) ||
+          (cellExtremes.adjustmentWidth < old->adjustmentWidth &&
+           old->adjustmentWidth >= base->adjustmentWidth) ||
+          (child->cell.widthSpecified && !widthSpecified) ||
+          (child->cell.widthPercentage && !widthPercentage)) {
+         DBG_OBJ_MSG ("resize", 1, "cell has become narrower");
+         return false;
+      }
+   }
+
+   base->minWidthIntrinsic =
+      misc::max (base->minWidthIntrinsic, cellExtremes.minWidthIntrinsic);
+   base->maxWidthIntrinsic =
+      misc::max (base->minWidthIntrinsic, base->maxWidthIntrinsic,
+                 cellExtremes.maxWidthIntrinsic);
+
+   base->minWidth = misc::max (base->minWidth, cellExtremes.minWidth);
+   base->maxWidth =
+      misc::max (base->minWidth, base->maxWidth, cellExtremes.maxWidth);
+
+   base->adjustmentWidth =
+      misc::max (base->adjustmentWidth, cellExtremes.adjustmentWidth);
+
+   if (widthSpecified)
+      baseColWidthSpecified->set (col, true);
+   if (widthPercentage)
+      baseColWidthPercentage->set (col, true);
+
+   child->cell.extremes = cellExtremes;
+   child->cell.widthSpecified = widthSpecified;
+   child->cell.widthPercentage = widthPercentage;
+   child->cell.extremesKnown = true;
+
+   return true;
+}
+
+/**
+ * \brief Inserts a new cell with colspan > 1 into dw::Table::colSpanCells,
+ *    preserving the order by column, then by row.
+ */
+void Table::addColSpanCell (int n)
+{
+   int col = n % numCols, row = n / numCols;
+   int i = colSpanCells->size ();
+   colSpanCells->increase ();
+
+   while (i > 0) {
+      int m = colSpanCells->get (i - 1);
+      if (m % numCols < col || (m % numCols == col && m / numCols < row))
+         break;
+      colSpanCells->set (i, m);
+      i--;
+   }
+
+   colSpanCells->set (i, n);
+}
+
+void Table::markCellExtremesDirty (int n)
+{
+   // When baseColExtremesValid is false, all cells are regarded anyway.
+   if (baseColExtremesValid && childDefined (n) &&
+       !children->get(n)->cell.extremesDirty) {
+      children->get(n)->cell.extremesDirty = true;
+      extremesDirtyCells->increase ();
+      extremesDirtyCells->setLast (n);
+   }
+}
+
 void Table::calcExtremesSpanMultiCols (int col, int cs,
                                        core::Extremes *cellExtremes,
                                        ExtrMod minExtrMod, ExtrMod maxExtrMod,
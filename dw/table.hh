@@ -174,6 +174,15 @@ namespace dw {
  *
  * </ol>
  *
+ * The values \f$e_{\hbox{base},i}\f$ are kept in
+ * dw::Table::baseColExtremes and updated incrementally: a cell, whose
+ * extremes have changed, is noted in dw::Table::markExtremesChange, and
+ * the next call of dw::Table::forceCalcColumnExtremes only regards these
+ * cells, as long as their extremes have grown. Only a column containing
+ * a cell which has become narrower is calculated again from all its
+ * cells. The second step is always done again, but only the (usually
+ * few) cells with colspan > 1 are involved.
+ *
  * Generally, if absolute widths are specified, they are, instead of the
  * results of dw::core::Widget::getExtremes, taken for the minimal and
  * maximal width of a cell (minus the box difference, i.e. the difference
@@ -270,7 +279,63 @@ namespace dw {
  *
  * <h5>Row Heights</h5>
  *
- * ...
+ * The height of a row is the maximum of the heights of its cells with
+ * rowspan = 1; cells with rowspan > 1 are regarded afterwards by
+ * dw::Table::apportionRowSpan.
+ *
+ * As long as the column widths have not changed and there are no cells
+ * with rowspan > 1, only the rows from dw::Table::heightsRefRow on are
+ * calculated again; this value is set in dw::Table::markSizeChange.
+ * Likewise, only the cells from dw::Table::allocRefRow on are allocated
+ * again, as long as the allocation of the table itself has not moved.
+ * This way, adding rows to a table does not touch the rows before.
+ *
+ * <h4>Fixed Layout</h4>
+ *
+ * When CSS 'table-layout' is 'fixed' (and 'width' is not 'auto'), the
+ * column widths do not depend on the contents of the cells. A column
+ * gets the width defined by dw::Table::addColumn (HTML \<col\>), or
+ * otherwise the width of the cell in the first row (cells with colspan
+ * > 1 divide their width equally). The rest of the total width \f$W\f$
+ * is divided equally between the columns without width, or, if there
+ * are none, between all columns.
+ *
+ * The extremes of the table are calculated from the absolute column
+ * widths only, so dw::Table::forceCalcColumnExtremes is not needed,
+ * and, together with the incremental row heights, a row can be laid
+ * out as soon as it is added.
+ *
+ * <h4>Virtual Rows</h4>
+ *
+ * Tables with fixed layout and at least dw::Table::minVirtualRows rows
+ * (see dw::Table::setMinVirtualRows; 0 disables this) do not keep the
+ * widgets of all rows. A row far away from the visible area (more than
+ * two viewport heights) is made \em virtual by
+ * dw::Table::virtualizeRow: each cell is replaced by a
+ * dw::Table::VirtualCell, which only holds the styles, the text (see
+ * dw::Textblock::getSimpleText) and the height of the cell. When the row
+ * comes near the visible area (one viewport height), dw::Table::buildRow
+ * creates the cells again.
+ *
+ * Only rows which can be built again exactly are made virtual: all
+ * cells must be instances of dw::SimpleTableCell with rowspan = 1 and
+ * static position, containing only text in one style. The first row
+ * (which defines the column widths) and the current row (which may still
+ * get contents) are never made virtual, nor are rows whose cells are
+ * referred to by dw::core::Layout (see
+ * dw::core::Layout::isWidgetInUse), or have not yet been laid out.
+ *
+ * The heights of virtual rows are kept, even when the column widths
+ * change; they are corrected when the row is built again.
+ *
+ * All this is done by dw::Table::updateVirtualRows, which is called
+ * from dw::Table::viewportChanged (see
+ * dw::core::Layout::addViewportWidget) when the visible area has moved
+ * far enough, or when rows have been added; never while drawing or
+ * during a resize, since the widget tree is changed.
+ *
+ * Iterators return virtual cells as text, so that searching and
+ * selecting still work; their allocation is that of the cell.
  *
  * <h3>Alternative Apportionment Algorithm</h3>
  *
@@ -325,6 +390,17 @@ namespace dw {
 class Table: public oof::OOFAwareWidget
 {
 private:
+   /**
+    * \brief What is left of a cell in a virtual row; see "Virtual Rows"
+    *    above.
+    */
+   struct VirtualCell
+   {
+      core::style::Style *style, *wordStyle;
+      char *text;
+      int height;
+   };
+
    struct Child
    {
       enum {
@@ -335,6 +411,16 @@ private:
          struct {
             core::Widget *widget;
             int colspanOrig, colspanEff, rowspan;
+
+            // The values last regarded by forceCalcColumnExtremes().
+            core::Extremes extremes;
+            bool widthSpecified, widthPercentage;
+            bool extremesKnown, extremesDirty;
+
+            // Set when the row has been made virtual once. When widget
+            // is NULL, the row is virtual, and this is all left of the
+            // cell.
+            VirtualCell *virt;
          } cell;
          struct {
             int startCol, startRow;  // where the cell starts
@@ -361,6 +447,13 @@ private:
    friend class TableIterator;
 
    static bool adjustTableMinWidth;
+   static int minVirtualRows;
+
+   enum RowState {
+      ROW_NORMAL,  // cannot be made virtual, or not yet examined
+      ROW_BUILT,   // can be made virtual, but has widgets; see builtRows
+      ROW_VIRTUAL
+   };
 
    bool limitTextWidth, rowClosed;
 
@@ -396,6 +489,56 @@ private:
    lout::misc::SimpleVector<bool> *colWidthPercentage;
    int numColWidthPercentage;
 
+   /**
+    * \brief The column extremes regarding only cells with colspan = 1,
+    *    i. e. \f$e_{\hbox{base},i}\f$ (see "Column Extremes").
+    *
+    * Together with baseColWidthSpecified and baseColWidthPercentage,
+    * this is updated incrementally by forceCalcColumnExtremes().
+    */
+   lout::misc::SimpleVector<core::Extremes> *baseColExtremes;
+   lout::misc::SimpleVector<bool> *baseColWidthSpecified;
+   lout::misc::SimpleVector<bool> *baseColWidthPercentage;
+
+   /**
+    * \brief When false, forceCalcColumnExtremes() has to regard all
+    *    cells, not only those in extremesDirtyCells.
+    */
+   bool baseColExtremesValid;
+
+   /**
+    * \brief Cells (as index in children) whose extremes may have
+    *    changed since the last call of forceCalcColumnExtremes().
+    */
+   lout::misc::SimpleVector<int> *extremesDirtyCells;
+
+   /**
+    * \brief All cells (as index in children) with colspan > 1, sorted
+    *    by column, then by row.
+    */
+   lout::misc::SimpleVector<int> *colSpanCells;
+
+   /**
+    * \brief The widths defined by addColumn(), or
+    *    dw::core::style::LENGTH_AUTO. Only used for fixed layout.
+    */
+   lout::misc::SimpleVector<core::style::Length> *definedColWidths;
+   int numDefinedCols;
+
+   /**
+    * \brief The heights of the rows before this one are up to date.
+    *
+    * See "Row Heights" above.
+    */
+   int heightsRefRow;
+
+   /**
+    * \brief The cells in the rows before this one have been allocated
+    *    and need not be allocated again (as long as the table has not
+    *    moved).
+    */
+   int allocRefRow;
+
    /**
     * \brief The widths of all columns.
     */
@@ -415,6 +558,35 @@ private:
 
    lout::misc::SimpleVector<core::style::Style*> *rowStyle;
 
+   /**
+    * \brief The state of each row regarding "Virtual Rows" (see above).
+    */
+   lout::misc::SimpleVector<RowState> *rowState;
+
+   /**
+    * \brief All rows with state ROW_BUILT.
+    */
+   lout::misc::SimpleVector<int> *builtRows;
+
+   /**
+    * \brief The rows before this one have been examined by
+    *    updateVirtualRows().
+    */
+   int virtRefRow;
+   int numVirtualRows;
+
+   /**
+    * \brief The scroll position relative to the first row, as regarded
+    *    by the last call of updateVirtualRows(), or INT_MIN.
+    */
+   int virtScrollY;
+
+   /**
+    * \brief Some rows could not yet be made virtual, since they had not
+    *    been laid out.
+    */
+   bool virtRetry;
+
    bool colWidthsUpToDateWidthColExtremes;
 
    enum ExtrMod { MIN, MIN_INTR, MIN_MIN, MAX_MIN, MAX, MAX_INTR, DATA };
@@ -428,7 +600,15 @@ private:
    inline bool childDefined(int n)
    {
       return n < children->size() && children->get(n) != NULL &&
-         children->get(n)->type != Child::SPAN_SPACE;
+         children->get(n)->type != Child::SPAN_SPACE &&
+         children->get(n)->cell.widget != NULL;
+   }
+
+   inline bool childVirtual(int n)
+   {
+      return n < children->size() && children->get(n) != NULL &&
+         children->get(n)->type == Child::CELL &&
+         children->get(n)->cell.widget == NULL;
    }
 
    int calcAvailWidthForDescendant (Widget *child);
@@ -441,6 +621,10 @@ private:
    void apportionRowSpan ();
 
    void forceCalcColumnExtremes ();
+   void markCellExtremesDirty (int n);
+   void addColSpanCell (int n);
+   void calcBaseColExtremes (int col, bool collectColSpanCells);
+   bool addToBaseColExtremes (int col, Child *child);
    void calcExtremesSpanMultiCols (int col, int cs,
                                    core::Extremes *cellExtremes,
                                    ExtrMod minExtrMod, ExtrMod maxExtrMod,
@@ -456,10 +640,33 @@ private:
    {
       if (value != cumHeight->get (row)) {
          redrawY = lout::misc::min ( redrawY, value );
+         allocRefRow = lout::misc::min (allocRefRow,
+                                        lout::misc::max (row - 1, 0));
          cumHeight->set (row, value);
       }
    }
 
+   inline bool isFixedLayout ()
+   {
+      return getStyle()->tableLayout == core::style::TABLE_LAYOUT_FIXED &&
+         getStyle()->width != core::style::LENGTH_AUTO;
+   }
+
+   int calcFixedColWidth (int col, int totalWidth);
+   void calcFixedColWidths (int totalWidth);
+
+   int findRowAtY (int y);
+   int getRowsOffsetY ();
+   void getCellAllocation (int n, core::Allocation *allocation);
+
+   bool isVirtualizing ();
+   bool updateVirtualRows ();
+   bool isVirtualizableRow (int row);
+   RowState virtualizeRow (int row);
+   void buildRow (int row);
+   void buildAllRows ();
+   static void freeVirtualCell (VirtualCell *virt);
+
 protected:
    void sizeRequestSimpl (core::Requisition *requisition);
    void getExtremesSimpl (core::Extremes *extremes);
@@ -470,12 +677,19 @@ protected:
 
    int getAvailWidthOfChild (Widget *child, bool forceValue);
 
+   void markSizeChange (int ref);
+   void markExtremesChange (int ref);
+
    void containerSizeChangedForChildren ();
    bool affectsSizeChangeContainerChild (Widget *child);
    bool usesAvailWidth ();
 
    bool isBlockLevel ();
 
+   void notifySetAsTopLevel ();
+   void notifySetParent ();
+   void viewportChanged ();
+
    void drawLevel (core::View *view, core::Rectangle *area, int level,
                    core::DrawingContext *context);
 
@@ -497,6 +711,9 @@ public:
    inline static bool getAdjustTableMinWidth ()
    { return Table::adjustTableMinWidth; }
 
+   inline static void setMinVirtualRows (int minVirtualRows)
+   { Table::minVirtualRows = minVirtualRows; }
+
    Table(bool limitTextWidth);
    ~Table();
 
@@ -507,6 +724,7 @@ public:
 
    void addCell (Widget *widget, int colspan, int rowspan);
    void addRow (core::style::Style *style);
+   void addColumn (core::style::Length width, int span);
    AlignedTableCell *getCellRef ();
 };
 
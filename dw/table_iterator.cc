@@ -63,7 +63,12 @@ void Table::TableIterator::getAllocation (int start, int end,
                                                   core::Allocation *allocation)
 {
    if (inFlow ()) {
-      /** \bug Not implemented. */
+      // Only virtual cells are returned as text, and get the allocation
+      // of the whole cell (see "Virtual Rows" in dw::Table).
+      Table *table = (Table*)getWidget();
+      if (table->childVirtual (getInFlowIndex ()))
+         table->getCellAllocation (getInFlowIndex (), allocation);
+      /** \bug Not implemented for widgets. */
    } else
       getAllocationOOF (start, end, allocation);
 }
@@ -78,10 +83,16 @@ void Table::TableIterator::getContentInFlow (int index,
 {
    Table *table = (Table*)getWidget();
 
-   if (table->children->get(index) != NULL &&
-       table->children->get(index)->type == Child::CELL) {
+   if (table->childDefined (index)) {
       content->type = core::Content::WIDGET_IN_FLOW;
       content->widget = table->children->get(index)->cell.widget;
+   } else if (table->childVirtual (index) &&
+              table->children->get(index)->cell.virt->text[0]) {
+      // See "Virtual Rows" in dw::Table.
+      const char *text = table->children->get(index)->cell.virt->text;
+      content->type = core::Content::TEXT;
+      content->text = text;
+      content->space = text[strlen (text) - 1] != ' ';
    } else
       content->type = core::Content::INVALID;       
 }
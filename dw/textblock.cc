@@ -303,6 +303,22 @@ Textblock::~Textblock ()
    DBG_OBJ_DELETE ();
 }
 
+/**
+ * \brief Approximate amount of memory taken by the words, lines,
+ *    paragraphs and anchors of this textblock.
+ *
+ * The texts of the words (allocated in dw::core::Layout::textZone),
+ * styles, and the children are not included.
+ */
+size_t Textblock::getMemoryUsage ()
+{
+   return sizeof (Textblock) +
+      words->size () * sizeof (Word) +
+      lines->size () * sizeof (Line) +
+      paragraphs->size () * sizeof (Paragraph) +
+      anchors->size () * sizeof (Anchor);
+}
+
 /**
  * The ascent of a textblock is the ascent of the first line, plus
  * padding/border/margin. This can be used to align the first lines
@@ -1770,6 +1786,11 @@ Textblock::Word *Textblock::addWord (int width, int ascent, int descent,
       DBG_OBJ_SET_NUM ("lineBreakWidth", lineBreakWidth);
    }
 
+   // The resize is only queued in flush(), but the text has already
+   // changed for iterators.
+   if (layout)
+      layout->contentChanged ();
+
    words->increase ();
    DBG_OBJ_SET_NUM ("words.size", words->size ());
    int wordNo = words->size () - 1;
@@ -2598,6 +2619,8 @@ void Textblock::addSpace (core::style::Style *style)
 
    int wordIndex = words->size () - 1;
    if (wordIndex >= 0) {
+      if (layout)
+         layout->contentChanged ();
       fillSpace (wordIndex, style);
       DBG_SET_WORD (wordIndex);
       accumulateWordData (wordIndex);
@@ -2978,6 +3001,53 @@ void Textblock::flush ()
    DBG_OBJ_LEAVE ();
 }
 
+/**
+ * \brief If this textblock contains only text in one style, append it
+ *    to \em text, so that it can be added again later.
+ *
+ * Words are separated by single spaces, and a trailing space means that
+ * addSpace() was called after the last word. \em wordStyle is set to
+ * the style of the words (or NULL, if there are none). Returns false
+ * (leaving \em text in an undefined state) if there are widgets, breaks,
+ * anchors, different styles, or anything else which would get lost.
+ */
+bool Textblock::getSimpleText (misc::StringBuffer *text,
+                               core::style::Style **wordStyle)
+{
+   *wordStyle = NULL;
+
+   if (anchors->size () > 0)
+      return false;
+
+   for (int i = 0; i < words->size (); i++) {
+      Word *word = words->getRef (i);
+
+      if (word->content.type != core::Content::TEXT ||
+          (*wordStyle != NULL && word->style != *wordStyle) ||
+          word->spaceStyle != word->style ||
+          word->content.text[0] == 0 ||
+          strchr (word->content.text, ' ') != NULL ||
+          // A soft hyphen has been removed (or the word has been
+          // hyphenated automatically).
+          ((word->flags & Word::DIV_CHAR_AT_EOL) &&
+           !(word->flags & Word::PERM_DIV_CHAR)))
+         return false;
+
+      *wordStyle = word->style;
+      text->append (word->content.text);
+
+      if (word->flags & Word::WORD_END) {
+         if (word->origSpace > 0)
+            text->append (" ");
+         else if (i < words->size () - 1)
+            // Break option, or two words without space.
+            return false;
+      } else if (word->origSpace > 0)
+         return false;
+   }
+
+   return true;
+}
 
 // next: Dw_page_find_word
 
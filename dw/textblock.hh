@@ -896,9 +896,14 @@ public:
    void addLinebreak (core::style::Style *style);
 
    void handOverBreak (core::style::Style *style);
+   bool getSimpleText (lout::misc::StringBuffer *text,
+                       core::style::Style **wordStyle);
    void changeLinkColor (int link, int newColor);
    void changeWordStyle (int from, int to, core::style::Style *style,
                          bool includeFirstSpace, bool includeLastSpace);
+
+   inline int getNumWords () { return words->size (); }
+   size_t getMemoryUsage ();
   
    void updateReference (int ref);
    void widgetRefSizeChanged (int externalIndex);
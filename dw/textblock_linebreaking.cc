@@ -25,6 +25,7 @@
 #include "../lout/msg.h"
 #include "../lout/debug.hh"
 #include "../lout/misc.hh"
+#include "../lout/trace.h"
 
 #include <stdio.h>
 #include <math.h>
@@ -1908,6 +1909,7 @@ void Textblock::calcTextOffset (int lineIndex, int totalWidth)
 void Textblock::rewrap ()
 {
    DBG_OBJ_ENTER0 ("construct.line", 0, "rewrap");
+   TRACE_SCOPE ("layout", "line breaking");
 
    if (wrapRefLines == -1)
       DBG_OBJ_MSG ("construct.line", 0, "does not have to be rewrapped");
@@ -267,6 +267,7 @@ void Widget::setParent (Widget *parent)
    } else
       stackingContextWidget = parent->stackingContextWidget;
 
+   checkViewportFixed ();
    notifySetParent();
 
    DBG_OBJ_LEAVE ();
@@ -318,6 +319,8 @@ void Widget::queueResize (int ref, bool extremesChanged, bool fast)
    Flags resizeFlag, extremesFlag, totalFlags;
 
    if (layout) {
+      layout->contentSerial++;
+
       // If RESIZE_QUEUED is set, this widget is already in the list.
       if (!resizeQueued ())
          layout->queueResizeList->put (this);
@@ -1159,6 +1162,8 @@ void Widget::sizeAllocate (Allocation *allocation)
       this->allocation = *allocation;
       unsetFlags (NEEDS_ALLOCATE);
       setFlags (WAS_ALLOCATED);
+      if (layout)
+         layout->allocationSerial++;
 
       resizeDrawImpl ();
 
@@ -1208,6 +1213,19 @@ void Widget::leaveNotify (EventCrossing *event)
  * call causes the widget to change its size, dw::core::Widget::queueResize
  * is called.
  */
+/**
+ * \brief Tell the layout when this widget is placed or painted relative to
+ *    the viewport; see dw::core::Layout::hasViewportFixedContent.
+ */
+void Widget::checkViewportFixed ()
+{
+   if (style && layout &&
+       (style->position == style::POSITION_FIXED ||
+        (style->backgroundImage &&
+         style->backgroundAttachment == style::BACKGROUND_ATTACHMENT_FIXED)))
+      layout->addViewportFixedContent ();
+}
+
 void Widget::setStyle (style::Style *style)
 {
    bool sizeChanged;
@@ -1239,6 +1257,7 @@ void Widget::setStyle (style::Style *style)
 
    if (layout != NULL) {
       layout->updateCursor ();
+      checkViewportFixed ();
    }
 
    // After Layout::addWidget() (as toplevel widget) or Widget::setParent()
@@ -1887,6 +1906,19 @@ void Widget::correctExtremesOfChild (Widget *child, Extremes *extremes,
    DBG_OBJ_LEAVE_VAL ("%d / %d", extremes->minWidth, extremes->maxWidth);
 }
 
+/**
+ * \brief This method is called when the visible part of the canvas has
+ *    changed (by scrolling, by a viewport size change, or after a resize),
+ *    for widgets registered by dw::core::Layout::addViewportWidget.
+ *
+ * Unlike in the drawing and the size request and allocation methods, the
+ * widget tree may be changed here, and dw::core::Widget::queueResize may
+ * be called.
+ */
+void Widget::viewportChanged ()
+{
+}
+
 /**
  * \brief This method is called after a widget has been set as the top of a
  *    widget tree.
@@ -353,6 +353,7 @@ protected:
 
    virtual void notifySetAsTopLevel();
    virtual void notifySetParent();
+   virtual void viewportChanged ();
 
    virtual bool buttonPressImpl (EventButton *event);
    virtual bool buttonReleaseImpl (EventButton *event);
@@ -418,6 +419,8 @@ private:
    void leaveSizeRequest () { if (layout) layout->sizeRequestCounter--; }
    bool sizeRequestEntered () { return layout && layout->sizeRequestCounter; }
 
+   void checkViewportFixed ();
+
    void enterGetExtremes () { if (layout) layout->getExtremesCounter++; }
    void leaveGetExtremes () { if (layout) layout->getExtremesCounter--; }
    bool getExtremesEntered () { return layout && layout->getExtremesCounter; }
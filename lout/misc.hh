@@ -626,7 +626,7 @@ public:
 class ZoneAllocator
 {
 private:
-   size_t poolSize, poolLimit, freeIdx;
+   size_t poolSize, poolLimit, freeIdx, bulkSize;
    SimpleVector <char*> *pools;
    SimpleVector <char*> *bulk;
 
@@ -635,6 +635,7 @@ public:
       this->poolSize = poolSize;
       this->poolLimit = poolSize / 4;
       this->freeIdx = poolSize;
+      this->bulkSize = 0;
       this->pools = new SimpleVector <char*> (1);
       this->bulk = new SimpleVector <char*> (1);
    };
@@ -649,6 +650,7 @@ public:
       void *ret;
 
       if (t > poolLimit) {
+         bulkSize += t;
          bulk->increase ();
          bulk->set (bulk->size () - 1, (char*) malloc (t));
          return bulk->get (bulk->size () - 1);
@@ -665,6 +667,17 @@ public:
       return ret;
    }
 
+   /**
+    * \brief Like zoneAlloc(), but the returned memory is suitably aligned
+    *    for any object (zoneAlloc() only packs bytes, e.g. for strings).
+    */
+   inline void * zoneAllocObject (size_t t) {
+      const size_t align = 2 * sizeof (void*);
+
+      freeIdx = min ((freeIdx + align - 1) & ~(align - 1), poolSize);
+      return zoneAlloc ((t + align - 1) & ~(align - 1));
+   }
+
    inline void zoneFree () {
       for (int i = 0; i < pools->size (); i++)
          free (pools->get (i));
@@ -672,9 +685,17 @@ public:
       for (int i = 0; i < bulk->size (); i++)
          free (bulk->get (i));
       bulk->setSize (0);
+      bulkSize = 0;
       freeIdx = poolSize;
    }
 
+   /**
+    * \brief Return the amount of memory currently allocated by the zone.
+    */
+   inline size_t size () {
+      return pools->size () * poolSize + bulkSize;
+   }
+
    inline const char *strndup (const char *str, size_t t) {
       char *new_str = (char *) zoneAlloc (t + 1);
       memcpy (new_str, str, t);
@@ -0,0 +1,206 @@
+/*
+ * Dillo Widget
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "trace.h"
+#include "misc.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+/*
+ * The ring buffer. Spans may be recorded by other threads (DNS, image
+ * decoding), so all access is protected by a mutex; this is only done
+ * while tracing is enabled.
+ */
+
+#define TRACE_NUM_EVENTS 65536
+#define TRACE_MAX_THREADS 32
+#define TRACE_MAX_CATS 16
+
+struct TraceEvent {
+   const char *cat, *name;
+   trace_time_t start, duration;
+   int tid;
+};
+
+struct TraceTotal {
+   const char *cat;
+   trace_time_t total;
+};
+
+int a_Trace_enabled = 0;
+
+static pthread_mutex_t traceMutex = PTHREAD_MUTEX_INITIALIZER;
+static TraceEvent *traceEvents = NULL;
+static int traceNext = 0, traceNum = 0;
+static struct timeval traceOrigin;
+static pthread_t traceThreads[TRACE_MAX_THREADS];
+static int traceNumThreads = 0;
+static TraceTotal traceTotals[TRACE_MAX_CATS];
+static int traceNumTotals = 0;
+
+/*
+ * Turn tracing on or off. Turning it on discards the recorded spans and
+ * the totals.
+ */
+void a_Trace_set_enabled(int enabled)
+{
+   pthread_mutex_lock (&traceMutex);
+   if (enabled && !a_Trace_enabled) {
+      if (traceEvents == NULL)
+         traceEvents = new TraceEvent[TRACE_NUM_EVENTS];
+      traceNext = traceNum = traceNumTotals = 0;
+      gettimeofday (&traceOrigin, NULL);
+   }
+   a_Trace_enabled = enabled ? 1 : 0;
+   pthread_mutex_unlock (&traceMutex);
+}
+
+int a_Trace_is_enabled(void)
+{
+   return a_Trace_enabled;
+}
+
+/*
+ * Return the current time for a span start; never 0 while tracing.
+ */
+trace_time_t a_Trace_now(void)
+{
+   struct timeval tv;
+
+   gettimeofday (&tv, NULL);
+   return (trace_time_t)(tv.tv_sec - traceOrigin.tv_sec) * 1000000 +
+      (tv.tv_usec - traceOrigin.tv_usec) + 1;
+}
+
+/*
+ * Small sequential thread ids, as preferred by the trace viewers.
+ * Called with the mutex locked.
+ */
+static int Trace_thread_id(void)
+{
+   pthread_t self = pthread_self ();
+
+   for (int i = 0; i < traceNumThreads; i++)
+      if (pthread_equal (traceThreads[i], self))
+         return i + 1;
+   if (traceNumThreads < TRACE_MAX_THREADS) {
+      traceThreads[traceNumThreads++] = self;
+      return traceNumThreads;
+   }
+   return 0;
+}
+
+/*
+ * Add a span to the total of its category. Called with the mutex locked.
+ */
+static void Trace_add_total(const char *cat, trace_time_t duration)
+{
+   int i;
+
+   for (i = 0; i < traceNumTotals; i++)
+      if (strcmp (traceTotals[i].cat, cat) == 0)
+         break;
+   if (i == traceNumTotals) {
+      if (traceNumTotals == TRACE_MAX_CATS)
+         return;
+      traceTotals[traceNumTotals].cat = cat;
+      traceTotals[traceNumTotals].total = 0;
+      traceNumTotals++;
+   }
+   traceTotals[i].total += duration;
+}
+
+/*
+ * Record a span from "start" (as returned by a_Trace_now()) until now.
+ * When the ring buffer is full, the oldest span is overwritten (but it
+ * still counts in the total of its category).
+ */
+void a_Trace_span(const char *cat, const char *name, trace_time_t start)
+{
+   trace_time_t end = a_Trace_now ();
+
+   pthread_mutex_lock (&traceMutex);
+   // Spans started before tracing was (re)enabled are dropped.
+   if (a_Trace_enabled && start > 0 && start <= end) {
+      TraceEvent *ev = &traceEvents[traceNext];
+      ev->cat = cat;
+      ev->name = name;
+      ev->start = start - 1;
+      ev->duration = end - start;
+      ev->tid = Trace_thread_id ();
+      traceNext = (traceNext + 1) % TRACE_NUM_EVENTS;
+      traceNum = lout::misc::min (traceNum + 1, TRACE_NUM_EVENTS);
+      Trace_add_total (cat, ev->duration);
+   }
+   pthread_mutex_unlock (&traceMutex);
+}
+
+/*
+ * Return the recorded spans as Chrome trace event JSON, oldest first.
+ * The string is allocated with malloc().
+ */
+char *a_Trace_dump(void)
+{
+   const size_t lineSize = 256;
+   char *json, *p;
+   int pid = (int) getpid ();
+
+   pthread_mutex_lock (&traceMutex);
+   p = json = (char*) malloc (traceNum * lineSize + 64);
+   p += sprintf (p, "{\"traceEvents\":[\n");
+   for (int i = 0; i < traceNum; i++) {
+      int n = (traceNext - traceNum + i + TRACE_NUM_EVENTS) % TRACE_NUM_EVENTS;
+      TraceEvent *ev = &traceEvents[n];
+      // Names and categories are literals, no quoting needed.
+      int len = snprintf (p, lineSize,
+                          "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                          "\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d}",
+                          i ? ",\n" : "", ev->name, ev->cat,
+                          (long long) ev->start, (long long) ev->duration,
+                          pid, ev->tid);
+      p += lout::misc::min (len, (int) lineSize - 1);
+   }
+   sprintf (p, "\n],\"displayTimeUnit\":\"ms\"}\n");
+   pthread_mutex_unlock (&traceMutex);
+
+   return json;
+}
+
+/*
+ * Return the time, in microseconds, spent in the spans of a category since
+ * tracing was turned on. Spans nested in others of the same category are
+ * counted twice.
+ */
+trace_time_t a_Trace_total(const char *cat)
+{
+   trace_time_t total = 0;
+
+   pthread_mutex_lock (&traceMutex);
+   for (int i = 0; i < traceNumTotals; i++)
+      if (strcmp (traceTotals[i].cat, cat) == 0)
+         total = traceTotals[i].total;
+   pthread_mutex_unlock (&traceMutex);
+
+   return total;
+}
@@ -0,0 +1,113 @@
+#ifndef __LOUT_TRACE_H__
+#define __LOUT_TRACE_H__
+
+/*
+ * Performance tracing.
+ *
+ * Spans (a name, a category, a start time and a duration) are recorded
+ * into a ring buffer, which can be dumped in the Chrome trace event
+ * format (load it in chrome://tracing or https://ui.perfetto.dev/).
+ *
+ * Tracing is compiled in only when DBG_TRACE is defined (see
+ * Makefile.options); otherwise all the macros below expand to nothing.
+ * When compiled in, it is still off until a_Trace_set_enabled() is
+ * called; then, an unused span costs one test of a global variable.
+ *
+ * This header can be used from C and C++. Names and categories must be
+ * string literals (only the pointers are stored).
+ *
+ * Besides, the time spent in the spans of each category is added up; see
+ * a_Trace_total().
+ *
+ * Usage, for a span ending in the same scope (C++ only):
+ *
+ *    TRACE_SCOPE ("layout", "resizeIdle");
+ *
+ * For a span started and ended in different places (e.g. callbacks), the
+ * start time is kept in a variable of the type trace_time_t:
+ *
+ *    TRACE_SET_START (conn->connectStart);
+ *    ...
+ *    TRACE_SPAN ("net", "connect", conn->connectStart);
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Microseconds since the start of the trace; 0 means "not traced" */
+typedef int64_t trace_time_t;
+
+void a_Trace_set_enabled(int enabled);
+int a_Trace_is_enabled(void);
+trace_time_t a_Trace_now(void);
+void a_Trace_span(const char *cat, const char *name, trace_time_t start);
+char *a_Trace_dump(void);
+trace_time_t a_Trace_total(const char *cat);
+
+extern int a_Trace_enabled;
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#ifdef DBG_TRACE
+
+#define TRACE_SET_START(var) \
+   ((var) = a_Trace_enabled ? a_Trace_now () : 0)
+#define TRACE_SPAN(cat, name, start) \
+   do { \
+      if (start) { \
+         a_Trace_span (cat, name, start); \
+         (start) = 0; \
+      } \
+   } while (0)
+
+#ifdef __cplusplus
+
+namespace lout {
+
+namespace trace {
+
+/**
+ * \brief Records a span from its construction to its destruction.
+ *
+ * Use TRACE_SCOPE().
+ */
+class Scope
+{
+private:
+   const char *cat, *name;
+   trace_time_t start;
+
+public:
+   inline Scope (const char *cat, const char *name)
+   {
+      this->cat = cat;
+      this->name = name;
+      start = a_Trace_enabled ? a_Trace_now () : 0;
+   }
+
+   inline ~Scope () { if (start) a_Trace_span (cat, name, start); }
+};
+
+} // namespace trace
+
+} // namespace lout
+
+#define TRACE_SCOPE(cat, name) \
+   ::lout::trace::Scope traceScope_ (cat, name)
+
+#endif /* __cplusplus */
+
+#else /* DBG_TRACE */
+
+#define TRACE_SET_START(var)          ((void) 0)
+#define TRACE_SPAN(cat, name, start)  ((void) (start))
+#define TRACE_SCOPE(cat, name)        ((void) 0)
+
+#endif /* DBG_TRACE */
+
+#endif /* __LOUT_TRACE_H__ */
@@ -27,6 +27,7 @@ void a_Dpi_ccc  (int Op, int Branch, int Dir, ChainLink *Info,
 
 char *a_Dpi_send_blocking_cmd(const char *server_name, const char *cmd);
 void a_Dpi_dillo_exit(void);
+void a_Dpi_prespawn(void);
 void a_Dpi_init(void);
 
 
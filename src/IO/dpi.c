@@ -26,6 +26,7 @@
 #include <errno.h>           /* for errno */
 #include <fcntl.h>
 #include <ctype.h>           /* isxdigit */
+#include <poll.h>
 
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -64,6 +65,7 @@ typedef struct {
    int TokIdx;
    int TokSize;
    int TokIsTag;
+   int TokIsFrame;
 
    ChainLink *InfoRecv;
    int Key;
@@ -77,6 +79,17 @@ static Klist_t *ValidConns = NULL; /* Active connections list. It holds
                                     * pointers to dpi_conn_t structures. */
 static char SharedKey[32];
 
+/* The control connection with dpid is kept open, and the socket paths of
+ * the dpi servers got through it are cached. dpid closes it when its
+ * plugin set changes (or when it exits), which invalidates the cache. */
+typedef struct {
+   char *name;
+   char *path;
+} dpi_sock_t;
+
+static int DpidFD = -1;
+static Dlist *ServerSocks = NULL;
+
 /*
  * Initialize local data
  */
@@ -131,10 +144,11 @@ static void Dpi_append_dbuf(dpi_conn_t *conn, DataBuf *dbuf)
 /*
  * Split the data stream into tokens.
  * Here, a token is either:
- *    a) a dpi tag
+ *    a) a dpi tag (as text, or as a frame)
  *    b) a raw data chunk
  *
- * Return Value: 0 upon a new token, -1 on not enough data.
+ * Return Value: 0 upon a new token, -1 on not enough data,
+ *               -2 if the stream is broken (the connection must be dropped).
  *
  * TODO: define an API and move this function into libDpip.a.
 */
@@ -161,14 +175,31 @@ static int Dpi_get_token(dpi_conn_t *conn)
 
    if (!conn->InTag) {
       /* search for start of tag */
-      while (conn->BufIdx < conn->Buf->len && buf[conn->BufIdx] != '<')
+      while (conn->BufIdx < conn->Buf->len && buf[conn->BufIdx] != '<' &&
+             buf[conn->BufIdx] != DPIP_FRAME_MARK)
          ++conn->BufIdx;
-      if (conn->BufIdx < conn->Buf->len) {
+      if (conn->BufIdx == conn->Buf->len) {
+         MSG_ERR("[Dpi_get_token] Can't find token start\n");
+      } else if (buf[conn->BufIdx] == DPIP_FRAME_MARK) {
+         /* framed tag: wait until it's all here */
+         int len, avail = conn->Buf->len - conn->BufIdx - DPIP_FRAME_HDR_SZ;
+
+         if (avail >= 0 && (len = a_Dpip_frame_len(buf + conn->BufIdx)) < 0) {
+            MSG_ERR("[Dpi_get_token] Bad frame length\n");
+            resp = -2;
+         } else if (avail >= 0 && avail >= len) {
+            conn->TokIsTag = 1;
+            conn->TokIsFrame = 1;
+            conn->TokIdx = conn->BufIdx + DPIP_FRAME_HDR_SZ;
+            conn->TokSize = len;
+            conn->BufIdx = conn->TokIdx + len;
+            resp = 0;
+         }
+         return resp;
+      } else {
          /* found */
          conn->InTag = 1;
          conn->TokIdx = conn->BufIdx;
-      } else {
-         MSG_ERR("[Dpi_get_token] Can't find token start\n");
       }
    }
 
@@ -182,6 +213,7 @@ static int Dpi_get_token(dpi_conn_t *conn)
       if (conn->BufIdx < conn->Buf->len) {
          /* found EOT */
          conn->TokIsTag = 1;
+         conn->TokIsFrame = 0;
          conn->TokSize = conn->BufIdx - conn->TokIdx + 1;
          ++conn->BufIdx;
          conn->InTag = 0;
@@ -192,6 +224,18 @@ static int Dpi_get_token(dpi_conn_t *conn)
    return resp;
 }
 
+/*
+ * Get an attribute's value from the current tag token
+ */
+static char *Dpi_get_attr(dpi_conn_t *conn, const char *attrname)
+{
+   char *Tok = conn->Buf->str + conn->TokIdx;
+
+   return (conn->TokIsFrame) ?
+      a_Dpip_frame_get_attr(Tok, (size_t)conn->TokSize, attrname) :
+      a_Dpip_get_attr_l(Tok, (size_t)conn->TokSize, attrname);
+}
+
 /*
  * Parse a dpi tag and take the appropriate actions
  */
@@ -209,39 +253,42 @@ static void Dpi_parse_token(dpi_conn_t *conn)
       return;
    }
 
-   tag = dStrndup(Tok, (size_t)conn->TokSize);
-   _MSG("Dpi_parse_token: {%s}\n", tag);
+   _MSG("Dpi_parse_token: {%.*s}\n", conn->TokSize, Tok);
+
+   if (!(cmd = Dpi_get_attr(conn, "cmd"))) {
+      MSG_ERR("[Dpi_parse_token] tag without cmd\n");
 
-   cmd = a_Dpip_get_attr_l(Tok, conn->TokSize, "cmd");
-   if (strcmp(cmd, "send_status_message") == 0) {
-      msg = a_Dpip_get_attr_l(Tok, conn->TokSize, "msg");
+   } else if (strcmp(cmd, "send_status_message") == 0) {
+      msg = Dpi_get_attr(conn, "msg");
       a_Chain_fcb(OpSend, conn->InfoRecv, msg, cmd);
       dFree(msg);
 
    } else if (strcmp(cmd, "chat") == 0) {
-      msg = a_Dpip_get_attr_l(Tok, conn->TokSize, "msg");
+      msg = Dpi_get_attr(conn, "msg");
       a_Chain_fcb(OpSend, conn->InfoRecv, msg, cmd);
       dFree(msg);
 
    } else if (strcmp(cmd, "dialog") == 0) {
       /* For now will send the dpip tag... */
+      tag = (conn->TokIsFrame) ?
+         a_Dpip_frame_to_tag(Tok, (size_t)conn->TokSize) :
+         dStrndup(Tok, (size_t)conn->TokSize);
       a_Chain_fcb(OpSend, conn->InfoRecv, tag, cmd);
+      dFree(tag);
 
    } else if (strcmp(cmd, "start_send_page") == 0) {
       conn->Send2EOF = 1;
-      urlstr = a_Dpip_get_attr_l(Tok, conn->TokSize, "url");
+      urlstr = Dpi_get_attr(conn, "url");
       a_Chain_fcb(OpSend, conn->InfoRecv, urlstr, cmd);
       dFree(urlstr);
-      /* TODO: a_Dpip_get_attr_l(Tok, conn->TokSize, "send_mode") */
+      /* TODO: Dpi_get_attr(conn, "send_mode") */
 
    } else if (strcmp(cmd, "reload_request") == 0) {
-      urlstr = a_Dpip_get_attr_l(Tok, conn->TokSize, "url");
+      urlstr = Dpi_get_attr(conn, "url");
       a_Chain_fcb(OpSend, conn->InfoRecv, urlstr, cmd);
       dFree(urlstr);
    }
    dFree(cmd);
-
-   dFree(tag);
 }
 
 
@@ -314,17 +361,31 @@ static char *Dpi_blocking_read(int fd)
 static void Dpi_process_dbuf(int Op, void *Data1, dpi_conn_t *conn)
 {
    DataBuf *dbuf = Data1;
-   int key = conn->Key;
+   ChainLink *Info;
+   int key = conn->Key, st = -1;
 
    /* Very useful for debugging: show the data stream as received. */
    /* fwrite(dbuf->Buf, dbuf->Size, 1, stdout); */
 
    if (Op == IORead) {
+      if (conn->Send2EOF && conn->BufIdx == conn->Buf->len) {
+         /* page data and nothing pending: pass it on without copying */
+         if (dbuf->Code == 0 && dbuf->Size > 0)
+            a_Chain_fcb(OpSend, conn->InfoRecv, dbuf, "send_page_2eof");
+         return;
+      }
       Dpi_append_dbuf(conn, dbuf);
       /* 'conn' has to be validated because Dpi_parse_token() MAY call abort */
-      while (Dpi_conn_valid(key) && Dpi_get_token(conn) != -1) {
+      while (Dpi_conn_valid(key) && (st = Dpi_get_token(conn)) == 0) {
          Dpi_parse_token(conn);
       }
+      if (st == -2 && Dpi_conn_valid(key)) {
+         /* nothing sensible can follow: drop the connection */
+         Info = conn->InfoRecv;
+         Dpi_conn_free(conn);
+         a_Chain_bfcb(OpAbort, Info, NULL, "Both");
+         dFree(Info);
+      }
 
    } else if (Op == IOClose) {
       /* unused */
@@ -417,18 +478,151 @@ static int Dpi_read_comm_keys(int *port)
 }
 
 /*
- * Return a socket file descriptor
+ * Return the path of dpid's Unix-domain service request socket,
+ * or NULL if dpid didn't save it (yet).
  */
-static int Dpi_make_socket_fd()
+static char *Dpi_srs_path(void)
 {
-   int fd, one = 1, ret = -1;
+   FILE *In;
+   char *fname, *sockdir = NULL, *srs = NULL;
 
-   if ((fd = socket(AF_INET, SOCK_STREAM, 0)) != -1) {
-      /* avoid delays when sending small pieces of data */
-      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
-      ret = fd;
+   fname = dStrconcat(dGethomedir(), "/." BINNAME "/dpi_socket_dir", NULL);
+   if ((In = fopen(fname, "r")) == NULL) {
+      MSG_ERR("[Dpi_srs_path] %s\n", dStrerror(errno));
+   } else if ((sockdir = dGetline(In)) == NULL) {
+      MSG_ERR("[Dpi_srs_path] empty file: %s\n", fname);
+   } else {
+      srs = dStrconcat(dStrstrip(sockdir), "/dpid-plus.srs", NULL);
    }
-   return ret;
+   if (In)
+      fclose(In);
+   dFree(sockdir);
+   dFree(fname);
+
+   return srs;
+}
+
+/*
+ * Connect a Unix-domain socket to 'path'.
+ * Return: the socket's FD, or -1 on error.
+ */
+static int Dpi_connect_path(const char *path)
+{
+   struct sockaddr_un sun;
+   int fd;
+
+   if (strlen(path) >= sizeof(sun.sun_path)) {
+      errno = ENAMETOOLONG;
+      return -1;
+   }
+   memset(&sun, 0, sizeof(sun));
+   sun.sun_family = AF_LOCAL;
+   strcpy(sun.sun_path, path);
+
+   if ((fd = socket(AF_LOCAL, SOCK_STREAM, 0)) == -1)
+      return -1;
+   if (connect(fd, (struct sockaddr *)&sun, D_SUN_LEN(&sun)) == -1) {
+      int err = errno;
+      dClose(fd);
+      errno = err;
+      return -1;
+   }
+   return fd;
+}
+
+/*
+ * Compare function for searching a cached socket path by server name.
+ */
+static int Dpi_sock_by_name_cmp(const void *v1, const void *v2)
+{
+   const dpi_sock_t *p = v1;
+   const char *name = v2;
+
+   return strcmp(p->name, name);
+}
+
+/*
+ * Forget the cached socket path of a dpi server (all of them when NULL).
+ */
+static void Dpi_sock_forget(const char *server_name)
+{
+   dpi_sock_t *p;
+   int i;
+
+   for (i = dList_length(ServerSocks) - 1; i >= 0; --i) {
+      p = dList_nth_data(ServerSocks, i);
+      if (!server_name || strcmp(p->name, server_name) == 0) {
+         dList_remove_fast(ServerSocks, p);
+         dFree(p->name);
+         dFree(p->path);
+         dFree(p);
+      }
+   }
+}
+
+/*
+ * Close the control connection with dpid, and flush the socket cache.
+ */
+static void Dpi_dpid_close(void)
+{
+   if (DpidFD != -1) {
+      dClose(DpidFD);
+      DpidFD = -1;
+   }
+   Dpi_sock_forget(NULL);
+}
+
+/*
+ * Check whether the control connection with dpid is still open.
+ * dpid doesn't send anything unasked, so if there's something to read,
+ * it's the EOF (or some garbage): either way the connection is closed.
+ * Return: 1 open, 0 closed.
+ */
+static int Dpi_dpid_alive(void)
+{
+   struct pollfd pfd;
+   int st;
+
+   if (DpidFD == -1)
+      return 0;
+
+   pfd.fd = DpidFD;
+   pfd.events = POLLIN;
+   while ((st = poll(&pfd, 1, 0)) == -1 && errno == EINTR) ;
+   if (st != 0) {
+      _MSG("Dpi_dpid_alive: dpid closed the control connection\n");
+      Dpi_dpid_close();
+      return 0;
+   }
+   return 1;
+}
+
+/*
+ * Open the control connection with dpid (this also reloads the shared
+ * key, as dpid may have been restarted).
+ * Return: 1 OK, -1 Error.
+ */
+static int Dpi_dpid_connect(void)
+{
+   int sock_fd, dpid_port;
+   char *srs;
+
+   Dpi_dpid_close();
+
+   /* Read the shared key from dpid's saved file */
+   if (Dpi_read_comm_keys(&dpid_port) == -1 || !(srs = Dpi_srs_path()))
+      return -1;
+
+   sock_fd = Dpi_connect_path(srs);
+   dFree(srs);
+   if (sock_fd == -1) {
+      MSG("Dpi_dpid_connect: %s\n", dStrerror(errno));
+      return -1;
+   }
+   /* don't let our children (e.g. downloads) hold it */
+   fcntl(sock_fd, F_SETFD, FD_CLOEXEC | fcntl(sock_fd, F_GETFD));
+   DpidFD = sock_fd;
+   return 1;
 }
 
 /*
@@ -437,25 +631,18 @@ static int Dpi_make_socket_fd()
  */
 static int Dpi_check_dpid_ids()
 {
-   struct sockaddr_in sin;
-   const socklen_t sin_sz = sizeof(sin);
-   int sock_fd, dpid_port, ret = -1;
+   int sock_fd, ret = -1;
+   char *srs;
 
    /* socket connection test */
-   memset(&sin, 0, sizeof(sin));
-   sin.sin_family = AF_INET;
-   sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-
-   if (Dpi_read_comm_keys(&dpid_port) != -1) {
-      sin.sin_port = htons(dpid_port);
-      if ((sock_fd = Dpi_make_socket_fd()) == -1) {
-         MSG("Dpi_check_dpid_ids: sock_fd=%d %s\n", sock_fd, dStrerror(errno));
-      } else if (connect(sock_fd, (struct sockaddr *)&sin, sin_sz) == -1) {
+   if ((srs = Dpi_srs_path()) != NULL) {
+      if ((sock_fd = Dpi_connect_path(srs)) == -1) {
          MSG("Dpi_check_dpid_ids: %s\n", dStrerror(errno));
       } else {
          dClose(sock_fd);
          ret = 1;
       }
+      dFree(srs);
    }
    return ret;
 }
@@ -506,6 +693,10 @@ static int Dpi_blocking_start_dpid(void)
    int cst, try = 0,
        n_tries = 12; /* 3 seconds */
 
+   /* an open control connection means dpid is running */
+   if (Dpi_dpid_alive())
+      return 0;
+
    /* test the dpid, and wait a bit for it to start if necessary */
    while ((cst = Dpi_check_dpid(n_tries)) == 1) {
       MSG("Dpi_blocking_start_dpid: try %d\n", ++try);
@@ -515,117 +706,127 @@ static int Dpi_blocking_start_dpid(void)
 }
 
 /*
- * Return the dpi server's port number, or -1 on error.
- * (A query is sent to dpid and then its answer parsed)
- * note: as the available servers and/or the dpi socket directory can
- *       change at any time, we'll ask each time. If someday we find
- *       that connecting each time significantly degrades performance,
- *       an optimized approach can be tried.
+ * Ask dpid to connect a socket to a dpi server, through the control
+ * connection. dpid passes the connected socket back, along with the
+ * server's socket path (saved in 'path', for next time).
+ * Return: the socket's FD, -1 if dpid can't connect to the server,
+ *         -2 on connection error.
  */
-static int Dpi_get_server_port(const char *server_name)
+static int Dpi_dpid_connect_server(const char *server_name, char **path)
 {
-   int sock_fd = -1, dpi_port = -1;
-   int dpid_port, ok = 0;
-   struct sockaddr_in sin;
-   char *cmd, *request, *rply = NULL, *port_str;
-   socklen_t sin_sz;
-
-   dReturn_val_if_fail (server_name != NULL, dpi_port);
-   _MSG("Dpi_get_server_port: server_name = [%s]\n", server_name);
-
-   /* Read dpid's port from saved file */
-   if (Dpi_read_comm_keys(&dpid_port) != -1) {
-      ok = 1;
-   }
-   if (ok) {
-      /* Connect a socket with dpid */
-      ok = 0;
-      sin_sz = sizeof(sin);
-      memset(&sin, 0, sizeof(sin));
-      sin.sin_family = AF_INET;
-      sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-      sin.sin_port = htons(dpid_port);
-      if ((sock_fd = Dpi_make_socket_fd()) == -1 ||
-          connect(sock_fd, (struct sockaddr *)&sin, sin_sz) == -1) {
-         MSG("Dpi_get_server_port: %s\n", dStrerror(errno));
-      } else {
-         ok = 1;
-      }
-   }
-   if (ok) {
-      /* ask dpid to check the dpi and send its port number back */
-      ok = 0;
-      request = a_Dpip_build_cmd("cmd=%s msg=%s", "check_server", server_name);
-      _MSG("[%s]\n", request);
-
-      if (Dpi_blocking_write(sock_fd, request, strlen(request)) == -1) {
-         MSG("Dpi_get_server_port: %s\n", dStrerror(errno));
-      } else {
-         ok = 1;
-      }
+   int fd = -1;
+   char *cmd, *request, buf[1024];
+   struct msghdr mh;
+   struct iovec iov;
+   union {
+      struct cmsghdr cm;
+      char buf[CMSG_SPACE(sizeof(int))];
+   } ctl;
+   struct cmsghdr *cmsg;
+   ssize_t st;
+
+   request = a_Dpip_build_cmd("cmd=%s msg=%s", "connect_server", server_name);
+   _MSG("[%s]\n", request);
+   if (Dpi_blocking_write(DpidFD, request, strlen(request)) == -1) {
+      MSG("Dpi_dpid_connect_server: %s\n", dStrerror(errno));
       dFree(request);
+      return -2;
    }
-   if (ok) {
-      /* Get the reply */
-      ok = 0;
-      if ((rply = Dpi_blocking_read(sock_fd)) == NULL) {
-         MSG("Dpi_get_server_port: can't read server port from dpid.\n");
-      } else {
-         ok = 1;
-      }
+   dFree(request);
+
+   /* Get the reply, and the socket with it */
+   iov.iov_base = buf;
+   iov.iov_len = sizeof(buf) - 1;
+   memset(&mh, 0, sizeof(mh));
+   mh.msg_iov = &iov;
+   mh.msg_iovlen = 1;
+   mh.msg_control = ctl.buf;
+   mh.msg_controllen = sizeof(ctl.buf);
+   while ((st = recvmsg(DpidFD, &mh, 0)) == -1 && errno == EINTR) ;
+   if (st <= 0) {
+      MSG("Dpi_dpid_connect_server: can't read reply from dpid.\n");
+      return -2;
    }
-   if (ok) {
-      /* Parse reply */
-      ok = 0;
-      cmd = a_Dpip_get_attr(rply, "cmd");
-      if (strcmp(cmd, "send_data") == 0) {
-         port_str = a_Dpip_get_attr(rply, "msg");
-         _MSG("Dpi_get_server_port: rply=%s\n", rply);
-         _MSG("Dpi_get_server_port: port_str=%s\n", port_str);
-         dpi_port = strtol(port_str, NULL, 10);
-         dFree(port_str);
-         ok = 1;
-      }
-      dFree(cmd);
+   buf[st] = 0;
+   for (cmsg = CMSG_FIRSTHDR(&mh); cmsg; cmsg = CMSG_NXTHDR(&mh, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+         memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
    }
-   dFree(rply);
-   dClose(sock_fd);
 
-   return ok ? dpi_port : -1;
-}
+   /* Parse reply */
+   cmd = a_Dpip_get_attr(buf, "cmd");
+   if (cmd && strcmp(cmd, "send_fd") == 0 && fd != -1) {
+      _MSG("Dpi_dpid_connect_server: rply=%s fd=%d\n", buf, fd);
+      *path = a_Dpip_get_attr(buf, "msg");
+   } else if (fd != -1) {
+      dClose(fd);
+      fd = -1;
+   }
+   dFree(cmd);
 
+   return fd;
+}
 
 /*
  * Connect a socket to a dpi server and return the socket's FD.
- * We have to ask 'dpid' (dpi daemon) for the port of the target dpi server.
- * Once we have it, then the proper file descriptor is returned (-1 on error).
+ * The server's socket path is taken from the cache, or else 'dpid'
+ * (dpi daemon) connects a socket for us and passes it back.
+ * Then the proper file descriptor is returned (-1 on error).
+ * note: as the available servers and/or the dpi socket directory can
+ *       change at any time, the cache is flushed whenever dpid closes
+ *       the control connection.
  */
-static int Dpi_connect_socket(const char *server_name)
+static int Dpi_connect_socket(const char *server_name, int frames)
 {
-   struct sockaddr_in sin;
-   int sock_fd, dpi_port, ret = -1;
-   char *cmd = NULL;
+   dpi_sock_t *p;
+   int sock_fd = -1, try, ret = -1;
+   char *cmd = NULL, *path = NULL;
+
+   dReturn_val_if_fail (server_name != NULL, -1);
+   _MSG("Dpi_connect_socket: server_name = [%s]\n", server_name);
+
+   if (Dpi_dpid_alive() &&
+       (p = dList_find_custom(ServerSocks, server_name,
+                              Dpi_sock_by_name_cmp))) {
+      _MSG("Dpi_connect_socket: cached %s=%s\n", server_name, p->path);
+      if ((sock_fd = Dpi_connect_path(p->path)) == -1) {
+         /* stale, ask dpid again */
+         Dpi_sock_forget(server_name);
+      }
+   }
 
-   /* Query dpid for the port number for this server */
-   if ((dpi_port = Dpi_get_server_port(server_name)) == -1) {
-      _MSG("Dpi_connect_socket: can't get port number for %s\n", server_name);
+   /* Retry once on a fresh connection, the old one may have been closed
+    * by dpid in the meantime */
+   for (try = 0; try < 2 && sock_fd == -1; ++try) {
+      if (!Dpi_dpid_alive() && Dpi_dpid_connect() == -1)
+         break;
+      if ((sock_fd = Dpi_dpid_connect_server(server_name, &path)) == -1) {
+         _MSG("Dpi_connect_socket: can't connect to %s\n", server_name);
+         return -1;
+      } else if (sock_fd == -2) {
+         Dpi_dpid_close();
+         sock_fd = -1;
+      }
+   }
+   if (sock_fd == -1) {
+      MSG_ERR("[Dpi_connect_socket] can't connect to dpid\n");
       return -1;
    }
-   _MSG("Dpi_connect_socket: server=%s port=%d\n", server_name, dpi_port);
 
-   /* connect with this server's socket */
-   memset(&sin, 0, sizeof(sin));
-   sin.sin_family = AF_INET;
-   sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-   sin.sin_port = htons(dpi_port);
-
-   if ((sock_fd = Dpi_make_socket_fd()) == -1) {
-      MSG_ERR("[Dpi_connect_socket] %s\n", dStrerror(errno));
-   } else if (connect(sock_fd, (void*)&sin, sizeof(sin)) == -1) {
-      MSG_ERR("[Dpi_connect_socket] errno:%d %s\n", errno, dStrerror(errno));
+   if (path) {
+      if (!ServerSocks)
+         ServerSocks = dList_new(8);
+      p = dNew(dpi_sock_t, 1);
+      p->name = dStrdup(server_name);
+      p->path = path;
+      dList_append(ServerSocks, p);
+   }
 
-   /* send authentication Key (the server closes sock_fd on auth error) */
-   } else if (!(cmd = a_Dpip_build_cmd("cmd=%s msg=%s", "auth", SharedKey))) {
+   /* send authentication Key (the server closes sock_fd on auth error),
+    * and offer to read framed tags (old servers ignore it) */
+   if (!(cmd = (frames) ?
+         a_Dpip_build_cmd("cmd=%s msg=%s frames=%s", "auth", SharedKey, "1") :
+         a_Dpip_build_cmd("cmd=%s msg=%s", "auth", SharedKey))) {
       MSG_ERR("[Dpi_connect_socket] Can't make auth message.\n");
    } else if (Dpi_blocking_write(sock_fd, cmd, strlen(cmd)) == -1) {
       MSG_ERR("[Dpi_connect_socket] Can't send auth message.\n");
@@ -633,7 +834,7 @@ static int Dpi_connect_socket(const char *server_name)
       ret = sock_fd;
    }
    dFree(cmd);
-   if (sock_fd != -1 && ret == -1) /* can't send cmd? */
+   if (ret == -1) /* can't send cmd? */
       dClose(sock_fd);
 
    return ret;
@@ -656,7 +857,9 @@ void a_Dpi_ccc(int Op, int Branch, int Dir, ChainLink *Info,
          switch (Op) {
          case OpStart:
             if ((st = Dpi_blocking_start_dpid()) == 0) {
-               if ((SockFD = Dpi_connect_socket(Data1)) != -1) {
+               /* (the "http" hack below reads everything as page data) */
+               SockFD = Dpi_connect_socket(Data1, strcmp(Data1, "http"));
+               if (SockFD != -1) {
                   int *fd = dNew(int, 1);
                   *fd = SockFD;
                   Info->LocalKey = fd;
@@ -753,6 +956,28 @@ void a_Dpi_ccc(int Op, int Branch, int Dir, ChainLink *Info,
    }
 }
 
+/*
+ * Let dpid start the servers it keeps ready (dpi_prespawn in dpidrc).
+ * Called once the first page is up. It's done only once, and only if dpid
+ * is already running: this must not delay anything.
+ */
+void a_Dpi_prespawn(void)
+{
+   static int done = 0;
+   char *cmd;
+
+   if (done)
+      return;
+   done = 1;
+
+   if (!Dpi_dpid_alive() && Dpi_dpid_connect() == -1)
+      return;
+   cmd = a_Dpip_build_cmd("cmd=%s", "prespawn");
+   if (Dpi_blocking_write(DpidFD, cmd, strlen(cmd)) == -1)
+      Dpi_dpid_close();
+   dFree(cmd);
+}
+
 /*! Let dpid know dillo is no longer running.
  * Note: currently disabled. It may serve to let the cookies dpi know
  * when to expire session cookies.
@@ -776,7 +1001,8 @@ char *a_Dpi_send_blocking_cmd(const char *server_name, const char *cmd)
       return ret;
    }
 
-   if ((sock_fd = Dpi_connect_socket(server_name)) == -1) {
+   /* the answer is read as a text tag */
+   if ((sock_fd = Dpi_connect_socket(server_name, 0)) == -1) {
       MSG_ERR("[a_Dpi_send_blocking_cmd] Can't connect to server.\n");
    } else if (Dpi_blocking_write(sock_fd, cmd, strlen(cmd)) == -1) {
       MSG_ERR("[a_Dpi_send_blocking_cmd] Can't send message.\n");
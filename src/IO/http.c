@@ -40,6 +40,7 @@
 #include "../misc.h"
 
 #include "../uicmd.hh"
+#include "../../lout/trace.h"
 
 /* Used to send a message to the bw's status bar */
 #define MSG_BW(web, root, ...)                                        \
@@ -68,6 +69,8 @@ typedef struct {
    char *connected_to;     /* Used for per-server connection limit */
    uint_t connect_port;
    Dstr *https_proxy_reply;
+   trace_time_t connect_start;  /* For tracing connect() and the time */
+   trace_time_t query_start;    /*  to the first byte of the reply */
 } SocketData_t;
 
 /* Data structures and functions to queue sockets that need to be
@@ -494,6 +497,7 @@ static void Http_send_query(SocketData_t *S)
                      S->flags & HTTP_SOCKET_USE_PROXY ? " through proxy" : "");
 
    /* send query */
+   TRACE_SET_START(S->query_start);
    a_Chain_bcb(OpSend, S->Info, dbuf, NULL);
    dFree(dbuf);
    dStr_free(query, 1);
@@ -553,10 +557,12 @@ static void Http_connect_socket_cb(int fd, void *data)
          MSG("Http_connect_socket() will try another IP address.\n");
          S->addr_list_idx++;
          Http_connect_socket(S->Info);
-      } else if (S->flags & HTTP_SOCKET_TLS) {
-         Http_connect_tls(S->Info);
       } else {
-         a_Http_connect_done(S->SockFD, TRUE);
+         TRACE_SPAN("net", "connect", S->connect_start);
+         if (S->flags & HTTP_SOCKET_TLS)
+            Http_connect_tls(S->Info);
+         else
+            a_Http_connect_done(S->SockFD, TRUE);
       }
    }
 }
@@ -628,8 +634,10 @@ static void Http_connect_socket(ChainLink *Info)
       } /* switch */
       MSG_BW(S->web, 1, "Contacting host...");
 
+      TRACE_SET_START(S->connect_start);
       if (connect(S->SockFD, (struct sockaddr *)&name, socket_len) == 0) {
          /* probably never succeeds immediately on any system */
+         TRACE_SPAN("net", "connect", S->connect_start);
          if (S->flags & HTTP_SOCKET_TLS) {
             Http_connect_tls(Info);
             break;
@@ -963,6 +971,7 @@ void a_Http_ccc(int Op, int Branch, int Dir, ChainLink *Info,
                }
             } else {
                /* Data1 = dbuf */
+               TRACE_SPAN("net", "first byte", sd->query_start);
                a_Chain_fcb(OpSend, Info, Data1, "send_page_2eof");
             }
             break;
@@ -44,6 +44,7 @@ void a_Tls_init()
 #include "iowatch.hh"
 #include "tls.h"
 #include "Url.h"
+#include "../../lout/trace.h"
 
 #include <openssl/err.h>
 #include <openssl/rand.h>
@@ -80,6 +81,7 @@ typedef struct {
    SSL *ssl;
    bool_t handshaked;
    bool_t connecting;
+   trace_time_t handshake_start;
 } Conn_t;
 
 /* List of active TLS connections */
@@ -167,6 +169,7 @@ static Conn_t *Tls_conn_new(int fd, const DilloUrl *url,
    conn->ssl = ssl;
    conn->handshaked = FALSE;
    conn->connecting = TRUE;
+   TRACE_SET_START(conn->handshake_start);
    return conn;
 }
 
@@ -796,6 +799,7 @@ static void Tls_handshake(int fd, int connkey)
          failed = FALSE;
       } else if (ret == 1) {
 	 conn->handshaked = TRUE;
+         TRACE_SPAN("net", "TLS handshake", conn->handshake_start);
          Server_t *srv = dList_find_sorted(servers, conn->url,
                                            Tls_servers_by_url_cmp);
          if (srv->cert_status == CERT_STATUS_RECEIVING) {
@@ -17,6 +17,7 @@
 #include "list.h"
 #include "capi.h"
 #include "uicmd.hh"
+#include "html.hh"
 
 
 /*
@@ -72,6 +73,10 @@ BrowserWindow *a_Bw_new()
    bw->num_page_bugs = 0;
    bw->page_bugs = dStr_new("");
 
+   bw->hibernated = 0;
+   bw->last_active = time(NULL);
+   bw->form_state = NULL;
+
    /* now that the bw is made, let's customize it.. */
    //Interface_browser_window_customize(bw);
 
@@ -105,6 +110,7 @@ void a_Bw_free(BrowserWindow *bw)
          a_Url_free(bw->meta_refresh_url);
 
          dStr_free(bw->page_bugs, 1);
+         a_Html_form_state_free(bw->form_state);
          dFree(bw);
          break;
       }
@@ -1,6 +1,8 @@
 #ifndef __BW_H__
 #define __BW_H__
 
+#include <time.h>
+
 #include "url.h"     /* for DilloUrl */
 
 /*
@@ -57,6 +59,14 @@ typedef struct {
    /* HTML-bugs detected at parse time */
    int num_page_bugs;
    Dstr *page_bugs;
+
+   /* Tab hibernation (see a_Nav_hibernate): the page's widgets have been
+    * dropped and are rebuilt from the cache when the tab is shown */
+   int hibernated;
+   /* When the tab was last shown (or created) */
+   time_t last_active;
+   /* Form contents of the hibernated page (opaque, see html.hh) */
+   void *form_state;
 } BrowserWindow;
 
 
@@ -14,10 +14,14 @@
  */
 
 #include <sys/types.h>
+#include <sys/stat.h>
 
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
 
 #include "msg.h"
 #include "IO/Url.h"
@@ -30,6 +34,7 @@
 #include "misc.h"
 #include "capi.h"
 #include "decode.h"
+#include "decodepool.h"
 #include "auth.h"
 #include "domain.h"
 #include "timeout.hh"
@@ -87,7 +92,6 @@ static uint_t DelayedQueueIdleId = 0;
 static CacheEntry_t *Cache_process_queue(CacheEntry_t *entry);
 static void Cache_delayed_process_queue(CacheEntry_t *entry);
 static void Cache_auth_entry(CacheEntry_t *entry, BrowserWindow *bw);
-static void Cache_entry_inject(const DilloUrl *Url, Dstr *data_ds);
 
 /*
  * Determine if two cache entries are equal (used by CachedURLs)
@@ -123,7 +127,7 @@ void a_Cache_init(void)
    {
       DilloUrl *url = a_Url_new("about:splash", NULL);
       Dstr *ds = dStr_new(AboutSplash);
-      Cache_entry_inject(url, ds);
+      a_Cache_entry_inject(url, ds);
       dStr_free(ds, 1);
       a_Url_free(url);
    }
@@ -262,9 +266,9 @@ static CacheEntry_t *Cache_entry_add(const DilloUrl *Url)
 
 /*
  * Inject full page content directly into the cache.
- * Used for "about:splash". May be used for "about:cache" too.
+ * Used for "about:splash", "about:tabs" and "about:memory".
  */
-static void Cache_entry_inject(const DilloUrl *Url, Dstr *data_ds)
+void a_Cache_entry_inject(const DilloUrl *Url, Dstr *data_ds)
 {
    CacheEntry_t *entry;
 
@@ -273,12 +277,22 @@ static void Cache_entry_inject(const DilloUrl *Url, Dstr *data_ds)
    entry->Flags = CA_GotHeader + CA_GotLength + CA_InternalUrl;
    if (data_ds->len)
       entry->Flags &= ~CA_IsEmpty;
+   a_Decodepool_buf_release(entry->Data->str);
    dStr_truncate(entry->Data, 0);
    dStr_append_l(entry->Data, data_ds->str, data_ds->len);
    dStr_fit(entry->Data);
    entry->ExpectedSize = entry->TransferSize = entry->Data->len;
 }
 
+/*
+ * Free the raw data of an entry.
+ */
+static void Cache_data_free(CacheEntry_t *entry)
+{
+   a_Decodepool_buf_release(entry->Data->str);
+   dStr_free(entry->Data, 1);
+}
+
 /*
  *  Free Authentication fields.
  */
@@ -304,7 +318,7 @@ static void Cache_entry_free(CacheEntry_t *entry)
    dStr_free(entry->Header, TRUE);
    a_Url_free((DilloUrl *)entry->Location);
    Cache_auth_free(entry->Auth);
-   dStr_free(entry->Data, 1);
+   Cache_data_free(entry);
    dStr_free(entry->UTF8Data, 1);
    if (entry->CharsetDecoder)
       a_Decode_free(entry->CharsetDecoder);
@@ -357,6 +371,76 @@ void a_Cache_entry_remove_by_url(DilloUrl *url)
    Cache_entry_remove(NULL, url);
 }
 
+/*
+ * Read a local file into a Dstr sized for it.
+ * The file is copied rather than mapped: a mapped file that is truncated
+ * on disk (e.g. a log rotated in place) would raise SIGBUS when read.
+ * If it changes while being read, it is just read up to its end.
+ */
+static void Cache_read_file(int fd, Dstr *ds)
+{
+   char buf[8*1024];
+   ssize_t st;
+
+   do {
+      if (ds->len + 1 < ds->sz) {
+         if ((st = read(fd, ds->str + ds->len, ds->sz - 1 - ds->len)) > 0) {
+            ds->len += st;
+            ds->str[ds->len] = 0;
+         }
+      } else if ((st = read(fd, buf, sizeof(buf))) > 0) {
+         /* the file has grown */
+         dStr_append_l(ds, buf, st);
+      }
+   } while (st > 0 || (st < 0 && errno == EINTR));
+}
+
+/*
+ * Put a local file directly into the cache, as the file dpi would send it.
+ * Return: 0 on success, -1 if the file has to go through the file dpi
+ *         (not a regular file, gzipped, huge, or unreadable).
+ */
+int a_Cache_entry_inject_file(const DilloUrl *Url, const char *filename)
+{
+   CacheEntry_t *entry;
+   struct stat sb;
+   const char *ct;
+   size_t len;
+   int fd;
+
+   /* the dpi knows how to label compressed files */
+   len = strlen(filename);
+   if (len > 3 && !dStrAsciiCasecmp(filename + len - 3, ".gz"))
+      return -1;
+
+   if ((fd = open(filename, O_RDONLY)) < 0)
+      return -1;
+   if (fstat(fd, &sb) < 0 || !S_ISREG(sb.st_mode) ||
+       sb.st_size > HUGE_FILESIZE) {
+      close(fd);
+      return -1;
+   }
+
+   Cache_entry_remove(NULL, (DilloUrl *)Url);
+   entry = Cache_entry_add(Url);
+   dStr_free(entry->Data, 1);
+   entry->Data = dStr_sized_new(sb.st_size);
+   Cache_read_file(fd, entry->Data);
+   dStr_fit(entry->Data);
+   close(fd);
+
+   entry->Flags |= CA_GotHeader | CA_GotLength;
+   entry->Flags &= ~CA_InProgress;
+   if (entry->Data->len)
+      entry->Flags &= ~CA_IsEmpty;
+   entry->ExpectedSize = entry->TransferSize = entry->Data->len;
+   if ((ct = a_Misc_get_content_type_from_ext(filename)))
+      a_Cache_set_content_type(entry->Url, ct, "http");
+   _MSG("a_Cache_entry_inject_file: %s (%d bytes)\n", filename,
+        entry->Data->len);
+   return 0;
+}
+
 /* Misc. operations ------------------------------------------------------- */
 
 /*
@@ -474,6 +558,42 @@ const char *a_Cache_get_content_type(const DilloUrl *url)
    return (entry) ? Cache_current_content_type(entry) : NULL;
 }
 
+/*
+ * Get the amount of memory taken by the data of the entry found by URL
+ * (zero if not cached).
+ */
+uint_t a_Cache_get_data_size(const DilloUrl *url)
+{
+   CacheEntry_t *entry = Cache_entry_search_with_redirect(url);
+   uint_t size = 0;
+
+   if (entry) {
+      size = entry->Data->len;
+      if (entry->UTF8Data)
+         size += entry->UTF8Data->len;
+   }
+   return size;
+}
+
+/*
+ * Get the number of cache entries and the memory taken by their data
+ * (raw and charset-translated), for "about:memory".
+ */
+void a_Cache_memory_usage(int *num_entries, uint_t *data_size,
+                          uint_t *utf8_size)
+{
+   CacheEntry_t *entry;
+   int i;
+
+   *data_size = *utf8_size = 0;
+   for (i = 0; (entry = dList_nth_data(CachedURLs, i)); ++i) {
+      *data_size += entry->Data->len;
+      if (entry->UTF8Data)
+         *utf8_size += entry->UTF8Data->len;
+   }
+   *num_entries = i;
+}
+
 /*
  * Get pointer to entry's data.
  */
@@ -538,6 +658,45 @@ const char *a_Cache_set_content_type(const DilloUrl *url, const char *ctype,
    return curr;
 }
 
+/*
+ * Whether the entry's current content type is HTML.
+ */
+static bool_t Cache_is_html(CacheEntry_t *entry)
+{
+   const char *curr = Cache_current_content_type(entry);
+
+   return (curr && !dStrnAsciiCasecmp(curr, "text/html", 9));
+}
+
+/*
+ * Look for a META charset in the first bytes of an HTML entry, and set the
+ * charset decoder before any data is handed to the parser.
+ * This avoids a META-triggered repush, which means a second parse and a
+ * second charset conversion of the whole page.
+ */
+static void Cache_prescan_charset(CacheEntry_t *entry)
+{
+   char *charset, *ctype;
+
+   if (entry->TypeMeta || !Cache_is_html(entry))
+      return;
+
+   if ((charset = a_Misc_prescan_charset(entry->Data->str,
+                                         entry->Data->len))) {
+      _MSG("Cache: prescan found charset '%s'\n", charset);
+      ctype = dStrconcat("text/html; charset=", charset, NULL);
+      a_Cache_set_content_type(entry->Url, ctype, "meta");
+      if (entry->CharsetDecoder && !entry->UTF8Data &&
+          entry->DataRefcount > 0) {
+         entry->UTF8Data = a_Decode_process(entry->CharsetDecoder,
+                                            entry->Data->str,
+                                            entry->Data->len);
+      }
+      dFree(ctype);
+      dFree(charset);
+   }
+}
+
 /*
  * Get the pointer to the URL document, and its size, from the cache entry.
  * Return: 1 cached, 0 not cached.
@@ -794,7 +953,7 @@ static void Cache_parse_header(CacheEntry_t *entry)
       /* Avoid some reallocs. With MAX_INIT_BUF we avoid a SEGFAULT
        * with huge files (e.g. iso files).
        * Note: the buffer grows automatically. */
-      dStr_free(entry->Data, 1);
+      Cache_data_free(entry);
       entry->Data = dStr_sized_new(MIN(entry->ExpectedSize, MAX_INIT_BUF));
    }
 
@@ -870,6 +1029,7 @@ static void Cache_finish_msg(CacheEntry_t *entry)
       a_Decode_free(entry->ContentDecoder);
       entry->ContentDecoder = NULL;
    }
+   a_Decodepool_buf_release(entry->Data->str);
    dStr_fit(entry->Data);                /* fit buffer size! */
 
    if ((entry = Cache_process_queue(entry))) {
@@ -931,6 +1091,10 @@ bool_t a_Cache_process_dbuf(int Op, const char *buf, size_t buf_size,
             str = dstr2->str;
             len = dstr2->len;
          }
+         /* Image decoders may be reading the buffer; only a growing one
+          * moves (see a_Decodepool_buf_release) */
+         if (entry->Data->len + len >= entry->Data->sz)
+            a_Decodepool_buf_release(entry->Data->str);
          dStr_append_l(entry->Data, str, len);
          if (entry->CharsetDecoder && entry->UTF8Data) {
             dstr3 = a_Decode_process(entry->CharsetDecoder, str, len);
@@ -1200,6 +1364,13 @@ static CacheEntry_t *Cache_process_queue(CacheEntry_t *entry)
       } else
          return entry;  /* i.e., wait for more data */
    }
+   if (!(entry->Flags & CA_Prescanned)) {
+      if ((entry->Flags & CA_InProgress) &&
+          entry->Data->len < PRESCAN_SIZE && Cache_is_html(entry))
+         return entry;  /* wait for more data */
+      Cache_prescan_charset(entry);
+      entry->Flags |= CA_Prescanned;
+   }
 
    Busy = TRUE;
    for (i = 0; (Client = dList_nth_data(ClientQueue, i)); ++i) {
@@ -1310,6 +1481,8 @@ static CacheEntry_t *Cache_process_queue(CacheEntry_t *entry)
                                              "read not complete.");
                }
                a_UIcmd_set_page_prog(Client_bw, 0, 0);
+               /* the first page is up, dpid may start its servers now */
+               a_Dpi_prespawn();
             }
             Cache_client_dequeue(Client);
             --i; /* Keep the index value in the next iteration */
@@ -1385,6 +1558,18 @@ static void Cache_delayed_process_queue(CacheEntry_t *entry)
    }
 }
 
+/*
+ * Feed the clients of this URL again from the main cycle
+ * (used when data arrives from elsewhere, e.g. the image decode pool).
+ */
+void a_Cache_update_clients(const DilloUrl *Url)
+{
+   CacheEntry_t *entry;
+
+   if ((entry = Cache_entry_search(Url)))
+      Cache_delayed_process_queue(entry);
+}
+
 /*
  * Last Client for this entry?
  * Return: Client if true, NULL otherwise
@@ -1431,7 +1616,8 @@ void a_Cache_stop_client(int Key)
       Cache_client_dequeue(Client);
 
    } else {
-      _MSG("WARNING: Cache_stop_client, nonexistent client\n");
+      /* It may be an image client waiting for its decoder to finish */
+      a_Dicache_stop_client(Key);
    }
 }
 
@@ -34,6 +34,7 @@ extern "C" {
 #define CA_HugeFile     0x1000  /* URL content is too big */
 #define CA_IsEmpty      0x2000  /* True until a byte of content arrives */
 #define CA_KeepAlive    0x4000
+#define CA_Prescanned   0x8000  /* HTML charset prescan has been done */
 
 typedef struct CacheClient CacheClient_t;
 
@@ -64,6 +65,9 @@ int a_Cache_open_url(void *Web, CA_Callback_t Call, void *CbData);
 int a_Cache_get_buf(const DilloUrl *Url, char **PBuf, int *BufSize);
 void a_Cache_unref_buf(const DilloUrl *Url);
 const char *a_Cache_get_content_type(const DilloUrl *url);
+uint_t a_Cache_get_data_size(const DilloUrl *url);
+void a_Cache_memory_usage(int *num_entries, uint_t *data_size,
+                          uint_t *utf8_size);
 const char *a_Cache_set_content_type(const DilloUrl *url, const char *ctype,
                                      const char *from);
 uint_t a_Cache_get_flags(const DilloUrl *url);
@@ -72,7 +76,10 @@ bool_t a_Cache_process_dbuf(int Op, const char *buf, size_t buf_size,
                           const DilloUrl *Url);
 int a_Cache_download_enabled(const DilloUrl *url);
 void a_Cache_entry_remove_by_url(DilloUrl *url);
+void a_Cache_entry_inject(const DilloUrl *Url, Dstr *data_ds);
+int a_Cache_entry_inject_file(const DilloUrl *Url, const char *filename);
 void a_Cache_freeall(void);
+void a_Cache_update_clients(const DilloUrl *Url);
 CacheClient_t *a_Cache_client_get_if_unique(int Key);
 void a_Cache_stop_client(int Key);
 
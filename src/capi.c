@@ -16,6 +16,7 @@
  */
 
 #include <string.h>
+#include <stdlib.h>     /* for free */
 #include <errno.h>
 
 #include "config.h"
@@ -29,6 +30,7 @@
 #include "dpiapi.h"
 #include "uicmd.hh"
 #include "domain.h"
+#include "lout/trace.h"
 #include "../dpip/dpip.h"
 
 /* for testing dpi chat */
@@ -313,6 +315,26 @@ static char *Capi_dpi_build_cmd(DilloWeb *web, char *server)
    return cmd;
 }
 
+/*
+ * Put a plain local file straight into the cache, instead of asking the
+ * file dpi for it. Directories and other special cases are left to the dpi.
+ * Return: 1 if the file is now cached, 0 otherwise.
+ */
+static int Capi_file_inject(DilloUrl *url)
+{
+   const char *host = URL_HOST(url);
+   char *path;
+   int ret = 0;
+
+   if ((!*host || !dStrAsciiCasecmp(host, "localhost")) &&
+       !URL_QUERY_(url) && URL_PATH(url)[0] == '/') {
+      path = a_Url_decode_hex_str(URL_PATH(url));
+      ret = (a_Cache_entry_inject_file(url, path) == 0);
+      dFree(path);
+   }
+   return ret;
+}
+
 /*
  * Send the requested URL's source to the "view source" dpi
  */
@@ -379,6 +401,34 @@ static bool_t Capi_request_permitted(DilloWeb *web)
    return permit;
 }
 
+/*
+ * Build the about:trace page: the recorded spans in the Chrome trace event
+ * format. "about:trace?start" and "about:trace?stop" toggle recording.
+ */
+static Dstr *Capi_trace_page(const DilloUrl *url)
+{
+   Dstr *ds = dStr_new("");
+   char *json;
+
+   if (!dStrAsciiCasecmp(URL_QUERY(url), "start")) {
+      a_Trace_set_enabled(1);
+#ifdef DBG_TRACE
+      dStr_append(ds, "Tracing started.\n");
+#else
+      dStr_append(ds, "Tracing is not compiled in (see DBG_TRACE in "
+                      "Makefile.options).\n");
+#endif
+   } else if (!dStrAsciiCasecmp(URL_QUERY(url), "stop")) {
+      a_Trace_set_enabled(0);
+      dStr_append(ds, "Tracing stopped.\n");
+   } else {
+      json = a_Trace_dump();
+      dStr_append(ds, json);
+      free(json);
+   }
+   return ds;
+}
+
 /*
  * Most used function for requesting a URL.
  * TODO: clean up the ad-hoc bindings with an API that allows dynamic
@@ -437,13 +487,20 @@ int a_Capi_open_url(DilloWeb *web, CA_Callback_t Call, void *CbData)
             }
             if (reload) {
                a_Capi_conn_abort_by_url(web->url);
-               /* Send dpip command */
-               _MSG("a_Capi_open_url, reload url='%s'\n", URL_STR(web->url));
-               cmd = Capi_dpi_build_cmd(web, server);
-               a_Capi_dpi_send_cmd(web->url, web->bw, cmd, server, 1);
-               dFree(cmd);
-               if (strcmp(server, "vsource") == 0) {
-                  Capi_dpi_send_source(web->bw, web->url);
+               if (strcmp(server, "proto.file") == 0 &&
+                   Capi_file_inject(web->url)) {
+                  /* plain file, now fresh in the cache: don't drop it */
+                  a_Url_set_flags(web->url,
+                                  URL_FLAGS(web->url) & ~URL_E2EQuery);
+               } else {
+                  /* Send dpip command */
+                  _MSG("a_Capi_open_url, reload url='%s'\n", URL_STR(web->url));
+                  cmd = Capi_dpi_build_cmd(web, server);
+                  a_Capi_dpi_send_cmd(web->url, web->bw, cmd, server, 1);
+                  dFree(cmd);
+                  if (strcmp(server, "vsource") == 0) {
+                     Capi_dpi_send_source(web->bw, web->url);
+                  }
                }
             }
             use_cache = 1;
@@ -476,6 +533,19 @@ int a_Capi_open_url(DilloWeb *web, CA_Callback_t Call, void *CbData)
 
       } else if (!dStrAsciiCasecmp(scheme, "about")) {
          /* internal request */
+         Dstr *ds = NULL;
+
+         /* these are generated anew on each request */
+         if (!dStrAsciiCasecmp(URL_PATH(web->url), "tabs"))
+            ds = a_UIcmd_tabs_page();
+         else if (!dStrAsciiCasecmp(URL_PATH(web->url), "memory"))
+            ds = a_UIcmd_memory_page();
+         else if (!dStrAsciiCasecmp(URL_PATH(web->url), "trace"))
+            ds = Capi_trace_page(web->url);
+         if (ds) {
+            a_Cache_entry_inject(web->url, ds);
+            dStr_free(ds, 1);
+         }
          use_cache = 1;
       }
    }
@@ -35,6 +35,7 @@ void a_Cookies_init(void)
 #include <stdio.h>
 #include <ctype.h>
 #include <errno.h>
+#include <time.h>
 
 #include "IO/Url.h"
 #include "list.h"
@@ -46,6 +47,12 @@ void a_Cookies_init(void)
 /* The maximum length of a line in the cookie file */
 #define LINE_MAXLEN 4096
 
+/* Seconds a cached jar is used before asking cookies.dpi again (it may be
+ * changed by other dillo processes, too) */
+#define COOKIES_JAR_TTL 60
+/* Maximum number of cached jars */
+#define COOKIES_JAR_MAX 64
+
 typedef enum {
    COOKIE_ACCEPT,
    COOKIE_ACCEPT_SESSION,
@@ -57,6 +64,23 @@ typedef struct {
    char *domain;
 } CookieControl;
 
+/*
+ * The cookies that may be sent to a host, as given by cookies.dpi,
+ * in the order in which they are sent.
+ */
+typedef struct {
+   char *path;
+   time_t expires_at;
+   char *pair;             /* "name=value" */
+} JarCookie_t;
+
+typedef struct {
+   char *key;              /* "scheme host" */
+   char *host;
+   time_t fetched;
+   Dlist *cookies;
+} Jar_t;
+
 /* Variables for access control */
 static CookieControl *ccontrol = NULL;
 static int num_ccontrol = 0;
@@ -65,10 +89,15 @@ static CookieControlAction default_action = COOKIE_DENY;
 
 static bool_t disabled;
 
+/* Cache of jars, sorted by key */
+static Dlist *jars = NULL;
+
 static FILE *Cookies_fopen(const char *file, char *init_str);
 static CookieControlAction Cookies_control_check(const DilloUrl *url);
 static CookieControlAction Cookies_control_check_domain(const char *domain);
 static int Cookie_control_init(void);
+static void Cookies_jar_invalidate(const char *host, const char *domain);
+static const char *Cookies_jar_domain_attr(const char *cookie_string);
 
 /*
  * Return a file pointer. If the file doesn't exist, try to create it,
@@ -131,6 +160,9 @@ void a_Cookies_init(void)
  */
 void a_Cookies_freeall()
 {
+   Cookies_jar_invalidate(NULL, NULL);
+   dList_free(jars);
+   jars = NULL;
 }
 
 /*
@@ -173,9 +205,246 @@ void a_Cookies_set(Dlist *cookie_strings, const DilloUrl *set_url,
       _MSG("a_Cookies_set: dpip_tag = {%s}\n", dpip_tag);
       dFree(dpip_tag);
       dFree(cmd);
+
+      Cookies_jar_invalidate(URL_HOST(set_url),
+                             Cookies_jar_domain_attr(cookie_string));
    }
 }
 
+/* -------------------------------------------------------------
+ *                    Cookie cache
+ * ------------------------------------------------------------- */
+
+/*
+ * The answers of cookies.dpi are cached per host: the cookies for any
+ * path on the host (with their paths and expiration times) are fetched
+ * once, and the path matching is done here. So, most requests (e.g. for
+ * the images in a page) don't wait for cookies.dpi. Setting a cookie
+ * invalidates the jars it may belong to.
+ */
+
+static int Cookies_jar_cmp(const void *v1, const void *v2)
+{
+   const Jar_t *j1 = v1, *j2 = v2;
+
+   return strcmp(j1->key, j2->key);
+}
+
+static int Cookies_jar_by_key_cmp(const void *v1, const void *v2)
+{
+   const Jar_t *j = v1;
+   const char *key = v2;
+
+   return strcmp(j->key, key);
+}
+
+static void Cookies_jar_free(Jar_t *jar)
+{
+   JarCookie_t *c;
+   int i;
+
+   for (i = 0; (c = dList_nth_data(jar->cookies, i)); ++i) {
+      dFree(c->path);
+      dFree(c->pair);
+      dFree(c);
+   }
+   dList_free(jar->cookies);
+   dFree(jar->key);
+   dFree(jar->host);
+   dFree(jar);
+}
+
+/*
+ * Return TRUE if 'host' is 'domain' or one of its subdomains.
+ * A leading dot in 'domain' (as in "Domain=.example.com") is ignored.
+ */
+static bool_t Cookies_host_in_domain(const char *host, const char *domain)
+{
+   int h_len, d_len;
+
+   if (domain[0] == '.')
+      domain++;
+   h_len = strlen(host);
+   d_len = strlen(domain);
+   if (d_len == 0 || d_len > h_len)
+      return FALSE;
+   return (!dStrAsciiCasecmp(host + h_len - d_len, domain) &&
+           (h_len == d_len || host[h_len - d_len - 1] == '.'));
+}
+
+/*
+ * Return the value of the Domain attribute of a Set-Cookie string, or NULL
+ * (the value is a static buffer).
+ */
+static const char *Cookies_jar_domain_attr(const char *cookie_string)
+{
+   static char domain[256];
+   const char *p = cookie_string;
+   size_t len;
+
+   while ((p = strchr(p, ';'))) {
+      p += strspn(p + 1, " \t") + 1;
+      if (!dStrnAsciiCasecmp(p, "domain", 6)) {
+         p += 6 + strspn(p + 6, " \t");
+         if (*p == '=') {
+            p += 1 + strspn(p + 1, " \t");
+            len = strcspn(p, "; \t");
+            if (len > 0 && len < sizeof(domain)) {
+               memcpy(domain, p, len);
+               domain[len] = '\0';
+               return domain;
+            }
+         }
+      }
+   }
+   return NULL;
+}
+
+/*
+ * Drop the cached jars of 'host', and of the hosts within 'domain' (which
+ * may be NULL). Both NULL drop every jar.
+ */
+static void Cookies_jar_invalidate(const char *host, const char *domain)
+{
+   Jar_t *jar;
+   int i;
+
+   for (i = 0; (jar = dList_nth_data(jars, i)); ++i) {
+      if ((!host && !domain) ||
+          (host && !dStrAsciiCasecmp(jar->host, host)) ||
+          (domain && Cookies_host_in_domain(jar->host, domain))) {
+         dList_remove(jars, jar);
+         Cookies_jar_free(jar);
+         --i;
+      }
+   }
+}
+
+/*
+ * Parse the answer of cookies.dpi to "get_cookie_jar": one line per cookie,
+ * as "<expires_at> <path length> <path> <name>=<value>".
+ */
+static Dlist *Cookies_jar_parse(const char *str)
+{
+   Dlist *cookies = dList_new(4);
+   const char *p = str, *nl, *path;
+   char *tail;
+   long expires_at, path_len;
+   JarCookie_t *c;
+
+   while (*p) {
+      nl = strchr(p, '\n');
+      if (!nl)
+         nl = p + strlen(p);
+      expires_at = strtol(p, &tail, 10);
+      path_len = (*tail == ' ') ? strtol(tail + 1, &tail, 10) : -1;
+      path = tail + 1;
+      if (*tail == ' ' && path_len >= 0 && path_len < nl - path &&
+          path[path_len] == ' ') {
+         c = dNew(JarCookie_t, 1);
+         c->path = dStrndup(path, path_len);
+         c->expires_at = (time_t) expires_at;
+         c->pair = dStrndup(path + path_len + 1, nl - path - path_len - 1);
+         dList_append(cookies, c);
+      }
+      p = *nl ? nl + 1 : nl;
+   }
+   return cookies;
+}
+
+/*
+ * Return the cached jar for a URL, fetching it from cookies.dpi when
+ * needed. NULL if cookies.dpi can't answer.
+ */
+static Jar_t *Cookies_jar_get(const DilloUrl *url)
+{
+   Jar_t *jar, *oldest;
+   char *key, *cmd, *dpip_tag, *str;
+   time_t now = time(NULL);
+   int i;
+
+   key = dStrconcat(URL_SCHEME(url), " ", URL_HOST(url), NULL);
+   jar = dList_find_sorted(jars, key, Cookies_jar_by_key_cmp);
+   if (jar && now - jar->fetched < COOKIES_JAR_TTL) {
+      dFree(key);
+      return jar;
+   }
+
+   cmd = a_Dpip_build_cmd("cmd=%s scheme=%s host=%s", "get_cookie_jar",
+                          URL_SCHEME(url), URL_HOST(url));
+   dpip_tag = a_Dpi_send_blocking_cmd("cookies", cmd);
+   dFree(cmd);
+   if (!dpip_tag || !(str = a_Dpip_get_attr(dpip_tag, "jar"))) {
+      /* e.g., an old cookies.dpi which doesn't know "get_cookie_jar" */
+      dFree(dpip_tag);
+      dFree(key);
+      return NULL;
+   }
+   dFree(dpip_tag);
+
+   if (jar) {
+      dList_remove(jars, jar);
+      Cookies_jar_free(jar);
+   } else if (dList_length(jars) >= COOKIES_JAR_MAX) {
+      oldest = dList_nth_data(jars, 0);
+      for (i = 1; (jar = dList_nth_data(jars, i)); ++i)
+         if (jar->fetched < oldest->fetched)
+            oldest = jar;
+      dList_remove(jars, oldest);
+      Cookies_jar_free(oldest);
+   }
+
+   jar = dNew(Jar_t, 1);
+   jar->key = key;
+   jar->host = dStrdup(URL_HOST(url));
+   jar->fetched = now;
+   jar->cookies = Cookies_jar_parse(str);
+   dFree(str);
+   if (!jars)
+      jars = dList_new(16);
+   dList_insert_sorted(jars, jar, Cookies_jar_cmp);
+   return jar;
+}
+
+/*
+ * Path matching, as in cookies.dpi.
+ */
+static bool_t Cookies_path_matches(const char *url_path,
+                                   const char *cookie_path)
+{
+   uint_t c_len = strlen(cookie_path);
+   uint_t u_len = strlen(url_path);
+
+   return (!strncmp(cookie_path, url_path, c_len) &&
+           ((c_len == u_len) ||
+            (c_len > 0 && cookie_path[c_len - 1] == '/') ||
+            (url_path[c_len] == '/')));
+}
+
+/*
+ * Build the Cookie header for 'url_path' from a jar.
+ */
+static char *Cookies_jar_query(Jar_t *jar, const char *url_path)
+{
+   Dstr *ds = dStr_new("");
+   JarCookie_t *c;
+   time_t now = time(NULL);
+   char *str;
+   int i;
+
+   for (i = 0; (c = dList_nth_data(jar->cookies, i)); ++i) {
+      if (c->expires_at < now || !Cookies_path_matches(url_path, c->path))
+         continue;
+      dStr_append(ds, ds->len ? "; " : "Cookie: ");
+      dStr_append(ds, c->pair);
+   }
+   if (ds->len)
+      dStr_append(ds, "\r\n");
+   str = ds->str;
+   dStr_free(ds, 0);
+   return str;
+}
+
 /*
  * Return a string containing cookie data for an HTTP query.
  */
@@ -184,6 +453,7 @@ char *a_Cookies_get_query(const DilloUrl *query_url, const DilloUrl *requester)
    char *cmd, *dpip_tag, *query;
    const char *path;
    CookieControlAction action;
+   Jar_t *jar;
 
    if (disabled)
       return dStrdup("");
@@ -204,6 +474,9 @@ char *a_Cookies_get_query(const DilloUrl *query_url, const DilloUrl *requester)
 
    path = URL_PATH_(query_url);
 
+   if ((jar = Cookies_jar_get(query_url)))
+      return Cookies_jar_query(jar, path ? path : "/");
+
    cmd = a_Dpip_build_cmd("cmd=%s scheme=%s host=%s path=%s",
                           "get_cookie", URL_SCHEME(query_url),
                          URL_HOST(query_url), path ? path : "/");
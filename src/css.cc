@@ -14,6 +14,7 @@
 #include "msg.h"
 #include "html_common.hh"
 #include "css.hh"
+#include "lout/trace.h"
 
 using namespace dw::core::style;
 
@@ -504,6 +505,7 @@ void CssContext::apply (CssPropertyList *props, Doctree *docTree,
          DoctreeNode *node,
          CssPropertyList *tagStyle, CssPropertyList *tagStyleImportant,
          CssPropertyList *nonCssHints) {
+   TRACE_SCOPE ("css", "cascade");
 
    userAgentSheet.apply (props, docTree, node, &matchCache);
 
@@ -214,6 +214,7 @@ typedef enum {
    CSS_PROPERTY_POSITION,
    CSS_PROPERTY_QUOTES,
    CSS_PROPERTY_RIGHT,
+   CSS_PROPERTY_TABLE_LAYOUT,
    CSS_PROPERTY_TEXT_ALIGN,
    CSS_PROPERTY_TEXT_DECORATION,
    CSS_PROPERTY_TEXT_INDENT,
@@ -24,6 +24,7 @@
 #include "html_common.hh"
 #include "css.hh"
 #include "cssparser.hh"
+#include "lout/trace.h"
 
 using namespace dw::core::style;
 
@@ -136,6 +137,10 @@ static const char *const Css_position_enum_vals[] = {
    "static", "relative", "absolute", "fixed", NULL
 };
 
+static const char *const Css_table_layout_enum_vals[] = {
+   "auto", "fixed", NULL
+};
+
 static const char *const Css_text_align_enum_vals[] = {
    "left", "right", "center", "justify", "string", NULL
 };
@@ -261,6 +266,8 @@ const CssPropertyInfo Css_property_info[CSS_PROPERTY_LAST] = {
    {"position", {CSS_TYPE_ENUM, CSS_TYPE_UNUSED}, Css_position_enum_vals},
    {"quotes", {CSS_TYPE_UNUSED}, NULL},
    {"right", {CSS_TYPE_SIGNED_LENGTH, CSS_TYPE_UNUSED}, NULL},
+   {"table-layout", {CSS_TYPE_ENUM, CSS_TYPE_UNUSED},
+    Css_table_layout_enum_vals},
    {"text-align", {CSS_TYPE_ENUM, CSS_TYPE_UNUSED}, Css_text_align_enum_vals},
    {"text-decoration", {CSS_TYPE_MULTI_ENUM, CSS_TYPE_UNUSED},
     Css_text_decoration_enum_vals},
@@ -1796,6 +1803,7 @@ void CssParser::parse(DilloHtml *html, const DilloUrl *baseUrl,
                       const char *buf,
                       int buflen, CssOrigin origin)
 {
+   TRACE_SCOPE ("style", "parse style sheet");
    CssParser parser (context, origin, baseUrl, buf, buflen);
    bool importsAreAllowed = true;
 
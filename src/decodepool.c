@@ -0,0 +1,444 @@
+/*
+ * File: decodepool.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * A bounded pool of threads for decoding images off the main thread.
+ *
+ * Each job wraps one image decoder. The main thread feeds it with the
+ * image data as the cache receives it; a worker thread runs the decoder
+ * over the data and posts its results (parameters, color maps, bands of
+ * decoded rows) back to the job. The main thread is woken up through a
+ * pipe (as dns.c does) and applies the results in batches.
+ *
+ * The data is not copied: workers read the cache's buffer in place, and
+ * the cache calls a_Decodepool_buf_release() before it moves or frees it.
+ *
+ * A job is decoded by at most one worker at a time, so decoders need no
+ * locking of their own. They must not touch main-thread data, though;
+ * dicache.c redirects their output through a_Decodepool_job_post*().
+ */
+
+#include <pthread.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "msg.h"
+#include "prefs.h"
+#include "decodepool.h"
+#include "IO/iowatch.hh"
+#include "lout/trace.h"
+
+struct DecodeJob {
+   CA_Callback_t Decoder;  /* Image decoder */
+   void *DecoderData;      /* Image decoder data */
+   DecodeJobCb_t Callback; /* Called on the main thread with new results */
+   void *CbData;
+
+   const char *buf;        /* Input data (the cache's buffer), from offset 0 */
+   uint_t size;            /* Amount of data in 'buf' */
+   uint_t decoded;         /* Amount of 'buf' handed to the decoder */
+   bool_t complete;        /* The cache entry was complete when fed */
+   bool_t closed;          /* No more input will come */
+   bool_t running;         /* A worker is decoding this job */
+   bool_t cancelled;       /* Being freed; don't run it again */
+   bool_t notify;          /* There are results for the main thread */
+
+   uint_t rowsize;         /* Row size for row events (worker side) */
+   Dlist *events;          /* Results, in order */
+};
+
+/*
+ * Local data
+ */
+static pthread_mutex_t Mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t WorkCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t DoneCond = PTHREAD_COND_INITIALIZER;
+static pthread_key_t CurrentJobKey;
+static pthread_t Threads[DECODEPOOL_MAX_THREADS];
+static int NumThreads = 0;
+static bool_t Quit = FALSE;
+static Dlist *Jobs = NULL;       /* All jobs, in round-robin order */
+static int NotifyPipe[2];
+
+
+/*
+ * Return whether a worker can run this job.
+ * (Call with the mutex held)
+ */
+static bool_t Decodepool_job_runnable(DecodeJob *job)
+{
+   return !job->running && !job->cancelled && job->buf &&
+          job->size > job->decoded;
+}
+
+/*
+ * Worker thread: run decoders over the data they have been fed.
+ */
+static void *Decodepool_worker(void *data)
+{
+   CacheClient_t Client;
+   DecodeJob *job;
+   const char *buf;
+   uint_t size;
+   int i;
+   trace_time_t start = 0;
+
+   pthread_mutex_lock(&Mutex);
+   while (!Quit) {
+      for (i = 0; (job = dList_nth_data(Jobs, i)); ++i)
+         if (Decodepool_job_runnable(job))
+            break;
+      if (!job) {
+         pthread_cond_wait(&WorkCond, &Mutex);
+         continue;
+      }
+      job->running = TRUE;
+      buf = job->buf;
+      size = job->size;
+      pthread_mutex_unlock(&Mutex);
+
+      /* 'buf' is not moved while the job is running (see
+       * a_Decodepool_buf_release), and data past 'size' is not read */
+      memset(&Client, 0, sizeof(Client));
+      Client.Buf = (void *)buf;
+      Client.BufSize = size;
+      Client.CbData = job->DecoderData;
+      pthread_setspecific(CurrentJobKey, job);
+      TRACE_SET_START(start);
+      job->Decoder(CA_Send, &Client);
+      TRACE_SPAN("image", "image decode", start);
+      pthread_setspecific(CurrentJobKey, NULL);
+
+      pthread_mutex_lock(&Mutex);
+      job->decoded = size;
+      job->running = FALSE;
+      job->notify = TRUE;
+      /* round-robin among images */
+      dList_remove(Jobs, job);
+      dList_append(Jobs, job);
+      pthread_cond_broadcast(&DoneCond);
+      pthread_mutex_unlock(&Mutex);
+
+      /* Not under the mutex: the main thread may be waiting for it.
+       * The pipe is non-blocking; when it's full, the main thread has
+       * a wake-up pending already. */
+      if (write(NotifyPipe[1], ".", 1) < 0 && errno != EAGAIN)
+         MSG_ERR("Decodepool_worker: can't notify the main thread\n");
+      pthread_mutex_lock(&Mutex);
+   }
+   pthread_mutex_unlock(&Mutex);
+   return NULL;
+}
+
+/*
+ * Called on the main thread when workers have results.
+ */
+static void Decodepool_notify_cb(int fd, void *data)
+{
+   DecodeJob *job;
+   char buf[64];
+   int i;
+
+   while (read(NotifyPipe[0], buf, sizeof(buf)) > 0) ;
+
+   /* The callback may free any job, so search from the start each time */
+   pthread_mutex_lock(&Mutex);
+   while (1) {
+      for (i = 0; (job = dList_nth_data(Jobs, i)); ++i)
+         if (job->notify && !job->cancelled)
+            break;
+      if (!job)
+         break;
+      job->notify = FALSE;
+      pthread_mutex_unlock(&Mutex);
+      job->Callback(job, job->CbData);
+      pthread_mutex_lock(&Mutex);
+   }
+   pthread_mutex_unlock(&Mutex);
+}
+
+/*
+ * Start the worker threads (prefs.image_decode_threads of them).
+ */
+void a_Decodepool_init(void)
+{
+   int i, n = MIN(prefs.image_decode_threads, DECODEPOOL_MAX_THREADS);
+
+   Jobs = dList_new(16);
+   if (n <= 0)
+      return;
+
+   if (pipe(NotifyPipe) < 0) {
+      MSG_ERR("a_Decodepool_init: pipe: decoding images inline\n");
+      return;
+   }
+   fcntl(NotifyPipe[0], F_SETFL, O_NONBLOCK);
+   fcntl(NotifyPipe[1], F_SETFL, O_NONBLOCK);
+   a_IOwatch_add_fd(NotifyPipe[0], DIO_READ, Decodepool_notify_cb, NULL);
+   pthread_key_create(&CurrentJobKey, NULL);
+
+   for (i = 0; i < n; ++i) {
+      if (pthread_create(&Threads[NumThreads], NULL, Decodepool_worker,
+                         NULL) == 0)
+         ++NumThreads;
+   }
+   _MSG("a_Decodepool_init: %d threads\n", NumThreads);
+}
+
+/*
+ * Stop the worker threads.
+ * (Call this one at exit time, after freeing every job)
+ */
+void a_Decodepool_freeall(void)
+{
+   int i;
+
+   if (NumThreads > 0) {
+      pthread_mutex_lock(&Mutex);
+      Quit = TRUE;
+      pthread_cond_broadcast(&WorkCond);
+      pthread_mutex_unlock(&Mutex);
+      for (i = 0; i < NumThreads; ++i)
+         pthread_join(Threads[i], NULL);
+      NumThreads = 0;
+
+      a_IOwatch_remove_fd(NotifyPipe[0], DIO_READ);
+      dClose(NotifyPipe[0]);
+      dClose(NotifyPipe[1]);
+   }
+   dList_free(Jobs);
+   Jobs = NULL;
+}
+
+/*
+ * Whether images are decoded by the pool (or inline).
+ */
+bool_t a_Decodepool_enabled(void)
+{
+   return NumThreads > 0;
+}
+
+/*
+ * Create a job for an image decoder.
+ * 'Callback' is called on the main thread whenever there are results.
+ */
+DecodeJob *a_Decodepool_job_new(CA_Callback_t Decoder, void *DecoderData,
+                                DecodeJobCb_t Callback, void *CbData)
+{
+   DecodeJob *job = dNew0(DecodeJob, 1);
+
+   job->Decoder = Decoder;
+   job->DecoderData = DecoderData;
+   job->Callback = Callback;
+   job->CbData = CbData;
+   job->events = dList_new(8);
+
+   pthread_mutex_lock(&Mutex);
+   dList_append(Jobs, job);
+   pthread_mutex_unlock(&Mutex);
+   return job;
+}
+
+/*
+ * Free an event.
+ */
+void a_Decodepool_event_free(DecodeEvent *ev)
+{
+   if (ev) {
+      dStr_free(ev->data, 1);
+      dFree(ev->parms);
+      dFree(ev);
+   }
+}
+
+/*
+ * Free a job. If a worker is running it, wait until it's done.
+ * The decoder itself is not freed: it belongs to the caller.
+ */
+void a_Decodepool_job_free(DecodeJob *job)
+{
+   DecodeEvent *ev;
+
+   dReturn_if (job == NULL);
+
+   pthread_mutex_lock(&Mutex);
+   job->cancelled = TRUE;
+   while (job->running)
+      pthread_cond_wait(&DoneCond, &Mutex);
+   dList_remove(Jobs, job);
+   pthread_mutex_unlock(&Mutex);
+
+   while ((ev = dList_nth_data(job->events, 0))) {
+      dList_remove_fast(job->events, ev);
+      a_Decodepool_event_free(ev);
+   }
+   dList_free(job->events);
+   dFree(job);
+}
+
+/*
+ * Give the job the cache data.
+ * 'Buf' and 'BufSize' are the whole data, as given to cache clients; the
+ * buffer is read in place until a_Decodepool_buf_release() is called on it.
+ */
+void a_Decodepool_job_feed(DecodeJob *job, const void *Buf, uint_t BufSize,
+                           bool_t complete)
+{
+   pthread_mutex_lock(&Mutex);
+   /* A running job's buffer can't have moved (see below) */
+   assert(!job->running || job->buf == Buf);
+   job->buf = Buf;
+   if (BufSize > job->size) {
+      job->size = BufSize;
+      pthread_cond_signal(&WorkCond);
+   }
+   job->complete = complete;
+   pthread_mutex_unlock(&Mutex);
+}
+
+/*
+ * The cache is about to reallocate or free 'buf' (main thread).
+ * Wait for the workers reading it, and keep them off it until the jobs
+ * are fed again.
+ */
+void a_Decodepool_buf_release(const char *buf)
+{
+   DecodeJob *job;
+   int i;
+
+   dReturn_if (NumThreads == 0 || buf == NULL);
+
+   pthread_mutex_lock(&Mutex);
+   for (i = 0; (job = dList_nth_data(Jobs, i)); ++i) {
+      if (job->buf == buf) {
+         if (job->running) {
+            /* Workers reorder the list: scan it again afterwards */
+            pthread_cond_wait(&DoneCond, &Mutex);
+            i = -1;
+            continue;
+         }
+         job->buf = NULL;
+      }
+   }
+   pthread_mutex_unlock(&Mutex);
+}
+
+/*
+ * No more input will be fed to this job.
+ */
+void a_Decodepool_job_close(DecodeJob *job)
+{
+   pthread_mutex_lock(&Mutex);
+   job->closed = TRUE;
+   job->complete = TRUE;
+   pthread_mutex_unlock(&Mutex);
+}
+
+/*
+ * Whether the job is closed and all its input has been decoded.
+ */
+bool_t a_Decodepool_job_done(DecodeJob *job)
+{
+   bool_t done;
+
+   pthread_mutex_lock(&Mutex);
+   /* Without a buffer (the cache dropped it), nothing more can be done */
+   done = job->closed && !job->running &&
+          (job->decoded == job->size || !job->buf);
+   pthread_mutex_unlock(&Mutex);
+   return done;
+}
+
+/*
+ * Take the results posted so far (main thread).
+ * Return value: a list of DecodeEvent, to be freed by the caller.
+ */
+Dlist *a_Decodepool_job_take_events(DecodeJob *job)
+{
+   Dlist *events;
+
+   pthread_mutex_lock(&Mutex);
+   events = job->events;
+   job->events = dList_new(8);
+   pthread_mutex_unlock(&Mutex);
+   return events;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Return the job being decoded by the calling thread, or NULL when
+ * called from the main thread.
+ */
+DecodeJob *a_Decodepool_current(void)
+{
+   return (NumThreads > 0) ? pthread_getspecific(CurrentJobKey) : NULL;
+}
+
+/*
+ * Whether the image data was complete when it was last fed.
+ */
+bool_t a_Decodepool_job_input_complete(DecodeJob *job)
+{
+   bool_t complete;
+
+   pthread_mutex_lock(&Mutex);
+   complete = job->complete;
+   pthread_mutex_unlock(&Mutex);
+   return complete;
+}
+
+/*
+ * Set the row size for subsequent row events (worker side).
+ */
+void a_Decodepool_job_set_rowsize(DecodeJob *job, uint_t rowsize)
+{
+   job->rowsize = rowsize;
+}
+
+/*
+ * Post a result. 'parms' is dFree'd with the event.
+ */
+void a_Decodepool_job_post(DecodeJob *job, int Op, void *parms)
+{
+   DecodeEvent *ev = dNew0(DecodeEvent, 1);
+
+   ev->Op = Op;
+   ev->parms = parms;
+   pthread_mutex_lock(&Mutex);
+   dList_append(job->events, ev);
+   pthread_mutex_unlock(&Mutex);
+}
+
+/*
+ * Post a decoded row. It's merged into the last event when that one is
+ * a band ending right above it.
+ */
+void a_Decodepool_job_post_row(DecodeJob *job, int Op, const uchar_t *row,
+                               uint_t y)
+{
+   DecodeEvent *ev;
+
+   pthread_mutex_lock(&Mutex);
+   ev = dList_nth_data(job->events, dList_length(job->events) - 1);
+   if (!ev || ev->Op != Op || ev->rowsize != job->rowsize ||
+       ev->y + ev->nrows != y) {
+      ev = dNew0(DecodeEvent, 1);
+      ev->Op = Op;
+      ev->y = y;
+      ev->rowsize = job->rowsize;
+      ev->data = dStr_sized_new(16 * job->rowsize);
+      dList_append(job->events, ev);
+   }
+   dStr_append_l(ev->data, (const char *)row, job->rowsize);
+   ev->nrows++;
+   pthread_mutex_unlock(&Mutex);
+}
@@ -0,0 +1,59 @@
+#ifndef __DECODEPOOL_H__
+#define __DECODEPOOL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+#include "cache.h"
+
+/* Maximum number of image decoding threads */
+#define DECODEPOOL_MAX_THREADS 16
+
+typedef struct DecodeJob DecodeJob;
+
+/*
+ * A result posted by a decoder running in a worker thread.
+ * Row events for consecutive rows are merged into one band.
+ */
+typedef struct {
+   int Op;              /* Event type, as defined by the job's owner */
+   uint_t y;            /* First row (row events) */
+   uint_t nrows;        /* Number of rows in the band (row events) */
+   uint_t rowsize;      /* Bytes per row (row events) */
+   Dstr *data;          /* Row data (row events) */
+   void *parms;         /* Owner-defined parameters (other events) */
+} DecodeEvent;
+
+/* Called on the main thread when a job has new results */
+typedef void (*DecodeJobCb_t)(DecodeJob *job, void *data);
+
+void a_Decodepool_init(void);
+void a_Decodepool_freeall(void);
+bool_t a_Decodepool_enabled(void);
+
+DecodeJob *a_Decodepool_job_new(CA_Callback_t Decoder, void *DecoderData,
+                                DecodeJobCb_t Callback, void *CbData);
+void a_Decodepool_job_free(DecodeJob *job);
+void a_Decodepool_job_feed(DecodeJob *job, const void *Buf, uint_t BufSize,
+                           bool_t complete);
+void a_Decodepool_job_close(DecodeJob *job);
+void a_Decodepool_buf_release(const char *buf);
+bool_t a_Decodepool_job_done(DecodeJob *job);
+Dlist *a_Decodepool_job_take_events(DecodeJob *job);
+void a_Decodepool_event_free(DecodeEvent *ev);
+
+/* For decoders running in a worker thread */
+DecodeJob *a_Decodepool_current(void);
+bool_t a_Decodepool_job_input_complete(DecodeJob *job);
+void a_Decodepool_job_set_rowsize(DecodeJob *job, uint_t rowsize);
+void a_Decodepool_job_post(DecodeJob *job, int Op, void *parms);
+void a_Decodepool_job_post_row(DecodeJob *job, int Op, const uchar_t *row,
+                               uint_t y);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* __DECODEPOOL_H__ */
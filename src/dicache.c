@@ -13,6 +13,7 @@
 #include <stdlib.h>
 
 #include "msg.h"
+#include "capi.h"
 #include "image.hh"
 #include "imgbuf.hh"
 #include "web.hh"
@@ -20,6 +21,7 @@
 #include "dpng.h"
 #include "dgif.h"
 #include "djpeg.h"
+#include "lout/trace.h"
 
 
 enum {
@@ -28,6 +30,37 @@ enum {
    DIC_Jpeg
 };
 
+/* Results posted by decoders running in the decode pool */
+enum {
+   DIC_EvParms,
+   DIC_EvCmap,
+   DIC_EvNewScan,
+   DIC_EvRows
+};
+
+typedef struct {
+   DilloImage *Image;
+   uint_t width, height;
+   DilloImgType type;
+   double gamma;
+} DicacheParms;
+
+typedef struct {
+   int bg_color;
+   uint_t num_colors;
+   int num_colors_max;
+   int bg_index;
+   uchar_t *cmap;        /* points right after this struct */
+} DicacheCmap;
+
+/* A cache client close that waits for the decode pool to finish */
+typedef struct {
+   int Op;               /* CA_Close or CA_Abort */
+   int Key;              /* Cache client key */
+   BrowserWindow *bw;
+   DilloImage *Image;    /* [ref] */
+} DicacheClose;
+
 
 /*
  * List of DICacheEntry. May hold several versions of the same image,
@@ -74,6 +107,8 @@ static DICacheEntry *Dicache_entry_new(void)
 
    entry->width = 0;
    entry->height = 0;
+   entry->ReqWidth = 0;
+   entry->ReqHeight = 0;
    entry->Flags = DIF_Valid;
    entry->SurvCleanup = 0;
    entry->type = DILLO_IMG_TYPE_NOTSET;
@@ -90,6 +125,10 @@ static DICacheEntry *Dicache_entry_new(void)
    entry->DecoderData = NULL;
    entry->DecodedSize = 0;
 
+   entry->Job = NULL;
+   entry->JobImage = NULL;
+   entry->JobCloses = NULL;
+
    return entry;
 }
 
@@ -138,6 +177,36 @@ DICacheEntry *a_Dicache_get_entry(const DilloUrl *Url, int version)
    return entry;
 }
 
+/*
+ * Stop decoding this entry in the pool (waiting for a running worker).
+ * Deferred closes are left for the caller.
+ */
+static void Dicache_job_free(DICacheEntry *entry)
+{
+   a_Decodepool_job_free(entry->Job);
+   entry->Job = NULL;
+   if (entry->JobImage) {
+      a_Image_unref(entry->JobImage);
+      entry->JobImage = NULL;
+   }
+}
+
+/*
+ * Drop the deferred closes of an entry (their clients are gone).
+ */
+static void Dicache_job_drop_closes(DICacheEntry *entry)
+{
+   DicacheClose *c;
+
+   while ((c = dList_nth_data(entry->JobCloses, 0))) {
+      dList_remove_fast(entry->JobCloses, c);
+      a_Image_unref(c->Image);
+      dFree(c);
+   }
+   dList_free(entry->JobCloses);
+   entry->JobCloses = NULL;
+}
+
 /*
  * Actually free a dicache entry, given the URL and the version number.
  */
@@ -157,7 +226,9 @@ static void Dicache_remove(const DilloUrl *Url, int version)
    dList_remove(CachedIMGs, entry);
    dicache_size_total -= entry->TotalSize;
 
-   /* entry cleanup */
+   /* entry cleanup (the decoder may be running in the pool) */
+   Dicache_job_free(entry);
+   Dicache_job_drop_closes(entry);
    a_Url_free(entry->url);
    dFree(entry->cmap);
    a_Bitvec_free(entry->BitVec);
@@ -227,9 +298,26 @@ void a_Dicache_set_parms(DilloUrl *url, int version, DilloImage *Image,
                          double gamma)
 {
    DICacheEntry *DicEntry;
+   DecodeJob *job;
 
    _MSG("a_Dicache_set_parms (%s)\n", URL_STR(url));
    dReturn_if_fail ( Image != NULL && width && height );
+
+   if ((job = a_Decodepool_current())) {
+      /* Called from the decode pool: hand it to the main thread */
+      DicacheParms *p = dNew(DicacheParms, 1);
+      p->Image = Image;
+      p->width = width;
+      p->height = height;
+      p->type = type;
+      p->gamma = gamma;
+      a_Decodepool_job_set_rowsize(job, width *
+         (type == DILLO_IMG_TYPE_RGB ? 3 :
+          type == DILLO_IMG_TYPE_CMYK_INV ? 4 : 1));
+      a_Decodepool_job_post(job, DIC_EvParms, p);
+      return;
+   }
+
    /* Find the DicEntry for this Image */
    DicEntry = a_Dicache_get_entry(url, version);
    dReturn_if_fail ( DicEntry != NULL );
@@ -260,8 +348,22 @@ void a_Dicache_set_cmap(DilloUrl *url, int version, int bg_color,
                         const uchar_t *cmap, uint_t num_colors,
                         int num_colors_max, int bg_index)
 {
-   DICacheEntry *DicEntry = a_Dicache_get_entry(url, version);
+   DICacheEntry *DicEntry;
+   DecodeJob *job;
+
+   if ((job = a_Decodepool_current())) {
+      DicacheCmap *p = dMalloc(sizeof(DicacheCmap) + 3 * num_colors);
+      p->bg_color = bg_color;
+      p->num_colors = num_colors;
+      p->num_colors_max = num_colors_max;
+      p->bg_index = bg_index;
+      p->cmap = (uchar_t *)(p + 1);
+      memcpy(p->cmap, cmap, 3 * num_colors);
+      a_Decodepool_job_post(job, DIC_EvCmap, p);
+      return;
+   }
 
+   DicEntry = a_Dicache_get_entry(url, version);
    _MSG("a_Dicache_set_cmap\n");
    dReturn_if_fail ( DicEntry != NULL );
 
@@ -283,9 +385,14 @@ void a_Dicache_set_cmap(DilloUrl *url, int version, int bg_color,
 void a_Dicache_new_scan(const DilloUrl *url, int version)
 {
    DICacheEntry *DicEntry;
+   DecodeJob *job;
 
    _MSG("a_Dicache_new_scan\n");
    dReturn_if_fail ( url != NULL );
+   if ((job = a_Decodepool_current())) {
+      a_Decodepool_job_post(job, DIC_EvNewScan, NULL);
+      return;
+   }
    DicEntry = a_Dicache_get_entry(url, version);
    dReturn_if_fail ( DicEntry != NULL );
    if (DicEntry->State < DIC_SetParms) {
@@ -306,8 +413,14 @@ void a_Dicache_new_scan(const DilloUrl *url, int version)
 void a_Dicache_write(DilloUrl *url, int version, const uchar_t *buf, uint_t Y)
 {
    DICacheEntry *DicEntry;
+   DecodeJob *job;
 
    _MSG("a_Dicache_write\n");
+   if ((job = a_Decodepool_current())) {
+      /* rows are merged into bands for the main thread */
+      a_Decodepool_job_post_row(job, DIC_EvRows, buf, Y);
+      return;
+   }
    DicEntry = a_Dicache_get_entry(url, version);
    dReturn_if_fail ( DicEntry != NULL );
    dReturn_if_fail ( DicEntry->width > 0 && DicEntry->height > 0 );
@@ -348,6 +461,35 @@ void a_Dicache_close(DilloUrl *url, int version, CacheClient_t *Client)
    a_Bw_close_client(Web->bw, Client->Key);
 }
 
+/*
+ * Return the largest power of two, up to 'max', by which a width x height
+ * image can be divided and still cover its display size.
+ * (Called by decoders, possibly from the decode pool)
+ */
+uint_t a_Dicache_reduction(uint_t req_width, uint_t req_height,
+                           uint_t width, uint_t height, uint_t max)
+{
+   uint_t denom = 1;
+
+   if (req_width && req_height)
+      while (denom < max &&
+             width / (2 * denom) >= req_width &&
+             height / (2 * denom) >= req_height)
+         denom *= 2;
+   return denom;
+}
+
+/*
+ * Can this entry serve an image with this display size?
+ * An entry that may have been reduced can't serve a larger image.
+ */
+static bool_t Dicache_entry_fits(DICacheEntry *entry, DilloImage *Image)
+{
+   return (entry->ReqWidth == 0 ||
+           (Image->req_width && Image->req_width <= entry->ReqWidth &&
+            Image->req_height && Image->req_height <= entry->ReqHeight));
+}
+
 /* ------------------------------------------------------------------------- */
 
 /*
@@ -376,9 +518,12 @@ static void *Dicache_image(int ImgType, const char *MimeType, void *Ptr,
    }
 
    DicEntry = a_Dicache_get_entry(web->url, DIC_Last);
-   if (!DicEntry) {
-      /* Create an entry for this image... */
+   if (!DicEntry || !Dicache_entry_fits(DicEntry, web->Image)) {
+      /* Create an entry for this image (a new version when the cached
+       * one was decoded for a smaller display size)... */
       DicEntry = Dicache_add_entry(web->url);
+      DicEntry->ReqWidth = web->Image->req_width;
+      DicEntry->ReqHeight = web->Image->req_height;
       /* Attach a decoder */
       if (ImgType == DIC_Jpeg) {
          DicEntry->Decoder = (CA_Callback_t)a_Jpeg_callback;
@@ -393,6 +538,11 @@ static void *Dicache_image(int ImgType, const char *MimeType, void *Ptr,
          DicEntry->DecoderData =
             a_Png_new(web->Image, DicEntry->url, DicEntry->version);
       }
+      if (a_Decodepool_enabled()) {
+         /* The decoder hands this image back from the pool */
+         DicEntry->JobImage = web->Image;
+         a_Image_ref(DicEntry->JobImage);
+      }
    } else {
       /* Repeated image */
       a_Dicache_ref(DicEntry->url, DicEntry->version);
@@ -433,15 +583,196 @@ void *a_Dicache_jpeg_image(const char *Type, void *Ptr, CA_Callback_t *Call,
    return Dicache_image(DIC_Jpeg, Type, Ptr, Call, Data);
 }
 
+/*
+ * Bring an image up to date with its dicache entry.
+ */
+static void Dicache_update_image(DICacheEntry *DicEntry, DilloImage *Image)
+{
+   uint_t i;
+
+   if (Image->height == 0 && DicEntry->State >= DIC_SetParms) {
+      /* Set parms */
+      a_Image_set_parms(
+         Image, DicEntry->v_imgbuf, DicEntry->url,
+         DicEntry->version, DicEntry->width, DicEntry->height,
+         DicEntry->type);
+   }
+   if (DicEntry->State == DIC_Write) {
+      if (DicEntry->ScanNumber == Image->ScanNumber) {
+         for (i = 0; i < DicEntry->height; ++i)
+            if (a_Bitvec_get_bit(DicEntry->BitVec, (int)i) &&
+                !a_Bitvec_get_bit(Image->BitVec, (int)i) )
+               a_Image_write(Image, i);
+      } else {
+         for (i = 0; i < DicEntry->height; ++i) {
+            if (a_Bitvec_get_bit(DicEntry->BitVec, (int)i) ||
+                !a_Bitvec_get_bit(Image->BitVec, (int)i)   ||
+                DicEntry->ScanNumber > Image->ScanNumber + 1) {
+               a_Image_write(Image, i);
+            }
+            if (!a_Bitvec_get_bit(DicEntry->BitVec, (int)i))
+               a_Bitvec_clear_bit(Image->BitVec, (int)i);
+         }
+         Image->ScanNumber = DicEntry->ScanNumber;
+      }
+   }
+}
+
+/*
+ * Is this layout still alive? (its page may be gone by the time
+ * a decoder in the pool gets to the image parameters)
+ */
+static bool_t Dicache_layout_alive(void *layout)
+{
+   int i;
+   BrowserWindow *bw;
+
+   for (i = 0; (bw = a_Bw_get(i)); ++i)
+      if (bw->render_layout == layout)
+         return TRUE;
+   return FALSE;
+}
+
+/*
+ * Apply the results posted by the decode pool to the entry.
+ */
+static void Dicache_job_apply(DICacheEntry *entry)
+{
+   Dlist *events = a_Decodepool_job_take_events(entry->Job);
+   DecodeEvent *ev;
+   uint_t r;
+   int i;
+
+   for (i = 0; (ev = dList_nth_data(events, i)); ++i) {
+      if (ev->Op == DIC_EvParms) {
+         DicacheParms *p = ev->parms;
+         if (Dicache_layout_alive(p->Image->layout))
+            a_Dicache_set_parms(entry->url, entry->version, p->Image,
+                                p->width, p->height, p->type, p->gamma);
+      } else if (ev->Op == DIC_EvCmap) {
+         DicacheCmap *p = ev->parms;
+         a_Dicache_set_cmap(entry->url, entry->version, p->bg_color,
+                            p->cmap, p->num_colors, p->num_colors_max,
+                            p->bg_index);
+      } else if (entry->State < DIC_SetParms) {
+         /* parameters were dropped: nowhere to put the rows */
+      } else if (ev->Op == DIC_EvNewScan) {
+         a_Dicache_new_scan(entry->url, entry->version);
+      } else if (ev->Op == DIC_EvRows) {
+         for (r = 0; r < ev->nrows; ++r)
+            a_Dicache_write(entry->url, entry->version,
+                            (uchar_t *)ev->data->str + r * ev->rowsize,
+                            ev->y + r);
+      }
+      a_Decodepool_event_free(ev);
+   }
+   dList_free(events);
+}
+
+/*
+ * The decode pool is done with this entry: run the cache client closes
+ * that were waiting for it.
+ */
+static void Dicache_job_finish(DICacheEntry *entry)
+{
+   DilloUrl *url = a_Url_dup(entry->url);
+   int version = entry->version;
+   Dlist *closes = entry->JobCloses;
+   DicacheClose *c;
+   CacheClient_t Client;
+   DilloWeb Web;
+
+   Dicache_job_apply(entry);
+   entry->JobCloses = NULL;
+   Dicache_job_free(entry);
+
+   while ((c = dList_nth_data(closes, 0))) {
+      dList_remove(closes, c);
+      /* each close holds a reference, but closing may free the entry */
+      if ((entry = a_Dicache_get_entry(url, version))) {
+         if (entry->v_imgbuf)
+            Dicache_update_image(entry, c->Image);
+         memset(&Web, 0, sizeof(Web));
+         Web.url = url;
+         Web.bw = c->bw;
+         Web.Image = c->Image;
+         memset(&Client, 0, sizeof(Client));
+         Client.Key = c->Key;
+         Client.Version = version;
+         Client.Url = url;
+         Client.Web = &Web;
+         Client.CbData = entry->DecoderData;
+         if (entry->State < DIC_Close) {
+            entry->Decoder(c->Op, &Client);
+         } else {
+            a_Dicache_close(url, version, &Client);
+         }
+      }
+      if (c->Op == CA_Close)
+         a_Image_close(c->Image);
+      else
+         a_Image_abort(c->Image);
+      a_Bw_close_client(c->bw, c->Key);
+      a_Image_unref(c->Image);
+      dFree(c);
+   }
+   dList_free(closes);
+   a_Url_free(url);
+}
+
+/*
+ * Called on the main thread when the decode pool has results for us.
+ */
+static void Dicache_job_cb(DecodeJob *job, void *data)
+{
+   DICacheEntry *entry = data;
+   DicacheClose *c;
+   int i;
+
+   if (a_Decodepool_job_done(job)) {
+      Dicache_job_finish(entry);
+   } else {
+      Dicache_job_apply(entry);
+      if (entry->v_imgbuf)
+         for (i = 0; (c = dList_nth_data(entry->JobCloses, i)); ++i)
+            Dicache_update_image(entry, c->Image);
+      /* let the cache feed the clients that are still receiving */
+      a_Cache_update_clients(entry->url);
+   }
+}
+
+/*
+ * Find the dicache entry of a cache client.
+ * There may be several versions of an image; before the client knows its
+ * version, look for the one whose decoder it was given.
+ */
+static DICacheEntry *Dicache_client_entry(CacheClient_t *Client)
+{
+   DilloWeb *Web = Client->Web;
+   DilloUrl *url = Web->url;
+   DICacheEntry *entry;
+   int i;
+
+   if (Client->Version)
+      return a_Dicache_get_entry(url, Client->Version);
+   if (Client->CbData)
+      for (i = 0; (entry = dList_nth_data(CachedIMGs, i)); ++i)
+         if (entry->DecoderData == Client->CbData &&
+             !a_Url_cmp(entry->url, url))
+            return entry;
+   return a_Dicache_get_entry(url, DIC_Last);
+}
+
 /*
  * This function is a cache client; (but feeds its clients from dicache)
  */
 void a_Dicache_callback(int Op, CacheClient_t *Client)
 {
-   uint_t i;
    DilloWeb *Web = Client->Web;
    DilloImage *Image = Web->Image;
-   DICacheEntry *DicEntry = a_Dicache_get_entry(Web->url, DIC_Last);
+   DICacheEntry *DicEntry = Dicache_client_entry(Client);
+   DicacheClose *c;
+   trace_time_t start = 0;
 
    dReturn_if_fail ( DicEntry != NULL );
 
@@ -449,11 +780,39 @@ void a_Dicache_callback(int Op, CacheClient_t *Client)
    if (Client->Version == 0)
       Client->Version = DicEntry->version;
 
-   /* Only call the decoder when necessary */
+   /* Only call the decoder when necessary. A pool job is fed every time,
+    * as the cache buffer it reads may have moved. */
    if (Op == CA_Send && DicEntry->State < DIC_Close &&
-       DicEntry->DecodedSize < Client->BufSize) {
-      DicEntry->Decoder(Op, Client);
+       (DicEntry->DecodedSize < Client->BufSize || DicEntry->Job)) {
+      if (a_Decodepool_enabled()) {
+         if (!DicEntry->Job)
+            DicEntry->Job = a_Decodepool_job_new(DicEntry->Decoder,
+                                                 DicEntry->DecoderData,
+                                                 Dicache_job_cb, DicEntry);
+         a_Decodepool_job_feed(DicEntry->Job, Client->Buf, Client->BufSize,
+                               (a_Capi_get_flags(DicEntry->url) &
+                                CAPI_Completed) ? TRUE : FALSE);
+      } else {
+         TRACE_SET_START(start);
+         DicEntry->Decoder(Op, Client);
+         TRACE_SPAN("image", "image decode", start);
+      }
       DicEntry->DecodedSize = Client->BufSize;
+   } else if ((Op == CA_Close || Op == CA_Abort) && DicEntry->Job) {
+      /* Let the pool finish first; Dicache_job_finish() closes it */
+      c = dNew(DicacheClose, 1);
+      c->Op = Op;
+      c->Key = Client->Key;
+      c->bw = Web->bw;
+      c->Image = Image;
+      a_Image_ref(Image);
+      if (!DicEntry->JobCloses)
+         DicEntry->JobCloses = dList_new(4);
+      dList_append(DicEntry->JobCloses, c);
+      a_Decodepool_job_close(DicEntry->Job);
+      if (a_Decodepool_job_done(DicEntry->Job))
+         Dicache_job_finish(DicEntry);
+      return;
    } else if (Op == CA_Close || Op == CA_Abort) {
       if (DicEntry->State < DIC_Close) {
          DicEntry->Decoder(Op, Client);
@@ -464,32 +823,7 @@ void a_Dicache_callback(int Op, CacheClient_t *Client)
 
    /* when the data stream is not an image 'v_imgbuf' remains NULL */
    if (Op == CA_Send && DicEntry->v_imgbuf) {
-      if (Image->height == 0 && DicEntry->State >= DIC_SetParms) {
-         /* Set parms */
-         a_Image_set_parms(
-            Image, DicEntry->v_imgbuf, DicEntry->url,
-            DicEntry->version, DicEntry->width, DicEntry->height,
-            DicEntry->type);
-      }
-      if (DicEntry->State == DIC_Write) {
-         if (DicEntry->ScanNumber == Image->ScanNumber) {
-            for (i = 0; i < DicEntry->height; ++i)
-               if (a_Bitvec_get_bit(DicEntry->BitVec, (int)i) &&
-                   !a_Bitvec_get_bit(Image->BitVec, (int)i) )
-                  a_Image_write(Image, i);
-         } else {
-            for (i = 0; i < DicEntry->height; ++i) {
-               if (a_Bitvec_get_bit(DicEntry->BitVec, (int)i) ||
-                   !a_Bitvec_get_bit(Image->BitVec, (int)i)   ||
-                   DicEntry->ScanNumber > Image->ScanNumber + 1) {
-                  a_Image_write(Image, i);
-               }
-               if (!a_Bitvec_get_bit(DicEntry->BitVec, (int)i))
-                  a_Bitvec_clear_bit(Image->BitVec, (int)i);
-            }
-            Image->ScanNumber = DicEntry->ScanNumber;
-         }
-      }
+      Dicache_update_image(DicEntry, Image);
    } else if (Op == CA_Close) {
       a_Image_close(Image);
       a_Bw_close_client(Web->bw, Client->Key);
@@ -499,6 +833,42 @@ void a_Dicache_callback(int Op, CacheClient_t *Client)
    }
 }
 
+/*
+ * A cache client was stopped while its close was waiting for the
+ * decode pool: forget about it.
+ */
+void a_Dicache_stop_client(int Key)
+{
+   int i, j;
+   DICacheEntry *entry;
+   DicacheClose *c;
+
+   for (i = 0; (entry = dList_nth_data(CachedIMGs, i)); ++i) {
+      for (j = 0; (c = dList_nth_data(entry->JobCloses, j)); ++j) {
+         if (c->Key == Key) {
+            dList_remove(entry->JobCloses, c);
+            a_Image_unref(c->Image);
+            dFree(c);
+            a_Dicache_unref(entry->url, entry->version);
+            return;
+         }
+      }
+   }
+}
+
+/*
+ * Whether all of the image data is available to its decoder.
+ * (decoders in the pool see the data as it was when last fed)
+ */
+bool_t a_Dicache_input_complete(const DilloUrl *url)
+{
+   DecodeJob *job;
+
+   if ((job = a_Decodepool_current()))
+      return a_Decodepool_job_input_complete(job);
+   return (a_Capi_get_flags(url) & CAPI_Completed) ? TRUE : FALSE;
+}
+
 /* ------------------------------------------------------------------------- */
 
 /*
@@ -524,6 +894,16 @@ void a_Dicache_cleanup(void)
    _MSG("a_Dicache_cleanup: length = %d\n", dList_length(CachedIMGs));
 }
 
+/*
+ * Get the number of dicache entries and the memory taken by their decoded
+ * images, for "about:memory".
+ */
+void a_Dicache_memory_usage(int *num_entries, uint_t *total_size)
+{
+   *num_entries = dList_length(CachedIMGs);
+   *total_size = dicache_size_total;
+}
+
 /* ------------------------------------------------------------------------- */
 
 /*
@@ -537,6 +917,8 @@ void a_Dicache_freeall(void)
    /* Remove all the dicache entries */
    while ((entry = dList_nth_data(CachedIMGs, dList_length(CachedIMGs)-1))) {
       dList_remove_fast(CachedIMGs, entry);
+      Dicache_job_free(entry);
+      Dicache_job_drop_closes(entry);
       a_Url_free(entry->url);
       dFree(entry->cmap);
       a_Bitvec_free(entry->BitVec);
@@ -9,6 +9,7 @@ extern "C" {
 #include "bitvec.h"
 #include "image.hh"
 #include "cache.h"
+#include "decodepool.h"
 
 /* Symbolic name to request the last version of an image */
 #define DIC_Last  -1
@@ -31,6 +32,8 @@ typedef struct DICacheEntry {
    DilloUrl *url;          /* Image URL for this entry */
    DilloImgType type;      /* Image type */
    uint_t width, height;   /* As taken from image data */
+   uint_t ReqWidth;        /* Display size the decoder was allowed to */
+   uint_t ReqHeight;       /*  reduce the image to (zero: full size) */
    short Flags;            /* See Flags */
    short SurvCleanup;      /* Cleanup-pass survival for unused images */
    uchar_t *cmap;          /* Color map */
@@ -46,6 +49,10 @@ typedef struct DICacheEntry {
    uint_t DecodedSize;     /* Size of already decoded data */
    CA_Callback_t Decoder;  /* Client function */
    void *DecoderData;      /* Client function data */
+
+   DecodeJob *Job;         /* Decoding job, when decoding in the pool */
+   DilloImage *JobImage;   /* Image the decoder was created with [ref] */
+   Dlist *JobCloses;       /* Client closes waiting for the job to end */
 } DICacheEntry;
 
 
@@ -70,11 +77,16 @@ void a_Dicache_set_cmap(DilloUrl *url, int version, int bg_color,
 void a_Dicache_new_scan(const DilloUrl *url, int version);
 void a_Dicache_write(DilloUrl *url, int version, const uchar_t *buf, uint_t Y);
 void a_Dicache_close(DilloUrl *url, int version, CacheClient_t *Client);
+bool_t a_Dicache_input_complete(const DilloUrl *url);
+uint_t a_Dicache_reduction(uint_t req_width, uint_t req_height,
+                           uint_t width, uint_t height, uint_t max);
 
 void a_Dicache_invalidate_entry(const DilloUrl *Url);
 DICacheEntry* a_Dicache_ref(const DilloUrl *Url, int version);
 void a_Dicache_unref(const DilloUrl *Url, int version);
+void a_Dicache_stop_client(int Key);
 void a_Dicache_cleanup(void);
+void a_Dicache_memory_usage(int *num_entries, uint_t *total_size);
 void a_Dicache_freeall(void);
 
 
@@ -55,6 +55,7 @@
 #include "domain.h"
 #include "auth.h"
 #include "styleengine.hh"
+#include "lout/trace.h"
 
 #include "dw/fltkcore.hh"
 #include "dw/widget.hh"
@@ -461,6 +462,7 @@ int main(int argc, char **argv)
       fclose(fp);
    }
    dLib_show_messages(prefs.show_msg);
+   a_Trace_set_enabled(prefs.trace_events);
 
    // initialize internal modules
    a_Dpi_init();
@@ -471,6 +473,7 @@ int main(int argc, char **argv)
    a_Mime_init();
    a_Capi_init();
    a_Dicache_init();
+   a_Decodepool_init();
    a_Bw_init();
    a_Cookies_init();
    a_Hsts_init(Paths::getPrefsFP(PATHS_HSTS_PRELOAD));
@@ -480,6 +483,7 @@ int main(int argc, char **argv)
 
    dw::core::Widget::setAdjustMinWidth (prefs.adjust_min_width);
    dw::Table::setAdjustTableMinWidth (prefs.adjust_table_min_width);
+   dw::Table::setMinVirtualRows (prefs.table_virtual_rows);
    dw::Textblock::setPenaltyHyphen (prefs.penalty_hyphen);
    dw::Textblock::setPenaltyHyphen2 (prefs.penalty_hyphen_2);
    dw::Textblock::setPenaltyEmDashLeft (prefs.penalty_em_dash_left);
@@ -590,6 +594,7 @@ int main(int argc, char **argv)
    a_Hsts_freeall();
    a_Cache_freeall();
    a_Dicache_freeall();
+   a_Decodepool_freeall();
    a_Http_freeall();
    a_Tls_freeall();
    a_Dns_freeall();
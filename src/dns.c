@@ -41,6 +41,7 @@
 #include "dns.h"
 #include "list.h"
 #include "IO/iowatch.hh"
+#include "lout/trace.h"
 
 
 /* Maximum dns resolving threads */
@@ -270,6 +271,7 @@ static void *Dns_server(void *data)
    Dlist *hosts;
    size_t length, i;
    char addr_string[40];
+   trace_time_t start = 0;
 
    memset(&hints, 0, sizeof(hints));
 #ifdef ENABLE_IPV6
@@ -284,7 +286,9 @@ static void *Dns_server(void *data)
    _MSG("Dns_server: starting...\n ch: %d host: %s\n",
         channel, dns_server[channel].hostname);
 
+   TRACE_SET_START(start);
    error = getaddrinfo(dns_server[channel].hostname, NULL, &hints, &res0);
+   TRACE_SPAN("net", "DNS", start);
 
    if (error != 0) {
       dns_server[channel].status = error;
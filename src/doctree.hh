@@ -1,8 +1,29 @@
 #ifndef __DOCTREE_HH__
 #define __DOCTREE_HH__
 
+#include <new>
+
 #include "lout/misc.hh"
 
+/**
+ * \brief The class names of a DoctreeNode, allocated from the Doctree's zone.
+ */
+class DoctreeClasses {
+   public:
+      int num;
+      char **names;
+
+      inline int size () { return num; };
+      inline char *get (int i) { return names[i]; };
+};
+
+/**
+ * \brief A node of the document tree.
+ *
+ * Nodes live as long as the page, so they, their id and their class
+ * names are allocated from the Doctree's zone. Nothing in them is freed
+ * individually, and they need no destructor.
+ */
 class DoctreeNode {
    public:
       DoctreeNode *parent;
@@ -10,7 +31,7 @@ class DoctreeNode {
       DoctreeNode *lastChild;
       int num; // unique ascending id
       int element;
-      lout::misc::SimpleVector<char*> *klass;
+      DoctreeClasses *klass;
       const char *pseudo;
       const char *id;
 
@@ -23,20 +44,6 @@ class DoctreeNode {
          id = NULL;
          element = 0;
       };
-
-      ~DoctreeNode () {
-         dFree ((void*) id);
-         while (lastChild) {
-            DoctreeNode *n = lastChild;
-            lastChild = lastChild->sibling;
-            delete n;
-         }
-         if (klass) {
-            for (int i = 0; i < klass->size (); i++)
-               dFree (klass->get(i));
-            delete klass;
-         }
-      }
 };
 
 /**
@@ -50,20 +57,27 @@ class Doctree {
       DoctreeNode *topNode;
       DoctreeNode *rootNode;
       int num;
+      lout::misc::ZoneAllocator *zone;
+
+      inline DoctreeNode *newNode () {
+         return new (zone->zoneAllocObject (sizeof (DoctreeNode))) DoctreeNode ();
+      };
 
    public:
-      Doctree () {
-         rootNode = new DoctreeNode;
+      Doctree (lout::misc::ZoneAllocator *zone) {
+         this->zone = zone;
+         rootNode = newNode ();
          topNode = rootNode;
          num = 0;
       };
 
-      ~Doctree () {
-         delete rootNode;
-      };
+      /* All nodes are in the zone, which the owner frees in one go. */
+      ~Doctree () {};
+
+      inline lout::misc::ZoneAllocator *getZone () { return zone; };
 
       DoctreeNode *push () {
-         DoctreeNode *dn = new DoctreeNode ();
+         DoctreeNode *dn = newNode ();
          dn->parent = topNode;
          dn->sibling = dn->parent->lastChild;
          dn->parent->lastChild = dn;
@@ -116,6 +116,8 @@ public:
    DilloHtmlInput *getRadioInput (const char *name);
    void submit(DilloHtmlInput *active_input, EventButton *event);
    void reset ();
+   void saveState (Dlist *values);
+   void restoreState (Dlist *values);
    void display_hiddens(bool display);
    void addInput(DilloHtmlInput *input, DilloHtmlInputType type);
    void setEnabled(bool enabled);
@@ -143,8 +145,8 @@ class DilloHtmlInput {
 public:  //BUG: for now everything is public
    DilloHtmlInputType type;
    Embed *embed; /* May be NULL (think: hidden input) */
-   char *name;
-   char *init_str;    /* note: some overloading - for buttons, init_str
+   const char *name;  /* name and init_str are in the page's zone */
+   const char *init_str; /* note: some overloading - for buttons, init_str
                          is simply the value of the button; for text
                          entries, it is the initial value */
    DilloHtmlSelect *select;
@@ -158,11 +160,14 @@ private:
    void readFile(BrowserWindow *bw);
 
 public:
-   DilloHtmlInput (DilloHtmlInputType type, Embed *embed,
-                   const char *name, const char *init_str, bool init_val);
+   DilloHtmlInput (lout::misc::ZoneAllocator *zone, DilloHtmlInputType type,
+                   Embed *embed, const char *name, const char *init_str,
+                   bool init_val);
    ~DilloHtmlInput ();
    void appendValuesTo(Dlist *values, bool is_active_submit);
    void reset();
+   Dstr *getState();
+   void setState(Dstr *state);
    void setEnabled(bool enabled) {if (embed) embed->setEnabled(enabled); };
 };
 
@@ -264,6 +269,16 @@ void a_Html_form_display_hiddens2(void *vform, bool display)
    ((DilloHtmlForm *)vform)->display_hiddens(display);
 }
 
+void a_Html_form_save_state2(void *vform, Dlist *values)
+{
+   ((DilloHtmlForm *)vform)->saveState(values);
+}
+
+void a_Html_form_restore_state2(void *vform, Dlist *values)
+{
+   ((DilloHtmlForm *)vform)->restoreState(values);
+}
+
 /*
  * Form parsing functions
  */
@@ -276,8 +291,8 @@ static void Html_add_input(DilloHtml *html, DilloHtmlInputType type,
                            const char *init_str, bool init_val)
 {
    _MSG("name=[%s] init_str=[%s] init_val=[%d]\n", name, init_str, init_val);
-   DilloHtmlInput *input = new DilloHtmlInput(type, embed, name, init_str,
-                                              init_val);
+   DilloHtmlInput *input = new DilloHtmlInput(html->zone, type, embed, name,
+                                              init_str, init_val);
    if (html->InFlags & IN_FORM) {
       html->getCurrentForm()->addInput(input, type);
    } else {
@@ -723,9 +738,10 @@ void Html_tag_close_textarea(DilloHtml *html)
       str = a_Html_parse_entities(html, html->Stash->str, html->Stash->len);
       input = Html_get_current_input(html);
       if (input) {
-         input->init_str = str;
+         input->init_str = html->zone->strdup(str);
          ((MultiLineTextResource *)input->embed->getResource ())->setText(str);
       }
+      dFree(str);
 
    }
    html->InFlags &= ~IN_TEXTAREA;
@@ -1527,6 +1543,29 @@ void DilloHtmlForm::reset ()
       inputs->get(i)->reset();
 }
 
+/*
+ * Append the current state of all inputs to 'values' (one Dstr per input).
+ */
+void DilloHtmlForm::saveState (Dlist *values)
+{
+   int size = inputs->size();
+   for (int i = 0; i < size; i++)
+      dList_append(values, inputs->get(i)->getState());
+}
+
+/*
+ * Set the inputs to a state saved by saveState(). The form must have been
+ * parsed from the same document; if the number of inputs differs, nothing
+ * is changed.
+ */
+void DilloHtmlForm::restoreState (Dlist *values)
+{
+   int size = inputs->size();
+   if (size == dList_length(values))
+      for (int i = 0; i < size; i++)
+         inputs->get(i)->setState((Dstr*)dList_nth_data(values, i));
+}
+
 /*
  * Show/hide "hidden" form controls
  */
@@ -1649,16 +1688,17 @@ void DilloHtmlReceiver::clicked (Resource *resource,
  */
 
 /*
- * Constructor
+ * Constructor. The strings are copied to "zone", which outlives the input.
  */
-DilloHtmlInput::DilloHtmlInput (DilloHtmlInputType type2, Embed *embed2,
+DilloHtmlInput::DilloHtmlInput (lout::misc::ZoneAllocator *zone,
+                                DilloHtmlInputType type2, Embed *embed2,
                                 const char *name2, const char *init_str2,
                                 bool init_val2)
 {
    type = type2;
    embed = embed2;
-   name = (name2) ? dStrdup(name2) : NULL;
-   init_str = (init_str2) ? dStrdup(init_str2) : NULL;
+   name = (name2) ? zone->strdup(name2) : NULL;
+   init_str = (init_str2) ? zone->strdup(init_str2) : NULL;
    init_val = init_val2;
    select = NULL;
    switch (type) {
@@ -1678,8 +1718,6 @@ DilloHtmlInput::DilloHtmlInput (DilloHtmlInputType type2, Embed *embed2,
  */
 DilloHtmlInput::~DilloHtmlInput ()
 {
-   dFree(name);
-   dFree(init_str);
    dStr_free(file_data, 1);
    if (select)
       delete select;
@@ -1883,6 +1921,85 @@ void DilloHtmlInput::reset ()
    }
 }
 
+/*
+ * Return the current state of the input as a string: the text of entries
+ * and text areas, "0"/"1" for toggle buttons, and one "0"/"1" per item
+ * for selections. Other inputs have no state (the empty string).
+ */
+Dstr *DilloHtmlInput::getState ()
+{
+   Dstr *state = dStr_new("");
+
+   switch (type) {
+   case DILLO_HTML_INPUT_TEXT:
+   case DILLO_HTML_INPUT_PASSWORD:
+   case DILLO_HTML_INPUT_INDEX:
+   case DILLO_HTML_INPUT_TEXTAREA:
+      {
+         TextResource *textres = (TextResource*)embed->getResource();
+         dStr_append(state, textres->getText());
+      }
+      break;
+   case DILLO_HTML_INPUT_CHECKBOX:
+   case DILLO_HTML_INPUT_RADIO:
+      {
+         ToggleButtonResource *tb_r =
+            (ToggleButtonResource*)embed->getResource();
+         dStr_append_c(state, tb_r->isActivated() ? '1' : '0');
+      }
+      break;
+   case DILLO_HTML_INPUT_SELECT:
+   case DILLO_HTML_INPUT_SEL_LIST:
+      if (select != NULL) {
+         SelectionResource *sr = (SelectionResource *) embed->getResource();
+         int n = sr->getNumberOfItems();
+         for (int i = 0; i < n; i++)
+            dStr_append_c(state, sr->isSelected(i) ? '1' : '0');
+      }
+      break;
+   default:
+      break;
+   }
+   return state;
+}
+
+/*
+ * Set the input to a state returned by getState().
+ */
+void DilloHtmlInput::setState (Dstr *state)
+{
+   switch (type) {
+   case DILLO_HTML_INPUT_TEXT:
+   case DILLO_HTML_INPUT_PASSWORD:
+   case DILLO_HTML_INPUT_INDEX:
+   case DILLO_HTML_INPUT_TEXTAREA:
+      {
+         TextResource *textres = (TextResource*)embed->getResource();
+         textres->setText(state->str);
+      }
+      break;
+   case DILLO_HTML_INPUT_CHECKBOX:
+   case DILLO_HTML_INPUT_RADIO:
+      if (state->len == 1) {
+         ToggleButtonResource *tb_r =
+            (ToggleButtonResource*)embed->getResource();
+         tb_r->setActivated(state->str[0] == '1');
+      }
+      break;
+   case DILLO_HTML_INPUT_SELECT:
+   case DILLO_HTML_INPUT_SEL_LIST:
+      if (select != NULL) {
+         SelectionResource *sr = (SelectionResource *) embed->getResource();
+         if (sr->getNumberOfItems() == state->len)
+            for (int i = 0; i < state->len; i++)
+               sr->setItem(i, state->str[i] == '1');
+      }
+      break;
+   default:
+      break;
+   }
+}
+
 /*
  * DilloHtmlSelect
  */
@@ -41,6 +41,8 @@ void a_Html_input_delete(DilloHtmlInput* input);
 void a_Html_form_submit2(void *v_form);
 void a_Html_form_reset2(void *v_form);
 void a_Html_form_display_hiddens2(void *v_form, bool display);
+void a_Html_form_save_state2(void *v_form, Dlist *values);
+void a_Html_form_restore_state2(void *v_form, Dlist *values);
 
 
 /*
@@ -45,6 +45,7 @@
 #include "dw/listitem.hh"
 #include "dw/image.hh"
 #include "dw/ruler.hh"
+#include "lout/trace.h"
 
 /*-----------------------------------------------------------------------------
  * Defines
@@ -282,6 +283,69 @@ void a_Html_form_display_hiddens(void *v_html, void *v_form, bool_t display)
    }
 }
 
+/*
+ * Form contents of a page, kept while its tab is hibernated.
+ */
+typedef struct {
+   DilloUrl *url;
+   Dlist *forms;     /* one Dlist of input states per form */
+} Html_form_state;
+
+/*
+ * Save the contents of the page's forms, to restore them when the page is
+ * parsed again (see DilloHtml::finishParsing). Returns NULL if there are
+ * no forms.
+ */
+void *a_Html_form_state_save(void *v_html)
+{
+   DilloHtml *html = (DilloHtml*)v_html;
+   Html_form_state *state = NULL;
+
+   if (html && html->forms->size() > 0) {
+      state = dNew(Html_form_state, 1);
+      state->url = a_Url_dup(html->page_url);
+      state->forms = dList_new(html->forms->size());
+      for (int i = 0; i < html->forms->size(); i++) {
+         Dlist *values = dList_new(8);
+         a_Html_form_save_state2(html->forms->get(i), values);
+         dList_append(state->forms, values);
+      }
+   }
+   return state;
+}
+
+void a_Html_form_state_free(void *v_state)
+{
+   Html_form_state *state = (Html_form_state*)v_state;
+   Dlist *values;
+
+   if (state) {
+      a_Url_free(state->url);
+      for (int i = 0; (values = (Dlist*)dList_nth_data(state->forms, i));
+           i++) {
+         for (int j = 0; j < dList_length(values); j++)
+            dStr_free((Dstr*)dList_nth_data(values, j), 1);
+         dList_free(values);
+      }
+      dList_free(state->forms);
+      dFree(state);
+   }
+}
+
+/*
+ * Restore form contents saved by a_Html_form_state_save(), if they belong
+ * to this page.
+ */
+static void Html_form_state_restore(DilloHtml *html, Html_form_state *state)
+{
+   if (a_Url_cmp(state->url, html->page_url) == 0 &&
+       dList_length(state->forms) == html->forms->size()) {
+      for (int i = 0; i < html->forms->size(); i++)
+         a_Html_form_restore_state2(html->forms->get(i),
+                                    (Dlist*)dList_nth_data(state->forms, i));
+   }
+}
+
 /*
  * Set the URL data for image maps.
  */
@@ -458,7 +522,8 @@ DilloHtml::DilloHtml(BrowserWindow *p_bw, const DilloUrl *url,
    DocType = DT_NONE;    /* assume Tag Soup 0.0!   :-) */
    DocTypeVersion = 0.0f;
 
-   styleEngine = new StyleEngine (HT2LT (this), page_url, base_url);
+   zone = new misc::ZoneAllocator (16 * 1024);
+   styleEngine = new StyleEngine (HT2LT (this), zone, page_url, base_url);
 
    cssUrls = new misc::SimpleVector <DilloUrl*> (1);
 
@@ -566,11 +631,11 @@ DilloHtml::~DilloHtml()
       DilloHtmlImage *img = images->get(i);
       a_Url_free(img->url);
       a_Image_unref(img->image);
-      dFree(img);
    }
    delete (images);
 
    delete styleEngine;
+   delete zone;
 }
 
 /*
@@ -582,6 +647,7 @@ void DilloHtml::write(char *Buf, int BufSize, int Eof)
    int token_start;
    char *buf = Buf + Start_Ofs;
    int bufsize = BufSize - Start_Ofs;
+   TRACE_SCOPE ("parse", "parse chunk");
 
    _MSG("DilloHtml::write BufSize=%d Start_Ofs=%d\n", BufSize, Start_Ofs);
 #if 0
@@ -676,6 +742,13 @@ void DilloHtml::finishParsing(int ClientKey)
    /* Nothing left to do with the parser. Clear all flags, except EOF. */
    InFlags = IN_EOF;
 
+   /* Give back the form contents of a page woken from hibernation */
+   if (bw->form_state) {
+      Html_form_state_restore(this, (Html_form_state*)bw->form_state);
+      a_Html_form_state_free(bw->form_state);
+      bw->form_state = NULL;
+   }
+
    /* Remove this client from our active list */
    a_Bw_close_client(bw, ClientKey);
 }
@@ -2172,7 +2245,19 @@ DilloImage *a_Html_image_new(DilloHtml *html, const char *tag, int tagsize)
    if (HT2TB(html)->getBgColor())
       image->bg_color = HT2TB(html)->getBgColor()->getColor();
 
-   DilloHtmlImage *hi = dNew(DilloHtmlImage, 1);
+   /* When the display size is fixed, the decoder may reduce the image
+    * data to it instead of keeping it at full size. */
+   dw::core::style::Style *style = html->style ();
+   if (dw::core::style::isAbsLength (style->width) &&
+       dw::core::style::isAbsLength (style->height) &&
+       style->minWidth == dw::core::style::LENGTH_AUTO &&
+       style->minHeight == dw::core::style::LENGTH_AUTO) {
+      image->req_width = dw::core::style::absLengthVal (style->width);
+      image->req_height = dw::core::style::absLengthVal (style->height);
+   }
+
+   DilloHtmlImage *hi =
+      (DilloHtmlImage *) html->zone->zoneAllocObject(sizeof(DilloHtmlImage));
    hi->url = url;
    html->images->increase();
    html->images->set(html->images->size() - 1, hi);
@@ -3506,7 +3591,7 @@ static const TagInfo Tags[] = {
  {"center", B8(01110),'R', Html_tag_open_default, NULL, NULL},
  {"cite", B8(01011),'R', Html_tag_open_default, NULL, NULL},
  {"code", B8(01011),'R', Html_tag_open_default, NULL, NULL},
- /* col 010010 'F' */
+ {"col", B8(01000),'F', Html_tag_open_col, Html_tag_content_col, NULL},
  /* colgroup */
  {"dd", B8(01110),'O', Html_tag_open_dd, NULL, NULL},
  {"del", B8(01111),'R', Html_tag_open_default, NULL, NULL},
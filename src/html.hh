@@ -14,6 +14,8 @@ void a_Html_load_images(void *v_html, DilloUrl *pattern);
 void a_Html_form_submit(void *v_html, void *v_form);
 void a_Html_form_reset(void *v_html, void *v_form);
 void a_Html_form_display_hiddens(void *v_html, void *v_form, bool_t display);
+void *a_Html_form_state_save(void *v_html);
+void a_Html_form_state_free(void *v_state);
 
 #ifdef __cplusplus
 }
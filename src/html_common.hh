@@ -203,6 +203,10 @@ public:  //BUG: for now everything is public
    lout::misc::SimpleVector<DilloHtmlImage*> *images;
    dw::ImageMapsList maps;
 
+   /* Zone for small objects living as long as the page (document tree
+    * nodes, id and class strings, image records); freed all at once. */
+   lout::misc::ZoneAllocator *zone;
+
    /* -------------------------------------------------------------------*/
    /* Variables used by Gemini, Gopher and Markdown parsers                      */
    /* -------------------------------------------------------------------*/
@@ -39,6 +39,8 @@ DilloImage *a_Image_new(void *layout, void *img_rndr, int32_t bg_color)
    Image->img_rndr = img_rndr;
    Image->width = 0;
    Image->height = 0;
+   Image->req_width = 0;
+   Image->req_height = 0;
    Image->bg_color = bg_color;
    Image->ScanNumber = 0;
    Image->BitVec = NULL;
@@ -50,6 +50,11 @@ struct _DilloImage {
    uint_t width;
    uint_t height;
 
+   /* Size it will be displayed at, when known beforehand (or zero).
+    * Decoders may reduce the image data down to it. */
+   uint_t req_width;
+   uint_t req_height;
+
    int32_t bg_color;        /* Background color */
    bitvec_t *BitVec;        /* Bit vector for decoded rows */
    uint_t ScanNumber;       /* Current decoding scan */
@@ -33,7 +33,6 @@
 #include "image.hh"
 #include "cache.h"
 #include "dicache.h"
-#include "capi.h"       /* get cache entry status */
 #include "msg.h"
 
 typedef enum {
@@ -65,6 +64,7 @@ struct DilloJpeg {
    DilloImage *Image;
    DilloUrl *url;
    int version;
+   uint_t req_width, req_height;   /* Display size, if known */
 
    my_source_mgr Src;
 
@@ -193,6 +193,8 @@ void *a_Jpeg_new(DilloImage *Image, DilloUrl *url, int version)
    jpeg->Image = Image;
    jpeg->url = url;
    jpeg->version = version;
+   jpeg->req_width = Image->req_width;
+   jpeg->req_height = Image->req_height;
 
    jpeg->state = DILLO_JPEG_INIT;
    jpeg->Start_Ofs = 0;
@@ -284,7 +286,7 @@ static void Jpeg_write(DilloJpeg *jpeg, void *Buf, uint_t BufSize)
           * use progressive display, updating as it arrives.
           */
          if (jpeg_has_multiple_scans(&jpeg->cinfo) &&
-             !(a_Capi_get_flags(jpeg->url) & CAPI_Completed))
+             !a_Dicache_input_complete(jpeg->url))
             jpeg->cinfo.buffered_image = TRUE;
 
          /* check max image size */
@@ -298,10 +300,19 @@ static void Jpeg_write(DilloJpeg *jpeg, void *Buf, uint_t BufSize)
             return;
          }
 
+         /* Let libjpeg's DCT scaling reduce images that are only
+          * displayed at a fraction of their size. */
+         jpeg->cinfo.scale_num = 1;
+         jpeg->cinfo.scale_denom =
+            a_Dicache_reduction(jpeg->req_width, jpeg->req_height,
+                                (uint_t)jpeg->cinfo.image_width,
+                                (uint_t)jpeg->cinfo.image_height, 8);
+         jpeg_calc_output_dimensions(&jpeg->cinfo);
+
          /** \todo Gamma for JPEG? */
          a_Dicache_set_parms(jpeg->url, jpeg->version, jpeg->Image,
-                             (uint_t)jpeg->cinfo.image_width,
-                             (uint_t)jpeg->cinfo.image_height,
+                             (uint_t)jpeg->cinfo.output_width,
+                             (uint_t)jpeg->cinfo.output_height,
                              type, 1 / 2.2);
          jpeg->Image = NULL; /* safeguard: may be freed by its owner later */
 
@@ -342,8 +353,8 @@ static void Jpeg_write(DilloJpeg *jpeg, void *Buf, uint_t BufSize)
    }
 
    if (jpeg->state == DILLO_JPEG_READ_IN_SCAN) {
-      linebuf = dMalloc(jpeg->cinfo.image_width *
-                         jpeg->cinfo.num_components);
+      linebuf = dMalloc(jpeg->cinfo.output_width *
+                         jpeg->cinfo.output_components);
       array[0] = linebuf;
 
       while (1) {
@@ -356,7 +367,7 @@ static void Jpeg_write(DilloJpeg *jpeg, void *Buf, uint_t BufSize)
 
          jpeg->y++;
 
-         if (jpeg->y == jpeg->cinfo.image_height) {
+         if (jpeg->y == jpeg->cinfo.output_height) {
             /* end of scan */
             if (!jpeg->cinfo.buffered_image) {
                /* single scan */
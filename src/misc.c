@@ -203,6 +203,44 @@ int a_Misc_get_content_type_from_data(void *Data, size_t Size, const char **PT)
    return st;
 }
 
+/*
+ * Return a content type based on the extension of a local filename,
+ * or NULL if it isn't known.
+ * (Keep in sync with FileUtil_ext() in the dpis).
+ */
+const char *a_Misc_get_content_type_from_ext(const char *filename)
+{
+   static const struct {
+      const char *ext, *type;
+   } Exts[] = {
+      {"gif", "image/gif"},
+      {"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"},
+      {"png", "image/png"},
+      {"html", "text/html"}, {"htm", "text/html"},
+      {"shtml", "text/html"}, {"xhtml", "text/html"},
+      {"xml", "text/xml"}, {"ncx", "text/xml"}, {"opf", "text/xml"},
+      {"pdf", "application/pdf"},
+      {"zip", "application/zip"},
+      {"epub", "application/epub"},
+      {"rss", "application/rss+xml"},
+      {"gmi", "text/gemini"},
+      {"gophermap", "text/gopher"},
+      {"md", "text/markdown"},
+      {"js", "text/javascript"},
+      {"css", "text/css"},
+      {"txt", "text/plain"}
+   };
+   const char *e;
+   uint_t i;
+
+   if (!(e = strrchr(filename, '.')))
+      return NULL;
+   for (++e, i = 0; i < sizeof(Exts) / sizeof(Exts[0]); ++i)
+      if (!dStrAsciiCasecmp(e, Exts[i].ext))
+         return Exts[i].type;
+   return NULL;
+}
+
 /*
  * Parse Content-Type string, e.g., "text/html; charset=utf-8".
  * Content-Type is defined in RFC 2045 section 5.1.
@@ -354,6 +392,200 @@ int a_Misc_content_type_check(const char *EntryType, const char *DetectedType)
    return st;
 }
 
+/*
+ * Prescan helpers (HTML5 spec, "prescan a byte stream to determine its
+ * encoding"). Whitespace here is the spec's ASCII whitespace set.
+ */
+#define PRESCAN_IS_SPACE(c) ((c) == 0x09 || (c) == 0x0A || (c) == 0x0C || \
+                             (c) == 0x0D || (c) == 0x20)
+
+/*
+ * Get an attribute from a tag in the prescan buffer.
+ * On success, name and value are set (both lowercased) and 1 is returned.
+ * Return 0 if there are no more attributes, and -1 at end of data.
+ */
+static int Misc_prescan_get_attr(const char *buf, size_t len, size_t *pos,
+                                 Dstr *name, Dstr *value)
+{
+   size_t i = *pos;
+   char quote;
+
+   dStr_truncate(name, 0);
+   dStr_truncate(value, 0);
+
+   for ( ; i < len && (PRESCAN_IS_SPACE(buf[i]) || buf[i] == '/'); ++i) ;
+   if (i >= len)
+      return -1;
+   if (buf[i] == '>') {
+      *pos = i;
+      return 0;
+   }
+
+   /* attribute name */
+   for ( ; i < len; ++i) {
+      if (buf[i] == '=' && name->len) {
+         break;
+      } else if (PRESCAN_IS_SPACE(buf[i])) {
+         for ( ; i < len && PRESCAN_IS_SPACE(buf[i]); ++i) ;
+         if (i < len && buf[i] != '=') {
+            *pos = i;
+            return 1;
+         }
+         break;
+      } else if (buf[i] == '/' || buf[i] == '>') {
+         *pos = i;
+         return 1;
+      }
+      dStr_append_c(name, D_ASCII_TOLOWER(buf[i]));
+   }
+   if (i >= len)
+      return -1;
+
+   /* attribute value (buf[i] is '=') */
+   for (++i; i < len && PRESCAN_IS_SPACE(buf[i]); ++i) ;
+   if (i >= len)
+      return -1;
+   if (buf[i] == '"' || buf[i] == '\'') {
+      for (quote = buf[i++]; i < len && buf[i] != quote; ++i)
+         dStr_append_c(value, D_ASCII_TOLOWER(buf[i]));
+      if (i >= len)
+         return -1;
+      *pos = i + 1;
+      return 1;
+   }
+   for ( ; i < len && !PRESCAN_IS_SPACE(buf[i]) && buf[i] != '>'; ++i)
+      dStr_append_c(value, D_ASCII_TOLOWER(buf[i]));
+   if (i >= len)
+      return -1;
+   *pos = i;
+   return 1;
+}
+
+/*
+ * Extract a character encoding from a META content attribute value.
+ * Return value: New string, or NULL.
+ */
+static char *Misc_prescan_content_charset(const char *str)
+{
+   const char *s = str, *e;
+
+   while ((s = dStriAsciiStr(s, "charset"))) {
+      for (s += 7; PRESCAN_IS_SPACE(*s); ++s) ;
+      if (*s != '=')
+         continue;
+      for (++s; PRESCAN_IS_SPACE(*s); ++s) ;
+      if (*s == '"' || *s == '\'') {
+         if ((e = strchr(s + 1, *s)))
+            return dStrndup(s + 1, e - s - 1);
+         return NULL;
+      }
+      for (e = s; *e && !PRESCAN_IS_SPACE(*e) && *e != ';'; ++e) ;
+      return (e > s) ? dStrndup(s, e - s) : NULL;
+   }
+   return NULL;
+}
+
+/*
+ * Examine a META tag's attributes in the prescan buffer.
+ * Return value: New string with the charset, or NULL.
+ */
+static char *Misc_prescan_meta(const char *buf, size_t len, size_t *pos)
+{
+   enum { GOT_EQUIV = 1, GOT_CONTENT = 2, GOT_CHARSET = 4 };
+   Dstr *name = dStr_new(""), *value = dStr_new("");
+   int st, seen = 0, got_pragma = 0, need_pragma = -1;
+   char *charset = NULL, *cs;
+
+   while ((st = Misc_prescan_get_attr(buf, len, pos, name, value)) == 1) {
+      if (!strcmp(name->str, "http-equiv") && !(seen & GOT_EQUIV)) {
+         seen |= GOT_EQUIV;
+         if (!strcmp(value->str, "content-type"))
+            got_pragma = 1;
+      } else if (!strcmp(name->str, "content") && !(seen & GOT_CONTENT)) {
+         seen |= GOT_CONTENT;
+         if (!charset && (cs = Misc_prescan_content_charset(value->str))) {
+            charset = cs;
+            need_pragma = 1;
+         }
+      } else if (!strcmp(name->str, "charset") && !(seen & GOT_CHARSET)) {
+         seen |= GOT_CHARSET;
+         dFree(charset);
+         charset = dStrdup(value->str);
+         need_pragma = 0;
+      }
+   }
+   dStr_free(name, 1);
+   dStr_free(value, 1);
+
+   if (st < 0 || need_pragma == -1 || (need_pragma == 1 && !got_pragma) ||
+       (charset && !*charset)) {
+      dFree(charset);
+      return NULL;
+   }
+   if (charset && !dStrnAsciiCasecmp(charset, "utf-16", 6)) {
+      /* the document is ASCII-compatible, so it can't really be UTF-16 */
+      dFree(charset);
+      charset = dStrdup("UTF-8");
+   } else if (charset && !dStrAsciiCasecmp(charset, "x-user-defined")) {
+      dFree(charset);
+      charset = dStrdup("windows-1252");
+   }
+   return charset;
+}
+
+/*
+ * Prescan the first bytes of an HTML document for its character encoding,
+ * following the "prescan a byte stream" algorithm from the HTML5 spec.
+ *
+ * This lets the cache set up the charset decoder before the parser gets
+ * any data, instead of restarting the parse when it finds the META tag.
+ * Only the first PRESCAN_SIZE bytes of 'Data' are examined.
+ *
+ * Return value: New string with the charset, or NULL if none was found.
+ */
+char *a_Misc_prescan_charset(const char *Data, size_t Size)
+{
+   const char *p = Data;
+   const char *e;
+   char *charset;
+   size_t i, len = MIN(Size, PRESCAN_SIZE);
+   Dstr *name, *value;
+
+   if (len >= 3 && !memcmp(p, "\xEF\xBB\xBF", 3))
+      return dStrdup("UTF-8");
+
+   for (i = 0; i < len; ++i) {
+      if (p[i] != '<')
+         continue;
+      if (len - i >= 4 && !strncmp(p + i, "<!--", 4)) {
+         for (i += 2; i + 2 < len && strncmp(p + i, "-->", 3); ++i) ;
+         i += 2;
+      } else if (len - i >= 6 && !dStrnAsciiCasecmp(p + i, "<meta", 5) &&
+                 (PRESCAN_IS_SPACE(p[i + 5]) || p[i + 5] == '/')) {
+         i += 6;
+         if ((charset = Misc_prescan_meta(p, len, &i)))
+            return charset;
+      } else if (len - i >= 2 &&
+                 (isalpha((uchar_t)p[i + 1]) ||
+                  (p[i + 1] == '/' && len - i >= 3 &&
+                   isalpha((uchar_t)p[i + 2])))) {
+         /* skip the tag name and its attributes */
+         for ( ; i < len && !PRESCAN_IS_SPACE(p[i]) && p[i] != '>'; ++i) ;
+         name = dStr_new("");
+         value = dStr_new("");
+         while (Misc_prescan_get_attr(p, len, &i, name, value) == 1) ;
+         dStr_free(name, 1);
+         dStr_free(value, 1);
+      } else if (len - i >= 2 &&
+                 (p[i + 1] == '!' || p[i + 1] == '/' || p[i + 1] == '?')) {
+         if (!(e = memchr(p + i, '>', len - i)))
+            break;
+         i = e - p;
+      }
+   }
+   return NULL;
+}
+
 /*
  * Parse a geometry string.
  */
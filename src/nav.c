@@ -22,6 +22,8 @@
 #include "prefs.h"
 #include "capi.h"
 #include "timeout.hh"
+#include "html.hh"
+#include "dicache.h"
 
 /*
  * For back and forward navigation, each bw keeps an url index,
@@ -396,6 +398,66 @@ void a_Nav_repush(BrowserWindow *bw)
    a_Timeout_add(0.0, Nav_repush_callback, (void*)bw);
 }
 
+/*
+ * Hibernate the page of a tab that is not shown: drop its widgets and
+ * images, keeping the scroll position and form contents, so that
+ * a_Nav_wake() can render it again from the cache.
+ * Return value: 1 if hibernated, 0 if the page can't be (e.g. still loading).
+ */
+int a_Nav_hibernate(BrowserWindow *bw)
+{
+   const DilloUrl *url;
+   int x, y, flags;
+
+   dReturn_val_if_fail (bw != NULL, 0);
+
+   if (bw->hibernated || a_Bw_expecting(bw) ||
+       dList_length(bw->RootClients) > 0 ||
+       !(url = a_History_get_url(NAV_TOP_UIDX(bw))))
+      return 0;
+   flags = a_Capi_get_flags_with_redirection(url);
+   if (!(flags & CAPI_IsCached) || !(flags & CAPI_Completed))
+      return 0;
+
+   _MSG("a_Nav_hibernate: '%s'\n", URL_STR(url));
+   a_UIcmd_get_scroll_xy(bw, &x, &y);
+   Nav_save_scroll_pos(bw, a_Nav_stack_ptr(bw), x, y);
+   a_Html_form_state_free(bw->form_state);
+   bw->form_state = a_Html_form_state_save(a_Bw_get_current_doc(bw));
+
+   a_Bw_stop_clients(bw, BW_Img);
+   a_Bw_cleanup(bw);
+   a_UIcmd_clear_page(bw);
+   /* Let go of decoded images nobody else uses */
+   a_Dicache_cleanup();
+   bw->hibernated = 1;
+   return 1;
+}
+
+/*
+ * Render the page of a hibernated tab again, from the cache.
+ */
+void a_Nav_wake(BrowserWindow *bw)
+{
+   DilloUrl *url;
+
+   dReturn_if_fail (bw != NULL);
+
+   if (bw->hibernated) {
+      bw->hibernated = 0;
+      a_Nav_cancel_expect(bw);
+      if (a_Nav_stack_size(bw)) {
+         url = a_Url_dup(a_History_get_url(NAV_TOP_UIDX(bw)));
+         /* Keep the scroll position saved by a_Nav_hibernate() */
+         a_Url_set_flags(url, URL_FLAGS(url) | URL_ReloadFromCache |
+                              URL_IgnoreScroll);
+         a_Bw_expect(bw, url);
+         Nav_open_url(bw, url, NULL, 0);
+         a_Url_free(url);
+      }
+   }
+}
+
 /*
  * This one does a_Nav_redirection0's job.
  */
@@ -17,6 +17,8 @@ void a_Nav_redirection0(BrowserWindow *bw, const DilloUrl *new_url);
 void a_Nav_push(BrowserWindow *bw, const DilloUrl *url,
                 const DilloUrl *requester);
 void a_Nav_repush(BrowserWindow *bw);
+int a_Nav_hibernate(BrowserWindow *bw);
+void a_Nav_wake(BrowserWindow *bw);
 void a_Nav_back(BrowserWindow *bw);
 void a_Nav_forw(BrowserWindow *bw);
 void a_Nav_home(BrowserWindow *bw);
@@ -96,7 +96,8 @@ DilloPlain::DilloPlain(BrowserWindow *p_bw)
 
    Layout *layout = (Layout*) bw->render_layout;
    // TODO (1x) No URL?
-   StyleEngine styleEngine (layout, NULL, NULL);
+   lout::misc::ZoneAllocator zone (1024);
+   StyleEngine styleEngine (layout, &zone, NULL, NULL);
 
    styleEngine.startElement ("body", bw);
    styleEngine.startElement ("pre", bw);
@@ -63,6 +63,7 @@ typedef struct {
    DilloUrl *url;               /* Primary Key for the dicache */
    int version;                 /* Secondary Key for the dicache */
    int bgcolor;                 /* Parent widget background color */
+   uint_t req_width, req_height; /* Display size, if known */
 
    png_uint_32 width;           /* png image width */
    png_uint_32 height;          /* png image height */
@@ -93,6 +94,10 @@ typedef struct {
 
    uchar_t *linebuf;            /* o/p raster data */
 
+   uint_t reduce;               /* Rows/columns averaged per output pixel */
+   uint_t *acc;                 /* Sums for the output row being reduced */
+   uchar_t *reducebuf;          /* Reduced o/p raster data */
+
 } DilloPng;
 
 #define DATASIZE  (png->ipbufsize - png->ipbufstart)
@@ -193,26 +198,74 @@ Png_datainfo_callback(png_structp png_ptr, png_infop info_ptr)
         "Png_datainfo_callback: height   = %lu\n",
         png->rowbytes, (ulong_t) png->width, (ulong_t) png->height);
 
-   png->image_data = (uchar_t *) dMalloc(png->rowbytes * png->height);
-   png->row_pointers = (uchar_t **) dMalloc(png->height * sizeof(uchar_t *));
-
-   for (i = 0; i < png->height; i++)
-      png->row_pointers[i] = png->image_data + (i * png->rowbytes);
+   /* Only interlaced images need the whole image to be kept around:
+    * other ones arrive as complete rows. */
+   if (interlace_type != PNG_INTERLACE_NONE) {
+      png->image_data = (uchar_t *) dMalloc(png->rowbytes * png->height);
+      png->row_pointers =
+         (uchar_t **) dMalloc(png->height * sizeof(uchar_t *));
+
+      for (i = 0; i < png->height; i++)
+         png->row_pointers[i] = png->image_data + (i * png->rowbytes);
+   } else {
+      /* Rows can be reduced as they come when the image is only
+       * displayed at a fraction of its size. */
+      png->reduce = a_Dicache_reduction(png->req_width, png->req_height,
+                                        (uint_t)png->width,
+                                        (uint_t)png->height, 8);
+   }
 
    png->linebuf = dMalloc(3 * png->width);
 
+   if (png->reduce > 1) {
+      uint_t w = (png->width + png->reduce - 1) / png->reduce;
+      png->acc = dNew0(uint_t, 3 * w);
+      png->reducebuf = dMalloc(3 * w);
+   }
+
    /* Initialize the dicache-entry here */
    a_Dicache_set_parms(png->url, png->version, png->Image,
-                       (uint_t)png->width, (uint_t)png->height,
+                       (uint_t)(png->width + png->reduce - 1) / png->reduce,
+                       (uint_t)(png->height + png->reduce - 1) / png->reduce,
                        DILLO_IMG_TYPE_RGB, file_gamma);
    png->Image = NULL; /* safeguard: hereafter it may be freed by its owner */
 }
 
+/*
+ * Add an RGB row to the output row being reduced, and send that one
+ * when it's complete.
+ */
+static void Png_reduce_row(DilloPng *png, const uchar_t *row,
+                           png_uint_32 row_num)
+{
+   uint_t r = png->reduce, x, ox, i, n, rows, cols;
+   uint_t w = (png->width + r - 1) / r;
+
+   for (x = 0, ox = 0; x < png->width; ox++)
+      for (n = 0; n < r && x < png->width; n++, x++)
+         for (i = 0; i < 3; i++)
+            png->acc[3 * ox + i] += row[3 * x + i];
+
+   if (row_num % r == r - 1 || row_num == png->height - 1) {
+      rows = row_num % r + 1;
+      for (ox = 0; ox < w; ox++) {
+         cols = MIN(r, png->width - ox * r);
+         n = rows * cols;
+         for (i = 0; i < 3; i++)
+            png->reducebuf[3 * ox + i] = png->acc[3 * ox + i] / n;
+      }
+      memset(png->acc, 0, 3 * w * sizeof(uint_t));
+      a_Dicache_write(png->url, png->version, png->reducebuf,
+                      (uint_t)(row_num / r));
+   }
+}
+
 static void
  Png_datarow_callback(png_structp png_ptr, png_bytep new_row,
                       png_uint_32 row_num, int pass)
 {
    DilloPng *png;
+   uchar_t *row;
    uint_t i;
 
    if (!new_row)                /* work to do? */
@@ -222,7 +275,13 @@ static void
 
    png = png_get_progressive_ptr(png_ptr);
 
-   png_progressive_combine_row(png_ptr, png->row_pointers[row_num], new_row);
+   if (png->row_pointers) {
+      png_progressive_combine_row(png_ptr, png->row_pointers[row_num],
+                                  new_row);
+      row = png->row_pointers[row_num];
+   } else {
+      row = new_row;
+   }
 
    _MSG("png: row_num=%u previous_row=%u\n", row_num, png->previous_row);
    if (row_num < png->previous_row) {
@@ -232,9 +291,6 @@ static void
 
    switch (png->channels) {
    case 3:
-      a_Dicache_write(png->url, png->version,
-                      png->image_data + (row_num * png->rowbytes),
-                      (uint_t)row_num);
       break;
    case 4:
      {
@@ -242,7 +298,7 @@ static void
          * of the image widget -- Livio.                 */
         int a, bg_red, bg_green, bg_blue;
         uchar_t *pl = png->linebuf;
-        uchar_t *data = png->image_data + (row_num * png->rowbytes);
+        uchar_t *data = row;
 
         /* TODO: maybe change prefs.bg_color to `a_Dw_widget_get_bg_color`,
          * when background colors are correctly implementated */
@@ -270,7 +326,7 @@ static void
               data++;
            }
         }
-        a_Dicache_write(png->url, png->version, png->linebuf, (uint_t)row_num);
+        row = png->linebuf;
         break;
      }
    default:
@@ -278,6 +334,11 @@ static void
           png->channels, pass);
       abort();
    }
+
+   if (png->reduce > 1)
+      Png_reduce_row(png, row, row_num);
+   else
+      a_Dicache_write(png->url, png->version, row, (uint_t)row_num);
 }
 
 static void Png_dataend_callback(png_structp png_ptr, png_infop info_ptr)
@@ -302,6 +363,8 @@ static void Png_free(DilloPng *png)
    dFree(png->image_data);
    dFree(png->row_pointers);
    dFree(png->linebuf);
+   dFree(png->acc);
+   dFree(png->reducebuf);
    if (setjmp(png->jmpbuf))
       MSG_WARN("PNG: can't destroy read structure\n");
    else if (png->png_ptr)
@@ -436,6 +499,8 @@ void *a_Png_new(DilloImage *Image, DilloUrl *url, int version)
    png->url = url;
    png->version = version;
    png->bgcolor = Image->bg_color;
+   png->req_width = Image->req_width;
+   png->req_height = Image->req_height;
    png->error = 0;
    png->ipbuf = NULL;
    png->ipbufstart = 0;
@@ -445,6 +510,9 @@ void *a_Png_new(DilloImage *Image, DilloUrl *url, int version)
    png->image_data = NULL;
    png->row_pointers = NULL;
    png->previous_row = 0;
+   png->reduce = 1;
+   png->acc = NULL;
+   png->reducebuf = NULL;
 
    return png;
 }
@@ -41,6 +41,7 @@ void a_Prefs_init(void)
    prefs.white_bg_replacement = 0xe0e0a3; // 0xdcd1ba;
    prefs.bg_color = 0xFFFFFF;
    prefs.buffered_drawing = 1;
+   prefs.tile_cache = 0;
    prefs.contrast_visited_color = TRUE;
    prefs.enterpress_forces_submit = FALSE;
    prefs.focus_new_tab = TRUE;
@@ -73,13 +74,17 @@ void a_Prefs_init(void)
    prefs.limit_text_width = FALSE;
    prefs.adjust_min_width = TRUE;
    prefs.adjust_table_min_width = TRUE;
+   prefs.table_virtual_rows = 0;
    prefs.load_images=TRUE;
    prefs.load_background_images=FALSE;
+   prefs.image_decode_threads = 2;
    prefs.use_cookies=TRUE;
    prefs.load_stylesheets=TRUE;
    prefs.middle_click_drags_page = TRUE;
    prefs.middle_click_opens_new_tab = TRUE;
    prefs.right_click_closes_tab = FALSE;
+   prefs.hibernate_tabs_after = 0;
+   prefs.max_awake_tabs = 0;
    prefs.no_proxy = dStrdup(PREFS_NO_PROXY);
    prefs.panel_size = P_medium;
    prefs.parse_embedded_css=TRUE;
@@ -110,6 +115,7 @@ void a_Prefs_init(void)
    prefs.small_icons = FALSE;
    prefs.start_page = a_Url_new(PREFS_START_PAGE, NULL);
    prefs.theme = dStrdup(PREFS_THEME);
+   prefs.trace_events = FALSE;
    prefs.ui_button_highlight_color = -1;
    prefs.ui_fg_color = -1;
    prefs.ui_main_bg_color = -1;
@@ -69,6 +69,7 @@ typedef struct {
    bool_t limit_text_width;
    bool_t adjust_min_width;
    bool_t adjust_table_min_width;
+   int32_t table_virtual_rows;
    bool_t focus_new_tab;
    double font_factor;
    int32_t font_max_size;
@@ -91,6 +92,7 @@ typedef struct {
    bool_t fullwindow_start;
    bool_t load_images;
    bool_t load_background_images;
+   int32_t image_decode_threads;
    bool_t use_cookies;
    bool_t load_stylesheets;
    bool_t parse_embedded_css;
@@ -98,6 +100,7 @@ typedef struct {
    bool_t http_persistent_conns;
    bool_t http_strict_transport_security;
    int32_t buffered_drawing;
+   int32_t tile_cache;
    char *font_serif;
    char *font_sans_serif;
    char *font_cursive;
@@ -106,10 +109,13 @@ typedef struct {
    bool_t enterpress_forces_submit;
    bool_t middle_click_opens_new_tab;
    bool_t right_click_closes_tab;
+   int32_t hibernate_tabs_after;
+   int32_t max_awake_tabs;
    bool_t search_url_idx;
    Dlist *search_urls;
    char *save_dir;
    bool_t show_msg;
+   bool_t trace_events;
    bool_t show_extra_warnings;
    bool_t middle_click_drags_page;
    int penalty_hyphen, penalty_hyphen_2;
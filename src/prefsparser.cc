@@ -150,6 +150,7 @@ void PrefsParser::parse(FILE *fp)
       { "white_bg_replacement", &prefs.white_bg_replacement, PREFS_COLOR, 0 },
       { "bg_color", &prefs.bg_color, PREFS_COLOR, 0 },
       { "buffered_drawing", &prefs.buffered_drawing, PREFS_INT32, 0 },
+      { "tile_cache", &prefs.tile_cache, PREFS_INT32, 0 },
       { "contrast_visited_color", &prefs.contrast_visited_color, PREFS_BOOL, 0 },
       { "enterpress_forces_submit", &prefs.enterpress_forces_submit,
         PREFS_BOOL, 0 },
@@ -177,8 +178,10 @@ void PrefsParser::parse(FILE *fp)
       { "limit_text_width", &prefs.limit_text_width, PREFS_BOOL, 0 },
       { "adjust_min_width", &prefs.adjust_min_width, PREFS_BOOL, 0 },
       { "adjust_table_min_width", &prefs.adjust_table_min_width, PREFS_BOOL, 0 },
+      { "table_virtual_rows", &prefs.table_virtual_rows, PREFS_INT32, 0 },
       { "load_images", &prefs.load_images, PREFS_BOOL, 0 },
       { "load_background_images", &prefs.load_background_images, PREFS_BOOL, 0 },
+      { "image_decode_threads", &prefs.image_decode_threads, PREFS_INT32, 0 },
       { "media_player", &prefs.media_player, PREFS_STRING, 0 },
       { "use_cookies", &prefs.use_cookies, PREFS_BOOL, 0 },
       { "load_stylesheets", &prefs.load_stylesheets, PREFS_BOOL, 0 },
@@ -188,6 +191,8 @@ void PrefsParser::parse(FILE *fp)
       { "middle_click_opens_new_tab", &prefs.middle_click_opens_new_tab,
         PREFS_BOOL, 0 },
       { "right_click_closes_tab", &prefs.right_click_closes_tab, PREFS_BOOL, 0 },
+      { "hibernate_tabs_after", &prefs.hibernate_tabs_after, PREFS_INT32, 0 },
+      { "max_awake_tabs", &prefs.max_awake_tabs, PREFS_INT32, 0 },
       { "no_proxy", &prefs.no_proxy, PREFS_STRING, 0 },
       { "panel_size", &prefs.panel_size, PREFS_PANEL_SIZE, 0 },
       { "parse_embedded_css", &prefs.parse_embedded_css, PREFS_BOOL, 0 },
@@ -215,6 +220,7 @@ void PrefsParser::parse(FILE *fp)
       { "small_icons", &prefs.small_icons, PREFS_BOOL, 0 },
       { "start_page", &prefs.start_page, PREFS_URL, 0 },
       { "theme", &prefs.theme, PREFS_STRING, 0 },
+      { "trace_events", &prefs.trace_events, PREFS_BOOL, 0 },
       { "ui_button_highlight_color", &prefs.ui_button_highlight_color,
         PREFS_COLOR, 0 },
       { "ui_fg_color", &prefs.ui_fg_color, PREFS_COLOR, 0 },
@@ -17,6 +17,7 @@
 #include "styleengine.hh"
 #include "web.hh"
 #include "capi.h"
+#include "lout/trace.h"
 
 using namespace lout::misc;
 using namespace dw::core::style;
@@ -58,12 +59,18 @@ void StyleImageDeletionReceiver::deleted (lout::signal::ObservedObject *object)
 
 // ----------------------------------------------------------------------
 
-StyleEngine::StyleEngine (dw::core::Layout *layout,
+/**
+ * \brief Create a StyleEngine for one document.
+ *
+ * The document tree is allocated from 'zone', which must outlive the
+ * StyleEngine.
+ */
+StyleEngine::StyleEngine (dw::core::Layout *layout, ZoneAllocator *zone,
                           const DilloUrl *pageUrl, const DilloUrl *baseUrl) {
    StyleAttrs style_attrs;
    FontAttrs font_attrs;
 
-   doctree = new Doctree ();
+   doctree = new Doctree (zone);
    stack = new lout::misc::SimpleVector <Node> (1);
    cssContext = new CssContext ();
    buildUserStyle ();
@@ -160,28 +167,38 @@ void StyleEngine::startElement (const char *tagname, BrowserWindow *bw) {
 void StyleEngine::setId (const char *id) {
    DoctreeNode *dn = doctree->top ();
    assert (dn->id == NULL);
-   dn->id = dStrdup (id);
+   dn->id = doctree->getZone ()->strdup (id);
 }
 
 /**
- * \brief split a string at sep chars and return a SimpleVector of strings
+ * \brief split a string at sep chars and return the parts as DoctreeClasses
+ *
+ * The list and the strings are allocated from 'zone'.
  */
-static lout::misc::SimpleVector<char *> *splitStr (const char *str, char sep) {
-   const char *p1 = NULL;
-   lout::misc::SimpleVector<char *> *list =
-      new lout::misc::SimpleVector<char *> (1);
-
-   for (;; str++) {
-      if (*str != '\0' && *str != sep) {
+static DoctreeClasses *splitStr (ZoneAllocator *zone, const char *str,
+                                 char sep) {
+   const char *p1 = NULL, *s;
+   DoctreeClasses *list =
+      (DoctreeClasses *) zone->zoneAllocObject (sizeof (DoctreeClasses));
+   int n = 0;
+
+   for (s = str; *s; s++)
+      if (*s != sep && (s == str || s[-1] == sep))
+         n++;
+
+   list->num = 0;
+   list->names = (char **) zone->zoneAllocObject (n * sizeof (char *));
+
+   for (s = str;; s++) {
+      if (*s != '\0' && *s != sep) {
          if (!p1)
-            p1 = str;
+            p1 = s;
       } else if (p1) {
-         list->increase ();
-         list->set (list->size () - 1, dStrndup (p1, str - p1));
+         list->names[list->num++] = (char *) zone->strndup (p1, s - p1);
          p1 = NULL;
       }
 
-      if (*str == '\0')
+      if (*s == '\0')
          break;
    }
 
@@ -191,7 +208,7 @@ static lout::misc::SimpleVector<char *> *splitStr (const char *str, char sep) {
 void StyleEngine::setClass (const char *klass) {
    DoctreeNode *dn = doctree->top ();
    assert (dn->klass == NULL);
-   dn->klass = splitStr (klass, ' ');
+   dn->klass = splitStr (doctree->getZone (), klass, ' ');
 }
 
 void StyleEngine::setStyle (const char *styleAttr) {
@@ -675,6 +692,9 @@ void StyleEngine::apply (int i, StyleAttrs *attrs, CssPropertyList *props,
          case CSS_PROPERTY_RIGHT:
             computeLength (&attrs->right, p->value.intVal, attrs->font);
             break;
+         case CSS_PROPERTY_TABLE_LAYOUT:
+            attrs->tableLayout = (TableLayout) p->value.intVal;
+            break;
          case CSS_PROPERTY_TEXT_ALIGN:
             attrs->textAlign = (TextAlignType) p->value.intVal;
             break;
@@ -892,6 +912,7 @@ Style * StyleEngine::backgroundStyle (BrowserWindow *bw) {
 Style * StyleEngine::style0 (int i, BrowserWindow *bw) {
    CssPropertyList props, *styleAttrProperties, *styleAttrPropertiesImportant;
    CssPropertyList *nonCssProperties;
+   TRACE_SCOPE ("style", "compute style");
    // get previous style from the stack
    StyleAttrs attrs = *stack->getRef (i - 1)->style;
 
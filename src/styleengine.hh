@@ -69,7 +69,7 @@ class StyleEngine {
    public:
       static void init ();
 
-      StyleEngine (dw::core::Layout *layout,
+      StyleEngine (dw::core::Layout *layout, lout::misc::ZoneAllocator *zone,
                    const DilloUrl *pageUrl, const DilloUrl *baseUrl);
       ~StyleEngine ();
 
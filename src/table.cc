@@ -230,6 +230,48 @@ void Html_tag_content_tr(DilloHtml *html, const char *tag, int tagsize)
    S_TOP(html)->table_mode = DILLO_HTML_TABLE_MODE_TR;
 }
 
+/*
+ * <COL>
+ */
+void Html_tag_open_col(DilloHtml *html, const char *tag, int tagsize)
+{
+   const char *attrbuf;
+
+   if ((attrbuf = a_Html_get_attr(html, tag, tagsize, "width"))) {
+      html->styleEngine->setNonCssHint (CSS_PROPERTY_WIDTH,
+                                        CSS_TYPE_LENGTH_PERCENTAGE,
+                                        a_Html_parse_length (html, attrbuf));
+      if (html->DocType == DT_HTML && html->DocTypeVersion >= 5.0f)
+         BUG_MSG("<col> width attribute is obsolete.");
+   }
+}
+
+/*
+ * Column widths are only used by tables with 'table-layout: fixed'.
+ * <colgroup> is not supported yet, but the <col> elements inside of it
+ * are regarded.
+ */
+void Html_tag_content_col(DilloHtml *html, const char *tag, int tagsize)
+{
+   const char *attrbuf;
+   int span = 1;
+
+   switch (S_TOP(html)->table_mode) {
+   case DILLO_HTML_TABLE_MODE_NONE:
+      BUG_MSG("<col> outside <table>.");
+      break;
+   case DILLO_HTML_TABLE_MODE_TOP:
+      if ((attrbuf = a_Html_get_attr(html, tag, tagsize, "span")))
+         span = MAX(1, strtol (attrbuf, NULL, 10));
+      ((dw::Table*)S_TOP(html)->table)->addColumn (html->style ()->width,
+                                                   span);
+      break;
+   default:
+      BUG_MSG("<col> after table rows.");
+      break;
+   }
+}
+
 /*
  * <TD>
  */
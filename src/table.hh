@@ -15,6 +15,8 @@ void Html_tag_open_table(DilloHtml *html, const char *tag, int tagsize);
 void Html_tag_content_table(DilloHtml *html, const char *tag, int tagsize);
 void Html_tag_open_tr(DilloHtml *html, const char *tag, int tagsize);
 void Html_tag_content_tr(DilloHtml *html, const char *tag, int tagsize);
+void Html_tag_open_col(DilloHtml *html, const char *tag, int tagsize);
+void Html_tag_content_col(DilloHtml *html, const char *tag, int tagsize);
 void Html_tag_open_td(DilloHtml *html, const char *tag, int tagsize);
 void Html_tag_content_td(DilloHtml *html, const char *tag, int tagsize);
 void Html_tag_open_tbody(DilloHtml *html, const char *tag, int tagsize);
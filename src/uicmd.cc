@@ -43,8 +43,10 @@
 #include "msg.h"
 #include "prefs.h"
 #include "misc.h"
+#include "dicache.h"
 
 #include "dw/fltkviewport.hh"
+#include "dw/textblock.hh"
 
 #include "nav.h"
 
@@ -54,6 +56,9 @@
 // Handy macro
 #define BW2UI(bw) ((UI*)((bw)->ui))
 
+// Seconds between checks for tabs to hibernate
+#define UIcmd_HIBERNATE_INTERVAL 30.0
+
 // Platform idependent part
 using namespace dw::core;
 // FLTK related
@@ -408,6 +413,9 @@ void CustTabs::switch_tab(CustTabButton *cbtn)
    UI *old_ui = (UI*)Wizard->value();
 
    if (cbtn && cbtn->ui() != old_ui) {
+      // The old tab starts being inactive now
+      if (old_ui && (bw = a_UIcmd_get_bw_by_widget(old_ui)))
+         bw->last_active = time(NULL);
       // Set old tab label to normal color
       if ((idx = get_btn_idx(old_ui)) != -1) {
          btn = (CustTabButton*)Pack->child(idx);
@@ -435,6 +443,9 @@ void CustTabs::switch_tab(CustTabButton *cbtn)
       if ((bw = a_UIcmd_get_bw_by_widget(cbtn->ui()))) {
          const char *title = (cbtn->ui())->label();
          UIcmd_set_window_labels(cbtn->window(), title ? title : "");
+         // Render the page again if it was hibernated
+         bw->last_active = time(NULL);
+         a_Nav_wake(bw);
       }
       // Update focus priority
       increase_focus_counter();
@@ -580,6 +591,64 @@ static void UIcmd_set_window_labels(Fl_Window *win, const char *str)
    win->label(copy, copy);
 }
 
+/*
+ * Tab hibernation: periodically hibernate the tabs that have not been shown
+ * for prefs.hibernate_tabs_after minutes, and the least recently shown ones
+ * while there are more than prefs.max_awake_tabs awake tabs.
+ */
+static void UIcmd_hibernate_cb(void *)
+{
+   BrowserWindow *bw, *oldest;
+   time_t now = time(NULL);
+   int i, awake = 0;
+
+   for (i = 0; (bw = a_Bw_get(i)); ++i) {
+      if (!bw->hibernated && prefs.hibernate_tabs_after > 0 &&
+          !BW2UI(bw)->visible() &&
+          now - bw->last_active >= prefs.hibernate_tabs_after * 60)
+         a_Nav_hibernate(bw);
+      if (!bw->hibernated)
+         ++awake;
+   }
+
+   if (prefs.max_awake_tabs > 0) {
+      /* Tabs which refuse to hibernate (e.g. still loading) are skipped
+       * by marking them as just shown for this pass */
+      Dlist *skip = dList_new(8);
+      while (awake > prefs.max_awake_tabs) {
+         oldest = NULL;
+         for (i = 0; (bw = a_Bw_get(i)); ++i)
+            if (!bw->hibernated && !BW2UI(bw)->visible() &&
+                !dList_find(skip, bw) &&
+                (!oldest || bw->last_active < oldest->last_active))
+               oldest = bw;
+         if (!oldest)
+            break;
+         if (a_Nav_hibernate(oldest))
+            --awake;
+         else
+            dList_append(skip, oldest);
+      }
+      dList_free(skip);
+   }
+
+   a_Timeout_repeat(UIcmd_HIBERNATE_INTERVAL, UIcmd_hibernate_cb, NULL);
+}
+
+/*
+ * Start checking for tabs to hibernate, if enabled in the preferences.
+ */
+static void UIcmd_hibernate_start()
+{
+   static bool started = false;
+
+   if (!started && (prefs.hibernate_tabs_after > 0 ||
+                    prefs.max_awake_tabs > 0)) {
+      a_Timeout_add(UIcmd_HIBERNATE_INTERVAL, UIcmd_hibernate_cb, NULL);
+      started = true;
+   }
+}
+
 /*
  * Create a new Tab button, UI and its associated BrowserWindow data
  * structure.
@@ -604,6 +673,7 @@ static BrowserWindow *UIcmd_tab_new(CustTabs *tabs, UI *old_ui, int focus)
    FltkViewport *viewport = new FltkViewport (0, 0, 0, 1);
    viewport->box(FL_NO_BOX);
    viewport->setBufferedDrawing (prefs.buffered_drawing ? true : false);
+   viewport->setTileCache (prefs.tile_cache);
    viewport->setDragScroll (prefs.middle_click_drags_page ? true : false);
    layout->attachView (viewport);
    new_ui->set_render_layout(viewport);
@@ -624,6 +694,8 @@ static BrowserWindow *UIcmd_tab_new(CustTabs *tabs, UI *old_ui, int focus)
    // WORKAROUND: see findbar_toggle()
    new_ui->findbar_toggle(0);
 
+   UIcmd_hibernate_start();
+
    return new_bw;
 }
 
@@ -665,6 +737,229 @@ void a_UIcmd_close_all_bw(void *)
          a_UIcmd_close_bw((void*)bw);
 }
 
+/*
+ * Drop the widgets of the page shown in bw (see a_Nav_hibernate).
+ */
+void a_UIcmd_clear_page(BrowserWindow *bw)
+{
+   Layout *layout = (Layout*)bw->render_layout;
+
+   layout->clearWidget();
+}
+
+/*
+ * Append str to ds, escaping the HTML special characters.
+ */
+static void UIcmd_append_html(Dstr *ds, const char *str)
+{
+   for (; *str; ++str) {
+      switch (*str) {
+      case '<': dStr_append(ds, "&lt;"); break;
+      case '>': dStr_append(ds, "&gt;"); break;
+      case '&': dStr_append(ds, "&amp;"); break;
+      case '\'': dStr_append(ds, "&#39;"); break;
+      default: dStr_append_c(ds, *str); break;
+      }
+   }
+}
+
+/*
+ * Get the memory taken by the data (cache) and decoded images (dicache) of
+ * the URLs requested by the page in bw. Both may be shared with other tabs
+ * showing the same URLs.
+ */
+static void UIcmd_page_memory(BrowserWindow *bw, uint_t *data_size,
+                              uint_t *img_size)
+{
+   const DilloUrl *url;
+   DICacheEntry *entry;
+
+   *data_size = *img_size = 0;
+   for (int i = 0; (url = (DilloUrl*)dList_nth_data(bw->PageUrls, i)); ++i) {
+      *data_size += a_Cache_get_data_size(url);
+      if ((entry = a_Dicache_get_entry(url, DIC_Last)))
+         *img_size += entry->TotalSize;
+   }
+   /* A hibernated page keeps only its cache entry */
+   if (bw->hibernated && (url = a_History_get_url(NAV_TOP_UIDX(bw))))
+      *data_size = a_Cache_get_data_size(url);
+}
+
+/*
+ * Append a table row start for the tab of bw: its number, a link to its
+ * page, and its state.
+ */
+static void UIcmd_append_tab_row(Dstr *ds, BrowserWindow *bw, int num)
+{
+   const DilloUrl *url = a_History_get_url(NAV_TOP_UIDX(bw));
+   const char *title, *state;
+
+   dStr_sprintfa(ds, "<tr><td>%d<td>", num);
+   if (url) {
+      title = a_History_get_title_by_url(url, 0);
+      dStr_append(ds, "<a href='");
+      UIcmd_append_html(ds, URL_STR(url));
+      dStr_append(ds, "'>");
+      UIcmd_append_html(ds, (title && *title) ? title : URL_STR(url));
+      dStr_append(ds, "</a>");
+   }
+   if (bw->hibernated)
+      state = "hibernated";
+   else if (BW2UI(bw)->visible())
+      state = "shown";
+   else
+      state = "awake";
+   dStr_sprintfa(ds, "<td>%s", state);
+}
+
+/*
+ * Generate the "about:tabs" page: the open tabs, their state and the
+ * memory taken by their page data and decoded images.
+ */
+Dstr *a_UIcmd_tabs_page(void)
+{
+   BrowserWindow *bw;
+   uint_t data_size, img_size, data_total = 0, img_total = 0;
+   int i, num_hibernated = 0;
+   time_t now = time(NULL);
+   Dstr *ds = dStr_new("");
+
+   dStr_append(ds,
+      "<!DOCTYPE HTML PUBLIC '-//W3C//DTD HTML 4.01//EN'>\n"
+      "<html><head><title>Tabs</title></head><body>\n"
+      "<h2>Tabs</h2>\n"
+      "<table border='1' cellpadding='3'>\n"
+      "<tr><th>#<th>Page<th>State<th>Inactive<th>Page data<th>Images\n");
+
+   for (i = 0; (bw = a_Bw_get(i)); ++i) {
+      UIcmd_page_memory(bw, &data_size, &img_size);
+      data_total += data_size;
+      img_total += img_size;
+      if (bw->hibernated)
+         ++num_hibernated;
+
+      UIcmd_append_tab_row(ds, bw, i + 1);
+      dStr_append(ds, "<td align='right'>");
+      if (!BW2UI(bw)->visible())
+         dStr_sprintfa(ds, "%ld min", (long)(now - bw->last_active) / 60);
+      dStr_sprintfa(ds, "<td align='right'>%u KB<td align='right'>%u KB\n",
+                    data_size / 1024, img_size / 1024);
+   }
+
+   dStr_sprintfa(ds,
+      "<tr><th colspan='4' align='left'>%d tabs, %d hibernated"
+      "<th align='right'>%u KB<th align='right'>%u KB\n"
+      "</table>\n", i, num_hibernated, data_total / 1024, img_total / 1024);
+   dStr_sprintfa(ds,
+      "<p>Tabs are hibernated after %d minutes (0: never), "
+      "and at most %d tabs are kept awake (0: no limit).\n"
+      "See hibernate_tabs_after and max_awake_tabs in dillorc.\n"
+      "<p>See also <a href='about:memory'>about:memory</a>.\n"
+      "</body></html>\n",
+      prefs.hibernate_tabs_after, prefs.max_awake_tabs);
+   return ds;
+}
+
+/*
+ * Count the widgets below (and including) widget, and the words and memory
+ * of its text blocks.
+ */
+static void UIcmd_widget_memory(Widget *widget, int *num_widgets,
+                                int *num_words, size_t *size)
+{
+   ++*num_widgets;
+   if (widget->instanceOf(dw::Textblock::CLASS_ID)) {
+      dw::Textblock *textblock = (dw::Textblock*)widget;
+      *num_words += textblock->getNumWords();
+      *size += textblock->getMemoryUsage();
+   }
+
+   Iterator *it =
+      widget->iterator ((Content::Type)
+                        (Content::WIDGET_IN_FLOW | Content::WIDGET_OOF_CONT),
+                        false);
+   while (it->next ())
+      UIcmd_widget_memory (it->getContent()->widget, num_widgets, num_words,
+                           size);
+   it->unref ();
+}
+
+/*
+ * Generate the "about:memory" page: the memory taken by each subsystem,
+ * and, where it can be attributed, by each tab.
+ */
+Dstr *a_UIcmd_memory_page(void)
+{
+   BrowserWindow *bw;
+   Layout *layout;
+   uint_t data_size, utf8_size, img_size;
+   size_t root_size, scaled_size, tb_size, zone_size;
+   int i, num, num_root, num_scaled, num_widgets, num_words;
+   Dstr *ds = dStr_new("");
+
+   dStr_append(ds,
+      "<!DOCTYPE HTML PUBLIC '-//W3C//DTD HTML 4.01//EN'>\n"
+      "<html><head><title>Memory</title></head><body>\n"
+      "<h2>Memory</h2>\n"
+      "<table border='1' cellpadding='3'>\n"
+      "<tr><th>Subsystem<th>Objects<th>Memory\n");
+
+   a_Cache_memory_usage(&num, &data_size, &utf8_size);
+   dStr_sprintfa(ds,
+      "<tr><td>Cache data<td align='right'>%d<td align='right'>%u KB\n"
+      "<tr><td>Cache data, converted to UTF-8<td><td align='right'>%u KB\n",
+      num, data_size / 1024, utf8_size / 1024);
+   a_Dicache_memory_usage(&num, &img_size);
+   dStr_sprintfa(ds,
+      "<tr><td>Decoded images<td align='right'>%d<td align='right'>%u KB\n",
+      num, img_size / 1024);
+   FltkImgbuf::getMemoryUsage (&num_root, &root_size, &num_scaled,
+                               &scaled_size);
+   dStr_sprintfa(ds,
+      "<tr><td>Image buffers<td align='right'>%d<td align='right'>%lu KB\n"
+      "<tr><td>Scaled image buffers<td align='right'>%d"
+      "<td align='right'>%lu KB\n",
+      num_root, (unsigned long)root_size / 1024,
+      num_scaled, (unsigned long)scaled_size / 1024);
+   num = style::Style::getNumStyles ();
+   dStr_sprintfa(ds,
+      "<tr><td>Styles<td align='right'>%d<td align='right'>%lu KB\n"
+      "<tr><td>Fonts<td align='right'>%d<td>\n"
+      "</table>\n",
+      num, (unsigned long)(num * sizeof(style::Style)) / 1024,
+      style::Font::getNumFonts ());
+
+   dStr_append(ds,
+      "<h3>Tabs</h3>\n"
+      "<table border='1' cellpadding='3'>\n"
+      "<tr><th>#<th>Page<th>State<th>Widgets<th>Words<th>Text blocks"
+      "<th>Text<th>Page data<th>Images\n");
+   for (i = 0; (bw = a_Bw_get(i)); ++i) {
+      layout = (Layout*)bw->render_layout;
+      num_widgets = num_words = 0;
+      tb_size = 0;
+      if (layout->getWidget())
+         UIcmd_widget_memory(layout->getWidget(), &num_widgets, &num_words,
+                             &tb_size);
+      zone_size = layout->textZone->size();
+      UIcmd_page_memory(bw, &data_size, &img_size);
+
+      UIcmd_append_tab_row(ds, bw, i + 1);
+      dStr_sprintfa(ds,
+         "<td align='right'>%d<td align='right'>%d<td align='right'>%lu KB"
+         "<td align='right'>%lu KB<td align='right'>%u KB"
+         "<td align='right'>%u KB\n",
+         num_widgets, num_words, (unsigned long)tb_size / 1024,
+         (unsigned long)zone_size / 1024, data_size / 1024, img_size / 1024);
+   }
+   dStr_append(ds,
+      "</table>\n"
+      "<p>Page data and images may be shared by several tabs, and also\n"
+      "remain in the cache after the tab is closed.\n"
+      "</body></html>\n");
+   return ds;
+}
+
 /*
  * Return a search string of the suffix if str starts with a
  * prefix of a search engine name and a blank
@@ -1488,15 +1783,18 @@ void a_UIcmd_findtext_search(BrowserWindow *bw, const char *key,
 
    switch (l->search(key, case_sens, backward)) {
    case FindtextState::RESTART:
-      a_UIcmd_set_msg(bw, backward?"Top reached; restarting from the bottom."
-                                  :"Bottom reached; restarting from the top.");
+      a_UIcmd_set_msg(bw, backward ?
+                      "Top reached; restarting from the bottom (%d of %d)." :
+                      "Bottom reached; restarting from the top (%d of %d).",
+                      l->getCurrentSearchMatch(), l->getNumSearchMatches());
       break;
    case FindtextState::NOT_FOUND:
       a_UIcmd_set_msg(bw, "\"%s\" not found.", key);
       break;
    case FindtextState::SUCCESS:
    default:
-      a_UIcmd_set_msg(bw, "");
+      a_UIcmd_set_msg(bw, "%d of %d matches.",
+                      l->getCurrentSearchMatch(), l->getNumSearchMatches());
    }
 }
 
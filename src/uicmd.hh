@@ -58,6 +58,9 @@ void a_UIcmd_nav_jump(BrowserWindow *bw, int offset, int new_bw);
 
 void a_UIcmd_close_bw(void *vbw);
 void a_UIcmd_close_all_bw(void *p);
+void a_UIcmd_clear_page(BrowserWindow *bw);
+Dstr *a_UIcmd_tabs_page(void);
+Dstr *a_UIcmd_memory_page(void);
 
 void a_UIcmd_init(void);
 
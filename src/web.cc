@@ -73,7 +73,8 @@ int a_Web_dispatch_by_type (const char *Type, DilloWeb *Web,
                           style::createPerLength (0));
 
       /* Set a style for the widget */
-      StyleEngine styleEngine (layout, Web->url, Web->url);
+      lout::misc::ZoneAllocator zone (1024);
+      StyleEngine styleEngine (layout, &zone, Web->url, Web->url);
       styleEngine.startElement ("body", Web->bw);
 
       dw = (Widget*) viewer(Type, Web, Call, Data);
@@ -31,6 +31,7 @@
 /* net */
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 
@@ -289,23 +290,23 @@ static int Dpi_blocking_start_dpid(void)
 
 
 /*
- * Return the dpi server's port number, or -1 on error.
+ * Return the dpi server's socket path, or NULL on error.
  * (A query is sent to dpid and then its answer parsed)
  * note: as the available servers and/or the dpi socket directory can
  *       change at any time, we'll ask each time. If someday we find
  *       that connecting each time significantly degrades performance,
  *       an optimized approach can be tried.
  */
-static int Dpi_get_server_port(const char *server_name)
+static char *Dpi_get_server_path(const char *server_name)
 {
-   int sock_fd = -1, dpi_port = -1;
+   int sock_fd = -1;
    int dpid_port, ok = 0;
    struct sockaddr_in sin;
-   char *cmd, *request, *rply = NULL, *port_str;
+   char *cmd, *request, *rply = NULL, *dpi_path = NULL;
    socklen_t sin_sz;
 
-   dReturn_val_if_fail (server_name != NULL, dpi_port);
-   _MSG("Dpi_get_server_port:: server_name = [%s]\n", server_name);
+   dReturn_val_if_fail (server_name != NULL, NULL);
+   _MSG("Dpi_get_server_path:: server_name = [%s]\n", server_name);
 
    /* Read dpid's port from saved file */
    if (Dpi_read_comm_keys(&dpid_port) != -1) {
@@ -321,7 +322,7 @@ static int Dpi_get_server_port(const char *server_name)
       sin.sin_port = htons(dpid_port);
       if ((sock_fd = Dpi_make_socket_fd()) == -1 ||
           connect(sock_fd, (struct sockaddr *)&sin, sin_sz) == -1) {
-         MSG("Dpi_get_server_port: %s\n", dStrerror(errno));
+         MSG("Dpi_get_server_path: %s\n", dStrerror(errno));
       } else {
          ok = 1;
       }
@@ -333,7 +334,7 @@ static int Dpi_get_server_port(const char *server_name)
       _MSG("[%s]\n", request);
 
       if (Dpi_blocking_write(sock_fd, request, strlen(request)) == -1) {
-         MSG("Dpi_get_server_port: %s\n", dStrerror(errno));
+         MSG("Dpi_get_server_path: %s\n", dStrerror(errno));
       } else {
          ok = 1;
       }
@@ -343,7 +344,7 @@ static int Dpi_get_server_port(const char *server_name)
       /* Get the reply */
       ok = 0;
       if ((rply = Dpi_blocking_read(sock_fd)) == NULL) {
-         MSG("Dpi_get_server_port: can't read server port from dpid.\n");
+         MSG("Dpi_get_server_path: can't read server path from dpid.\n");
       } else {
          ok = 1;
       }
@@ -353,11 +354,8 @@ static int Dpi_get_server_port(const char *server_name)
       ok = 0;
       cmd = a_Dpip_get_attr(rply, "cmd");
       if (strcmp(cmd, "send_data") == 0) {
-         port_str = a_Dpip_get_attr(rply, "msg");
-         _MSG("Dpi_get_server_port: rply=%s\n", rply);
-         _MSG("Dpi_get_server_port: port_str=%s\n", port_str);
-         dpi_port = strtol(port_str, NULL, 10);
-         dFree(port_str);
+         dpi_path = a_Dpip_get_attr(rply, "msg");
+         _MSG("Dpi_get_server_path: rply=%s\n", rply);
          ok = 1;
       }
       dFree(cmd);
@@ -365,32 +363,36 @@ static int Dpi_get_server_port(const char *server_name)
    dFree(rply);
    Dpi_close_fd(sock_fd);
 
-   return ok ? dpi_port : -1;
+   if (!ok) {
+      dFree(dpi_path);
+      dpi_path = NULL;
+   }
+   return dpi_path;
 }
 
 
 static int Dpi_connect_socket(const char *server_name)
 {
-   struct sockaddr_in sin;
-   int sock_fd, dpi_port, ret = -1;
-   char *cmd = NULL;
+   struct sockaddr_un sun;
+   int sock_fd, ret = -1;
+   char *cmd = NULL, *dpi_path;
 
-   /* Query dpid for the port number for this server */
-   if ((dpi_port = Dpi_get_server_port(server_name)) == -1) {
-      _MSG("Dpi_connect_socket:: can't get port number for %s\n", server_name);
+   /* Query dpid for the socket path for this server */
+   if ((dpi_path = Dpi_get_server_path(server_name)) == NULL) {
+      _MSG("Dpi_connect_socket:: can't get socket path for %s\n", server_name);
       return -1;
    }
-   _MSG("Dpi_connect_socket: server=%s port=%d\n", server_name, dpi_port);
+   _MSG("Dpi_connect_socket: server=%s path=%s\n", server_name, dpi_path);
 
    /* connect with this server's socket */
-   memset(&sin, 0, sizeof(sin));
-   sin.sin_family = AF_INET;
-   sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-   sin.sin_port = htons(dpi_port);
+   memset(&sun, 0, sizeof(sun));
+   sun.sun_family = AF_UNIX;
+   strncpy(sun.sun_path, dpi_path, sizeof(sun.sun_path) - 1);
+   dFree(dpi_path);
 
-   if ((sock_fd = Dpi_make_socket_fd()) == -1) {
+   if ((sock_fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
       perror("[dpi::socket]");
-   } else if (connect(sock_fd, (void*)&sin, sizeof(sin)) == -1) {
+   } else if (connect(sock_fd, (void*)&sun, sizeof(sun)) == -1) {
       MSG("[dpi::connect] errno:%d %s\n", errno, dStrerror(errno));
 
    /* send authentication Key (the server closes sock_fd on auth error) */
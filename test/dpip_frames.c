@@ -0,0 +1,146 @@
+/*
+ * Dpip framed tags test
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Writes tags through a Dsh in frame mode (nothing is flushed, the frames
+ * are taken from the write buffer), reads them back with the frame API, and
+ * checks that broken frame headers are rejected.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../dpip/dpip.h"
+
+static int failures = 0;
+
+static void check_str(const char *what, const char *got, const char *exp)
+{
+   int ok = (got && exp) ? !strcmp(got, exp) : got == exp;
+
+   printf("%s: %s = %s%s%s\n", ok ? "ok" : "FAILED", what,
+          got ? "\"" : "", got ? got : "NULL", got ? "\"" : "");
+   if (!ok) {
+      printf("   expected %s\n", exp ? exp : "NULL");
+      failures++;
+   }
+}
+
+static void check_int(const char *what, int got, int exp)
+{
+   printf("%s: %s = %d\n", got == exp ? "ok" : "FAILED", what, got);
+   if (got != exp) {
+      printf("   expected %d\n", exp);
+      failures++;
+   }
+}
+
+/*
+ * Frame one tag, and check its attributes and the tag made back from it.
+ */
+static void test_tag(Dsh *dsh, const char *tag, const char *names[],
+                     const char *values[])
+{
+   char *frame, *val, *tag2;
+   int i, len;
+
+   printf("%s\n", tag);
+   dStr_truncate(dsh->wrbuf, 0);
+   dsh->mode |= DPIP_FRAMES;
+   a_Dpip_dsh_write_str(dsh, 0, tag);
+
+   check_int("framed", dsh->wrbuf->str[0] == DPIP_FRAME_MARK, 1);
+   len = a_Dpip_frame_len(dsh->wrbuf->str);
+   check_int("length", len + DPIP_FRAME_HDR_SZ, dsh->wrbuf->len);
+   frame = dsh->wrbuf->str + DPIP_FRAME_HDR_SZ;
+
+   for (i = 0; names[i]; ++i) {
+      val = a_Dpip_frame_get_attr(frame, len, names[i]);
+      check_str(names[i], val, values[i]);
+      dFree(val);
+   }
+   val = a_Dpip_frame_get_attr(frame, len, "nonexistent");
+   check_str("nonexistent", val, NULL);
+   dFree(val);
+
+   /* the text form of the frame must have the same attributes */
+   tag2 = a_Dpip_frame_to_tag(frame, len);
+   for (i = 0; names[i]; ++i) {
+      val = a_Dpip_get_attr(tag2, names[i]);
+      check_str(names[i], val, values[i]);
+      dFree(val);
+   }
+   dFree(tag2);
+}
+
+int main(void)
+{
+   const char *names1[] = {"cmd", "msg", NULL},
+              *values1[] = {"chat", "ain't", NULL},
+              *names2[] = {"cmd", "url", "msg", NULL},
+              *values2[] = {"dialog", "file:/a'b'/c", "'' and ''''", NULL},
+              *names3[] = {"cmd", "msg", NULL},
+              *values3[] = {"send_status_message", "", NULL};
+   char *tag;
+   int fds[2];
+   Dsh *dsh;
+
+   if (pipe(fds)) {
+      perror("pipe");
+      return 1;
+   }
+   dsh = a_Dpip_dsh_new(fds[0], fds[1], 1024*1024);
+
+   /* quote stuffing: each "'" in a value goes as "''" in the text tag */
+   tag = a_Dpip_build_cmd("cmd=%s msg=%s", "chat", "ain't");
+   check_str("tag", tag, "<cmd='chat' msg='ain''t' '>");
+   test_tag(dsh, tag, names1, values1);
+   dFree(tag);
+
+   tag = a_Dpip_build_cmd("cmd=%s url=%s msg=%s", "dialog", "file:/a'b'/c",
+                          "'' and ''''");
+   test_tag(dsh, tag, names2, values2);
+   dFree(tag);
+
+   tag = a_Dpip_build_cmd("cmd=%s msg=%s", "send_status_message", "");
+   test_tag(dsh, tag, names3, values3);
+   dFree(tag);
+
+   /* a malformed tag isn't framed: it's passed on as it is */
+   dStr_truncate(dsh->wrbuf, 0);
+   dsh->mode |= DPIP_FRAMES;
+   a_Dpip_dsh_write_str(dsh, 0, "<cmd='chat' msg='unterminated '>");
+   check_str("malformed tag", dsh->wrbuf->str,
+             "<cmd='chat' msg='unterminated '>");
+
+   /* lengths with the top bit set, or over the maximum, are rejected */
+   check_int("length 0x80000005", a_Dpip_frame_len("\1\x80\0\0\5"), -1);
+   check_int("length 0xffffffff", a_Dpip_frame_len("\1\xff\xff\xff\xff"), -1);
+   check_int("length DPIP_FRAME_MAX + 1",
+             a_Dpip_frame_len("\1\0\x10\0\1"), -1);
+   check_int("length DPIP_FRAME_MAX",
+             a_Dpip_frame_len("\1\0\x10\0\0"), DPIP_FRAME_MAX);
+
+   a_Dpip_dsh_free(dsh);
+   close(fds[0]);
+   close(fds[1]);
+
+   if (failures)
+      printf("%d FAILED\n", failures);
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,281 @@
+/*
+ * Dillo Widget
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Tests dw::core::FindtextState: the results of searches, the number of
+ * matches, and that text added to the page is found, also when the page
+ * has not been laid out again since the last search. No FLTK is needed:
+ * the platform has fixed font metrics, and the view draws nothing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "../lout/misc.hh"
+#include "../lout/unicode.hh"
+#include "../dw/core.hh"
+#include "../dw/textblock.hh"
+
+using namespace lout::misc;
+using namespace dw;
+using namespace dw::core;
+using namespace dw::core::style;
+
+class TestFont: public Font
+{
+public:
+   TestFont (FontAttrs *attrs)
+   {
+      copyAttrs (attrs);
+      ascent = size * 4 / 5;
+      descent = size - ascent;
+      spaceWidth = size / 4;
+      xHeight = size / 2;
+   }
+};
+
+class TestColor: public Color
+{
+public:
+   TestColor (int color): Color (color) { }
+};
+
+class TestTooltip: public Tooltip
+{
+public:
+   TestTooltip (const char *text): Tooltip (text) { }
+};
+
+class TestPlatform: public Platform
+{
+   Layout *layout;
+   SimpleVector <void (Layout::*) ()> *idleQueue;
+
+public:
+   TestPlatform ()
+   { layout = NULL; idleQueue = new SimpleVector <void (Layout::*) ()> (4); }
+   ~TestPlatform () { delete idleQueue; }
+
+   /** Process the idle functions (resizing), as the FLTK main loop would. */
+   void runIdle ()
+   {
+      while (idleQueue->size () > 0) {
+         void (Layout::*func) () = *idleQueue->getRef (0);
+         for (int i = 1; i < idleQueue->size (); i++)
+            idleQueue->set (i - 1, *idleQueue->getRef (i));
+         idleQueue->setSize (idleQueue->size () - 1);
+         (layout->*func) ();
+      }
+   }
+
+   void setLayout (Layout *layout) { this->layout = layout; }
+   void attachView (View *view) { }
+   void detachView (View *view) { }
+
+   int textWidth (Font *font, const char *text, int len)
+   { return len * font->size / 2; }
+   char *textToUpper (const char *text, int len)
+   {
+      char *s = strndup (text, len);
+      for (int i = 0; i < len; i++)
+         s[i] = toupper ((unsigned char) s[i]);
+      return s;
+   }
+   char *textToLower (const char *text, int len)
+   {
+      char *s = strndup (text, len);
+      for (int i = 0; i < len; i++)
+         s[i] = tolower ((unsigned char) s[i]);
+      return s;
+   }
+   int nextGlyph (const char *text, int idx)
+   { return lout::unicode::nextUtf8Char (text + idx) - text; }
+   int prevGlyph (const char *text, int idx)
+   {
+      do
+         idx--;
+      while (idx > 0 && (text[idx] & 0xc0) == 0x80);
+      return idx;
+   }
+   float dpiX () { return 96; }
+   float dpiY () { return 96; }
+
+   // Only resizing is queued here, which may be done in any order.
+   int addIdle (void (Layout::*func) ())
+   { idleQueue->increase (); idleQueue->set (idleQueue->size () - 1, func);
+     return idleQueue->size (); }
+   void removeIdle (int idleId) { }
+
+   Font *createFont (FontAttrs *attrs, bool tryEverything)
+   { return new TestFont (attrs); }
+   bool fontExists (const char *name) { return true; }
+   Color *createColor (int color) { return new TestColor (color); }
+   Tooltip *createTooltip (const char *text)
+   { return new TestTooltip (text); }
+   void cancelTooltip () { }
+   Imgbuf *createImgbuf (Imgbuf::Type type, int width, int height,
+                         double gamma) { return NULL; }
+   void copySelection (const char *text) { }
+   ui::ResourceFactory *getResourceFactory () { return NULL; }
+};
+
+class TestView: public View
+{
+public:
+   void setLayout (Layout *layout) { }
+   void setCanvasSize (int width, int ascent, int descent) { }
+   void setCursor (Cursor cursor) { }
+   void setBgColor (Color *color) { }
+
+   bool usesViewport () { return true; }
+   int getHScrollbarThickness () { return 0; }
+   int getVScrollbarThickness () { return 0; }
+   void scrollTo (int x, int y) { }
+   void setViewportSize (int width, int height,
+                         int hScrollbarThickness, int vScrollbarThickness) { }
+
+   void startDrawing (Rectangle *area) { }
+   void finishDrawing (Rectangle *area) { }
+   void queueDraw (Rectangle *area) { }
+   void queueDrawTotal () { }
+   void cancelQueueDraw () { }
+
+   void drawPoint (Color *color, Color::Shading shading, int x, int y) { }
+   void drawLine (Color *color, Color::Shading shading,
+                  int x1, int y1, int x2, int y2) { }
+   void drawTypedLine (Color *color, Color::Shading shading,
+                       LineType type, int width, int x1, int y1, int x2,
+                       int y2) { }
+   void drawRectangle (Color *color, Color::Shading shading, bool filled,
+                       int x, int y, int width, int height) { }
+   void drawArc (Color *color, Color::Shading shading, bool filled,
+                 int centerX, int centerY, int width, int height,
+                 int angle1, int angle2) { }
+   void drawPolygon (Color *color, Color::Shading shading, bool filled,
+                     bool convex, Point *points, int npoints) { }
+   void drawText (Font *font, Color *color, Color::Shading shading,
+                  int x, int y, const char *text, int len) { }
+   void drawSimpleWrappedText (Font *font, Color *color,
+                               Color::Shading shading, int x, int y,
+                               int w, int h, const char *text) { }
+   void drawImage (Imgbuf *imgbuf, int xRoot, int yRoot,
+                   int x, int y, int width, int height) { }
+
+   View *getClippingView (int x, int y, int width, int height)
+   { return this; }
+   void mergeClippingView (View *clippingView) { }
+};
+
+static int failures = 0;
+
+static void check (Layout *layout, const char *key, bool caseSens,
+                   bool backwards, FindtextState::Result expResult,
+                   int expNum, int expCurrent)
+{
+   static const char *const names[] = { "SUCCESS", "RESTART", "NOT_FOUND" };
+   FindtextState::Result result = layout->search (key, caseSens, backwards);
+   int num = layout->getNumSearchMatches ();
+   int current = layout->getCurrentSearchMatch ();
+   bool ok = result == expResult && num == expNum && current == expCurrent;
+
+   printf ("%s: \"%s\"%s%s => %s, %d of %d", ok ? "ok" : "FAILED", key,
+           caseSens ? " (case sensitive)" : "", backwards ? " (backwards)" : "",
+           names[result], current, num);
+   if (!ok) {
+      printf (" (expected %s, %d of %d)", names[expResult], expCurrent, expNum);
+      failures++;
+   }
+   printf ("\n");
+}
+
+static void addWords (Textblock *textblock, Style *style, const char *text)
+{
+   char *copy = strdup (text);
+   for (char *word = strtok (copy, " "); word; word = strtok (NULL, " ")) {
+      textblock->addText (word, style);
+      textblock->addSpace (style);
+   }
+   free (copy);
+   textblock->flush ();
+}
+
+int main (int argc, char **argv)
+{
+   TestPlatform *platform = new TestPlatform ();
+   Layout *layout = new Layout (platform);
+   TestView *view = new TestView ();
+   layout->attachView (view);
+
+   FontAttrs fontAttrs;
+   fontAttrs.name = "Test";
+   fontAttrs.size = 14;
+   fontAttrs.weight = 400;
+   fontAttrs.style = FONT_STYLE_NORMAL;
+   fontAttrs.letterSpacing = 0;
+   fontAttrs.fontVariant = FONT_VARIANT_NORMAL;
+
+   StyleAttrs styleAttrs;
+   styleAttrs.initValues ();
+   styleAttrs.font = Font::create (layout, &fontAttrs);
+   styleAttrs.color = Color::create (layout, 0x000000);
+   Style *style = Style::create (&styleAttrs);
+
+   Textblock *textblock = new Textblock (false);
+   textblock->setStyle (style);
+   layout->setWidget (textblock);
+
+   addWords (textblock, style, "The early bird catches the worm, but the "
+             "second mouse gets the cheese. Worms: WORM wormworm.");
+   layout->viewportSizeChanged (view, 300, 200);
+   platform->runIdle ();
+
+   check (layout, "zebra", false, false, FindtextState::NOT_FOUND, 0, 0);
+   check (layout, "worm", false, false, FindtextState::SUCCESS, 5, 1);
+   check (layout, "worm", false, false, FindtextState::SUCCESS, 5, 2);
+   check (layout, "worm", false, true, FindtextState::SUCCESS, 5, 1);
+   check (layout, "worm", false, true, FindtextState::RESTART, 5, 5);
+   check (layout, "worm", true, false, FindtextState::SUCCESS, 3, 1);
+   check (layout, "WORM", true, false, FindtextState::SUCCESS, 1, 1);
+   check (layout, "WORM", true, false, FindtextState::RESTART, 1, 1);
+   // Overlapping matches, and a key spanning several words.
+   check (layout, "ormwo", false, false, FindtextState::SUCCESS, 1, 1);
+   check (layout, "the worm, but", false, false, FindtextState::SUCCESS, 1, 1);
+   check (layout, "the  worm", false, false, FindtextState::NOT_FOUND, 0, 0);
+
+   // Text added without a new layout (as while a page is being parsed)
+   // must be found by the next search.
+   addWords (textblock, style, "A late worm.");
+   check (layout, "worm", false, false, FindtextState::SUCCESS, 6, 1);
+   check (layout, "late", false, false, FindtextState::SUCCESS, 1, 1);
+   platform->runIdle ();
+   check (layout, "worm", false, true, FindtextState::SUCCESS, 6, 6);
+
+   layout->resetSearch ();
+   if (layout->getNumSearchMatches () != 0) {
+      printf ("FAILED: matches after resetSearch\n");
+      failures++;
+   }
+
+   style->unref ();
+   delete layout;
+
+   if (failures)
+      printf ("%d FAILED\n", failures);
+   return failures ? 1 : 0;
+}
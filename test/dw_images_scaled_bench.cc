@@ -0,0 +1,111 @@
+/*
+ * Dillo Widget
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Times the scaling of image buffers, as done when a large photo is
+ * shown as a thumbnail (see dw_images_scaled.cc for the visual test).
+ * No window is opened.
+ *
+ * Usage: dw-images-scaled-bench [width height scaledWidth scaledHeight
+ *                                [iterations]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "../dw/core.hh"
+#include "../dw/fltkcore.hh"
+
+using namespace dw::core;
+using namespace dw::fltk;
+
+static double now ()
+{
+   struct timeval tv;
+   gettimeofday (&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/*
+ * Fill a root buffer row by row, with one scaled buffer attached, as
+ * the dicache does while an image arrives.
+ */
+static double bench (Layout *layout, Imgbuf::Type type, int bpp,
+                     int width, int height, int sWidth, int sHeight,
+                     int iterations)
+{
+   unsigned char *row = new unsigned char[width * bpp];
+   double start = now ();
+
+   for (int it = 0; it < iterations; it++) {
+      Imgbuf *rootbuf = layout->createImgbuf (type, width, height, 2.2);
+      Imgbuf *scaledbuf = rootbuf->getScaledBuf (sWidth, sHeight);
+
+      for (int y = 0; y < height; y++) {
+         for (int x = 0; x < width * bpp; x++)
+            row[x] = (x * 7 + y * 13 + it) & 0xff;
+         rootbuf->copyRow (y, row);
+      }
+
+      scaledbuf->unref ();
+      rootbuf->unref ();
+   }
+
+   delete[] row;
+   return (now () - start) / iterations;
+}
+
+int main(int argc, char **argv)
+{
+   int width = 3000, height = 2000, sWidth = 300, sHeight = 200;
+   int iterations = 5;
+
+   if (argc >= 5) {
+      width = atoi (argv[1]);
+      height = atoi (argv[2]);
+      sWidth = atoi (argv[3]);
+      sHeight = atoi (argv[4]);
+   }
+   if (argc >= 6)
+      iterations = atoi (argv[5]);
+   if (width <= 0 || height <= 0 || sWidth <= 0 || sHeight <= 0 ||
+       iterations <= 0) {
+      fprintf (stderr, "usage: %s [width height scaledWidth scaledHeight "
+               "[iterations]]\n", argv[0]);
+      return 1;
+   }
+
+   FltkPlatform *platform = new FltkPlatform ();
+   Layout *layout = new Layout (platform);
+
+   printf ("%d x %d -> %d x %d, %d iterations\n",
+           width, height, sWidth, sHeight, iterations);
+   printf ("RGB:  %8.2f ms/image\n",
+           1000 * bench (layout, Imgbuf::RGB, 3, width, height,
+                         sWidth, sHeight, iterations));
+   printf ("RGBA: %8.2f ms/image\n",
+           1000 * bench (layout, Imgbuf::RGBA, 4, width, height,
+                         sWidth, sHeight, iterations));
+   printf ("Up:   %8.2f ms/image\n",
+           1000 * bench (layout, Imgbuf::RGB, 3, sWidth, sHeight,
+                         width, height, iterations));
+
+   delete layout;
+
+   return 0;
+}
@@ -0,0 +1,699 @@
+/*
+ * Dillo Widget
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Times the rendering of HTML files (by default, the samples in this
+ * directory) through the same code as dillo: html.cc parses the page and
+ * builds the widgets, the StyleEngine computes their styles from the CSS,
+ * and dw lays them out and draws them. Nothing is shown, and FLTK is not
+ * used: a platform with fixed font metrics and a view which only counts
+ * the drawing operations stand in for dw::fltk, so that the layout (and so
+ * the numbers) do not depend on the fonts installed.
+ *
+ * The hooks into the rest of dillo (a_Bw_*, a_Capi_*, a_UIcmd_*, ...) are
+ * stubs below. Nothing is fetched, so images and external style sheets
+ * are left out. There are no form widgets without FLTK, so pages with
+ * form controls can't be rendered.
+ *
+ * The output has one line per measurement, separated by tabs:
+ *
+ *    file  stage  width  milliseconds  [key=value]
+ *
+ * where "stage" is one of
+ *
+ *    parse   html.cc, without the time spent in the StyleEngine;
+ *    style   the StyleEngine: parsing the style sheets and computing the
+ *            styles. This is done while parsing, so it is taken from the
+ *            "style" trace spans (this program is built with DBG_TRACE);
+ *    layout  laying the page out at the given viewport width;
+ *    draw    drawing the whole page, one viewport at a time as when
+ *            scrolling;
+ *    hit     moving the pointer over the page, one point every 20 pixels
+ *            (this finds the widget under the pointer).
+ *
+ * The time is the minimum over all iterations. The canvas height (after
+ * layout), the number of drawing operations and the number of points are
+ * printed as well; as they do not depend on the machine, changes in them
+ * point to changes in behaviour rather than in speed.
+ *
+ * Usage: dw-render-bench [-i iterations] [-w width,width,...] [file ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/time.h>
+
+#include "../lout/misc.hh"
+#include "../lout/unicode.hh"
+#include "../lout/container.hh"
+#include "../lout/trace.h"
+#include "../dw/core.hh"
+#include "../src/prefs.h"
+#include "../src/html_common.hh"
+#include "../src/styleengine.hh"
+#include "../src/capi.h"
+#include "../src/uicmd.hh"
+#include "../src/dialog.hh"
+#include "../src/history.h"
+#include "../src/hsts.h"
+#include "../src/utf8.hh"
+
+using namespace lout::misc;
+using namespace lout::container::typed;
+using namespace dw;
+using namespace dw::core;
+using namespace dw::core::style;
+
+static const char *defaultFiles[] = {
+   "Anna_Karenina_1.html", "KHM1.html", "KHM1-shy.html", "anchors.html",
+   "floats1.html", "floats-table.html", "floats4.html", "floats-many.html",
+   "hyphens-etc.html", "lang.html", "table-1.html", "table-h1.html",
+   "table-narrow.html", "table-thead-tfoot.html", "table-fixed.html",
+   "white-space.html", NULL
+};
+
+static const int viewportHeight = 600, hitStep = 20;
+
+static double now ()
+{
+   struct timeval tv;
+   gettimeofday (&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// ----------------------------------------------------------------------
+//    Platform with fixed metrics
+// ----------------------------------------------------------------------
+
+class BenchFont: public Font
+{
+   static HashTable <FontAttrs, BenchFont> *fontsTable;
+
+   BenchFont (FontAttrs *attrs);
+   ~BenchFont ();
+
+public:
+   int charWidth;
+
+   static BenchFont *create (FontAttrs *attrs);
+};
+
+HashTable <FontAttrs, BenchFont> *BenchFont::fontsTable =
+   new HashTable <FontAttrs, BenchFont> (false, false);
+
+BenchFont::BenchFont (FontAttrs *attrs)
+{
+   copyAttrs (attrs);
+   charWidth = max ((size * (weight >= 500 ? 6 : 5) + 5) / 10, 1);
+   ascent = (size * 8 + 5) / 10;
+   descent = size - ascent;
+   spaceWidth = max (size / 4, 1) + letterSpacing;
+   xHeight = size / 2;
+}
+
+BenchFont::~BenchFont ()
+{
+   fontsTable->remove (this);
+}
+
+BenchFont *BenchFont::create (FontAttrs *attrs)
+{
+   BenchFont *font = fontsTable->get (attrs);
+
+   if (font == NULL) {
+      font = new BenchFont (attrs);
+      fontsTable->put (font, font);
+   }
+   return font;
+}
+
+class BenchColor: public Color
+{
+public:
+   BenchColor (int color): Color (color) { }
+};
+
+class BenchTooltip: public Tooltip
+{
+public:
+   BenchTooltip (const char *text): Tooltip (text) { }
+};
+
+class BenchPlatform: public Platform
+{
+   struct IdleFunc {
+      int id;
+      void (Layout::*func) ();
+   };
+
+   Layout *layout;
+   SimpleVector <IdleFunc> *idleQueue;
+   int idleFuncId;
+
+public:
+   BenchPlatform ();
+   ~BenchPlatform ();
+
+   void runIdle ();
+
+   void setLayout (Layout *layout) { this->layout = layout; }
+   void attachView (View *view) { }
+   void detachView (View *view) { }
+
+   int textWidth (Font *font, const char *text, int len);
+   char *textToUpper (const char *text, int len);
+   char *textToLower (const char *text, int len);
+   int nextGlyph (const char *text, int idx);
+   int prevGlyph (const char *text, int idx);
+   float dpiX () { return 96; }
+   float dpiY () { return 96; }
+
+   int addIdle (void (Layout::*func) ());
+   void removeIdle (int idleId);
+
+   Font *createFont (FontAttrs *attrs, bool tryEverything)
+   { return BenchFont::create (attrs); }
+   bool fontExists (const char *name) { return true; }
+   Color *createColor (int color) { return new BenchColor (color); }
+   Tooltip *createTooltip (const char *text)
+   { return new BenchTooltip (text); }
+   void cancelTooltip () { }
+   Imgbuf *createImgbuf (Imgbuf::Type type, int width, int height,
+                         double gamma) { return NULL; }
+   void copySelection (const char *text) { }
+   ui::ResourceFactory *getResourceFactory () { return NULL; }
+};
+
+BenchPlatform::BenchPlatform ()
+{
+   layout = NULL;
+   idleQueue = new SimpleVector <IdleFunc> (4);
+   idleFuncId = 0;
+}
+
+BenchPlatform::~BenchPlatform ()
+{
+   delete idleQueue;
+}
+
+/**
+ * Process the idle functions (resizing, scrolling) until none are left,
+ * as the FLTK main loop would do.
+ */
+void BenchPlatform::runIdle ()
+{
+   while (idleQueue->size () > 0) {
+      IdleFunc idleFunc = *idleQueue->getRef (0);
+      for (int i = 1; i < idleQueue->size (); i++)
+         idleQueue->set (i - 1, *idleQueue->getRef (i));
+      idleQueue->setSize (idleQueue->size () - 1);
+      (layout->*(idleFunc.func)) ();
+   }
+}
+
+int BenchPlatform::textWidth (Font *font, const char *text, int len)
+{
+   BenchFont *bf = (BenchFont*) font;
+   int n = 0;
+
+   // One glyph per character; continuation bytes are not counted.
+   for (int i = 0; i < len; i++)
+      if ((text[i] & 0xc0) != 0x80)
+         n++;
+   return n * (bf->charWidth + font->letterSpacing);
+}
+
+char *BenchPlatform::textToUpper (const char *text, int len)
+{
+   char *s = (char*) malloc (len + 1);
+   for (int i = 0; i < len; i++)
+      s[i] = toupper ((unsigned char) text[i]);
+   s[len] = '\0';
+   return s;
+}
+
+char *BenchPlatform::textToLower (const char *text, int len)
+{
+   char *s = (char*) malloc (len + 1);
+   for (int i = 0; i < len; i++)
+      s[i] = tolower ((unsigned char) text[i]);
+   s[len] = '\0';
+   return s;
+}
+
+int BenchPlatform::nextGlyph (const char *text, int idx)
+{
+   return lout::unicode::nextUtf8Char (text + idx) - text;
+}
+
+int BenchPlatform::prevGlyph (const char *text, int idx)
+{
+   do
+      idx--;
+   while (idx > 0 && (text[idx] & 0xc0) == 0x80);
+   return idx;
+}
+
+int BenchPlatform::addIdle (void (Layout::*func) ())
+{
+   idleQueue->increase ();
+   idleQueue->getLastRef()->id = ++idleFuncId;
+   idleQueue->getLastRef()->func = func;
+   return idleFuncId;
+}
+
+void BenchPlatform::removeIdle (int idleId)
+{
+   for (int i = 0; i < idleQueue->size (); i++)
+      if (idleQueue->getRef(i)->id == idleId) {
+         for (int j = i + 1; j < idleQueue->size (); j++)
+            idleQueue->set (j - 1, *idleQueue->getRef (j));
+         idleQueue->setSize (idleQueue->size () - 1);
+         break;
+      }
+}
+
+// ----------------------------------------------------------------------
+//    View which only counts
+// ----------------------------------------------------------------------
+
+class BenchView: public View
+{
+public:
+   int canvasWidth, canvasHeight, numOps;
+
+   BenchView () { canvasWidth = canvasHeight = numOps = 0; }
+
+   void setLayout (Layout *layout) { }
+   void setCanvasSize (int width, int ascent, int descent)
+   { canvasWidth = width; canvasHeight = ascent + descent; }
+   void setCursor (Cursor cursor) { }
+   void setBgColor (Color *color) { }
+
+   bool usesViewport () { return true; }
+   int getHScrollbarThickness () { return 0; }
+   int getVScrollbarThickness () { return 0; }
+   void scrollTo (int x, int y) { }
+   void setViewportSize (int width, int height,
+                         int hScrollbarThickness, int vScrollbarThickness) { }
+
+   void startDrawing (Rectangle *area) { }
+   void finishDrawing (Rectangle *area) { }
+   void queueDraw (Rectangle *area) { }
+   void queueDrawTotal () { }
+   void cancelQueueDraw () { }
+
+   void drawPoint (Color *color, Color::Shading shading, int x, int y)
+   { numOps++; }
+   void drawLine (Color *color, Color::Shading shading,
+                  int x1, int y1, int x2, int y2)
+   { numOps++; }
+   void drawTypedLine (Color *color, Color::Shading shading,
+                       LineType type, int width, int x1, int y1, int x2, int y2)
+   { numOps++; }
+   void drawRectangle (Color *color, Color::Shading shading, bool filled,
+                       int x, int y, int width, int height)
+   { numOps++; }
+   void drawArc (Color *color, Color::Shading shading, bool filled,
+                 int centerX, int centerY, int width, int height,
+                 int angle1, int angle2)
+   { numOps++; }
+   void drawPolygon (Color *color, Color::Shading shading, bool filled,
+                     bool convex, Point *points, int npoints)
+   { numOps++; }
+   void drawText (Font *font, Color *color, Color::Shading shading,
+                  int x, int y, const char *text, int len)
+   { numOps++; }
+   void drawSimpleWrappedText (Font *font, Color *color,
+                               Color::Shading shading,
+                               int x, int y, int w, int h, const char *text)
+   { numOps++; }
+   void drawImage (Imgbuf *imgbuf, int xRoot, int yRoot,
+                   int x, int y, int width, int height)
+   { numOps++; }
+
+   View *getClippingView (int x, int y, int width, int height)
+   { return this; }
+   void mergeClippingView (View *clippingView) { }
+};
+
+// ----------------------------------------------------------------------
+//    The rest of dillo
+// ----------------------------------------------------------------------
+
+/*
+ * Nothing is loaded: a request fails at once, as a_Capi_open_url() does
+ * when it can't be served, and so it frees the DilloWeb.
+ */
+DilloWeb *a_Web_new (BrowserWindow *bw, const DilloUrl *url,
+                     const DilloUrl *requester)
+{
+   DilloWeb *web = dNew0 (DilloWeb, 1);
+   web->bw = bw;
+   return web;
+}
+
+int a_Capi_open_url (DilloWeb *web, CA_Callback_t Call, void *CbData)
+{
+   if (web->Image)
+      a_Image_unref (web->Image);
+   dFree (web);
+   return 0;
+}
+
+int a_Capi_get_buf (const DilloUrl *Url, char **PBuf, int *BufSize)
+{
+   *PBuf = NULL;
+   *BufSize = 0;
+   return 0;
+}
+
+void a_Capi_unref_buf (const DilloUrl *Url) { }
+const char *a_Capi_set_content_type (const DilloUrl *url, const char *ctype,
+                                     const char *from) { return ctype; }
+int a_Capi_get_flags_with_redirection (const DilloUrl *Url) { return 0; }
+int a_Capi_dpi_verify_request (BrowserWindow *bw, DilloUrl *url) { return 0; }
+void a_Capi_stop_client (int Key, int force) { }
+
+void a_Bw_add_client (BrowserWindow *bw, int Key, int Root) { }
+void a_Bw_close_client (BrowserWindow *bw, int ClientKey) { }
+void a_Bw_add_doc (BrowserWindow *bw, void *vdoc) { }
+void a_Bw_remove_doc (BrowserWindow *bw, void *vdoc) { }
+void a_Bw_add_url (BrowserWindow *bw, const DilloUrl *Url) { }
+bool_t a_Bw_expecting (BrowserWindow *bw) { return FALSE; }
+
+void a_UIcmd_open_url (BrowserWindow *bw, const DilloUrl *url) { }
+void a_UIcmd_open_url_nw (BrowserWindow *bw, const DilloUrl *url) { }
+void a_UIcmd_open_url_nt (void *vbw, const DilloUrl *url, int focus) { }
+void a_UIcmd_repush (void *vbw) { }
+void a_UIcmd_redirection0 (void *vbw, const DilloUrl *url) { }
+const char *a_UIcmd_select_file () { return NULL; }
+void a_UIcmd_page_popup (void *vbw, bool_t has_bugs, void *v_cssUrls) { }
+void a_UIcmd_link_popup (void *vbw, const DilloUrl *url) { }
+void a_UIcmd_image_popup (void *vbw, const DilloUrl *url, bool_t loaded_img,
+                          DilloUrl *page_url, DilloUrl *link_url) { }
+void a_UIcmd_form_popup (void *vbw, const DilloUrl *url, void *vform,
+                         bool_t showing_hiddens) { }
+void a_UIcmd_set_bug_prog (BrowserWindow *bw, int n_bug) { }
+void a_UIcmd_set_page_title (BrowserWindow *bw, const char *label) { }
+void a_UIcmd_set_msg (BrowserWindow *bw, const char *format, ...) { }
+
+int a_Dialog_choice (const char *title, const char *msg, ...) { return 0; }
+void a_History_set_title_by_url (const DilloUrl *url, const char *title) { }
+bool_t a_Hsts_require_https (const char *host) { return FALSE; }
+
+/*
+ * The parts of src/utf8.cc which do not need FLTK, and lout::unicode
+ * instead of the parts which do.
+ */
+uint_t a_Utf8_end_of_char (const char *str, uint_t i)
+{
+   if (str && *str && (str[i] & 0x80)) {
+      int internal_bytes = (str[i] & 0x40) ? 0 : 1;
+
+      while (((str[i + 1] & 0xc0) == 0x80) && (++internal_bytes < 4))
+         i++;
+   }
+   return i;
+}
+
+uint_t a_Utf8_decode (const char *str, const char *end, int *len)
+{
+   int c = lout::unicode::decodeUtf8 (str, end - str);
+
+   if (c < 0) {
+      // Not UTF-8; taken as ISO-8859-1, like fl_utf8decode() does.
+      *len = 1;
+      return (unsigned char) *str;
+   }
+   // nextUtf8Char() returns NULL for the last character, so do not use it.
+   *len = 1 + (int)a_Utf8_end_of_char (str, 0);
+   return c;
+}
+
+int a_Utf8_encode (unsigned int ucs, char *buf)
+{
+   if (ucs < 0x80) {
+      buf[0] = ucs;
+      return 1;
+   } else if (ucs < 0x800) {
+      buf[0] = 0xc0 | (ucs >> 6);
+      buf[1] = 0x80 | (ucs & 0x3f);
+      return 2;
+   } else if (ucs < 0x10000) {
+      buf[0] = 0xe0 | (ucs >> 12);
+      buf[1] = 0x80 | ((ucs >> 6) & 0x3f);
+      buf[2] = 0x80 | (ucs & 0x3f);
+      return 3;
+   } else {
+      buf[0] = 0xf0 | (ucs >> 18);
+      buf[1] = 0x80 | ((ucs >> 12) & 0x3f);
+      buf[2] = 0x80 | ((ucs >> 6) & 0x3f);
+      buf[3] = 0x80 | (ucs & 0x3f);
+      return 4;
+   }
+}
+
+int a_Utf8_test (const char *src, unsigned int srclen)
+{
+   int ret = 1;
+
+   for (unsigned int i = 0; i < srclen; ) {
+      unsigned char c = src[i];
+      int n = c < 0x80 ? 1 : c < 0xc2 ? 0 : c < 0xe0 ? 2 : c < 0xf0 ? 3 :
+              c < 0xf5 ? 4 : 0;
+
+      if (n == 0 || i + n > srclen)
+         return 0;
+      for (int j = 1; j < n; j++)
+         if ((src[i + j] & 0xc0) != 0x80)
+            return 0;
+      ret = max (ret, n);
+      i += n;
+   }
+   return ret;
+}
+
+bool_t a_Utf8_ideographic (const char *s, const char *end, int *len)
+{
+   bool_t ret = FALSE;
+
+   if ((uchar_t)*s >= 0xe2) {
+      unsigned unicode = a_Utf8_decode (s, end, len);
+
+      if (unicode >= 0x2e80 &&
+           ((unicode <= 0xa4cf) ||
+            (unicode >= 0xf900 && unicode <= 0xfaff) ||
+            (unicode >= 0xff00 && unicode <= 0xff9f))) {
+         ret = TRUE;
+     }
+   } else {
+      *len = 1 + (int)a_Utf8_end_of_char (s, 0);
+   }
+   return ret;
+}
+
+bool_t a_Utf8_combining_char (int unicode)
+{
+   return ((unicode >= 0x0300 && unicode <= 0x036f) ||
+           (unicode >= 0x1dc0 && unicode <= 0x1dff) ||
+           (unicode >= 0x20d0 && unicode <= 0x20ff) ||
+           (unicode >= 0xfe20 && unicode <= 0xfe2f));
+}
+
+// ----------------------------------------------------------------------
+//    Benchmark
+// ----------------------------------------------------------------------
+
+static char *readFile (const char *filename)
+{
+   FILE *file = fopen (filename, "r");
+   char *buf = NULL;
+   size_t size = 0, len = 0, n;
+
+   if (file == NULL)
+      return NULL;
+   do {
+      size = size * 2 + 4096;
+      buf = (char*) realloc (buf, size);
+      n = fread (buf + len, 1, size - len - 1, file);
+      len += n;
+   } while (len == size - 1);
+   buf[len] = '\0';
+   fclose (file);
+   return buf;
+}
+
+static void report (const char *filename, const char *stage, int width,
+                    double seconds, const char *key, int value)
+{
+   printf ("%s\t%s\t%d\t%.3f", filename, stage, width, seconds * 1000);
+   if (key)
+      printf ("\t%s=%d", key, value);
+   printf ("\n");
+}
+
+static bool bench (const char *filename, int iterations,
+                   SimpleVector <int> *widths)
+{
+   char *html = readFile (filename);
+   if (html == NULL) {
+      perror (filename);
+      return false;
+   }
+
+   char *urlStr = dStrconcat ("file:", filename, NULL);
+   DilloUrl *url = a_Url_new (urlStr, NULL);
+   BrowserWindow *bw = dNew0 (BrowserWindow, 1);
+   bw->page_bugs = dStr_new ("");
+
+   double parseTime = 1e9, styleTime = 1e9;
+   double *layoutTime = new double[widths->size ()];
+   double *drawTime = new double[widths->size ()];
+   double *hitTime = new double[widths->size ()];
+   int *heights = new int[widths->size ()], *ops = new int[widths->size ()];
+   int *points = new int[widths->size ()];
+
+   for (int w = 0; w < widths->size (); w++)
+      layoutTime[w] = drawTime[w] = hitTime[w] = 1e9;
+
+   for (int it = 0; it < iterations; it++) {
+      BenchPlatform *platform = new BenchPlatform ();
+      BenchView *view = new BenchView ();
+      Layout *layout = new Layout (platform);
+      layout->attachView (view);
+      bw->render_layout = layout;
+
+      // As a_Html_text() and Html_callback() do, with the whole page
+      // at once.
+      a_Trace_set_enabled (1);
+      double start = now ();
+      DilloHtml *doc = new DilloHtml (bw, url, "text/html");
+      layout->setWidget ((Widget*) doc->dw);
+      doc->write (html, strlen (html), 1);
+      doc->finishParsing (0);
+      double total = now () - start;
+      double style = a_Trace_total ("style") / 1e6;
+      a_Trace_set_enabled (0);
+      parseTime = min (parseTime, total - style);
+      styleTime = min (styleTime, style);
+
+      for (int w = 0; w < widths->size (); w++) {
+         start = now ();
+         layout->viewportSizeChanged (view, widths->get (w), viewportHeight);
+         platform->runIdle ();
+         layoutTime[w] = min (layoutTime[w], now () - start);
+         heights[w] = view->canvasHeight;
+
+         view->numOps = 0;
+         start = now ();
+         for (int y = 0; y < view->canvasHeight; y += viewportHeight) {
+            Rectangle area (0, y, view->canvasWidth, viewportHeight);
+            layout->expose (view, &area);
+         }
+         drawTime[w] = min (drawTime[w], now () - start);
+         ops[w] = view->numOps;
+
+         points[w] = 0;
+         start = now ();
+         for (int y = 0; y < view->canvasHeight; y += hitStep)
+            for (int x = 0; x < view->canvasWidth; x += hitStep) {
+               layout->motionNotify (view, x, y, (ButtonState) 0);
+               points[w]++;
+            }
+         layout->leaveNotify (view, (ButtonState) 0);
+         hitTime[w] = min (hitTime[w], now () - start);
+      }
+
+      // Deleting the widgets deletes the DilloHtml too.
+      delete layout;
+   }
+
+   report (filename, "parse", 0, parseTime, NULL, 0);
+   report (filename, "style", 0, styleTime, NULL, 0);
+   for (int w = 0; w < widths->size (); w++) {
+      report (filename, "layout", widths->get (w), layoutTime[w],
+              "height", heights[w]);
+      report (filename, "draw", widths->get (w), drawTime[w],
+              "ops", ops[w]);
+      report (filename, "hit", widths->get (w), hitTime[w],
+              "points", points[w]);
+   }
+
+   delete[] layoutTime;
+   delete[] drawTime;
+   delete[] hitTime;
+   delete[] heights;
+   delete[] ops;
+   delete[] points;
+   dStr_free (bw->page_bugs, 1);
+   dFree (bw);
+   a_Url_free (url);
+   dFree (urlStr);
+   free (html);
+   return true;
+}
+
+int main(int argc, char **argv)
+{
+   int iterations = 20, i;
+   SimpleVector <int> widths (4);
+   const char *widthsStr = "320,800,1280";
+   bool ok = true;
+
+   for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+      if (strcmp (argv[i], "-i") == 0 && i + 1 < argc)
+         iterations = atoi (argv[++i]);
+      else if (strcmp (argv[i], "-w") == 0 && i + 1 < argc)
+         widthsStr = argv[++i];
+      else
+         iterations = 0;
+   }
+
+   for (const char *p = widthsStr; *p; p++) {
+      widths.increase ();
+      widths.set (widths.size () - 1, atoi (p));
+      if (widths.get (widths.size () - 1) <= 0)
+         iterations = 0;
+      p += strcspn (p, ",");
+      if (!*p)
+         break;
+   }
+
+   if (iterations <= 0) {
+      fprintf (stderr, "usage: %s [-i iterations] [-w width,width,...] "
+               "[file ...]\n", argv[0]);
+      return 1;
+   }
+
+   a_Prefs_init ();
+   prefs.show_msg = FALSE;
+   StyleEngine::init ();
+
+   printf ("# file\tstage\twidth\tms (minimum of %d)\n", iterations);
+   if (i < argc) {
+      for (; i < argc; i++)
+         ok = bench (argv[i], iterations, &widths) && ok;
+   } else {
+      for (int j = 0; defaultFiles[j]; j++)
+         ok = bench (defaultFiles[j], iterations, &widths) && ok;
+   }
+
+   return ok ? 0 : 1;
+}